@@ -1,5 +1,7 @@
 #include "App.hpp"
 #include <GLFW/glfw3.h>
+#include <vector>
+#include <chrono>
 
 using namespace std;
 
@@ -24,10 +26,44 @@ void AppBase::wm_cleanup() {
 	glfwTerminate();
 }
 
+void AppBase::readoptions() {
+	frameLimit = CommandLine::GetValue("frames", frameLimit);
+	warmupFrames = CommandLine::GetValue("warmup", warmupFrames);
+	drawsPerFrame = CommandLine::GetValue("draws", drawsPerFrame);
+}
+
+bool AppBase::running() {
+	if (frameLimit > 0 && framesRun >= frameLimit) {
+		return false;
+	}
+	return window == nullptr || !glfwWindowShouldClose(window);
+}
+
 void AppBase::mainloop()
 {
-	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+	using clock = std::chrono::steady_clock;
+	auto toMs = [](clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	};
+
+	auto frameStart = clock::now();
+	while (running()) {
+		pacehook();
+		if (window) {
+			glfwPollEvents();
+		}
+		auto tickStart = clock::now();
+		submitTimed = false;
 		tickhook();
+
+		// submit cost is the recording and submitting the backend marked, or the whole tick,
+		// frame time is the whole loop including pacing
+		auto now = clock::now();
+		if (framesRun >= warmupFrames) {
+			auto submitTime = submitTimed ? submitEnd - submitStart : now - tickStart;
+			timings.Add(toMs(now - frameStart), toMs(submitTime));
+		}
+		frameStart = now;
+		framesRun++;
 	}
 }
@@ -1,19 +1,28 @@
 #pragma once
 struct GLFWwindow;
+#include <chrono>
 #include <cstdint>
+#include "CommandLine.hpp"
+#include "FrameTimings.hpp"
 
 static uint32_t WIDTH = 800;
 static uint32_t HEIGHT = 600;
 
 struct AppBase {
 	void Run() {
-		wm_init();
+		readoptions();
+		if (!headless()) {
+			wm_init();
+		}
 		inithook();
 		mainloop();
 		cleanuphook();
-		wm_cleanup();
+		if (!headless()) {
+			wm_cleanup();
+		}
 	}
 
+	void readoptions();
 	void wm_init();
 	void wm_cleanup();
 	void mainloop();
@@ -22,14 +31,38 @@ struct AppBase {
 	virtual void inithook() = 0;
 	virtual void cleanuphook() = 0;
 	virtual void tickhook() = 0;
+	virtual void pacehook() {}		// runs before input is polled, to wait for the right time to start a frame
 	virtual void onresize(int newWidth, int newHeight) {}
 	virtual const char* getBackendName() = 0;
-	GLFWwindow* window;
+	virtual bool headless() const { return false; }		// runs without a window, or GLFW at all
+	bool running();										// the main loop continues while this is true
+	const FrameTimings& getTimings() const { return timings; }
+
+	// backends call these around recording and submitting a frame, so waiting for a frame slot or acquiring an
+	// image isn't counted as submit cost. A tick that doesn't call them is timed whole
+	void beginSubmitTiming() { submitStart = std::chrono::steady_clock::now(); }
+	void endSubmitTiming() { submitEnd = std::chrono::steady_clock::now(); submitTimed = true; }
+	GLFWwindow* window = nullptr;
+
+	// --frames=N stops after N frames, 0 runs until the window is closed.
+	// The first --warmup=N frames are left out of the timings
+	uint64_t frameLimit = 0;
+	uint64_t warmupFrames = 0;
+	uint64_t framesRun = 0;
+	// what the process exits with, backends set it nonzero in cleanuphook when the run failed a check
+	int exitCode = 0;
+	// --draws=N draws every backend's test mesh N times a frame, so --compare runs the same workload on each
+	uint32_t drawsPerFrame = 1;
+	FrameTimings timings;
+	std::chrono::steady_clock::time_point submitStart;
+	std::chrono::steady_clock::time_point submitEnd;
+	bool submitTimed = false;
 };
 
 struct VkApp : public AppBase {
 	void inithook() final;
 	void tickhook() final;
+	void pacehook() final;
 	void cleanuphook() final;
 	const char* getBackendName() final {
 		return "Vulkan";
@@ -54,3 +87,16 @@ struct MTLApp : public AppBase {
 		return "Metal";
 	}
 };
+
+// renders through the null RHI, to run without a GPU
+struct NullApp : public AppBase {
+	void inithook() final;
+	void tickhook() final;
+	void cleanuphook() final;
+	const char* getBackendName() final {
+		return "Null";
+	}
+	bool headless() const final {
+		return true;
+	}
+};
@@ -0,0 +1,891 @@
+#include "BlockCompression.hpp"
+#include "CommandLine.hpp"
+#include "CpuFeatures.hpp"
+#include "Ktx2.hpp"
+#include "MappedFile.hpp"
+#include "TextureCooker.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr uint32_t RowsPerJob = 4;          // rows of blocks encoded per job
+    // BC7's 4 bit interpolation weights, out of 64
+    constexpr uint32_t Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // a block's 16 pixels, a row of 16 per channel so 8 pixels fill a register
+    struct BlockPixels
+    {
+        alignas(32) float channels[4][16];
+    };
+
+    // the values a block's pixels can pick from
+    struct Palette
+    {
+        float entries[16][4];
+        uint32_t count;
+    };
+
+    using FindIndicesFunction = float (*)(const BlockPixels& pixels, uint32_t channelCount, const Palette& palette, uint8_t* indices);
+
+    // The nearest palette entry for each pixel over the first channelCount channels, lower indices winning ties.
+    // Returns the total squared error.
+    float FindIndicesScalar(const BlockPixels& pixels, uint32_t channelCount, const Palette& palette, uint8_t* indices)
+    {
+        float errors[16];
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            float best = std::numeric_limits<float>::max();
+            uint8_t bestIndex = 0;
+            for (uint32_t entry = 0; entry < palette.count; entry++)
+            {
+                float distance = 0.0f;
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    float difference = pixels.channels[channel][pixel] - palette.entries[entry][channel];
+                    distance = distance + difference * difference;
+                }
+                if (distance < best)
+                {
+                    best = distance;
+                    bestIndex = static_cast<uint8_t>(entry);
+                }
+            }
+            errors[pixel] = best;
+            indices[pixel] = bestIndex;
+        }
+        float total = 0.0f;
+        for (float error : errors)
+        {
+            total += error;
+        }
+        return total;
+    }
+
+#if AVX2_AVAILABLE
+    // the same as FindIndicesScalar, 8 pixels at a time
+    AVX2_FUNCTION float FindIndicesAvx2(const BlockPixels& pixels, uint32_t channelCount, const Palette& palette, uint8_t* indices)
+    {
+        alignas(32) float errors[16];
+        alignas(32) int32_t bestIndices[16];
+        for (uint32_t half = 0; half < 2; half++)
+        {
+            __m256 values[4];
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                values[channel] = _mm256_load_ps(&pixels.channels[channel][half * 8]);
+            }
+            __m256 best = _mm256_set1_ps(std::numeric_limits<float>::max());
+            __m256i bestIndex = _mm256_setzero_si256();
+            for (uint32_t entry = 0; entry < palette.count; entry++)
+            {
+                __m256 distance = _mm256_setzero_ps();
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    __m256 difference = _mm256_sub_ps(values[channel], _mm256_set1_ps(palette.entries[entry][channel]));
+                    distance = _mm256_add_ps(distance, _mm256_mul_ps(difference, difference));
+                }
+                __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+                best = _mm256_blendv_ps(best, distance, closer);
+                bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(static_cast<int32_t>(entry)), _mm256_castps_si256(closer));
+            }
+            _mm256_store_ps(&errors[half * 8], best);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(&bestIndices[half * 8]), bestIndex);
+        }
+        float total = 0.0f;
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            total += errors[pixel];
+            indices[pixel] = static_cast<uint8_t>(bestIndices[pixel]);
+        }
+        return total;
+    }
+#endif
+
+    void LoadBlock(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockPixels& pixels)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            uint32_t row = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t column = std::min(blockX * 4 + x, width - 1);
+                const uint8_t* pixel = &rgba[(size_t(row) * width + column) * 4];
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    pixels.channels[channel][y * 4 + x] = pixel[channel];
+                }
+            }
+        }
+    }
+
+    // Endpoints at either end of the line through the pixels' mean along their principal axis, found by power
+    // iteration on the covariance matrix, pulled in by inset of the range since the extremes are rarely worth it.
+    void FitEndpoints(const BlockPixels& pixels, uint32_t channelCount, float inset, float (&first)[4], float (&second)[4])
+    {
+        float mean[4] = {};
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                mean[channel] += pixels.channels[channel][pixel];
+            }
+            mean[channel] /= 16.0f;
+        }
+        float covariance[4][4] = {};
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                for (uint32_t j = 0; j < channelCount; j++)
+                {
+                    covariance[i][j] += (pixels.channels[i][pixel] - mean[i]) * (pixels.channels[j][pixel] - mean[j]);
+                }
+            }
+        }
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                for (uint32_t j = 0; j < channelCount; j++)
+                {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+                largest = std::max(largest, std::abs(next[i]));
+            }
+            if (largest < 1e-6f)
+            {
+                break;      // a flat block, which any axis fits
+            }
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                axis[i] = next[i] / largest;
+            }
+        }
+
+        float lowest = std::numeric_limits<float>::max(), highest = std::numeric_limits<float>::lowest();
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            float t = 0.0f;
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                t += (pixels.channels[channel][pixel] - mean[channel]) * axis[channel];
+            }
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        float lengthSquared = 0.0f;
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            lengthSquared += axis[channel] * axis[channel];
+        }
+        lengthSquared = std::max(lengthSquared, 1e-12f);
+        float pull = (highest - lowest) * inset;
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            first[channel] = std::clamp(mean[channel] + axis[channel] * (highest - pull) / lengthSquared, 0.0f, 255.0f);
+            second[channel] = std::clamp(mean[channel] + axis[channel] * (lowest + pull) / lengthSquared, 0.0f, 255.0f);
+        }
+    }
+
+    // The endpoints with the least squared error given each pixel's index, where index i blends weights[i] of the
+    // second endpoint into the first. Returns false if the indices don't pin two endpoints down.
+    bool RefineEndpoints(const BlockPixels& pixels, uint32_t channelCount, const uint8_t* indices, const float* weights, float (&first)[4], float (&second)[4])
+    {
+        float aa = 0, ab = 0, bb = 0;
+        float ax[4] = {}, bx[4] = {};
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            float b = weights[indices[pixel]];
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                ax[channel] += a * pixels.channels[channel][pixel];
+                bx[channel] += b * pixels.channels[channel][pixel];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            first[channel] = std::clamp((ax[channel] * bb - bx[channel] * ab) / determinant, 0.0f, 255.0f);
+            second[channel] = std::clamp((bx[channel] * aa - ax[channel] * ab) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    uint16_t To565(const float (&colour)[4])
+    {
+        uint32_t r = static_cast<uint32_t>(std::lround(colour[0] * 31.0f / 255.0f));
+        uint32_t g = static_cast<uint32_t>(std::lround(colour[1] * 63.0f / 255.0f));
+        uint32_t b = static_cast<uint32_t>(std::lround(colour[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    // BC1's four colours, with the 3 colour and transparent black mode when the first endpoint isn't the larger
+    void Bc1Colours(uint16_t first, uint16_t second, uint32_t (&colours)[4][4])
+    {
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            uint32_t packed = i == 0 ? first : second;
+            uint32_t r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+            colours[i][0] = r << 3 | r >> 2;
+            colours[i][1] = g << 2 | g >> 4;
+            colours[i][2] = b << 3 | b >> 2;
+            colours[i][3] = 255;
+        }
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            uint32_t a = colours[0][channel], b = colours[1][channel];
+            colours[2][channel] = first > second ? (2 * a + b + 1) / 3 : (a + b + 1) / 2;
+            colours[3][channel] = first > second ? (a + 2 * b + 1) / 3 : 0;
+        }
+        colours[2][3] = 255;
+        colours[3][3] = first > second ? 255 : 0;
+    }
+
+    // BC4's eight values, with the 6 value mode that adds 0 and 255 when the first endpoint isn't the larger
+    void Bc4Values(uint32_t first, uint32_t second, uint32_t (&values)[8])
+    {
+        values[0] = first;
+        values[1] = second;
+        if (first > second)
+        {
+            for (uint32_t i = 2; i < 8; i++)
+            {
+                values[i] = ((8 - i) * first + (i - 1) * second + 3) / 7;
+            }
+        }
+        else
+        {
+            for (uint32_t i = 2; i < 6; i++)
+            {
+                values[i] = ((6 - i) * first + (i - 1) * second + 2) / 5;
+            }
+            values[6] = 0;
+            values[7] = 255;
+        }
+    }
+
+    void StoreBits(uint64_t bits, uint32_t byteCount, std::byte* out)
+    {
+        for (uint32_t i = 0; i < byteCount; i++)
+        {
+            out[i] = static_cast<std::byte>((bits >> (i * 8)) & 0xFF);
+        }
+    }
+
+    uint64_t LoadBits(const std::byte* in, uint32_t byteCount)
+    {
+        uint64_t bits = 0;
+        for (uint32_t i = 0; i < byteCount; i++)
+        {
+            bits |= static_cast<uint64_t>(in[i]) << (i * 8);
+        }
+        return bits;
+    }
+
+    void EncodeBc1(const BlockPixels& pixels, FindIndicesFunction findIndices, uint32_t refinements, std::byte* out)
+    {
+        // how much of the second endpoint each index is, in the 4 colour mode
+        constexpr float Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        float first[4], second[4];
+        FitEndpoints(pixels, 3, 1.0f / 16.0f, first, second);
+        uint16_t best[2] = {};
+        uint8_t bestIndices[16] = {};
+        float bestError = std::numeric_limits<float>::max();
+        auto tryEndpoints = [&]() {
+            uint16_t packed[2] = { To565(first), To565(second) };
+            // the 4 colour mode needs the first endpoint larger, which the order they are stored in sorts out
+            uint16_t larger = std::max(packed[0], packed[1]), smaller = std::min(packed[0], packed[1]);
+            uint32_t colours[4][4];
+            Bc1Colours(larger, smaller, colours);
+            Palette palette;     // the entries in use are filled in below
+            palette.count = 4;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                for (uint32_t channel = 0; channel < 3; channel++)
+                {
+                    palette.entries[packed[0] >= packed[1] ? i : i ^ 1][channel] = static_cast<float>(colours[i][channel]);
+                }
+            }
+            uint8_t indices[16];
+            float error = findIndices(pixels, 3, palette, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best[0] = packed[0];
+                best[1] = packed[1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        };
+        tryEndpoints();
+        for (uint32_t i = 0; i < refinements && RefineEndpoints(pixels, 3, bestIndices, Weights, first, second); i++)
+        {
+            tryEndpoints();
+        }
+
+        // storing the larger endpoint first swaps indices 0 and 1, and 2 and 3
+        uint64_t bits = 0;
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            uint32_t index = best[0] >= best[1] ? bestIndices[pixel] : bestIndices[pixel] ^ 1;
+            bits |= static_cast<uint64_t>(index) << (32 + pixel * 2);
+        }
+        bits |= std::max(best[0], best[1]);
+        bits |= static_cast<uint64_t>(std::min(best[0], best[1])) << 16;
+        StoreBits(bits, 8, out);
+    }
+
+    void EncodeBc4(const BlockPixels& pixels, uint32_t channel, FindIndicesFunction findIndices, uint32_t refinements, std::byte* out)
+    {
+        // how much of the second endpoint each index is, in the 8 value mode
+        constexpr float Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+        BlockPixels single;
+        std::memcpy(single.channels[0], pixels.channels[channel], sizeof(single.channels[0]));
+        float first[4] = { *std::max_element(single.channels[0], single.channels[0] + 16) };
+        float second[4] = { *std::min_element(single.channels[0], single.channels[0] + 16) };
+        uint32_t best[2] = {};
+        uint8_t bestIndices[16] = {};
+        float bestError = std::numeric_limits<float>::max();
+        auto tryEndpoints = [&]() {
+            // the 8 value mode, unless the endpoints are equal and the 6 value mode's 0 and 255 might help
+            uint32_t a = static_cast<uint32_t>(std::lround(first[0])), b = static_cast<uint32_t>(std::lround(second[0]));
+            uint32_t endpoints[2] = { std::max(a, b), std::min(a, b) };
+            uint32_t values[8];
+            Bc4Values(endpoints[0], endpoints[1], values);
+            Palette palette;     // the entries in use are filled in below
+            palette.count = 8;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                palette.entries[i][0] = static_cast<float>(values[i]);
+            }
+            uint8_t indices[16];
+            float error = findIndices(single, 1, palette, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best[0] = endpoints[0];
+                best[1] = endpoints[1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        };
+        tryEndpoints();
+        for (uint32_t i = 0; i < refinements && best[0] > best[1] && RefineEndpoints(single, 1, bestIndices, Weights, first, second); i++)
+        {
+            tryEndpoints();
+        }
+
+        uint64_t bits = best[0] | best[1] << 8;
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            bits |= static_cast<uint64_t>(bestIndices[pixel]) << (16 + pixel * 3);
+        }
+        StoreBits(bits, 8, out);
+    }
+
+    // BC7 mode 6: 7 bit RGBA endpoints, each with a shared low bit (the p-bit), and 4 bit indices
+    void EncodeBc7(const BlockPixels& pixels, FindIndicesFunction findIndices, uint32_t refinements, std::byte* out)
+    {
+        float weights[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            weights[i] = Bc7Weights[i] / 64.0f;
+        }
+
+        float first[4], second[4];
+        FitEndpoints(pixels, 4, 1.0f / 32.0f, first, second);
+        uint32_t best[2][4] = {};           // 8 bit endpoints, the p-bit their lowest bit
+        uint8_t bestIndices[16] = {};
+        float bestError = std::numeric_limits<float>::max();
+        auto tryEndpoints = [&]() {
+            for (uint32_t pbits = 0; pbits < 4; pbits++)
+            {
+                uint32_t endpoints[2][4];
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    for (uint32_t e = 0; e < 2; e++)
+                    {
+                        uint32_t pbit = (pbits >> e) & 1;
+                        float value = e == 0 ? first[channel] : second[channel];
+                        long high = std::clamp(std::lround((value - pbit) / 2.0f), 0l, 127l);
+                        endpoints[e][channel] = static_cast<uint32_t>(high) << 1 | pbit;
+                    }
+                }
+                Palette palette;     // the entries in use are filled in below
+                palette.count = 16;
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    for (uint32_t channel = 0; channel < 4; channel++)
+                    {
+                        uint32_t value = ((64 - Bc7Weights[i]) * endpoints[0][channel] + Bc7Weights[i] * endpoints[1][channel] + 32) >> 6;
+                        palette.entries[i][channel] = static_cast<float>(value);
+                    }
+                }
+                uint8_t indices[16];
+                float error = findIndices(pixels, 4, palette, indices);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    std::memcpy(best, endpoints, sizeof(best));
+                    std::memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+        };
+        tryEndpoints();
+        for (uint32_t i = 0; i < refinements && RefineEndpoints(pixels, 4, bestIndices, weights, first, second); i++)
+        {
+            tryEndpoints();
+        }
+
+        // the first pixel's index has its top bit left out, so it must be below 8. Swapping the endpoints flips them
+        if (bestIndices[0] >= 8)
+        {
+            std::swap(best[0], best[1]);
+            for (auto& index : bestIndices)
+            {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+        uint64_t bits[2] = {};
+        uint32_t position = 0;
+        auto put = [&](uint32_t value, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++, position++)
+            {
+                bits[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+            }
+        };
+        put(1 << 6, 7);
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            put(best[0][channel] >> 1, 7);
+            put(best[1][channel] >> 1, 7);
+        }
+        put(best[0][0] & 1, 1);
+        put(best[1][0] & 1, 1);
+        put(bestIndices[0], 3);
+        for (uint32_t pixel = 1; pixel < 16; pixel++)
+        {
+            put(bestIndices[pixel], 4);
+        }
+        StoreBits(bits[0], 8, out);
+        StoreBits(bits[1], 8, out + 8);
+    }
+
+    void DecodeBc1(const std::byte* in, uint8_t (&pixels)[16][4])
+    {
+        uint64_t bits = LoadBits(in, 8);
+        uint32_t colours[4][4];
+        Bc1Colours(static_cast<uint16_t>(bits & 0xFFFF), static_cast<uint16_t>((bits >> 16) & 0xFFFF), colours);
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            uint32_t index = (bits >> (32 + pixel * 2)) & 3;
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                pixels[pixel][channel] = static_cast<uint8_t>(colours[index][channel]);
+            }
+        }
+    }
+
+    void DecodeBc4(const std::byte* in, uint32_t channel, uint8_t (&pixels)[16][4])
+    {
+        uint64_t bits = LoadBits(in, 8);
+        uint32_t values[8];
+        Bc4Values(bits & 0xFF, (bits >> 8) & 0xFF, values);
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            pixels[pixel][channel] = static_cast<uint8_t>(values[(bits >> (16 + pixel * 3)) & 7]);
+        }
+    }
+
+    void DecodeBc7(const std::byte* in, uint8_t (&pixels)[16][4])
+    {
+        uint64_t bits[2] = { LoadBits(in, 8), LoadBits(in + 8, 8) };
+        uint32_t position = 0;
+        auto get = [&](uint32_t count) {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, position++)
+            {
+                value |= static_cast<uint32_t>((bits[position / 64] >> (position % 64)) & 1) << i;
+            }
+            return value;
+        };
+        if (get(7) != 1 << 6)
+        {
+            for (auto& pixel : pixels)
+            {
+                pixel[0] = 255, pixel[1] = 0, pixel[2] = 255, pixel[3] = 255;
+            }
+            return;
+        }
+        uint32_t endpoints[2][4];
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            endpoints[0][channel] = get(7) << 1;
+            endpoints[1][channel] = get(7) << 1;
+        }
+        uint32_t pbits[2] = { get(1), get(1) };
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            endpoints[0][channel] |= pbits[0];
+            endpoints[1][channel] |= pbits[1];
+        }
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            uint32_t weight = Bc7Weights[get(pixel == 0 ? 3 : 4)];
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                pixels[pixel][channel] = static_cast<uint8_t>(((64 - weight) * endpoints[0][channel] + weight * endpoints[1][channel] + 32) >> 6);
+            }
+        }
+    }
+
+    // FNV-1a, to compare the paths' output
+    uint64_t Checksum(std::span<const std::byte> data)
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for (auto byte : data)
+        {
+            hash = (hash ^ static_cast<uint8_t>(byte)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // peak signal to noise ratio over the channels a format keeps
+    double Psnr(std::span<const uint8_t> original, std::span<const uint8_t> decoded, uint32_t channelCount)
+    {
+        double squared = 0;
+        for (size_t i = 0; i < original.size(); i += 4)
+        {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                double difference = double(original[i + channel]) - double(decoded[i + channel]);
+                squared += difference * difference;
+            }
+        }
+        double mean = squared / (original.size() / 4 * channelCount);
+        return mean == 0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mean);
+    }
+
+    uint32_t GetChannelCount(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return 3;
+        case BlockFormat::BC4: return 1;
+        case BlockFormat::BC5: return 2;
+        default: return 4;
+        }
+    }
+
+    // Smooth gradients and soft blobs with sharp edged stripes and fine noise across them, and alpha that fades
+    // in and out, so the encoders see both the easy and the hard cases.
+    std::vector<uint8_t> MakeColourImage(uint32_t size)
+    {
+        std::vector<uint8_t> rgba(size_t(size) * size * 4);
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> noise(-6, 6);
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                float u = float(x) / size, v = float(y) / size;
+                float blob = 0.5f + 0.5f * std::sin(u * 17.0f) * std::cos(v * 13.0f);
+                bool stripe = ((x / 24 + y / 40) % 5) == 0;
+                int value[4] = {
+                    int(255 * u * blob),
+                    stripe ? 230 : int(200 * v),
+                    int(255 * (1.0f - blob)),
+                    int(255 * (0.5f + 0.5f * std::cos(u * 9.0f + v * 4.0f))),
+                };
+                uint8_t* pixel = &rgba[(size_t(y) * size + x) * 4];
+                for (int channel = 0; channel < 4; channel++)
+                {
+                    pixel[channel] = static_cast<uint8_t>(std::clamp(value[channel] + noise(rng), 0, 255));
+                }
+            }
+        }
+        return rgba;
+    }
+
+    // a tangent space normal map of overlapping bumps, x and y in red and green as BC5 stores them
+    std::vector<uint8_t> MakeNormalImage(uint32_t size)
+    {
+        std::vector<uint8_t> rgba(size_t(size) * size * 4);
+        auto height = [size](float x, float y) {
+            return 6.0f * std::sin(x * 40.0f / size) * std::sin(y * 32.0f / size) + 2.0f * std::sin((x + 2.0f * y) * 150.0f / size);
+        };
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                float dx = height(x + 1.0f, float(y)) - height(x - 1.0f, float(y));
+                float dy = height(float(x), y + 1.0f) - height(float(x), y - 1.0f);
+                float length = std::sqrt(dx * dx + dy * dy + 4.0f);
+                uint8_t* pixel = &rgba[(size_t(y) * size + x) * 4];
+                pixel[0] = static_cast<uint8_t>(std::lround((-dx / length * 0.5f + 0.5f) * 255.0f));
+                pixel[1] = static_cast<uint8_t>(std::lround((-dy / length * 0.5f + 0.5f) * 255.0f));
+                pixel[2] = static_cast<uint8_t>(std::lround((2.0f / length * 0.5f + 0.5f) * 255.0f));
+                pixel[3] = 255;
+            }
+        }
+        return rgba;
+    }
+}
+
+BlockEncoder::BlockEncoder(WorkerPool& workers, const Settings& settings)
+    : m_Workers(workers),
+    m_Settings(settings),
+    m_Simd(settings.simd && IsSimdSupported())
+{
+}
+
+bool BlockEncoder::IsSimdSupported()
+{
+    return IsAvx2Supported();
+}
+
+uint32_t BlockEncoder::GetBlockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t BlockEncoder::GetEncodedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+const char* BlockEncoder::GetFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1: return "bc1";
+    case BlockFormat::BC4: return "bc4";
+    case BlockFormat::BC5: return "bc5";
+    default: return "bc7";
+    }
+}
+
+void BlockEncoder::Encode(BlockFormat format, std::span<const uint8_t> rgba, uint32_t width, uint32_t height, std::span<std::byte> blocks)
+{
+    assert(rgba.size() >= size_t(width) * height * 4 && blocks.size() >= GetEncodedSize(format, width, height));
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    uint32_t blockSize = GetBlockSize(format);
+    FindIndicesFunction findIndices = FindIndicesScalar;
+#if AVX2_AVAILABLE
+    if (m_Simd)
+    {
+        findIndices = FindIndicesAvx2;
+    }
+#endif
+    uint32_t refinements = m_Settings.refinements;
+    m_Workers.ParallelFor((blocksHigh + RowsPerJob - 1) / RowsPerJob, [&](uint32_t job) {
+        uint32_t endRow = std::min(blocksHigh, (job + 1) * RowsPerJob);
+        BlockPixels pixels;
+        for (uint32_t blockY = job * RowsPerJob; blockY < endRow; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+            {
+                LoadBlock(rgba, width, height, blockX, blockY, pixels);
+                std::byte* out = &blocks[(size_t(blockY) * blocksWide + blockX) * blockSize];
+                switch (format)
+                {
+                case BlockFormat::BC1:
+                    EncodeBc1(pixels, findIndices, refinements, out);
+                    break;
+                case BlockFormat::BC4:
+                    EncodeBc4(pixels, 0, findIndices, refinements, out);
+                    break;
+                case BlockFormat::BC5:
+                    EncodeBc4(pixels, 0, findIndices, refinements, out);
+                    EncodeBc4(pixels, 1, findIndices, refinements, out + 8);
+                    break;
+                case BlockFormat::BC7:
+                    EncodeBc7(pixels, findIndices, refinements, out);
+                    break;
+                }
+            }
+        }
+    });
+}
+
+void DecodeBlocks(BlockFormat format, std::span<const std::byte> blocks, uint32_t width, uint32_t height, std::span<uint8_t> rgba)
+{
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    uint32_t blockSize = BlockEncoder::GetBlockSize(format);
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            const std::byte* in = &blocks[(size_t(blockY) * blocksWide + blockX) * blockSize];
+            uint8_t pixels[16][4] = {};
+            for (auto& pixel : pixels)
+            {
+                pixel[3] = 255;
+            }
+            switch (format)
+            {
+            case BlockFormat::BC1:
+                DecodeBc1(in, pixels);
+                break;
+            case BlockFormat::BC4:
+                DecodeBc4(in, 0, pixels);
+                break;
+            case BlockFormat::BC5:
+                DecodeBc4(in, 0, pixels);
+                DecodeBc4(in + 8, 1, pixels);
+                break;
+            case BlockFormat::BC7:
+                DecodeBc7(in, pixels);
+                break;
+            }
+            // the parts of edge blocks past the image are dropped
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+                {
+                    std::memcpy(&rgba[((size_t(blockY) * 4 + y) * width + blockX * 4 + x) * 4], pixels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+int RunBlockCompressionBenchmark()
+{
+    uint32_t threadCount = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+    uint32_t size = std::max(CommandLine::GetValue("size", 1024u), 4u);
+
+    auto colour = MakeColourImage(size);
+    auto normals = MakeNormalImage(size);
+    struct Case
+    {
+        BlockFormat format;
+        const std::vector<uint8_t>* image;
+        const char* content;
+    };
+    const Case cases[] = {
+        { BlockFormat::BC1, &colour, "colour" },
+        { BlockFormat::BC4, &colour, "red" },
+        { BlockFormat::BC5, &normals, "normals" },
+        { BlockFormat::BC7, &colour, "colour" },
+    };
+
+    bool simdSupported = BlockEncoder::IsSimdSupported();
+    std::cout << std::format("{}x{} images, AVX2 {}", size, size, simdSupported ? "supported" : "not supported") << std::endl;
+    std::cout << std::format("{:<7} {:<8} {:<8} {:>8} {:>10} {:>10} {:>9}", "format", "content", "path", "threads", "ms", "MPixel/s", "PSNR dB") << std::endl;
+
+    auto configs = GetSimdBenchmarkConfigs(threadCount);
+
+    bool agree = true;
+    std::vector<uint8_t> decoded(size_t(size) * size * 4);
+    for (const auto& test : cases)
+    {
+        std::vector<std::byte> blocks(BlockEncoder::GetEncodedSize(test.format, size, size));
+        uint64_t reference = 0;
+        for (const auto& config : configs)
+        {
+            WorkerPool workers(config.threads);
+            BlockEncoder encoder(workers, { .simd = config.simd });
+            auto start = std::chrono::high_resolution_clock::now();
+            encoder.Encode(test.format, *test.image, size, size, blocks);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            DecodeBlocks(test.format, blocks, size, size, decoded);
+            double psnr = Psnr(*test.image, decoded, GetChannelCount(test.format));
+            std::cout << std::format("{:<7} {:<8} {:<8} {:>8} {:>10.2f} {:>10.2f} {:>9.2f}", BlockEncoder::GetFormatName(test.format), test.content,
+                config.name, config.threads, ms, double(size) * size / (ms * 1000.0), psnr) << std::endl;
+            uint64_t checksum = Checksum(blocks);
+            if (&config == &configs.front())
+            {
+                reference = checksum;
+            }
+            else if (checksum != reference)
+            {
+                std::cout << std::format("{} on {} threads doesn't match the scalar path", config.name, config.threads) << std::endl;
+                agree = false;
+            }
+        }
+    }
+
+    // cook each format with its mips, then map the file back in and read every level out of it as a loader would
+    std::cout << std::endl << std::format("{:<7} {:<6} {:>10} {:>10} {:>10} {:>8} {:>10} {:>9}", "format", "super", "RGBA8 KiB", "blocks KiB",
+        "file KiB", "saved", "cook ms", "load ms") << std::endl;
+    WorkerPool workers(threadCount);
+    BlockEncoder encoder(workers, { .simd = simdSupported });
+    auto directory = std::filesystem::temp_directory_path();
+    bool roundTrips = true;
+    for (const auto& test : cases)
+    {
+        for (auto supercompression : { Ktx2Supercompression::None, Ktx2Supercompression::Zlib })
+        {
+            CookSettings settings{
+                .format = test.format,
+                .srgb = test.format != BlockFormat::BC5,
+                .supercompression = supercompression
+            };
+            CookStats stats;
+            auto file = CookTexture(encoder, *test.image, size, size, settings, &stats);
+            auto path = directory / std::format("bench-{}-{}.ktx2", BlockEncoder::GetFormatName(test.format), supercompression == Ktx2Supercompression::Zlib ? "zlib" : "none");
+            std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(file.data()), file.size());
+
+            std::vector<std::byte> levels;
+            double loadMs;
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                MappedFile mapped(path);
+                Ktx2Reader reader(mapped.GetData());
+                size_t total = 0;
+                for (uint32_t level = 0; level < reader.GetLevelCount(); level++)
+                {
+                    total += reader.GetLevelSize(level);
+                }
+                levels.resize(total);
+                size_t offset = 0;
+                for (uint32_t level = 0; level < reader.GetLevelCount(); level++)
+                {
+                    reader.ReadLevel(level, std::span(levels).subspan(offset, reader.GetLevelSize(level)));
+                    offset += reader.GetLevelSize(level);
+                }
+                loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            }
+            std::filesystem::remove(path);
+
+            // what the loader read has to be what the cooker encoded, starting with mip 0
+            std::vector<std::byte> blocks(BlockEncoder::GetEncodedSize(test.format, size, size));
+            encoder.Encode(test.format, *test.image, size, size, blocks);
+            if (levels.size() != stats.blockBytes || !std::equal(blocks.begin(), blocks.end(), levels.begin()))
+            {
+                std::cout << std::format("{} didn't survive the trip through KTX2", BlockEncoder::GetFormatName(test.format)) << std::endl;
+                roundTrips = false;
+            }
+            std::cout << std::format("{:<7} {:<6} {:>10} {:>10} {:>10} {:>7.1f}% {:>10.2f} {:>9.2f}", BlockEncoder::GetFormatName(test.format),
+                supercompression == Ktx2Supercompression::Zlib ? "zlib" : "none", stats.uncompressedBytes / 1024, stats.blockBytes / 1024,
+                stats.fileBytes / 1024, 100.0 * (1.0 - double(stats.blockBytes) / stats.uncompressedBytes), stats.mipMs + stats.encodeMs + stats.writeMs, loadMs) << std::endl;
+        }
+    }
+    return agree && roundTrips ? 0 : 1;
+}
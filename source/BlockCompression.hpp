@@ -0,0 +1,68 @@
+/**
+ * CPU encoders for the BC formats desktop GPUs sample directly, so textures stay compressed in memory:
+ * BC1 (opaque RGB, 4 bits per pixel), BC4 (one channel), BC5 (two channels, for normal maps) and BC7 (RGBA, 8 bits
+ * per pixel). Endpoints start on the principal axis of each 4x4 block's colours and are refined by least squares
+ * from the indices they produce. BC7 only uses mode 6 (one subset, RGBA endpoints with a p-bit each, 16 levels),
+ * which handles smooth and noisy blocks well but not blocks with two unrelated colours.
+ * Picking each pixel's nearest palette entry is where the time goes. It runs on 8 pixels at a time with AVX2 where
+ * the CPU has it, doing the same float operations in the same order as the scalar path, so both produce the same
+ * blocks. Rows of blocks are encoded in parallel on a WorkerPool.
+ */
+
+#pragma once
+
+#include "WorkerPool.hpp"
+
+#include <cstddef>      // For std::byte
+#include <cstdint>      // For uint8_t, uint32_t
+#include <span>         // For std::span
+
+enum class BlockFormat : uint8_t
+{
+    BC1,
+    BC4,
+    BC5,
+    BC7,
+};
+
+class BlockEncoder
+{
+public:
+    struct Settings
+    {
+        bool simd = true;               // use AVX2 if the CPU supports it
+        uint32_t refinements = 2;       // least squares passes over each block's endpoints
+    };
+
+    BlockEncoder(WorkerPool& workers, const Settings& settings);
+    virtual ~BlockEncoder() {}
+
+    // Encode tightly packed RGBA8 pixels into blocks, in rows from the top left. Blocks past the right or bottom
+    // edge repeat the edge pixels. BC4 takes red and BC5 red and green, BC1 ignores alpha.
+    void Encode(BlockFormat format, std::span<const uint8_t> rgba, uint32_t width, uint32_t height, std::span<std::byte> blocks);
+
+    static uint32_t GetBlockSize(BlockFormat format);
+    static size_t GetEncodedSize(BlockFormat format, uint32_t width, uint32_t height);
+    static const char* GetFormatName(BlockFormat format);
+
+    // whether this build and CPU have the AVX2 path
+    static bool IsSimdSupported();
+    bool IsSimdEnabled() const {
+        return m_Simd;
+    }
+
+private:
+    WorkerPool&     m_Workers;
+    Settings        m_Settings;
+    bool            m_Simd;
+};
+
+// Decode blocks back to RGBA8, for checking what the encoders made. BC4 fills red and BC5 red and green, with the
+// other channels 0 and alpha 255. BC7 blocks in any mode but 6 decode to magenta.
+void DecodeBlocks(BlockFormat format, std::span<const std::byte> blocks, uint32_t width, uint32_t height, std::span<uint8_t> rgba);
+
+// CPU-only benchmark encoding generated images in every format, scalar and SIMD on one thread and across a worker
+// pool. Checks the paths agree, reports throughput and quality, then cooks the images into KTX2 files (with and
+// without supercompression) and maps them back in, reporting the memory saved and the load time.
+// Run with --bench-bc; --size=N (the image width and height) and --bench-threads=N change the workload.
+int RunBlockCompressionBenchmark();
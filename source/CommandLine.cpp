@@ -0,0 +1,56 @@
+#include "CommandLine.hpp"
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <vector>
+
+static std::vector<std::string_view> commandLineArgs;
+
+void CommandLine::Init(int argc, char** argv) {
+	commandLineArgs.assign(argv + 1, argv + argc);
+}
+
+bool CommandLine::HasFlag(std::string_view name) {
+	return GetValue(name).has_value();
+}
+
+std::optional<std::string_view> CommandLine::GetValue(std::string_view name) {
+	for (auto arg : commandLineArgs) {
+		if (!arg.starts_with("--")) {
+			continue;
+		}
+		arg.remove_prefix(2);
+		if (!arg.starts_with(name)) {
+			continue;
+		}
+		arg.remove_prefix(name.size());
+		// --name has an empty value, --name=value has a value
+		if (arg.empty()) {
+			return arg;
+		}
+		if (arg.front() == '=') {
+			return arg.substr(1);
+		}
+	}
+	return std::nullopt;
+}
+
+template<typename T>
+T CommandLine::GetValue(std::string_view name, T fallback) {
+	auto option = GetValue(name);
+	if (!option || option->empty()) {
+		return fallback;
+	}
+	T value;
+	auto [end, error] = std::from_chars(option->data(), option->data() + option->size(), value);
+	if (error != std::errc{} || end != option->data() + option->size()) {
+		std::cout << std::format("Expected a number for --{}, got {}", name, *option) << std::endl;
+		return fallback;
+	}
+	return value;
+}
+
+template uint32_t CommandLine::GetValue(std::string_view, uint32_t);
+template uint64_t CommandLine::GetValue(std::string_view, uint64_t);
+template double CommandLine::GetValue(std::string_view, double);
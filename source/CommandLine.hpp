@@ -0,0 +1,14 @@
+#pragma once
+#include <optional>
+#include <string_view>
+
+// options passed on the command line, in the form --name or --name=value
+struct CommandLine {
+	static void Init(int argc, char** argv);
+	static bool HasFlag(std::string_view name);
+	static std::optional<std::string_view> GetValue(std::string_view name);
+	// --name=N as a number, or fallback if there's no value. A value that isn't a number is reported and gives fallback too.
+	// For uint32_t, uint64_t and double
+	template<typename T>
+	static T GetValue(std::string_view name, T fallback);
+};
@@ -0,0 +1,43 @@
+#include "CpuFeatures.hpp"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+bool IsAvx2Supported()
+{
+#if AVX2_AVAILABLE
+#if defined(_MSC_VER) && !defined(__clang__)
+    // the CPU has to have AVX2, and the OS has to save the upper halves of the registers
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesAvx && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+#else
+    return false;
+#endif
+}
+
+std::vector<SimdBenchmarkConfig> GetSimdBenchmarkConfigs(uint32_t threadCount)
+{
+    bool simdSupported = IsAvx2Supported();
+    std::vector<SimdBenchmarkConfig> configs = { { "scalar", false, 1 } };
+    if (simdSupported)
+    {
+        configs.push_back({ "avx2", true, 1 });
+    }
+    if (threadCount > 1)
+    {
+        configs.push_back({ simdSupported ? "avx2" : "scalar", simdSupported, threadCount });
+    }
+    return configs;
+}
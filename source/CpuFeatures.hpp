@@ -0,0 +1,35 @@
+/**
+ * What the CPU running this can do, for choosing between the scalar and SIMD versions of hot loops.
+ * On x64 the AVX2 versions are compiled in whatever the compiler flags are (AVX2_AVAILABLE), marked AVX2_FUNCTION,
+ * and only called when IsAvx2Supported() says the CPU has it.
+ */
+
+#pragma once
+
+#include <cstdint>  // For uint32_t
+#include <vector>   // For std::vector
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AVX2_AVAILABLE 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#else
+#define AVX2_AVAILABLE 0
+#endif
+
+// the CPU has AVX2, and the OS saves the upper halves of the registers
+bool IsAvx2Supported();
+
+// One way of running a benchmark: the scalar path on one thread, the AVX2 path on one thread if the CPU has it, and
+// the best of those on every thread, each checked against the first.
+struct SimdBenchmarkConfig
+{
+    const char* name;
+    bool simd;
+    uint32_t threads;
+};
+std::vector<SimdBenchmarkConfig> GetSimdBenchmarkConfigs(uint32_t threadCount);
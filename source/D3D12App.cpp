@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <memory>
+#include <span>
 
 // DirectX 12 specific headers.
 #include <d3d12.h>
@@ -27,6 +29,8 @@
 #undef max
 
 #include "D3D12CommandQueue.hpp"
+#include "D3D12RHI.hpp"
+#include "FrameArena.hpp"
 
 using namespace std;
 using namespace Microsoft::WRL;
@@ -39,6 +43,9 @@ bool g_UseWarp = false;
 // Set to true once the DX12 objects have been initialized.
 bool g_IsInitialized = false;
 
+// the app being run, for its options and frame timing
+DxApp* g_App = nullptr;
+
 // Window handle.
 HWND g_hWnd;
 // Window rectangle (used to toggle fullscreen state).
@@ -53,7 +60,6 @@ ComPtr<ID3D12GraphicsCommandList> g_CommandList;
 ComPtr<ID3D12DescriptorHeap> g_RTVDescriptorHeap;		// contains render target views
 UINT g_RTVDescriptorSize;			// vendor-specific
 UINT g_CurrentBackBufferIndex;		// what texture we are on -- may not be sequential on every vendor
-aps
 // Synchronization objects
 ComPtr<ID3D12Fence> g_Fence;
 uint64_t g_FenceValue = 0;
@@ -69,12 +75,12 @@ bool g_TearingSupported = false;
 // Can be toggled with the Alt+Enter or F11
 bool g_Fullscreen = false;
 
-// Vertex buffer for the cube.
-Microsoft::WRL::ComPtr<ID3D12Resource> m_VertexBuffer;
-D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
-// Index buffer for the cube.
-Microsoft::WRL::ComPtr<ID3D12Resource> m_IndexBuffer;
-D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+// the cube's buffers are made and bound through the RHI, on the direct queue
+std::unique_ptr<D3D12RHIDevice> g_RHIDevice;
+RHIBuffer m_VertexBuffer;
+RHIBuffer m_IndexBuffer;
+// the pipeline below, imported so the RHI can bind vertex buffers with its stride
+RHIPipeline m_CubePipeline;
 
 // Depth buffer.
 Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthBuffer;
@@ -102,6 +108,14 @@ using namespace DirectX;
 
 uint64_t m_FenceValues[g_NumFrames] = {};
 
+// scratch memory for the frame being built, one set per back buffer.
+// Declared before the graph so it outlives it
+FrameArenas g_FrameArenas(g_NumFrames);
+
+// rebuilt every frame, works out the transitions between passes
+RenderGraph g_RenderGraph;
+D3D12RenderGraphBackend g_RenderGraphBackend;
+
 
 // Vertex data for a colored cube.
 // matches VertexPosColor in the HLSL file
@@ -122,8 +136,8 @@ static constexpr VertexPosColor g_Vertices[8] = {
     { XMFLOAT3(1.0f,  1.0f,  1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) }, // 6
     { XMFLOAT3(1.0f, -1.0f,  1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f) }  // 7
 };
-// cube index data
-static constexpr WORD g_Indicies[36] =
+// cube index data, 32 bit as the RHI's index buffers are
+static constexpr uint32_t g_Indicies[36] =
 {
     0, 1, 2, 0, 2, 3,
     4, 6, 5, 4, 7, 6,
@@ -163,26 +177,24 @@ D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentRenderTargetView()
 
 bool LoadContent() {
     auto device = g_Device;
-    auto commandQueue = GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-    auto commandList = commandQueue->GetCommandList();
-
-    // Upload vertex buffer data.
-    ComPtr<ID3D12Resource> intermediateVertexBuffer;
-    UpdateBufferResource(commandList.Get(), &m_VertexBuffer, &intermediateVertexBuffer, _countof(g_Vertices), sizeof(VertexPosColor), g_Vertices, g_Device);
 
-    // Create the vertex buffer view.
-    m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-    m_VertexBufferView.SizeInBytes = sizeof(g_Vertices);
-    m_VertexBufferView.StrideInBytes = sizeof(VertexPosColor);
-
-    // Upload index buffer data.
-    ComPtr<ID3D12Resource> intermediateIndexBuffer;
-    UpdateBufferResource(commandList.Get(), &m_IndexBuffer, &intermediateIndexBuffer, _countof(g_Indicies), sizeof(WORD), g_Indicies, device);
-
-    // Create index buffer view.
-    m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
-    m_IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-    m_IndexBufferView.SizeInBytes = sizeof(g_Indicies);
+    // host visible, so they're written straight from here. They're small enough that reading them over PCIe doesn't matter
+    g_RHIDevice = std::make_unique<D3D12RHIDevice>(D3D12RHIDevice::Settings{
+        .device = g_Device,
+        .queue = m_DirectCommandQueue.get(),
+    });
+    m_VertexBuffer = g_RHIDevice->CreateBuffer({
+        .size = sizeof(g_Vertices),
+        .usage = RHIBufferUsage::Vertex,
+        .hostVisible = true
+    });
+    g_RHIDevice->WriteBuffer(m_VertexBuffer, 0, std::as_bytes(std::span(g_Vertices)));
+    m_IndexBuffer = g_RHIDevice->CreateBuffer({
+        .size = sizeof(g_Indicies),
+        .usage = RHIBufferUsage::Index,
+        .hostVisible = true
+    });
+    g_RHIDevice->WriteBuffer(m_IndexBuffer, 0, std::as_bytes(std::span(g_Indicies)));
 
     // Create the descriptor heap for the depth-stencil view.
     D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
@@ -266,11 +278,7 @@ bool LoadContent() {
        sizeof(PipelineStateStream), &pipelineStateStream
     };
     DX_CHECK(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
-
-    // we still haven't actually done anything yet
-    // execute this command list to put everything on the GPU
-    auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-    commandQueue->WaitForFenceValue(fenceValue);
+    m_CubePipeline = g_RHIDevice->ImportPipeline(m_PipelineState, m_RootSignature, sizeof(VertexPosColor), RHITopology::TriangleList);
 
     m_ContentLoaded = true;
 
@@ -628,38 +636,25 @@ UINT  Present()
     return g_CurrentBackBufferIndex;
 }
 
-// 2 steps
-// clear the backbuffer
-// present the rendered frame
-void Render()
+// records the clear and the cube
+void RenderMainPass(ComPtr<ID3D12GraphicsCommandList2> commandList)
 {
-
-    auto commandQueue = GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-    auto commandList = commandQueue->GetCommandList();
-
-    UINT currentBackBufferIndex = g_CurrentBackBufferIndex;
-    auto backBuffer = g_BackBuffers[g_CurrentBackBufferIndex];
     auto rtv = GetCurrentRenderTargetView();
     auto dsv = m_DSVHeap->GetCPUDescriptorHandleForHeapStart();
 
     // Clear the render targets.
     {
-        TransitionResource(commandList, backBuffer,
-            D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);      // done
-
         FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };        // done
 
         ClearRTV(commandList, rtv, clearColor);         // done
         ClearDepth(commandList, dsv);
     }
 
-    // prepare pipeline for rendering
-    commandList->SetPipelineState(m_PipelineState.Get());       // done
-    commandList->SetGraphicsRootSignature(m_RootSignature.Get());   // done
-
-    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);   // done
-    commandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);     // done
-    commandList->IASetIndexBuffer(&m_IndexBufferView);
+    // prepare pipeline for rendering. The root constants are set directly, as the RHI has none
+    D3D12RHICommandList rhiCommands(*g_RHIDevice, commandList);
+    rhiCommands.SetPipeline(m_CubePipeline);
+    rhiCommands.SetVertexBuffer(m_VertexBuffer, 0);
+    rhiCommands.SetIndexBuffer(m_IndexBuffer, 0);
 
     commandList->RSSetViewports(1, &m_Viewport);            // done
     commandList->RSSetScissorRects(1, &m_ScissorRect);      // done
@@ -672,14 +667,52 @@ void Render()
     commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &mvpMatrix, 0);
 
     // draw call
-    commandList->DrawIndexedInstanced(_countof(g_Indicies), 1, 0, 0, 0);        //done
+    for (uint32_t i = 0; i < g_App->drawsPerFrame; i++)
+    {
+        rhiCommands.DrawIndexed(_countof(g_Indicies), 1, 0);
+    }
+}
+
+// 2 steps
+// clear the backbuffer
+// present the rendered frame
+void Render()
+{
+
+    auto commandQueue = GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    g_App->beginSubmitTiming();
+    auto commandList = commandQueue->GetCommandList();
+
+    UINT currentBackBufferIndex = g_CurrentBackBufferIndex;
+    auto backBuffer = g_BackBuffers[g_CurrentBackBufferIndex];
+
+    // the wait at the end of the last frame means the GPU is done with this back buffer's arenas
+    g_FrameArenas.BeginFrame(currentBackBufferIndex);
+
+    // describe the frame, the graph inserts the transitions
+    g_RenderGraph.Reset(g_FrameArenas.GetResource());
+    auto backBufferResource = g_RenderGraph.ImportTexture("backbuffer", { WIDTH, HEIGHT, DXGI_FORMAT_R8G8B8A8_UNORM }, ResourceState::Present, ResourceState::Present);
+    g_RenderGraphBackend.BindImported(backBufferResource, backBuffer);
+    // the depth buffer lives in DEPTH_WRITE, so importing it costs no barriers
+    auto depthResource = g_RenderGraph.ImportTexture("depth", { WIDTH, HEIGHT, DXGI_FORMAT_D32_FLOAT }, ResourceState::DepthAttachment, ResourceState::DepthAttachment);
+    g_RenderGraphBackend.BindImported(depthResource, m_DepthBuffer);
+
+    g_RenderGraph.AddPass("main",
+        [&](RenderGraph::PassBuilder& pass) {
+            pass.Write(backBufferResource, ResourceState::ColorAttachment);
+            pass.Write(depthResource, ResourceState::DepthAttachment);
+        },
+        [&] {
+            RenderMainPass(commandList);
+        }
+    );
+    g_RenderGraph.Compile();
+    g_RenderGraphBackend.Execute(g_RenderGraph, commandList);
 
     // Present
     {
-        TransitionResource(commandList, backBuffer,
-            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);      //done
-
         m_FenceValues[currentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);  //done
+        g_App->endSubmitTiming();
 
         currentBackBufferIndex = Present(); 
 
@@ -764,6 +797,7 @@ void ResizeDepthBuffer(int width, int height)
 
 void DxApp::inithook()
 {
+    g_App = this;
     g_hWnd = glfwGetWin32Window(window);
     g_TearingSupported = CheckTearingSupport();
     ::GetWindowRect(g_hWnd, &g_WindowRect);
@@ -809,6 +843,10 @@ void DxApp::cleanuphook()
 {
     // ensure all commands are done before closing
     Flush();
+    g_RHIDevice->DestroyPipeline(m_CubePipeline);
+    g_RHIDevice->DestroyBuffer(m_IndexBuffer);
+    g_RHIDevice->DestroyBuffer(m_VertexBuffer);
+    g_RHIDevice.reset();
 }
 
 #endif
\ No newline at end of file
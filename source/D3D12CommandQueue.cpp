@@ -41,12 +41,15 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::GetCommandList(
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
 
+    auto isComplete = [this](uint64_t fenceValue) {
+        return IsFenceComplete(fenceValue);
+    };
+
     // before the commandlist can be reset, an unused allocator is required
     // it can be reused as long as it is not currently in-flight
-    if (!m_CommandAllocatorQueue.empty() && IsFenceComplete(m_CommandAllocatorQueue.front().fenceValue))
+    if (auto recycled = m_CommandAllocators.TryPop(isComplete))
     {
-        commandAllocator = m_CommandAllocatorQueue.front().commandAllocator;
-        m_CommandAllocatorQueue.pop();
+        commandAllocator = *recycled;
 
         DX_CHECK(commandAllocator->Reset());
     }
@@ -56,10 +59,9 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::GetCommandList(
     }
 
     // with a valid command allocator, create a commandlist
-    if (!m_CommandListQueue.empty())
+    if (auto recycled = m_CommandLists.TryPop(isComplete))
     {
-        commandList = m_CommandListQueue.front();
-        m_CommandListQueue.pop();
+        commandList = *recycled;
 
         DX_CHECK(commandList->Reset(commandAllocator.Get(), nullptr));
     }
@@ -94,8 +96,8 @@ uint64_t CommandQueue::ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsC
     m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
     uint64_t fenceValue = Signal();
 
-    m_CommandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandAllocator });
-    m_CommandListQueue.push(commandList);
+    m_CommandAllocators.Push(fenceValue, commandAllocator);
+    m_CommandLists.Push(0, commandList);
 
     // The ownership of the command allocator has been transferred to the ComPtr
     // in the command allocator queue. It is safe to release the reference 
@@ -9,7 +9,8 @@
 #include <wrl.h>    // For Microsoft::WRL::ComPtr
 
 #include <cstdint>  // For uint64_t
-#include <queue>    // For std::queue
+
+#include "FenceRecycler.hpp"
 
 class CommandQueue
 {
@@ -17,10 +18,10 @@ public:
     CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
     virtual ~CommandQueue() {}
 
-    // Get an available command list from the command queue.
+    // Get an available command list from the command queue. It may be called from any thread.
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetCommandList();
 
-    // Execute a command list.
+    // Execute a command list. Submissions and signals must not overlap, or the fence values could arrive out of order.
     // Returns the fence value to wait for for this command list.
     uint64_t ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
 
@@ -39,15 +40,10 @@ protected:
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
 
 private:
-    // Keep track of command allocators that are "in-flight"
-    struct CommandAllocatorEntry
-    {
-        uint64_t fenceValue;
-        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator; // must have one for each frame in flight (at least the number of swapchain images)
-    };
-
-    using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-    using CommandListQueue = std::queue< Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> >;
+    // Keep track of command allocators that are "in-flight", tagged with the fence value they can be reused after.
+    // Command lists can be reset as soon as they are executed, so they are pushed with 0
+    using CommandAllocatorRecycler = FenceRecycler< Microsoft::WRL::ComPtr<ID3D12CommandAllocator> >;
+    using CommandListRecycler = FenceRecycler< Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> >;
 
     D3D12_COMMAND_LIST_TYPE                     m_CommandListType;
     Microsoft::WRL::ComPtr<ID3D12Device2>       m_d3d12Device;
@@ -56,7 +52,7 @@ private:
     HANDLE                                      m_FenceEvent;
     uint64_t                                    m_FenceValue;
 
-    CommandAllocatorQueue                       m_CommandAllocatorQueue;
-    CommandListQueue                            m_CommandListQueue;
+    CommandAllocatorRecycler                    m_CommandAllocators;
+    CommandListRecycler                         m_CommandLists;
 };
 #endif
@@ -1,6 +1,7 @@
 #if DX12_AVAILABLE
 #include "D3D12Common.hpp"
 #include <directx/d3dx12.h>	
+#include <cassert>
 
 void TransitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList, Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
 {
@@ -57,4 +58,66 @@ void UpdateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> com
         UpdateSubresources(commandList.Get(), *pDestinationResource, *pIntermediateResource, 0, 0, 1, &subresourceData);
     }
 }
+
+D3D12_RESOURCE_STATES D3D12RenderGraphBackend::GetD3D12State(ResourceState state)
+{
+    switch (state)
+    {
+    case ResourceState::Undefined:          return D3D12_RESOURCE_STATE_COMMON;
+    case ResourceState::ColorAttachment:    return D3D12_RESOURCE_STATE_RENDER_TARGET;
+    case ResourceState::DepthAttachment:    return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    case ResourceState::DepthRead:          return D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    case ResourceState::ShaderRead:         return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    case ResourceState::Storage:            return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    case ResourceState::TransferSrc:        return D3D12_RESOURCE_STATE_COPY_SOURCE;
+    case ResourceState::TransferDst:        return D3D12_RESOURCE_STATE_COPY_DEST;
+    case ResourceState::Present:            return D3D12_RESOURCE_STATE_PRESENT;
+    }
+    assert(false && "Invalid resource state.");
+    return D3D12_RESOURCE_STATE_COMMON;
+}
+
+void D3D12RenderGraphBackend::BindImported(RGResource resource, Microsoft::WRL::ComPtr<ID3D12Resource> d3d12Resource)
+{
+    if (m_Resources.size() <= resource)
+    {
+        m_Resources.resize(resource + 1);
+    }
+    m_Resources[resource] = d3d12Resource;
+}
+
+void D3D12RenderGraphBackend::Execute(RenderGraph& graph, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList)
+{
+    assert(graph.GetTransients().empty() && "Transient textures are not supported on D3D12.");
+    m_CommandList = commandList;
+    graph.Execute(*this);
+    m_CommandList.Reset();
+}
+
+void D3D12RenderGraphBackend::Barriers(const RenderGraph& graph, std::span<const Barrier> barriers)
+{
+    // one ResourceBarrier call for the whole batch
+    std::pmr::vector<CD3DX12_RESOURCE_BARRIER> d3d12Barriers(graph.GetScratch());
+    d3d12Barriers.reserve(barriers.size());
+    for (const auto& barrier : barriers)
+    {
+        auto resource = m_Resources[barrier.resource].Get();
+        auto before = GetD3D12State(barrier.before);
+        auto after = GetD3D12State(barrier.after);
+        if (before != after)
+        {
+            d3d12Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after));
+        }
+        else if (barrier.after == ResourceState::Storage)
+        {
+            // back-to-back UAV writes
+            d3d12Barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+        }
+        // D3D12 already orders render target and depth writes in the same state
+    }
+    if (!d3d12Barriers.empty())
+    {
+        m_CommandList->ResourceBarrier(static_cast<UINT>(d3d12Barriers.size()), d3d12Barriers.data());
+    }
+}
 #endif
@@ -5,6 +5,9 @@
 
 #include <d3d12.h>  // For ID3D12CommandQueue, ID3D12Device2, and ID3D12Fence
 #include <wrl.h> 
+#include <vector>
+
+#include "RenderGraph.hpp"
 
 void TransitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
     Microsoft::WRL::ComPtr<ID3D12Resource> resource,
@@ -26,4 +29,25 @@ void UpdateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> com
 
 // Resize the depth buffer to match the size of the client area.
 void ResizeDepthBuffer(int width, int height);
+
+// Turns render graph transitions into D3D12 resource barriers.
+// Only imported resources are supported, transients have no D3D12 backing yet.
+class D3D12RenderGraphBackend : public RenderGraphBackend
+{
+public:
+    // Tell the backend which resource an imported texture refers to this frame.
+    void BindImported(RGResource resource, Microsoft::WRL::ComPtr<ID3D12Resource> d3d12Resource);
+
+    // Run a compiled graph, recording its barriers into the command list.
+    void Execute(RenderGraph& graph, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
+
+    void Barriers(const RenderGraph& graph, std::span<const Barrier> barriers) override;
+
+    // the D3D12 state a resource state maps to, also used by the RHI backend
+    static D3D12_RESOURCE_STATES GetD3D12State(ResourceState state);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_CommandList;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_Resources;    // indexed by RGResource
+};
 #endif
@@ -0,0 +1,524 @@
+#if DX12_AVAILABLE
+#include "D3D12RHI.hpp"
+#include "D3D12Common.hpp"
+
+#include <directx/d3dx12.h>
+
+#include <climits>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    D3D12_RESOURCE_FLAGS GetTextureFlags(RHITextureUsage usage)
+    {
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+        if (HasFlag(usage, RHITextureUsage::RenderTarget)) flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+        if (HasFlag(usage, RHITextureUsage::DepthStencil)) flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        if (HasFlag(usage, RHITextureUsage::Storage)) flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        return flags;
+    }
+
+    DXGI_FORMAT GetVertexFormat(RHIVertexFormat format)
+    {
+        switch (format)
+        {
+        case RHIVertexFormat::Float2:
+            return DXGI_FORMAT_R32G32_FLOAT;
+        case RHIVertexFormat::Float3:
+            return DXGI_FORMAT_R32G32B32_FLOAT;
+        case RHIVertexFormat::Float4:
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        }
+        throw std::runtime_error("unknown vertex format!");
+    }
+
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE GetTopologyType(RHITopology topology)
+    {
+        switch (topology)
+        {
+        case RHITopology::TriangleList:
+        case RHITopology::TriangleStrip:
+            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        case RHITopology::LineList:
+            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        case RHITopology::PointList:
+            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
+        }
+        throw std::runtime_error("unknown topology!");
+    }
+
+    D3D_PRIMITIVE_TOPOLOGY GetTopology(RHITopology topology)
+    {
+        switch (topology)
+        {
+        case RHITopology::TriangleList:
+            return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        case RHITopology::TriangleStrip:
+            return D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+        case RHITopology::LineList:
+            return D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+        case RHITopology::PointList:
+            return D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+        }
+        throw std::runtime_error("unknown topology!");
+    }
+}
+
+void D3D12RHICommandList::Barrier(RHITexture texture, ResourceState state)
+{
+    auto& data = m_Device.FindTexture(texture);
+    auto before = D3D12RenderGraphBackend::GetD3D12State(data.state);
+    auto after = D3D12RenderGraphBackend::GetD3D12State(state);
+    if (before != after)
+    {
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(data.resource.Get(), before, after);
+        m_CommandList->ResourceBarrier(1, &barrier);
+    }
+    else if (state == ResourceState::Storage)
+    {
+        // back-to-back UAV writes
+        auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(data.resource.Get());
+        m_CommandList->ResourceBarrier(1, &barrier);
+    }
+    data.state = state;
+}
+
+void D3D12RHICommandList::BeginRenderPass(const RHIRenderPassDesc& desc)
+{
+    auto& color = m_Device.FindTexture(desc.colorTarget);
+    if (color.rtv.ptr == 0)
+    {
+        throw std::runtime_error("RHI render pass color target wasn't created as a render target!");
+    }
+    m_CommandList->ClearRenderTargetView(color.rtv, desc.clearColor.data(), 0, nullptr);
+
+    const D3D12_CPU_DESCRIPTOR_HANDLE* dsv = nullptr;
+    if (desc.depthTarget.IsValid())
+    {
+        auto& depth = m_Device.FindTexture(desc.depthTarget);
+        if (depth.dsv.ptr == 0)
+        {
+            throw std::runtime_error("RHI render pass depth target wasn't created as a depth target!");
+        }
+        // a pass that only tests against depth keeps it read-only
+        if (depth.state == ResourceState::DepthRead)
+        {
+            dsv = &depth.readOnlyDsv;
+        }
+        else
+        {
+            dsv = &depth.dsv;
+            m_CommandList->ClearDepthStencilView(depth.dsv, D3D12_CLEAR_FLAG_DEPTH, desc.clearDepth, 0, 0, nullptr);
+        }
+    }
+    m_CommandList->OMSetRenderTargets(1, &color.rtv, FALSE, dsv);
+}
+
+void D3D12RHICommandList::EndRenderPass()
+{
+    // D3D12 has no render pass objects, the targets stay bound until the next pass replaces them
+}
+
+void D3D12RHICommandList::SetPipeline(RHIPipeline pipeline)
+{
+    auto& data = m_Device.FindPipeline(pipeline);
+    m_CommandList->SetPipelineState(data.pipelineState.Get());
+    if (data.compute)
+    {
+        m_CommandList->SetComputeRootSignature(data.rootSignature.Get());
+    }
+    else
+    {
+        m_CommandList->SetGraphicsRootSignature(data.rootSignature.Get());
+        m_CommandList->IASetPrimitiveTopology(data.topology);
+    }
+    // the stride comes with the pipeline, so a vertex buffer bound for the last one may need binding again
+    if (pipeline != m_Pipeline)
+    {
+        m_Pipeline = pipeline;
+        m_VertexBufferDirty = m_VertexBuffer.IsValid();
+    }
+}
+
+void D3D12RHICommandList::SetViewport(uint32_t width, uint32_t height)
+{
+    // the scissor always covers the viewport
+    CD3DX12_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+    m_CommandList->RSSetViewports(1, &viewport);
+    CD3DX12_RECT scissor(0, 0, static_cast<LONG>(width), static_cast<LONG>(height));
+    m_CommandList->RSSetScissorRects(1, &scissor);
+}
+
+void D3D12RHICommandList::SetVertexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    m_Device.FindBuffer(buffer);    // so a dead handle is reported here rather than at the draw
+    m_VertexBuffer = buffer;
+    m_VertexOffset = offset;
+    m_VertexBufferDirty = true;
+}
+
+void D3D12RHICommandList::BindVertexBuffer()
+{
+    if (!m_VertexBufferDirty)
+    {
+        return;
+    }
+    if (!m_Pipeline.IsValid())
+    {
+        throw std::runtime_error("RHI draw needs a pipeline set first!");
+    }
+    auto& buffer = m_Device.FindBuffer(m_VertexBuffer);
+    D3D12_VERTEX_BUFFER_VIEW view{
+        .BufferLocation = buffer.resource->GetGPUVirtualAddress() + m_VertexOffset,
+        .SizeInBytes = static_cast<UINT>(buffer.size - m_VertexOffset),
+        .StrideInBytes = m_Device.FindPipeline(m_Pipeline).vertexStride
+    };
+    m_CommandList->IASetVertexBuffers(0, 1, &view);
+    m_VertexBufferDirty = false;
+}
+
+void D3D12RHICommandList::SetIndexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    auto& data = m_Device.FindBuffer(buffer);
+    D3D12_INDEX_BUFFER_VIEW view{
+        .BufferLocation = data.resource->GetGPUVirtualAddress() + offset,
+        .SizeInBytes = static_cast<UINT>(data.size - offset),
+        .Format = DXGI_FORMAT_R32_UINT
+    };
+    m_CommandList->IASetIndexBuffer(&view);
+}
+
+void D3D12RHICommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex)
+{
+    BindVertexBuffer();
+    m_CommandList->DrawInstanced(vertexCount, instanceCount, firstVertex, 0);
+}
+
+void D3D12RHICommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex)
+{
+    BindVertexBuffer();
+    m_CommandList->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, 0, 0);
+}
+
+void D3D12RHICommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    m_CommandList->Dispatch(x, y, z);
+}
+
+void D3D12RHICommandList::CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size)
+{
+    m_CommandList->CopyBufferRegion(m_Device.FindBuffer(destination).resource.Get(), 0, m_Device.FindBuffer(source).resource.Get(), 0, size);
+}
+
+D3D12RHIDevice::D3D12RHIDevice(const Settings& settings)
+    : m_Settings(settings)
+{
+    // nothing is bound but the pipeline and vertex buffers, so one empty root signature does for every pipeline
+    CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    Microsoft::WRL::ComPtr<ID3DBlob> rootSignatureBlob;
+    Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+    DX_CHECK(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rootSignatureBlob, &errorBlob));
+    DX_CHECK(m_Settings.device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&m_EmptyRootSignature)));
+
+    // a view per texture handle slot, so they are created once with the texture. Depth targets get a second,
+    // read-only one for passes that only test against them
+    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
+    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+    rtvHeapDesc.NumDescriptors = m_Settings.maxRenderTargets;
+    DX_CHECK(m_Settings.device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_RtvHeap)));
+    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
+    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    dsvHeapDesc.NumDescriptors = m_Settings.maxRenderTargets * 2;
+    DX_CHECK(m_Settings.device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DsvHeap)));
+    m_RtvSize = m_Settings.device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    m_DsvSize = m_Settings.device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+}
+
+D3D12RHIDevice::~D3D12RHIDevice()
+{
+    // the handle pools' ComPtrs release everything still alive
+}
+
+D3D12RHIDevice::BufferData& D3D12RHIDevice::FindBuffer(RHIBuffer buffer)
+{
+    auto data = m_Buffers.Find(buffer);
+    if (!data)
+    {
+        throw std::runtime_error("RHI buffer handle isn't a live buffer!");
+    }
+    return *data;
+}
+
+D3D12RHIDevice::TextureData& D3D12RHIDevice::FindTexture(RHITexture texture)
+{
+    auto data = m_Textures.Find(texture);
+    if (!data)
+    {
+        throw std::runtime_error("RHI texture handle isn't a live texture!");
+    }
+    return *data;
+}
+
+D3D12RHIDevice::PipelineData& D3D12RHIDevice::FindPipeline(RHIPipeline pipeline)
+{
+    auto data = m_Pipelines.Find(pipeline);
+    if (!data)
+    {
+        throw std::runtime_error("RHI pipeline handle isn't a live pipeline!");
+    }
+    return *data;
+}
+
+DXGI_FORMAT D3D12RHIDevice::GetDxgiFormat(RHIFormat format)
+{
+    switch (format)
+    {
+    case RHIFormat::Undefined:
+        return DXGI_FORMAT_UNKNOWN;
+    case RHIFormat::RGBA8Unorm:
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case RHIFormat::BGRA8Unorm:
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+    case RHIFormat::RGBA16Float:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case RHIFormat::D32Float:
+        return DXGI_FORMAT_D32_FLOAT;
+    }
+    throw std::runtime_error("unknown RHI format!");
+}
+
+RHIBuffer D3D12RHIDevice::CreateBuffer(const RHIBufferDesc& desc)
+{
+    BufferData data{ .size = desc.size };
+    // constant buffer views cover whole 256 byte blocks. The upload heap can't have unordered access
+    uint64_t size = HasFlag(desc.usage, RHIBufferUsage::Uniform) ? (desc.size + 255) & ~uint64_t(255) : desc.size;
+    auto flags = HasFlag(desc.usage, RHIBufferUsage::Storage) && !desc.hostVisible ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(desc.hostVisible ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+    // upload heap resources stay in GENERIC_READ, default heap buffers are promoted out of COMMON by their first use
+    auto initialState = desc.hostVisible ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON;
+    DX_CHECK(m_Settings.device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, initialState, nullptr, IID_PPV_ARGS(&data.resource)));
+
+    // host visible buffers stay mapped, WriteBuffer is a memcpy. They are never read on the CPU
+    if (desc.hostVisible)
+    {
+        CD3DX12_RANGE readRange(0, 0);
+        void* mapped;
+        DX_CHECK(data.resource->Map(0, &readRange, &mapped));
+        data.mapped = static_cast<std::byte*>(mapped);
+    }
+    return m_Buffers.Allocate(data);
+}
+
+void D3D12RHIDevice::DestroyBuffer(RHIBuffer buffer)
+{
+    // releasing doesn't wait for the GPU, callers defer it with fences
+    FindBuffer(buffer);
+    m_Buffers.Release(buffer);
+}
+
+void D3D12RHIDevice::WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data)
+{
+    auto& bufferData = FindBuffer(buffer);
+    if (!bufferData.mapped || offset + data.size() > bufferData.size)
+    {
+        throw std::runtime_error("WriteBuffer needs a host visible buffer big enough for the data!");
+    }
+    std::memcpy(bufferData.mapped + offset, data.data(), data.size());
+}
+
+RHITexture D3D12RHIDevice::CreateTexture(const RHITextureDesc& desc)
+{
+    TextureData data{
+        .format = GetDxgiFormat(desc.format),
+        .width = desc.width,
+        .height = desc.height,
+    };
+    // passes clear to whatever they ask for, so there is no optimized clear value
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(data.format, desc.width, desc.height, 1, 1, 1, 0, GetTextureFlags(desc.usage));
+    DX_CHECK(m_Settings.device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&data.resource)));
+
+    auto texture = m_Textures.Allocate(data);
+    bool renderTarget = HasFlag(desc.usage, RHITextureUsage::RenderTarget);
+    bool depthTarget = HasFlag(desc.usage, RHITextureUsage::DepthStencil);
+    if (!renderTarget && !depthTarget)
+    {
+        return texture;
+    }
+    if (texture.index >= m_Settings.maxRenderTargets)
+    {
+        m_Textures.Release(texture);
+        throw std::runtime_error("more live render targets than D3D12RHIDevice::Settings::maxRenderTargets!");
+    }
+
+    auto& stored = FindTexture(texture);
+    if (renderTarget)
+    {
+        stored.rtv = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_RtvHeap->GetCPUDescriptorHandleForHeapStart(), texture.index, m_RtvSize);
+        m_Settings.device->CreateRenderTargetView(stored.resource.Get(), nullptr, stored.rtv);
+    }
+    if (depthTarget)
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+        dsvDesc.Format = stored.format;
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+        dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+        stored.dsv = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_DsvHeap->GetCPUDescriptorHandleForHeapStart(), texture.index * 2, m_DsvSize);
+        m_Settings.device->CreateDepthStencilView(stored.resource.Get(), &dsvDesc, stored.dsv);
+
+        dsvDesc.Flags = D3D12_DSV_FLAG_READ_ONLY_DEPTH;
+        stored.readOnlyDsv = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_DsvHeap->GetCPUDescriptorHandleForHeapStart(), texture.index * 2 + 1, m_DsvSize);
+        m_Settings.device->CreateDepthStencilView(stored.resource.Get(), &dsvDesc, stored.readOnlyDsv);
+    }
+    return texture;
+}
+
+void D3D12RHIDevice::DestroyTexture(RHITexture texture)
+{
+    // the views are overwritten by whichever texture gets the slot next
+    FindTexture(texture);
+    m_Textures.Release(texture);
+}
+
+std::vector<char> D3D12RHIDevice::LoadShader(std::string_view name)
+{
+    auto path = m_Settings.shaderDirectory / (std::string(name) + ".cso");
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error(std::format("failed to open {}", path.string()));
+    }
+    std::vector<char> code(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(code.data(), code.size());
+    return code;
+}
+
+RHIPipeline D3D12RHIDevice::CreatePipeline(const RHIPipelineDesc& desc)
+{
+    PipelineData data{
+        .rootSignature = m_EmptyRootSignature,
+        .vertexStride = desc.vertexStride,
+        .topology = GetTopology(desc.topology),
+    };
+
+    if (!desc.computeShader.empty())
+    {
+        auto computeShader = LoadShader(desc.computeShader);
+        D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+        pipelineDesc.pRootSignature = data.rootSignature.Get();
+        pipelineDesc.CS = { computeShader.data(), computeShader.size() };
+        DX_CHECK(m_Settings.device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&data.pipelineState)));
+        data.compute = true;
+        return m_Pipelines.Allocate(data);
+    }
+
+    auto vertexShader = LoadShader(desc.vertexShader);
+    auto pixelShader = LoadShader(desc.fragmentShader);
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+    for (uint32_t location = 0; location < desc.vertexAttributes.size(); location++)
+    {
+        inputLayout.push_back({
+            .SemanticName = "ATTRIBUTE",
+            .SemanticIndex = location,
+            .Format = GetVertexFormat(desc.vertexAttributes[location].format),
+            .InputSlot = 0,
+            .AlignedByteOffset = desc.vertexAttributes[location].offset,
+            .InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+            .InstanceDataStepRate = 0
+        });
+    }
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc = {};
+    pipelineDesc.pRootSignature = data.rootSignature.Get();
+    pipelineDesc.VS = { vertexShader.data(), vertexShader.size() };
+    pipelineDesc.PS = { pixelShader.data(), pixelShader.size() };
+    pipelineDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    pipelineDesc.SampleMask = UINT_MAX;
+    pipelineDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    pipelineDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    // the RHI has no depth state yet, a depth target is only there to match the pass
+    pipelineDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    pipelineDesc.DepthStencilState.DepthEnable = FALSE;
+    pipelineDesc.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
+    pipelineDesc.PrimitiveTopologyType = GetTopologyType(desc.topology);
+    pipelineDesc.NumRenderTargets = 1;
+    pipelineDesc.RTVFormats[0] = GetDxgiFormat(desc.colorFormat);
+    pipelineDesc.DSVFormat = GetDxgiFormat(desc.depthFormat);
+    pipelineDesc.SampleDesc = { 1, 0 };
+    DX_CHECK(m_Settings.device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&data.pipelineState)));
+    return m_Pipelines.Allocate(data);
+}
+
+RHIPipeline D3D12RHIDevice::ImportPipeline(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature,
+    uint32_t vertexStride, RHITopology topology)
+{
+    return m_Pipelines.Allocate({
+        .pipelineState = pipelineState,
+        .rootSignature = rootSignature,
+        .vertexStride = vertexStride,
+        .topology = GetTopology(topology),
+    });
+}
+
+void D3D12RHIDevice::DestroyPipeline(RHIPipeline pipeline)
+{
+    FindPipeline(pipeline);
+    m_Pipelines.Release(pipeline);
+}
+
+RHICommandList* D3D12RHIDevice::GetCommandList()
+{
+    // the queue's allocators are what wait for the GPU, the list wrapping a command list can be reused straight away
+    auto commandList = m_Settings.queue->GetCommandList();
+    if (!m_FreeCommandLists.empty())
+    {
+        auto list = m_FreeCommandLists.back();
+        m_FreeCommandLists.pop_back();
+        list->m_CommandList = commandList;
+        return list;
+    }
+    m_CommandLists.push_back(std::make_unique<D3D12RHICommandList>(*this, commandList));
+    return m_CommandLists.back().get();
+}
+
+uint64_t D3D12RHIDevice::ExecuteCommandList(RHICommandList* commandList)
+{
+    auto list = static_cast<D3D12RHICommandList*>(commandList);
+    uint64_t fenceValue = m_Settings.queue->ExecuteCommandList(list->m_CommandList);
+    list->m_CommandList.Reset();
+    list->m_Pipeline = {};
+    list->m_VertexBuffer = {};
+    list->m_VertexBufferDirty = false;
+    m_FreeCommandLists.push_back(list);
+    return fenceValue;
+}
+
+bool D3D12RHIDevice::IsFenceComplete(uint64_t fenceValue)
+{
+    return m_Settings.queue->IsFenceComplete(fenceValue);
+}
+
+void D3D12RHIDevice::WaitForFenceValue(uint64_t fenceValue)
+{
+    m_Settings.queue->WaitForFenceValue(fenceValue);
+}
+
+void D3D12RHIDevice::Flush()
+{
+    m_Settings.queue->Flush();
+}
+
+ID3D12Resource* D3D12RHIDevice::GetD3D12Resource(RHIBuffer buffer)
+{
+    return FindBuffer(buffer).resource.Get();
+}
+
+ID3D12Resource* D3D12RHIDevice::GetD3D12Resource(RHITexture texture)
+{
+    return FindTexture(texture).resource.Get();
+}
+#endif
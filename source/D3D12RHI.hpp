@@ -0,0 +1,159 @@
+/**
+ * RHI backend on D3D12. Buffers and textures are committed resources, host visible buffers live in the upload heap
+ * and stay mapped, and pipelines load <name>.cso from the shader directory with an empty root signature, their vertex
+ * attributes read as ATTRIBUTE0, ATTRIBUTE1, ... in HLSL. Command lists come from a CommandQueue, so fence values are
+ * that queue's. Render targets get their views from heaps the device owns, one slot per texture handle.
+ * D3D12 wants the vertex stride when the vertex buffer is bound, so command lists hold on to it until the next draw,
+ * when the pipeline's stride is known. Texture states are tracked as barriers are recorded, as on Vulkan.
+ */
+
+#pragma once
+#if DX12_AVAILABLE
+
+#include "RHI.hpp"
+#include "D3D12CommandQueue.hpp"
+
+#include <d3d12.h>      // For ID3D12Resource, ID3D12PipelineState, ID3D12RootSignature
+#include <wrl.h>        // For Microsoft::WRL::ComPtr
+
+#include <cstdint>      // For uint32_t, uint64_t
+#include <filesystem>   // For std::filesystem::path
+#include <memory>       // For std::unique_ptr
+#include <vector>       // For std::vector
+
+class D3D12RHIDevice;
+
+class D3D12RHICommandList : public RHICommandList
+{
+public:
+    // Record into a command list that is open, which the caller executes itself.
+    D3D12RHICommandList(D3D12RHIDevice& device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList) : m_Device(device), m_CommandList(commandList) {}
+
+    void Barrier(RHITexture texture, ResourceState state) final;
+    void BeginRenderPass(const RHIRenderPassDesc& desc) final;
+    void EndRenderPass() final;
+    void SetPipeline(RHIPipeline pipeline) final;
+    void SetViewport(uint32_t width, uint32_t height) final;
+    void SetVertexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void SetIndexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex) final;
+    void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex) final;
+    void Dispatch(uint32_t x, uint32_t y, uint32_t z) final;
+    void CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size) final;
+
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList() const {
+        return m_CommandList;
+    }
+
+private:
+    friend class D3D12RHIDevice;
+
+    // bind the vertex buffer set since the last draw, with the stride of the pipeline drawing it
+    void BindVertexBuffer();
+
+    D3D12RHIDevice&                                     m_Device;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>  m_CommandList;
+    RHIPipeline                                         m_Pipeline = {};
+    RHIBuffer                                           m_VertexBuffer = {};
+    uint64_t                                            m_VertexOffset = 0;
+    bool                                                m_VertexBufferDirty = false;
+};
+
+class D3D12RHIDevice : public RHIDevice
+{
+public:
+    struct Settings
+    {
+        Microsoft::WRL::ComPtr<ID3D12Device2> device = nullptr;
+        CommandQueue* queue = nullptr;                  // a direct queue command lists are executed on, it must outlive the device
+        std::filesystem::path shaderDirectory = {};
+        uint32_t maxRenderTargets = 64;                 // texture handles with render target or depth views
+    };
+
+    explicit D3D12RHIDevice(const Settings& settings);
+    // releases whatever is still alive, so the GPU has to be done with it
+    virtual ~D3D12RHIDevice();
+
+    const char* GetName() const final {
+        return "D3D12";
+    }
+
+    RHIBuffer CreateBuffer(const RHIBufferDesc& desc) final;
+    void DestroyBuffer(RHIBuffer buffer) final;
+    void WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data) final;
+
+    RHITexture CreateTexture(const RHITextureDesc& desc) final;
+    void DestroyTexture(RHITexture texture) final;
+
+    RHIPipeline CreatePipeline(const RHIPipelineDesc& desc) final;
+    // A pipeline made outside the RHI, like one with root constants, so command lists can still set it and bind
+    // vertex buffers for it. The device keeps references to both objects until it is destroyed.
+    RHIPipeline ImportPipeline(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature,
+        uint32_t vertexStride, RHITopology topology);
+    void DestroyPipeline(RHIPipeline pipeline) final;
+
+    RHICommandList* GetCommandList() final;
+    uint64_t ExecuteCommandList(RHICommandList* commandList) final;
+
+    bool IsFenceComplete(uint64_t fenceValue) final;
+    void WaitForFenceValue(uint64_t fenceValue) final;
+    void Flush() final;
+
+    ID3D12Resource* GetD3D12Resource(RHIBuffer buffer);
+    ID3D12Resource* GetD3D12Resource(RHITexture texture);
+
+    static DXGI_FORMAT GetDxgiFormat(RHIFormat format);
+
+private:
+    friend class D3D12RHICommandList;
+
+    struct BufferData
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
+        uint64_t size = 0;
+        std::byte* mapped = nullptr;        // only for host visible buffers
+    };
+
+    struct TextureData
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        D3D12_CPU_DESCRIPTOR_HANDLE rtv = {};   // only for render targets
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv = {};   // only for depth targets
+        D3D12_CPU_DESCRIPTOR_HANDLE readOnlyDsv = {};
+        ResourceState state = ResourceState::Undefined;     // as of the last barrier recorded
+    };
+
+    struct PipelineData
+    {
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState = nullptr;
+        Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature = nullptr;
+        uint32_t vertexStride = 0;
+        D3D_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        bool compute = false;
+    };
+
+    // Throws std::runtime_error if the handle doesn't refer to a live resource, like using a destroyed one
+    BufferData& FindBuffer(RHIBuffer buffer);
+    TextureData& FindTexture(RHITexture texture);
+    PipelineData& FindPipeline(RHIPipeline pipeline);
+
+    std::vector<char> LoadShader(std::string_view name);
+
+    Settings                                        m_Settings;
+    Microsoft::WRL::ComPtr<ID3D12RootSignature>     m_EmptyRootSignature;   // every pipeline CreatePipeline makes uses it
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>    m_RtvHeap;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>    m_DsvHeap;
+    uint32_t                                        m_RtvSize = 0;
+    uint32_t                                        m_DsvSize = 0;
+
+    RHIHandlePool<RHIBuffer, BufferData>            m_Buffers;
+    RHIHandlePool<RHITexture, TextureData>          m_Textures;
+    RHIHandlePool<RHIPipeline, PipelineData>        m_Pipelines;
+
+    std::vector<std::unique_ptr<D3D12RHICommandList>> m_CommandLists;       // owns every command list handed out
+    std::vector<D3D12RHICommandList*>               m_FreeCommandLists;     // executed, their command lists are the queue's again
+};
+#endif
@@ -0,0 +1,817 @@
+#include "Deflate.hpp"
+
+#include <stdexcept>
+
+#if ZLIB_AVAILABLE
+#include <zlib.h>
+
+std::vector<std::byte> ZlibCompress(std::span<const std::byte> data, uint32_t maxChainLength)
+{
+    z_stream stream{};
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        throw std::runtime_error("failed to start a zlib stream!");
+    }
+    // the default level's settings, but with the chain length asked for
+    deflateTune(&stream, 8, 16, 128, static_cast<int>(maxChainLength));
+
+    // one call with room for the worst case, which is stored blocks
+    std::vector<std::byte> output(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    int result = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END)
+    {
+        throw std::runtime_error("failed to compress a zlib stream!");
+    }
+    return output;
+}
+
+void ZlibDecompress(std::span<const std::byte> stream, std::span<std::byte> output)
+{
+    z_stream inflater{};
+    if (inflateInit(&inflater) != Z_OK)
+    {
+        throw std::runtime_error("failed to start a zlib stream!");
+    }
+    inflater.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(stream.data()));
+    inflater.avail_in = static_cast<uInt>(stream.size());
+    inflater.next_out = reinterpret_cast<Bytef*>(output.data());
+    inflater.avail_out = static_cast<uInt>(output.size());
+    int result = inflate(&inflater, Z_FINISH);
+    size_t written = inflater.total_out;
+    inflateEnd(&inflater);
+
+    // zlib checks the header and the checksum itself, and calls either failing a data error
+    if (result == Z_DATA_ERROR)
+    {
+        throw std::runtime_error("corrupt zlib stream!");
+    }
+    if (result != Z_STREAM_END || written != output.size())
+    {
+        throw std::runtime_error(written < output.size() ? "zlib stream is shorter than expected!" : "zlib stream is longer than expected!");
+    }
+}
+#else
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+    constexpr uint32_t WindowSize = 32768;
+    constexpr uint32_t HashBits = 15;
+    constexpr uint32_t MinMatch = 3;
+    constexpr uint32_t MaxMatch = 258;
+    constexpr size_t BlockInput = 65535;        // bytes of input per block, the most a stored block can hold
+    constexpr uint32_t MaxCodeLength = 15;
+    constexpr uint32_t MaxCodeLengthCodeLength = 7;
+
+    constexpr uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    constexpr uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    constexpr uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    constexpr uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    // the order a dynamic block lists the code length code's lengths in
+    constexpr uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // a literal (distance 0) or a match
+    struct Token
+    {
+        uint16_t literalOrLength;
+        uint16_t distance;
+    };
+
+    uint32_t Adler32(std::span<const std::byte> data)
+    {
+        uint32_t a = 1, b = 0;
+        size_t i = 0;
+        while (i < data.size())
+        {
+            // the most bytes that can be summed before b might overflow
+            size_t end = std::min(data.size(), i + 5552);
+            for (; i < end; i++)
+            {
+                a += static_cast<uint8_t>(data[i]);
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    uint32_t ReverseBits(uint32_t code, uint32_t length)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    uint32_t LengthCode(uint32_t length)
+    {
+        return static_cast<uint32_t>(std::upper_bound(std::begin(LengthBase), std::end(LengthBase), length) - std::begin(LengthBase)) - 1;
+    }
+
+    uint32_t DistanceCode(uint32_t distance)
+    {
+        return static_cast<uint32_t>(std::upper_bound(std::begin(DistanceBase), std::end(DistanceBase), distance) - std::begin(DistanceBase)) - 1;
+    }
+
+    // The canonical codes deflate gives symbols of these lengths, bits reversed so they can be written and looked up
+    // least significant bit first. Returns false if the lengths ask for more codes than there are.
+    bool AssignCodes(std::span<const uint8_t> lengths, std::span<uint16_t> codes)
+    {
+        uint32_t counts[MaxCodeLength + 1] = {};
+        for (auto length : lengths)
+        {
+            counts[length]++;
+        }
+        counts[0] = 0;
+        uint32_t next[MaxCodeLength + 1] = {};
+        uint32_t code = 0;
+        int32_t left = 1;
+        for (uint32_t bits = 1; bits <= MaxCodeLength; bits++)
+        {
+            code = (code + counts[bits - 1]) << 1;
+            next[bits] = code;
+            left = left * 2 - static_cast<int32_t>(counts[bits]);
+            if (left < 0)
+            {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < lengths.size(); i++)
+        {
+            if (lengths[i] != 0)
+            {
+                codes[i] = static_cast<uint16_t>(ReverseBits(next[lengths[i]]++, lengths[i]));
+            }
+        }
+        return true;
+    }
+
+    // Huffman code lengths for these symbol frequencies, none longer than maxLength. If the tree comes out too deep
+    // the frequencies are flattened and it is built again, which costs a little ratio but only on very skewed data.
+    // Codes are always complete, so a lone symbol gets an unused partner.
+    void BuildLengths(std::span<const uint32_t> frequencies, uint32_t maxLength, std::span<uint8_t> lengths)
+    {
+        std::fill(lengths.begin(), lengths.end(), uint8_t(0));
+        std::vector<uint32_t> used;
+        for (uint32_t i = 0; i < frequencies.size(); i++)
+        {
+            if (frequencies[i] != 0)
+            {
+                used.push_back(i);
+            }
+        }
+        if (used.size() < 2)
+        {
+            uint32_t symbol = used.empty() ? 0 : used[0];
+            lengths[symbol] = 1;
+            lengths[symbol == 0 ? 1 : 0] = 1;
+            return;
+        }
+
+        struct Node
+        {
+            uint64_t weight;
+            uint32_t parent;
+        };
+        size_t leafCount = used.size();
+        std::vector<uint64_t> weights(leafCount);
+        for (size_t i = 0; i < leafCount; i++)
+        {
+            weights[i] = frequencies[used[i]];
+        }
+        std::vector<Node> nodes;
+        std::vector<uint32_t> leaves(leafCount);
+        std::vector<uint32_t> depths;
+        while (true)
+        {
+            // two queues, the sorted leaves and the internal nodes, which are made in order of weight
+            nodes.clear();
+            nodes.reserve(leafCount * 2 - 1);
+            for (size_t i = 0; i < leafCount; i++)
+            {
+                nodes.push_back({ weights[i], 0 });
+            }
+            std::iota(leaves.begin(), leaves.end(), 0u);
+            std::stable_sort(leaves.begin(), leaves.end(), [&nodes](uint32_t a, uint32_t b) {
+                return nodes[a].weight < nodes[b].weight;
+            });
+            size_t nextLeaf = 0, nextInternal = leafCount;
+            auto takeLightest = [&]() -> uint32_t {
+                if (nextLeaf < leafCount && (nextInternal >= nodes.size() || nodes[leaves[nextLeaf]].weight <= nodes[nextInternal].weight))
+                {
+                    return leaves[nextLeaf++];
+                }
+                return static_cast<uint32_t>(nextInternal++);
+            };
+            while (nodes.size() < leafCount * 2 - 1)
+            {
+                uint32_t a = takeLightest();
+                uint32_t b = takeLightest();
+                nodes.push_back({ nodes[a].weight + nodes[b].weight, 0 });
+                nodes[a].parent = nodes[b].parent = static_cast<uint32_t>(nodes.size() - 1);
+            }
+
+            // parents come after their children, so walking down from the root sees each parent's depth first
+            depths.assign(nodes.size(), 0);
+            uint32_t deepest = 0;
+            for (size_t i = nodes.size() - 1; i-- > 0;)
+            {
+                depths[i] = depths[nodes[i].parent] + 1;
+                deepest = std::max(deepest, depths[i]);
+            }
+            if (deepest <= maxLength)
+            {
+                for (size_t i = 0; i < leafCount; i++)
+                {
+                    lengths[used[i]] = static_cast<uint8_t>(depths[i]);
+                }
+                return;
+            }
+            for (auto& weight : weights)
+            {
+                weight = (weight >> 1) | 1;
+            }
+        }
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<std::byte>& output)
+            : m_Output(output)
+        {
+        }
+
+        // up to 32 bits, least significant first
+        void Put(uint32_t value, uint32_t count)
+        {
+            m_Buffer |= static_cast<uint64_t>(value) << m_Count;
+            m_Count += count;
+            while (m_Count >= 8)
+            {
+                m_Output.push_back(static_cast<std::byte>(m_Buffer & 0xFF));
+                m_Buffer >>= 8;
+                m_Count -= 8;
+            }
+        }
+
+        void AlignToByte()
+        {
+            if (m_Count > 0)
+            {
+                Put(0, 8 - m_Count);
+            }
+        }
+
+    private:
+        std::vector<std::byte>& m_Output;
+        uint64_t                m_Buffer = 0;
+        uint32_t                m_Count = 0;
+    };
+
+    // Write one block of tokens, covering raw. Dynamic Huffman codes unless storing raw is smaller.
+    void WriteBlock(BitWriter& writer, const std::vector<Token>& tokens, const uint8_t* raw, size_t rawSize, bool last)
+    {
+        uint32_t literalFrequencies[286] = {};
+        uint32_t distanceFrequencies[30] = {};
+        for (const auto& token : tokens)
+        {
+            if (token.distance == 0)
+            {
+                literalFrequencies[token.literalOrLength]++;
+            }
+            else
+            {
+                literalFrequencies[257 + LengthCode(token.literalOrLength)]++;
+                distanceFrequencies[DistanceCode(token.distance)]++;
+            }
+        }
+        literalFrequencies[256] = 1;    // the end of the block
+        uint8_t literalLengths[286], distanceLengths[30];
+        BuildLengths(literalFrequencies, MaxCodeLength, literalLengths);
+        BuildLengths(distanceFrequencies, MaxCodeLength, distanceLengths);
+        uint32_t literalCount = 286;
+        while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+        {
+            literalCount--;
+        }
+        uint32_t distanceCount = 30;
+        while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+        {
+            distanceCount--;
+        }
+
+        // both codes' lengths in one list, with runs coded as repeats
+        struct Run
+        {
+            uint8_t symbol;
+            uint8_t extra;
+        };
+        std::vector<uint8_t> allLengths(literalLengths, literalLengths + literalCount);
+        allLengths.insert(allLengths.end(), distanceLengths, distanceLengths + distanceCount);
+        std::vector<Run> runs;
+        for (size_t i = 0; i < allLengths.size();)
+        {
+            uint8_t length = allLengths[i];
+            size_t run = 1;
+            while (i + run < allLengths.size() && allLengths[i + run] == length)
+            {
+                run++;
+            }
+            if (length == 0 && run >= 3)
+            {
+                size_t count = std::min<size_t>(run, 138);
+                runs.push_back(count >= 11 ? Run{ 18, static_cast<uint8_t>(count - 11) } : Run{ 17, static_cast<uint8_t>(count - 3) });
+                i += count;
+            }
+            else if (length != 0 && run >= 4)
+            {
+                size_t count = std::min<size_t>(run - 1, 6);
+                runs.push_back({ length, 0 });
+                runs.push_back({ 16, static_cast<uint8_t>(count - 3) });
+                i += 1 + count;
+            }
+            else
+            {
+                runs.push_back({ length, 0 });
+                i++;
+            }
+        }
+        uint32_t codeLengthFrequencies[19] = {};
+        for (const auto& run : runs)
+        {
+            codeLengthFrequencies[run.symbol]++;
+        }
+        uint8_t codeLengthLengths[19];
+        BuildLengths(codeLengthFrequencies, MaxCodeLengthCodeLength, codeLengthLengths);
+        uint32_t codeLengthCount = 19;
+        while (codeLengthCount > 4 && codeLengthLengths[CodeLengthOrder[codeLengthCount - 1]] == 0)
+        {
+            codeLengthCount--;
+        }
+
+        uint16_t literalCodes[286] = {}, distanceCodes[30] = {}, codeLengthCodes[19] = {};
+        AssignCodes(literalLengths, literalCodes);
+        AssignCodes(distanceLengths, distanceCodes);
+        AssignCodes(codeLengthLengths, codeLengthCodes);
+
+        // store the block instead if that is smaller
+        constexpr uint32_t RepeatExtra[19] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7 };
+        uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount;
+        for (const auto& run : runs)
+        {
+            dynamicBits += codeLengthLengths[run.symbol] + RepeatExtra[run.symbol];
+        }
+        for (uint32_t i = 0; i < 286; i++)
+        {
+            dynamicBits += static_cast<uint64_t>(literalFrequencies[i]) * (literalLengths[i] + (i > 256 ? LengthExtra[i - 257] : 0));
+        }
+        for (uint32_t i = 0; i < 30; i++)
+        {
+            dynamicBits += static_cast<uint64_t>(distanceFrequencies[i]) * (distanceLengths[i] + DistanceExtra[i]);
+        }
+        uint64_t storedBits = 3 + 7 + 32 + rawSize * 8;
+        if (storedBits < dynamicBits)
+        {
+            writer.Put(last ? 1 : 0, 1);
+            writer.Put(0, 2);
+            writer.AlignToByte();
+            writer.Put(static_cast<uint32_t>(rawSize), 16);
+            writer.Put(static_cast<uint32_t>(~rawSize & 0xFFFF), 16);
+            for (size_t i = 0; i < rawSize; i++)
+            {
+                writer.Put(raw[i], 8);
+            }
+            return;
+        }
+
+        writer.Put(last ? 1 : 0, 1);
+        writer.Put(2, 2);
+        writer.Put(literalCount - 257, 5);
+        writer.Put(distanceCount - 1, 5);
+        writer.Put(codeLengthCount - 4, 4);
+        for (uint32_t i = 0; i < codeLengthCount; i++)
+        {
+            writer.Put(codeLengthLengths[CodeLengthOrder[i]], 3);
+        }
+        for (const auto& run : runs)
+        {
+            writer.Put(codeLengthCodes[run.symbol], codeLengthLengths[run.symbol]);
+            writer.Put(run.extra, RepeatExtra[run.symbol]);
+        }
+        for (const auto& token : tokens)
+        {
+            if (token.distance == 0)
+            {
+                writer.Put(literalCodes[token.literalOrLength], literalLengths[token.literalOrLength]);
+                continue;
+            }
+            uint32_t lengthCode = LengthCode(token.literalOrLength);
+            writer.Put(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+            writer.Put(token.literalOrLength - LengthBase[lengthCode], LengthExtra[lengthCode]);
+            uint32_t distanceCode = DistanceCode(token.distance);
+            writer.Put(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+            writer.Put(token.distance - DistanceBase[distanceCode], DistanceExtra[distanceCode]);
+        }
+        writer.Put(literalCodes[256], literalLengths[256]);
+    }
+
+    [[noreturn]] void Corrupt()
+    {
+        throw std::runtime_error("corrupt zlib stream!");
+    }
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size)
+            : m_Data(data),
+            m_Size(size)
+        {
+        }
+
+        // the next count bits without consuming them, zeros past the end of the stream
+        uint32_t Peek(uint32_t count)
+        {
+            Refill();
+            return static_cast<uint32_t>(m_Buffer & ((1ull << count) - 1));
+        }
+
+        void Consume(uint32_t count)
+        {
+            if (count > m_Count)
+            {
+                Corrupt();
+            }
+            m_Buffer >>= count;
+            m_Count -= count;
+        }
+
+        uint32_t Get(uint32_t count)
+        {
+            uint32_t value = Peek(count);
+            Consume(count);
+            return value;
+        }
+
+        void AlignToByte()
+        {
+            Consume(m_Count % 8);
+        }
+
+        // after AlignToByte, so the buffer holds whole bytes
+        void ReadBytes(uint8_t* output, size_t count)
+        {
+            while (count > 0 && m_Count >= 8)
+            {
+                *output++ = static_cast<uint8_t>(Get(8));
+                count--;
+            }
+            if (count > m_Size - m_Position)
+            {
+                Corrupt();
+            }
+            std::memcpy(output, m_Data + m_Position, count);
+            m_Position += count;
+        }
+
+    private:
+        void Refill()
+        {
+            while (m_Count <= 56 && m_Position < m_Size)
+            {
+                m_Buffer |= static_cast<uint64_t>(m_Data[m_Position++]) << m_Count;
+                m_Count += 8;
+            }
+        }
+
+        const uint8_t*  m_Data;
+        size_t          m_Size;
+        size_t          m_Position = 0;
+        uint64_t        m_Buffer = 0;
+        uint32_t        m_Count = 0;
+    };
+
+    // every code of up to maxLength bits, so a symbol is one lookup of the next maxLength bits
+    class HuffmanTable
+    {
+    public:
+        void Build(std::span<const uint8_t> lengths)
+        {
+            m_MaxLength = std::max<uint32_t>(*std::max_element(lengths.begin(), lengths.end()), 1);
+            std::vector<uint16_t> codes(lengths.size());
+            if (!AssignCodes(lengths, codes))
+            {
+                Corrupt();
+            }
+            // entries a code doesn't reach stay 0, which decoding rejects
+            m_Entries.assign(size_t(1) << m_MaxLength, 0);
+            for (size_t symbol = 0; symbol < lengths.size(); symbol++)
+            {
+                uint32_t length = lengths[symbol];
+                if (length == 0)
+                {
+                    continue;
+                }
+                for (size_t i = codes[symbol]; i < m_Entries.size(); i += size_t(1) << length)
+                {
+                    m_Entries[i] = static_cast<uint16_t>((symbol << 4) | length);
+                }
+            }
+        }
+
+        uint32_t Decode(BitReader& reader) const
+        {
+            uint16_t entry = m_Entries[reader.Peek(m_MaxLength)];
+            if ((entry & 15) == 0)
+            {
+                Corrupt();
+            }
+            reader.Consume(entry & 15);
+            return entry >> 4;
+        }
+
+    private:
+        std::vector<uint16_t>   m_Entries;      // symbol << 4 | length
+        uint32_t                m_MaxLength = 1;
+    };
+
+    void ReadDynamicTables(BitReader& reader, HuffmanTable& literals, HuffmanTable& distances)
+    {
+        uint32_t literalCount = reader.Get(5) + 257;
+        uint32_t distanceCount = reader.Get(5) + 1;
+        uint32_t codeLengthCount = reader.Get(4) + 4;
+        if (literalCount > 286 || distanceCount > 30)
+        {
+            Corrupt();
+        }
+        uint8_t codeLengthLengths[19] = {};
+        for (uint32_t i = 0; i < codeLengthCount; i++)
+        {
+            codeLengthLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(reader.Get(3));
+        }
+        HuffmanTable codeLengths;
+        codeLengths.Build(codeLengthLengths);
+
+        uint8_t lengths[286 + 30] = {};
+        uint32_t total = literalCount + distanceCount;
+        for (uint32_t i = 0; i < total;)
+        {
+            uint32_t symbol = codeLengths.Decode(reader);
+            if (symbol < 16)
+            {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t value = 0;
+            uint32_t count;
+            if (symbol == 16)
+            {
+                if (i == 0)
+                {
+                    Corrupt();
+                }
+                value = lengths[i - 1];
+                count = 3 + reader.Get(2);
+            }
+            else if (symbol == 17)
+            {
+                count = 3 + reader.Get(3);
+            }
+            else
+            {
+                count = 11 + reader.Get(7);
+            }
+            if (i + count > total)
+            {
+                Corrupt();
+            }
+            std::fill_n(lengths + i, count, value);
+            i += count;
+        }
+        if (lengths[256] == 0)
+        {
+            Corrupt();
+        }
+        literals.Build(std::span<const uint8_t>(lengths, literalCount));
+        distances.Build(std::span<const uint8_t>(lengths + literalCount, distanceCount));
+    }
+}
+
+std::vector<std::byte> ZlibCompress(std::span<const std::byte> data, uint32_t maxChainLength)
+{
+    std::vector<std::byte> output;
+    output.reserve(data.size() / 2 + 64);
+    // deflate with a 32 KiB window and no preset dictionary
+    output.push_back(std::byte{ 0x78 });
+    output.push_back(std::byte{ 0x01 });
+    BitWriter writer(output);
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+    // the latest position each hash of 3 bytes was seen at, and before that the one before, per window slot
+    std::vector<int64_t> head(size_t(1) << HashBits, -1);
+    std::vector<int64_t> previous(WindowSize, -1);
+    auto hash = [bytes](size_t i) {
+        uint32_t value = bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16);
+        return (value * 2654435761u) >> (32 - HashBits);
+    };
+    auto insert = [&](size_t i) {
+        if (i + MinMatch <= size)
+        {
+            uint32_t h = hash(i);
+            previous[i % WindowSize] = head[h];
+            head[h] = static_cast<int64_t>(i);
+        }
+    };
+
+    std::vector<Token> tokens;
+    size_t blockStart = 0;
+    do
+    {
+        size_t blockEnd = std::min(size, blockStart + BlockInput);
+        tokens.clear();
+        for (size_t i = blockStart; i < blockEnd;)
+        {
+            // the longest match among the most recent candidates, not reaching past the block
+            uint32_t bestLength = 0, bestDistance = 0;
+            if (i + MinMatch <= blockEnd)
+            {
+                uint32_t maxLength = static_cast<uint32_t>(std::min<size_t>(MaxMatch, blockEnd - i));
+                int64_t candidate = head[hash(i)];
+                for (uint32_t chain = 0; candidate >= 0 && chain < maxChainLength; chain++)
+                {
+                    size_t distance = i - static_cast<size_t>(candidate);
+                    if (distance > WindowSize)
+                    {
+                        break;
+                    }
+                    const uint8_t* a = bytes + candidate;
+                    const uint8_t* b = bytes + i;
+                    uint32_t length = 0;
+                    while (length < maxLength && a[length] == b[length])
+                    {
+                        length++;
+                    }
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = static_cast<uint32_t>(distance);
+                        if (length == maxLength)
+                        {
+                            break;
+                        }
+                    }
+                    candidate = previous[candidate % WindowSize];
+                }
+            }
+            if (bestLength >= MinMatch)
+            {
+                tokens.push_back({ static_cast<uint16_t>(bestLength), static_cast<uint16_t>(bestDistance) });
+                for (uint32_t k = 0; k < bestLength; k++)
+                {
+                    insert(i + k);
+                }
+                i += bestLength;
+            }
+            else
+            {
+                tokens.push_back({ bytes[i], 0 });
+                insert(i);
+                i++;
+            }
+        }
+        WriteBlock(writer, tokens, bytes + blockStart, blockEnd - blockStart, blockEnd == size);
+        blockStart = blockEnd;
+    } while (blockStart < size);
+    writer.AlignToByte();
+
+    uint32_t adler = Adler32(data);
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        output.push_back(static_cast<std::byte>((adler >> shift) & 0xFF));
+    }
+    return output;
+}
+
+void ZlibDecompress(std::span<const std::byte> stream, std::span<std::byte> output)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(stream.data());
+    // deflate, no preset dictionary, and a header that checks out
+    if (stream.size() < 6 || (bytes[0] & 15) != 8 || ((bytes[0] << 8) | bytes[1]) % 31 != 0 || (bytes[1] & 0x20))
+    {
+        throw std::runtime_error("not a zlib stream!");
+    }
+    BitReader reader(bytes + 2, stream.size() - 2);
+    uint8_t* out = reinterpret_cast<uint8_t*>(output.data());
+    size_t position = 0;
+    size_t capacity = output.size();
+
+    HuffmanTable literals, distances;
+    bool last = false;
+    while (!last)
+    {
+        last = reader.Get(1) != 0;
+        uint32_t type = reader.Get(2);
+        if (type == 0)
+        {
+            reader.AlignToByte();
+            uint32_t length = reader.Get(16);
+            uint32_t inverse = reader.Get(16);
+            if ((length ^ 0xFFFF) != inverse || position + length > capacity)
+            {
+                Corrupt();
+            }
+            reader.ReadBytes(out + position, length);
+            position += length;
+            continue;
+        }
+        if (type == 1)
+        {
+            uint8_t lengths[288 + 30];
+            std::fill_n(lengths, 144, uint8_t(8));
+            std::fill_n(lengths + 144, 112, uint8_t(9));
+            std::fill_n(lengths + 256, 24, uint8_t(7));
+            std::fill_n(lengths + 280, 8, uint8_t(8));
+            std::fill_n(lengths + 288, 30, uint8_t(5));
+            literals.Build(std::span<const uint8_t>(lengths, 288));
+            distances.Build(std::span<const uint8_t>(lengths + 288, 30));
+        }
+        else if (type == 2)
+        {
+            ReadDynamicTables(reader, literals, distances);
+        }
+        else
+        {
+            Corrupt();
+        }
+
+        while (true)
+        {
+            uint32_t symbol = literals.Decode(reader);
+            if (symbol < 256)
+            {
+                if (position >= capacity)
+                {
+                    Corrupt();
+                }
+                out[position++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256)
+            {
+                break;
+            }
+            uint32_t lengthCode = symbol - 257;
+            if (lengthCode >= 29)
+            {
+                Corrupt();
+            }
+            uint32_t length = LengthBase[lengthCode] + reader.Get(LengthExtra[lengthCode]);
+            uint32_t distanceCode = distances.Decode(reader);
+            if (distanceCode >= 30)
+            {
+                Corrupt();
+            }
+            uint32_t distance = DistanceBase[distanceCode] + reader.Get(DistanceExtra[distanceCode]);
+            if (distance > position || position + length > capacity)
+            {
+                Corrupt();
+            }
+            // byte by byte, since a match can overlap the bytes it is making
+            const uint8_t* from = out + position - distance;
+            for (uint32_t i = 0; i < length; i++)
+            {
+                out[position + i] = from[i];
+            }
+            position += length;
+        }
+    }
+    if (position != capacity)
+    {
+        throw std::runtime_error("zlib stream is shorter than expected!");
+    }
+
+    reader.AlignToByte();
+    uint32_t adler = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        adler = (adler << 8) | reader.Get(8);
+    }
+    if (adler != Adler32(output))
+    {
+        throw std::runtime_error("zlib stream fails its checksum!");
+    }
+}
+#endif
@@ -0,0 +1,22 @@
+/**
+ * zlib streams (RFC 1950 wrapping RFC 1951 deflate), for supercompressing KTX2 levels and PNG image data.
+ * When the build finds zlib (ZLIB_AVAILABLE) these go straight to it. Otherwise an in-tree implementation stands in,
+ * so the build doesn't depend on it: the compressor finds matches with hash chains over a 32 KiB window and codes each 64 KiB of input as a dynamic
+ * Huffman block, or stores it as it is when that comes out smaller, so incompressible data grows by a few bytes at
+ * most. The decompressor reads any valid stream, looking codes up in one table per block rather than bit by bit.
+ */
+
+#pragma once
+
+#include <cstddef>  // For std::byte
+#include <cstdint>  // For uint32_t
+#include <span>     // For std::span
+#include <vector>   // For std::vector
+
+// maxChainLength is how many earlier positions with the same 3 bytes are tried for each match. More compresses
+// a little better and a lot slower.
+std::vector<std::byte> ZlibCompress(std::span<const std::byte> data, uint32_t maxChainLength = 32);
+
+// Inflate a stream into exactly output.size() bytes. Throws std::runtime_error if the stream is corrupt, fails
+// its checksum or doesn't inflate to that size.
+void ZlibDecompress(std::span<const std::byte> stream, std::span<std::byte> output);
@@ -0,0 +1,62 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // aim below the budget, so normal variance doesn't push every other frame over it
+    constexpr double Headroom = 0.9;
+
+    // how much of the way towards a higher scale to move each frame
+    constexpr double RecoveryRate = 0.05;
+
+    // changes smaller than this are not worth a different render size
+    constexpr double MinScaleChange = 0.01;
+}
+
+DynamicResolution::DynamicResolution(const Settings& settings)
+    : m_Settings(settings),
+    m_Scale(settings.maxScale)
+{
+}
+
+double DynamicResolution::Update(double gpuMs)
+{
+    m_Stats.frames++;
+    m_Stats.scaleSum += m_Scale;
+    m_Stats.minScale = std::min(m_Stats.minScale, m_Scale);
+    if (gpuMs > m_Settings.budgetMs)
+    {
+        m_Stats.framesOverBudget++;
+    }
+
+    if (gpuMs <= 0)
+    {
+        return m_Scale;
+    }
+
+    // pixel count goes with the square of the axis scale
+    double idealScale = m_Scale * std::sqrt(m_Settings.budgetMs * Headroom / gpuMs);
+
+    double newScale;
+    if (idealScale < m_Scale)
+    {
+        newScale = idealScale;      // drop straight away, a late frame is worse than a blurry one
+    }
+    else
+    {
+        newScale = std::min(idealScale, m_Scale + std::max((idealScale - m_Scale) * RecoveryRate, MinScaleChange));
+    }
+    newScale = std::clamp(newScale, m_Settings.minScale, m_Settings.maxScale);
+
+    if (std::abs(newScale - m_Scale) >= MinScaleChange || newScale == m_Settings.maxScale || newScale == m_Settings.minScale)
+    {
+        m_Scale = newScale;
+    }
+    return m_Scale;
+}
+
+uint32_t DynamicResolution::Scale(uint32_t size) const
+{
+    return std::max(1u, static_cast<uint32_t>(std::lround(size * m_Scale)));
+}
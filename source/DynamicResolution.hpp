@@ -0,0 +1,58 @@
+/**
+ * Picks a render resolution from GPU frame time feedback, to hold a frame time budget.
+ * GPU time is assumed to scale with pixel count, so the axis scale moves with the square root
+ * of the budget over the measured time. Spikes over budget are answered on the next frame,
+ * while recovering towards full resolution is damped so the scale doesn't oscillate.
+ */
+
+#pragma once
+
+#include <cstdint>  // For uint32_t, uint64_t
+
+class DynamicResolution
+{
+public:
+    struct Settings
+    {
+        double budgetMs = 16.6;
+        double minScale = 0.5;      // per axis
+        double maxScale = 1.0;
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t framesOverBudget = 0;
+        double scaleSum = 0;
+        double minScale = 1;
+
+        double AverageScale() const {
+            return frames == 0 ? 1.0 : scaleSum / frames;
+        }
+    };
+
+    DynamicResolution(const Settings& settings);
+    virtual ~DynamicResolution() = default;
+
+    // Feed the GPU time of a finished frame. Returns the scale to render the next frame at.
+    double Update(double gpuMs);
+
+    double GetScale() const {
+        return m_Scale;
+    }
+
+    // A full resolution size scaled down to the current render size.
+    uint32_t Scale(uint32_t size) const;
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+    const Settings& GetSettings() const {
+        return m_Settings;
+    }
+
+private:
+    Settings    m_Settings;
+    double      m_Scale;
+    Stats       m_Stats;
+};
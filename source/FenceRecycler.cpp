@@ -0,0 +1,112 @@
+#include "FenceRecycler.hpp"
+#include "CommandLine.hpp"
+
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <queue>
+#include <vector>
+
+namespace {
+    // how long each configuration runs for
+    constexpr auto BenchmarkDuration = std::chrono::milliseconds(250);
+
+    // submissions the simulated GPU lags behind, like frames in flight
+    constexpr uint64_t GpuLag = 4;
+
+    // what CommandQueue used to do, made thread-safe with a single lock
+    template<typename T>
+    class LockedQueue
+    {
+    public:
+        void Push(uint64_t fenceValue, T object)
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Entries.push({ fenceValue, std::move(object) });
+        }
+
+        template<typename IsComplete>
+        std::optional<T> TryPop(IsComplete&& isComplete)
+        {
+            std::lock_guard lock(m_Mutex);
+            if (m_Entries.empty() || !isComplete(m_Entries.front().first))
+            {
+                return std::nullopt;
+            }
+            std::optional<T> object(std::move(m_Entries.front().second));
+            m_Entries.pop();
+            return object;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::queue<std::pair<uint64_t, T>> m_Entries;
+    };
+
+    struct Result
+    {
+        double opsPerSecond;
+        uint64_t created;   // objects that had to be made because nothing was ready
+    };
+
+    // every thread repeatedly requests an object, "records" into it and submits it, like GetCommandList and ExecuteCommandList
+    template<typename Recycler>
+    Result Run(Recycler& recycler, uint32_t threadCount)
+    {
+        std::atomic<uint64_t> submitted = 0;
+        std::atomic<uint64_t> created = 0;
+        std::atomic<uint64_t> operations = 0;
+        std::atomic<bool> stop = false;
+        auto isComplete = [&submitted](uint64_t fenceValue) {
+            return fenceValue + GpuLag <= submitted.load(std::memory_order_relaxed);
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&]() {
+                uint64_t localOperations = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    auto object = recycler.TryPop(isComplete);
+                    if (!object)
+                    {
+                        object = created.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    recycler.Push(submitted.fetch_add(1, std::memory_order_relaxed) + 1, *object);
+                    localOperations++;
+                }
+                operations += localOperations;
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(BenchmarkDuration);
+        stop = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return { operations / seconds, created };
+    }
+}
+
+int RunFenceRecyclerBenchmark()
+{
+    uint32_t maxThreads = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+
+    std::cout << std::format("{:>8} {:>16} {:>16} {:>10} {:>10}", "threads", "locked ops/s", "sharded ops/s", "steals", "contended") << std::endl;
+    for (uint32_t threads = 1; threads <= maxThreads; threads = threads < maxThreads ? std::min(threads * 2, maxThreads) : threads + 1)
+    {
+        LockedQueue<uint64_t> locked;
+        auto lockedResult = Run(locked, threads);
+
+        FenceRecycler<uint64_t> sharded;
+        auto shardedResult = Run(sharded, threads);
+        auto stats = sharded.GetStats();
+
+        std::cout << std::format("{:>8} {:>16.0f} {:>16.0f} {:>10} {:>10}", threads, lockedResult.opsPerSecond, shardedResult.opsPerSecond,
+            stats.steals, stats.contended) << std::endl;
+    }
+    return 0;
+}
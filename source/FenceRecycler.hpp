@@ -0,0 +1,176 @@
+/**
+ * Thread-safe pool of objects the GPU is done with after a fence value, shared by the backends' command recycling.
+ * Objects are kept in shards, one per hardware thread, chosen by the calling thread. Threads mostly stay on their own
+ * shard and only take another shard's lock when theirs has nothing ready, so many threads can request command lists
+ * without queueing up behind a single lock.
+ * Each shard is ordered by push, and fence values within a queue only grow, so only the front of a shard has to be checked.
+ */
+
+#pragma once
+
+#include <algorithm>    // For std::max
+#include <atomic>       // For std::atomic
+#include <cstddef>      // For size_t
+#include <cstdint>      // For uint64_t
+#include <deque>        // For std::deque
+#include <memory_resource>  // For std::pmr::unsynchronized_pool_resource
+#include <memory>       // For std::unique_ptr
+#include <mutex>        // For std::mutex
+#include <optional>     // For std::optional
+#include <thread>       // For std::thread
+
+template<typename T>
+class FenceRecycler
+{
+public:
+    struct Stats
+    {
+        uint64_t pushes = 0;
+        uint64_t pops = 0;          // objects handed back out
+        uint64_t steals = 0;        // pops that came from another thread's shard
+        uint64_t contended = 0;     // times a thread had to wait for its own shard's lock
+    };
+
+    explicit FenceRecycler(size_t shardCount = std::thread::hardware_concurrency())
+        : m_ShardCount(std::max<size_t>(shardCount, 1)),
+        m_Shards(std::make_unique<Shard[]>(m_ShardCount))
+    {
+    }
+    virtual ~FenceRecycler() {}
+
+    // Hand back an object that is in use until the GPU reaches fenceValue. 0 means it's free right away.
+    void Push(uint64_t fenceValue, T object)
+    {
+        auto& shard = LockShard(GetShardIndex());
+        shard.entries.push_back({ fenceValue, std::move(object) });
+        shard.pushes++;
+        shard.mutex.unlock();
+    }
+
+    // Take an object whose fence value isComplete(fenceValue) says the GPU has reached, if there is one.
+    // The calling thread's shard is tried first, the others only if they aren't busy.
+    template<typename IsComplete>
+    std::optional<T> TryPop(IsComplete&& isComplete)
+    {
+        size_t home = GetShardIndex();
+        {
+            auto& shard = LockShard(home);
+            auto object = PopFront(shard, isComplete);
+            shard.mutex.unlock();
+            if (object)
+            {
+                return object;
+            }
+        }
+        for (size_t i = 1; i < m_ShardCount; i++)
+        {
+            auto& shard = m_Shards[(home + i) % m_ShardCount];
+            if (!shard.mutex.try_lock())
+            {
+                continue;
+            }
+            auto object = PopFront(shard, isComplete);
+            if (object)
+            {
+                shard.steals++;
+            }
+            shard.mutex.unlock();
+            if (object)
+            {
+                return object;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Call f on every object still held and empty the recycler, for shutdown.
+    template<typename F>
+    void Drain(F&& f)
+    {
+        for (size_t i = 0; i < m_ShardCount; i++)
+        {
+            std::lock_guard lock(m_Shards[i].mutex);
+            for (auto& entry : m_Shards[i].entries)
+            {
+                f(entry.object);
+            }
+            m_Shards[i].entries.clear();
+        }
+    }
+
+    Stats GetStats()
+    {
+        Stats stats;
+        for (size_t i = 0; i < m_ShardCount; i++)
+        {
+            std::lock_guard lock(m_Shards[i].mutex);
+            stats.pushes += m_Shards[i].pushes;
+            stats.pops += m_Shards[i].pops;
+            stats.steals += m_Shards[i].steals;
+            stats.contended += m_Shards[i].contended;
+        }
+        return stats;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t fenceValue;
+        T object;
+    };
+
+    // on its own cache line, so threads working on neighbouring shards don't slow each other down
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        // the deque frees and reallocates its chunks as entries cycle through it, keep them instead of going back to the heap.
+        // Already under the shard's lock, so the pool needs none of its own
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::deque<Entry> entries{ &pool };
+        uint64_t pushes = 0;
+        uint64_t pops = 0;
+        uint64_t steals = 0;
+        uint64_t contended = 0;
+    };
+
+    size_t GetShardIndex() const
+    {
+        // threads are numbered as they first show up, which spreads them out more evenly than hashing their ids
+        static std::atomic<size_t> nextThread = 0;
+        thread_local size_t threadIndex = nextThread++;
+        return threadIndex % m_ShardCount;
+    }
+
+    Shard& LockShard(size_t index)
+    {
+        auto& shard = m_Shards[index];
+        if (!shard.mutex.try_lock())
+        {
+            shard.mutex.lock();
+            shard.contended++;
+        }
+        return shard;
+    }
+
+    template<typename IsComplete>
+    static std::optional<T> PopFront(Shard& shard, IsComplete& isComplete)
+    {
+        if (shard.entries.empty() || (shard.entries.front().fenceValue != 0 && !isComplete(shard.entries.front().fenceValue)))
+        {
+            return std::nullopt;
+        }
+        std::optional<T> object(std::move(shard.entries.front().object));
+        shard.entries.pop_front();
+        shard.pops++;
+        return object;
+    }
+
+    size_t                      m_ShardCount;
+    std::unique_ptr<Shard[]>    m_Shards;
+};
+
+// CPU-only benchmark of FenceRecycler against a single locked queue, with increasing numbers of threads
+// requesting and returning objects. The objects are plain numbers and nothing waits on a GPU, so only the locking
+// and queue operations are timed: it shows how the pool scales with threads, not what it saves a frame over creating
+// and resetting real fences or command lists. Run with --bench-recycler, --bench-threads=N sets the most threads to try.
+int RunFenceRecyclerBenchmark();
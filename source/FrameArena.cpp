@@ -0,0 +1,382 @@
+#include "FrameArena.hpp"
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+LinearArena::LinearArena(size_t blockSize, std::pmr::memory_resource* upstream)
+    : m_Upstream(upstream),
+    m_BlockSize(std::max<size_t>(blockSize, 256))
+{
+}
+
+LinearArena::~LinearArena()
+{
+    ReleaseBlocks();
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+    m_Stats.allocations++;
+    for (;;)
+    {
+        // move on through the blocks kept from earlier frames before asking for another
+        if (m_CurrentBlock == m_Blocks.size())
+        {
+            AddBlock(std::max(m_BlockSize, size + alignment));
+        }
+        auto& block = m_Blocks[m_CurrentBlock];
+        auto address = reinterpret_cast<uintptr_t>(block.data) + m_Offset;
+        size_t padding = (alignment - address % alignment) % alignment;
+        if (m_Offset + padding + size <= block.size)
+        {
+            void* result = block.data + m_Offset + padding;
+            m_Offset += padding + size;
+            m_Stats.usedBytes += padding + size;
+            m_Stats.peakBytes = std::max(m_Stats.peakBytes, m_Stats.usedBytes);
+            return result;
+        }
+        m_CurrentBlock++;
+        m_Offset = 0;
+    }
+}
+
+void LinearArena::Reset()
+{
+    if (m_Blocks.size() > 1)
+    {
+        size_t total = m_Stats.capacityBytes;
+        ReleaseBlocks();
+        AddBlock(total);
+    }
+    m_CurrentBlock = 0;
+    m_Offset = 0;
+    m_Stats.usedBytes = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    return Allocate(bytes, alignment);
+}
+
+void LinearArena::AddBlock(size_t size)
+{
+    m_Blocks.push_back({ static_cast<std::byte*>(m_Upstream->allocate(size)), size });
+    m_Stats.blockAllocations++;
+    m_Stats.capacityBytes += size;
+}
+
+void LinearArena::ReleaseBlocks()
+{
+    for (const auto& block : m_Blocks)
+    {
+        m_Upstream->deallocate(block.data, block.size);
+    }
+    m_Blocks.clear();
+    m_Stats.capacityBytes = 0;
+}
+
+FrameArenas::FrameArenas(uint32_t framesInFlight, size_t blockSize, uint32_t threadCount, std::pmr::memory_resource* upstream)
+    : m_FramesInFlight(framesInFlight),
+    m_ThreadCount(std::max(threadCount, 1u)),
+    m_ThreadSlots(std::make_unique<std::atomic<std::thread::id>[]>(m_ThreadCount)),
+    m_Arenas(std::make_unique<std::unique_ptr<LinearArena>[]>(m_FramesInFlight * m_ThreadCount))
+{
+    // arenas don't take any memory until they are first used, so threads that never allocate cost nothing
+    for (uint32_t i = 0; i < m_FramesInFlight * m_ThreadCount; i++)
+    {
+        m_Arenas[i] = std::make_unique<LinearArena>(blockSize, upstream);
+    }
+}
+
+void FrameArenas::BeginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < m_FramesInFlight);
+
+    size_t frameBytes = 0;
+    for (uint32_t thread = 0; thread < m_ThreadCount; thread++)
+    {
+        auto& arena = *m_Arenas[frameIndex * m_ThreadCount + thread];
+        frameBytes += arena.GetStats().usedBytes;
+        arena.Reset();
+    }
+    m_PeakFrameBytes = std::max(m_PeakFrameBytes, frameBytes);
+
+    // blame any growth since the last call, including merging blocks just now, on the frame that just finished
+    auto stats = GetStats();
+    if (stats.blockAllocations != m_BlockAllocations)
+    {
+        m_BlockAllocations = stats.blockAllocations;
+        m_LastGrowthFrame = m_FrameCount;
+    }
+    m_FrameCount++;
+    m_CurrentFrame.store(frameIndex, std::memory_order_release);
+}
+
+LinearArena& FrameArenas::Get()
+{
+    uint32_t slot = GetThreadSlot();
+    uint32_t frame = m_CurrentFrame.load(std::memory_order_acquire);
+    return *m_Arenas[frame * m_ThreadCount + slot];
+}
+
+void FrameArenas::ReleaseThread()
+{
+    auto self = std::this_thread::get_id();
+    for (uint32_t slot = 0; slot < m_ThreadCount; slot++)
+    {
+        if (m_ThreadSlots[slot].load(std::memory_order_relaxed) == self)
+        {
+            m_ThreadSlots[slot].store(std::thread::id(), std::memory_order_release);
+            return;
+        }
+    }
+}
+
+uint32_t FrameArenas::GetThreadSlot()
+{
+    // The slot this thread used last, if it was from these arenas. It's checked against the table, as the thread
+    // may have released it since, or these arenas may be new ones at the address of some destroyed before
+    thread_local const FrameArenas* cachedArenas = nullptr;
+    thread_local uint32_t cachedSlot = 0;
+    auto self = std::this_thread::get_id();
+    if (cachedArenas == this && m_ThreadSlots[cachedSlot].load(std::memory_order_relaxed) == self)
+    {
+        return cachedSlot;
+    }
+
+    // a slot can only hold this thread's id if this thread put it there
+    uint32_t found = m_ThreadCount;
+    for (uint32_t slot = 0; slot < m_ThreadCount && found == m_ThreadCount; slot++)
+    {
+        if (m_ThreadSlots[slot].load(std::memory_order_relaxed) == self)
+        {
+            found = slot;
+        }
+    }
+    for (uint32_t slot = 0; slot < m_ThreadCount && found == m_ThreadCount; slot++)
+    {
+        auto free = std::thread::id();
+        if (m_ThreadSlots[slot].compare_exchange_strong(free, self, std::memory_order_acq_rel))
+        {
+            found = slot;
+        }
+    }
+    if (found == m_ThreadCount)
+    {
+        throw std::runtime_error(std::format("all {} FrameArenas thread slots are taken!", m_ThreadCount));
+    }
+    cachedArenas = this;
+    cachedSlot = found;
+    return found;
+}
+
+FrameArenas::Stats FrameArenas::GetStats() const
+{
+    Stats stats{
+        .frames = m_FrameCount,
+        .lastGrowthFrame = m_LastGrowthFrame,
+        .peakFrameBytes = m_PeakFrameBytes
+    };
+    for (uint32_t i = 0; i < m_FramesInFlight * m_ThreadCount; i++)
+    {
+        const auto& arenaStats = m_Arenas[i]->GetStats();
+        stats.allocations += arenaStats.allocations;
+        stats.blockAllocations += arenaStats.blockAllocations;
+        stats.capacityBytes += arenaStats.capacityBytes;
+    }
+    return stats;
+}
+
+namespace {
+    constexpr uint32_t FramesInFlight = 2;
+
+    // hands allocations on to the heap, counting them
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        uint64_t GetAllocations() const {
+            return m_Allocations.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            m_Allocations.fetch_add(1, std::memory_order_relaxed);
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        std::atomic<uint64_t> m_Allocations = 0;
+    };
+
+    // roughly what a renderer keeps per draw
+    struct DrawPacket
+    {
+        uint64_t sortKey;
+        uint32_t pipeline;
+        uint32_t material;
+        uint32_t mesh;
+        uint32_t instanceCount;
+        float transform[12];
+    };
+
+    // One thread's share of a frame: gather draw packets without knowing up front how many there will be,
+    // sort them, and build the per-draw binding lists recording would use.
+    uint64_t BuildDraws(std::pmr::memory_resource* resource, uint32_t first, uint32_t count, uint64_t frame)
+    {
+        std::pmr::vector<DrawPacket> packets(resource);
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            uint32_t pipeline = i % 7;
+            uint32_t material = (i * 2654435761u) % 61;
+            packets.push_back(DrawPacket{
+                .sortKey = (uint64_t(pipeline) << 48) | (uint64_t(material) << 32) | ((i + frame) & 0xffff),
+                .pipeline = pipeline,
+                .material = material,
+                .mesh = i % 101,
+                .instanceCount = 1 + i % 3,
+                .transform = { 1, 0, 0, float(i), 0, 1, 0, 0, 0, 0, 1, 0 }
+            });
+        }
+
+        std::pmr::vector<uint32_t> order(packets.size(), resource);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return packets[a].sortKey < packets[b].sortKey;
+        });
+
+        // the inner vectors get the same resource as the outer one
+        std::pmr::vector<std::pmr::vector<uint32_t>> bindings(resource);
+        bindings.reserve(packets.size());
+        uint64_t checksum = 0;
+        for (uint32_t index : order)
+        {
+            const auto& packet = packets[index];
+            auto& list = bindings.emplace_back();
+            list.push_back(packet.mesh);
+            list.push_back(packet.material);
+            for (uint32_t instance = 0; instance < packet.instanceCount; instance++)
+            {
+                list.push_back(index + instance);
+            }
+            checksum += list.size() + packet.sortKey;
+        }
+        return checksum;
+    }
+
+    struct Result
+    {
+        double msPerFrame;
+        double allocationsPerFrame;         // over all frames
+        uint64_t steadyStateAllocations;    // after the warmup frames
+    };
+
+    // threadCount workers each build their share of every frame, with the main thread starting frames like a renderer would
+    template<typename GetResource>
+    Result Run(uint32_t threadCount, uint32_t draws, uint32_t frames, uint32_t warmup, CountingResource& heap, GetResource&& getResource, FrameArenas* arenas)
+    {
+        std::barrier start(threadCount + 1);
+        std::barrier done(threadCount + 1);
+        std::atomic<bool> stop = false;
+        std::atomic<uint64_t> checksum = 0;
+        uint64_t frame = 0;
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&, i]() {
+                uint32_t first = draws * i / threadCount;
+                uint32_t count = draws * (i + 1) / threadCount - first;
+                for (;;)
+                {
+                    start.arrive_and_wait();
+                    if (stop)
+                    {
+                        break;
+                    }
+                    checksum += BuildDraws(getResource(), first, count, frame);
+                    done.arrive_and_wait();
+                }
+                if (arenas)
+                {
+                    arenas->ReleaseThread();
+                }
+            });
+        }
+
+        uint64_t allocationsBefore = heap.GetAllocations();
+        uint64_t steadyStateStart = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (frame = 0; frame < frames; frame++)
+        {
+            if (frame == warmup)
+            {
+                steadyStateStart = heap.GetAllocations();
+            }
+            // the GPU is never behind here, so the slot is always free to reuse
+            if (arenas)
+            {
+                arenas->BeginFrame(frame % FramesInFlight);
+            }
+            start.arrive_and_wait();
+            done.arrive_and_wait();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        uint64_t allocations = heap.GetAllocations();
+
+        stop = true;
+        start.arrive_and_wait();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        return {
+            seconds * 1000.0 / frames,
+            double(allocations - allocationsBefore) / frames,
+            allocations - steadyStateStart
+        };
+    }
+}
+
+int RunFrameArenaBenchmark()
+{
+    uint32_t threadCount = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+    uint32_t draws = CommandLine::GetValue("draws", 10000u);
+    uint32_t frames = std::max(CommandLine::GetValue("frames", 500u), 2u);
+    uint32_t warmup = std::min(frames / 2, 10u);
+
+    std::cout << std::format("{} threads, {} draws per frame, {} frames ({} warmup)", threadCount, draws, frames, warmup) << std::endl;
+    std::cout << std::format("{:<8} {:>10} {:>14} {:>22}", "memory", "ms/frame", "heap allocs", "steady-state allocs") << std::endl;
+
+    CountingResource heap;
+    auto heapResult = Run(threadCount, draws, frames, warmup, heap, [&heap]() -> std::pmr::memory_resource* {
+        return &heap;
+    }, nullptr);
+    std::cout << std::format("{:<8} {:>10.3f} {:>14.1f} {:>22}", "heap", heapResult.msPerFrame, heapResult.allocationsPerFrame, heapResult.steadyStateAllocations) << std::endl;
+
+    CountingResource arenaHeap;
+    FrameArenas arenas(FramesInFlight, 64 * 1024, threadCount + 1, &arenaHeap);
+    auto arenaResult = Run(threadCount, draws, frames, warmup, arenaHeap, [&arenas]() {
+        return arenas.GetResource();
+    }, &arenas);
+    std::cout << std::format("{:<8} {:>10.3f} {:>14.1f} {:>22}", "arena", arenaResult.msPerFrame, arenaResult.allocationsPerFrame, arenaResult.steadyStateAllocations) << std::endl;
+
+    auto stats = arenas.GetStats();
+    std::cout << std::format("Arenas: {} KiB held, {} KiB peak per frame, last grew in frame {}",
+        stats.capacityBytes / 1024, stats.peakFrameBytes / 1024, stats.lastGrowthFrame) << std::endl;
+
+    return arenaResult.steadyStateAllocations == 0 ? 0 : 1;
+}
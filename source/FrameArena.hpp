@@ -0,0 +1,137 @@
+/**
+ * Linear allocators for CPU data that only lives as long as one frame: draw packets, sort keys,
+ * barrier and submit arrays. Allocating is a pointer bump, freeing does nothing, and everything
+ * is thrown away at once when the GPU is done with the frame.
+ * FrameArenas keeps one set of arenas per frame in flight, so the CPU can fill the next frame while
+ * the GPU still reads the last one, and one sub-arena per thread, so recording threads never share a lock.
+ * Each FrameArenas has a fixed number of thread slots, taken by threads as they first allocate from it.
+ * Arenas keep their memory when they are reset, so after the first few frames they stop touching the heap.
+ * Both are std::pmr::memory_resources, so standard containers can allocate from them:
+ *     std::pmr::vector<DrawPacket> packets(arenas.GetResource());
+ * Only put trivially destructible data in them, or make sure destructors have run before the reset.
+ */
+
+#pragma once
+
+#include <atomic>           // For std::atomic
+#include <cstddef>          // For size_t, std::byte
+#include <cstdint>          // For uint32_t, uint64_t
+#include <memory>           // For std::unique_ptr
+#include <memory_resource>  // For std::pmr::memory_resource
+#include <thread>           // For std::thread
+#include <type_traits>      // For std::is_trivially_destructible_v
+#include <vector>           // For std::vector
+
+class LinearArena : public std::pmr::memory_resource
+{
+public:
+    struct Stats
+    {
+        uint64_t allocations = 0;       // from the arena
+        uint64_t blockAllocations = 0;  // from the upstream resource, what the arena is there to avoid
+        size_t usedBytes = 0;           // since the last reset
+        size_t peakBytes = 0;           // most used between two resets
+        size_t capacityBytes = 0;       // held from upstream
+    };
+
+    // Memory comes from upstream in blocks of at least blockSize.
+    explicit LinearArena(size_t blockSize = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    virtual ~LinearArena();
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // uninitialized storage for count Ts
+    template<typename T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Forget everything allocated so far. If the last frame spilled into more than one block,
+    // they are replaced by a single one big enough for all of it, so the next frame fits without growing.
+    void Reset();
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+private:
+    struct Block
+    {
+        std::byte* data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    void AddBlock(size_t size);
+    void ReleaseBlocks();
+
+    std::pmr::memory_resource*  m_Upstream;
+    size_t                      m_BlockSize;
+    std::vector<Block>          m_Blocks;
+    size_t                      m_CurrentBlock = 0;
+    size_t                      m_Offset = 0;         // into the current block
+    Stats                       m_Stats;
+};
+
+class FrameArenas
+{
+public:
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t allocations = 0;
+        uint64_t blockAllocations = 0;
+        uint64_t lastGrowthFrame = 0;   // the last frame that had to go to the heap
+        size_t peakFrameBytes = 0;      // over all threads
+        size_t capacityBytes = 0;
+    };
+
+    // Threads take one of threadCount slots the first time they allocate from these arenas, and keep it until they call ReleaseThread.
+    explicit FrameArenas(uint32_t framesInFlight, size_t blockSize = 64 * 1024, uint32_t threadCount = std::thread::hardware_concurrency(),
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    virtual ~FrameArenas() {}
+
+    // Rewind every thread's arena for this frame slot and allocate from it until the next BeginFrame.
+    // Only call this once the GPU has finished the frame that last used the slot, and while no other thread is allocating.
+    void BeginFrame(uint32_t frameIndex);
+
+    // the calling thread's arena for the current frame.
+    // Throws std::runtime_error if the thread has no slot yet and all of them are taken
+    LinearArena& Get();
+    std::pmr::memory_resource* GetResource() {
+        return &Get();
+    }
+
+    // Give up the calling thread's slot, for a thread that is done allocating from these arenas, like one about to exit.
+    // What it allocated stays valid until its frame slot is reset, whichever thread takes the slot next.
+    void ReleaseThread();
+
+    Stats GetStats() const;
+
+private:
+    uint32_t GetThreadSlot();
+
+    uint32_t                        m_FramesInFlight;
+    uint32_t                        m_ThreadCount;
+    std::unique_ptr<std::atomic<std::thread::id>[]> m_ThreadSlots;  // the thread holding each slot, or no thread
+    std::unique_ptr<std::unique_ptr<LinearArena>[]> m_Arenas;      // [frame * m_ThreadCount + thread]
+    std::atomic<uint32_t>           m_CurrentFrame = 0;
+    uint64_t                        m_FrameCount = 0;
+    uint64_t                        m_BlockAllocations = 0;        // as of the last BeginFrame
+    uint64_t                        m_LastGrowthFrame = 0;
+    size_t                          m_PeakFrameBytes = 0;
+};
+
+// CPU-only benchmark building frames of draw packets with the heap and with FrameArenas,
+// counting the allocations that reach the heap. Run with --bench-arena; --bench-threads=N, --draws=N and --frames=N change the workload.
+int RunFrameArenaBenchmark();
@@ -0,0 +1,44 @@
+#include "FrameTimings.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+FrameTimings::FrameTimings()
+    : m_FrameMs(MaxFrames)
+    , m_SubmitMs(MaxFrames)
+{
+}
+
+void FrameTimings::Add(double frameMs, double submitMs)
+{
+    m_FrameMs[m_Next] = frameMs;
+    m_SubmitMs[m_Next] = submitMs;
+    m_Next = (m_Next + 1) % MaxFrames;
+    m_Count = std::min(m_Count + 1, MaxFrames);
+}
+
+FrameTimings::Summary FrameTimings::Summarize(const std::vector<double>& ring) const
+{
+    Summary summary;
+    if (m_Count == 0)
+    {
+        return summary;
+    }
+    // until the ring wraps the frames kept are its start, after that all of it. The order doesn't matter once sorted
+    std::vector<double> samples(ring.begin(), ring.begin() + m_Count);
+    std::sort(samples.begin(), samples.end());
+
+    // nearest rank
+    auto percentile = [&samples](double p) {
+        auto rank = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+    summary.frames = samples.size();
+    summary.averageMs = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    summary.maxMs = samples.back();
+    return summary;
+}
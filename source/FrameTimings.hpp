@@ -0,0 +1,49 @@
+/**
+ * Per-frame CPU timings collected by the main loop, for comparing backends.
+ * Both the whole frame (everything between the starts of two frames, including pacing and waits) and the cost of
+ * recording and submitting it are kept, and summarized as percentiles since averages hide hitches.
+ * Only the most recent MaxFrames are kept, in a ring allocated up front, so long runs neither grow it nor allocate
+ * in the main loop.
+ */
+
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint64_t
+#include <vector>   // For std::vector
+
+class FrameTimings
+{
+public:
+    static constexpr size_t MaxFrames = 4096;
+
+    struct Summary
+    {
+        uint64_t frames = 0;
+        double averageMs = 0;
+        double p50Ms = 0;
+        double p95Ms = 0;
+        double p99Ms = 0;
+        double maxMs = 0;
+    };
+
+    FrameTimings();
+
+    // overwrites the oldest frame once MaxFrames are kept
+    void Add(double frameMs, double submitMs);
+
+    Summary SummarizeFrames() const {
+        return Summarize(m_FrameMs);
+    }
+    Summary SummarizeSubmits() const {
+        return Summarize(m_SubmitMs);
+    }
+
+private:
+    Summary Summarize(const std::vector<double>& ring) const;
+
+    std::vector<double> m_FrameMs;
+    std::vector<double> m_SubmitMs;
+    size_t              m_Next = 0;     // where the next frame goes
+    size_t              m_Count = 0;    // frames kept, up to MaxFrames
+};
@@ -0,0 +1,349 @@
+#include "FrameWriter.hpp"
+#include "CommandLine.hpp"
+#include "MappedFile.hpp"
+#include "Png.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+FrameWriter::FrameWriter(const Settings& settings)
+    : m_Settings(settings)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_Settings.directory, error);
+    if (error)
+    {
+        throw std::runtime_error("failed to create the capture directory!");
+    }
+    m_Settings.maxQueued = std::max(m_Settings.maxQueued, 1u);
+    m_Thread = std::thread(&FrameWriter::WriterMain, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_FrameQueued.notify_one();
+    m_Thread.join();
+}
+
+const char* FrameWriter::GetFormatName(Format format)
+{
+    return format == Format::Png ? "png" : "raw";
+}
+
+std::filesystem::path FrameWriter::GetFileName(uint64_t number, Format format)
+{
+    return std::format("frame{:06}.{}", number, format == Format::Png ? "png" : "rgba");
+}
+
+void FrameWriter::Submit(uint64_t number, std::span<const std::byte> pixels, uint32_t width, uint32_t height, uint32_t rowPitch, bool bgra)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t rowSize = size_t(width) * 4;
+    if (width == 0 || height == 0 || rowPitch < rowSize || pixels.size() < size_t(rowPitch) * (height - 1) + rowSize)
+    {
+        throw std::runtime_error("captured frame is smaller than its size says!");
+    }
+
+    std::unique_lock lock(m_Mutex);
+    RethrowError();
+    if (m_Queue.size() >= m_Settings.maxQueued)
+    {
+        m_Stats.submitWaits++;
+        m_FrameDone.wait(lock, [this] { return m_Queue.size() < m_Settings.maxQueued || m_Error; });
+        RethrowError();
+    }
+    Frame frame{ number, width, height, bgra, {} };
+    if (!m_SpareBuffers.empty())
+    {
+        frame.pixels = std::move(m_SpareBuffers.back());
+        m_SpareBuffers.pop_back();
+    }
+    lock.unlock();
+
+    // the copy is the only part on the caller's thread, a row at a time when the rows are padded
+    frame.pixels.resize(rowSize * height);
+    if (rowPitch == rowSize)
+    {
+        std::memcpy(frame.pixels.data(), pixels.data(), frame.pixels.size());
+    }
+    else
+    {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            std::memcpy(frame.pixels.data() + y * rowSize, pixels.data() + size_t(y) * rowPitch, rowSize);
+        }
+    }
+
+    lock.lock();
+    m_Queue.push_back(std::move(frame));
+    m_Stats.submitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    lock.unlock();
+    m_FrameQueued.notify_one();
+}
+
+void FrameWriter::Finish()
+{
+    std::unique_lock lock(m_Mutex);
+    m_FrameDone.wait(lock, [this] { return (m_Queue.empty() && !m_Writing) || m_Error; });
+    RethrowError();
+}
+
+FrameWriter::Stats FrameWriter::GetStats() const
+{
+    std::lock_guard lock(m_Mutex);
+    return m_Stats;
+}
+
+// called with the mutex held
+void FrameWriter::RethrowError()
+{
+    if (m_Error)
+    {
+        std::rethrow_exception(std::exchange(m_Error, nullptr));
+    }
+}
+
+void FrameWriter::WriterMain()
+{
+    std::unique_lock lock(m_Mutex);
+    for (;;)
+    {
+        // finish the queue before stopping
+        m_FrameQueued.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+        if (m_Queue.empty())
+        {
+            return;
+        }
+        Frame frame = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        m_Writing = true;
+        lock.unlock();
+        m_FrameDone.notify_all();
+
+        std::exception_ptr error;
+        try
+        {
+            WriteFrame(frame);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        m_Writing = false;
+        if (error)
+        {
+            m_Error = error;
+        }
+        m_SpareBuffers.push_back(std::move(frame.pixels));
+        m_FrameDone.notify_all();
+    }
+}
+
+void FrameWriter::WriteFrame(Frame& frame)
+{
+    auto start = std::chrono::steady_clock::now();
+    // RGBA in place, which the files and the golden images are in
+    auto& pixels = frame.pixels;
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        if (frame.bgra)
+        {
+            std::swap(pixels[i], pixels[i + 2]);
+        }
+        if (m_Settings.opaque)
+        {
+            pixels[i + 3] = 255;
+        }
+    }
+    std::vector<std::byte> encoded;
+    if (m_Settings.format == Format::Png)
+    {
+        encoded = WritePng(pixels, frame.width, frame.height, m_Settings.maxChainLength);
+    }
+    auto encodedAt = std::chrono::steady_clock::now();
+
+    auto name = GetFileName(frame.number, m_Settings.format);
+    auto bytes = m_Settings.format == Format::Png ? std::span<const std::byte>(encoded) : std::as_bytes(std::span(pixels));
+    std::ofstream file(m_Settings.directory / name, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!file)
+    {
+        throw std::runtime_error("failed to write a captured frame!");
+    }
+    file.close();
+    auto writtenAt = std::chrono::steady_clock::now();
+
+    // against the golden image of the same frame, if there is one
+    bool compared = false, missing = false, mismatch = false;
+    uint32_t maxDifference = 0;
+    double psnr = std::numeric_limits<double>::infinity();
+    if (!m_Settings.goldenDirectory.empty())
+    {
+        auto goldenPath = m_Settings.goldenDirectory / GetFileName(frame.number, Format::Png);
+        if (!std::filesystem::exists(goldenPath))
+        {
+            missing = true;
+        }
+        else
+        {
+            MappedFile mapped(goldenPath);
+            auto golden = ReadPng(mapped.GetData());
+            compared = true;
+            if (golden.width != frame.width || golden.height != frame.height)
+            {
+                mismatch = true;
+                maxDifference = 255;
+                psnr = 0;
+            }
+            else
+            {
+                double squaredError = 0;
+                for (size_t i = 0; i < pixels.size(); i++)
+                {
+                    int difference = std::abs(int(pixels[i]) - golden.rgba[i]);
+                    maxDifference = std::max(maxDifference, uint32_t(difference));
+                    squaredError += double(difference) * difference;
+                }
+                mismatch = maxDifference > m_Settings.tolerance;
+                if (squaredError > 0)
+                {
+                    psnr = 10.0 * std::log10(255.0 * 255.0 / (squaredError / pixels.size()));
+                }
+            }
+        }
+    }
+
+    std::lock_guard lock(m_Mutex);
+    m_Stats.framesWritten++;
+    m_Stats.pixelBytes += pixels.size();
+    m_Stats.fileBytes += bytes.size();
+    m_Stats.encodeMs += std::chrono::duration<double, std::milli>(encodedAt - start).count();
+    m_Stats.writeMs += std::chrono::duration<double, std::milli>(writtenAt - encodedAt).count();
+    m_Stats.compared += compared;
+    m_Stats.missingGoldens += missing;
+    m_Stats.mismatches += mismatch;
+    m_Stats.maxDifference = std::max(m_Stats.maxDifference, maxDifference);
+    m_Stats.worstPsnr = std::min(m_Stats.worstPsnr, psnr);
+}
+
+namespace {
+    // a gradient with a square moving across it, as BGRA like most swapchains
+    void MakeFrame(std::vector<std::byte>& bgra, uint32_t width, uint32_t height, uint32_t frame)
+    {
+        uint32_t square = std::max(height / 4, 1u);
+        uint32_t squareX = (frame * 16) % std::max(width - std::min(square, width), 1u);
+        uint32_t squareY = height / 2 - square / 2;
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                auto* pixel = &bgra[(size_t(y) * width + x) * 4];
+                bool inSquare = x >= squareX && x < squareX + square && y >= squareY && y < squareY + square;
+                pixel[0] = std::byte(inSquare ? 40 : 255 * y / height);
+                pixel[1] = std::byte(inSquare ? 200 : 128);
+                pixel[2] = std::byte(inSquare ? 240 : 255 * x / width);
+                pixel[3] = std::byte(0);     // swapchains don't promise anything for alpha
+            }
+        }
+    }
+}
+
+int RunFrameWriterBenchmark()
+{
+    uint32_t width = std::max(CommandLine::GetValue("width", 1280u), 1u);
+    uint32_t height = std::max(CommandLine::GetValue("height", 720u), 1u);
+    uint32_t frames = std::max(CommandLine::GetValue("bench-frames", 30u), 2u);
+
+    std::vector<std::vector<std::byte>> sources(frames, std::vector<std::byte>(size_t(width) * height * 4));
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        MakeFrame(sources[i], width, height, i);
+    }
+    auto directory = std::filesystem::temp_directory_path() / "gfx-api-learning-capture";
+    std::filesystem::remove_all(directory);
+
+    std::cout << std::format("{} frames of {}x{}", frames, width, height) << std::endl;
+    std::cout << std::format("{:<6} {:>12} {:>12} {:>10} {:>10} {:>10} {:>8}", "format", "submit ms", "writer ms", "frames/s", "MB/s", "KiB/frame", "waits") << std::endl;
+    bool ok = true;
+    for (auto format : { FrameWriter::Format::Png, FrameWriter::Format::Raw })
+    {
+        auto formatDirectory = directory / FrameWriter::GetFormatName(format);
+        FrameWriter::Stats stats;
+        {
+            FrameWriter writer({ .directory = formatDirectory, .format = format });
+            for (uint32_t i = 0; i < frames; i++)
+            {
+                writer.Submit(i, sources[i], width, height, width * 4, true);
+            }
+            writer.Finish();
+            stats = writer.GetStats();
+        }
+        std::cout << std::format("{:<6} {:>12.3f} {:>12.2f} {:>10.1f} {:>10.0f} {:>10} {:>8}", FrameWriter::GetFormatName(format),
+            stats.submitMs / frames, (stats.encodeMs + stats.writeMs) / frames, stats.FramesPerSecond(), stats.MegabytesPerSecond(),
+            stats.fileBytes / frames / 1024, stats.submitWaits) << std::endl;
+        if (stats.framesWritten != frames)
+        {
+            std::cout << std::format("{} frames written, not {}", stats.framesWritten, frames) << std::endl;
+            ok = false;
+        }
+    }
+
+    // the files hold what was submitted, as opaque RGBA
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        MappedFile png(directory / "png" / FrameWriter::GetFileName(i, FrameWriter::Format::Png));
+        MappedFile raw(directory / "raw" / FrameWriter::GetFileName(i, FrameWriter::Format::Raw));
+        auto image = ReadPng(png.GetData());
+        bool matches = image.width == width && image.height == height && raw.GetData().size() == image.rgba.size()
+            && std::memcmp(raw.GetData().data(), image.rgba.data(), image.rgba.size()) == 0;
+        for (size_t p = 0; matches && p < image.rgba.size(); p += 4)
+        {
+            const auto* source = &sources[i][p];
+            matches = image.rgba[p] == uint8_t(source[2]) && image.rgba[p + 1] == uint8_t(source[1]) && image.rgba[p + 2] == uint8_t(source[0]) && image.rgba[p + 3] == 255;
+        }
+        if (!matches)
+        {
+            std::cout << std::format("frame {} didn't read back as it was submitted", i) << std::endl;
+            ok = false;
+        }
+    }
+
+    // the PNGs as golden images: only the frame changed here should differ
+    {
+        uint32_t changed = frames / 2;
+        for (size_t p = 0; p < sources[changed].size(); p += 4 * 97)
+        {
+            sources[changed][p] ^= std::byte(0x40);
+        }
+        FrameWriter writer({ .directory = directory / "compare", .goldenDirectory = directory / "png" });
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            writer.Submit(i, sources[i], width, height, width * 4, true);
+        }
+        writer.Finish();
+        auto stats = writer.GetStats();
+        std::cout << std::format("golden compare: {} frames, {} mismatched (max difference {}, worst PSNR {:.1f} dB)",
+            stats.compared, stats.mismatches, stats.maxDifference, stats.worstPsnr) << std::endl;
+        if (stats.compared != frames || stats.mismatches != 1)
+        {
+            std::cout << "the golden compare should have found exactly the one changed frame" << std::endl;
+            ok = false;
+        }
+    }
+    std::filesystem::remove_all(directory);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/**
+ * Writes captured frames to disk on a thread of its own, so the render loop only pays for copying them out of
+ * wherever they were read back to. Frames arrive as rows of 8-bit RGBA or BGRA and are written as RGBA, either as
+ * PNG or raw (tightly packed rows, the texture cooker's input format), named by frame number.
+ * Given a directory of golden images, each frame is also compared with the PNG of the same name there, counting
+ * the frames with any channel further off than a tolerance, for checking rendering against known good output.
+ * The queue is bounded: Submit blocks while it is full, so offline rendering never drops a frame, and the time
+ * spent blocked shows the writer can't keep up. Errors on the writer thread are thrown from the next Submit or Finish.
+ */
+
+#pragma once
+
+#include <condition_variable>   // For std::condition_variable
+#include <cstddef>              // For std::byte
+#include <cstdint>              // For uint8_t, uint32_t, uint64_t
+#include <deque>                // For std::deque
+#include <exception>            // For std::exception_ptr
+#include <filesystem>           // For std::filesystem::path
+#include <limits>               // For std::numeric_limits
+#include <mutex>                // For std::mutex
+#include <span>                 // For std::span
+#include <thread>               // For std::thread
+#include <vector>               // For std::vector
+
+class FrameWriter
+{
+public:
+    enum class Format : uint8_t
+    {
+        Png,
+        Raw,
+    };
+
+    struct Settings
+    {
+        std::filesystem::path directory = {};   // created if it doesn't exist
+        Format format = Format::Png;
+        std::filesystem::path goldenDirectory = {}; // PNGs to compare frames with, empty doesn't compare
+        uint32_t tolerance = 2;                 // the largest channel difference still counting as a match
+        uint32_t maxQueued = 4;                 // frames waiting for the writer before Submit blocks
+        uint32_t maxChainLength = 8;            // for the PNG compressor, lower is faster and bigger
+        bool opaque = true;                     // alpha written as 255, as swapchains are presented
+    };
+
+    struct Stats
+    {
+        uint64_t framesWritten = 0;
+        uint64_t pixelBytes = 0;            // as RGBA8, before encoding
+        uint64_t fileBytes = 0;
+        double encodeMs = 0;                // swizzling and compressing, on the writer thread
+        double writeMs = 0;                 // to the files, on the writer thread
+        double submitMs = 0;                // in Submit, copying frames in and waiting
+        uint64_t submitWaits = 0;           // Submits that blocked on a full queue
+        uint64_t compared = 0;
+        uint64_t mismatches = 0;            // frames with a channel more than tolerance off their golden image
+        uint64_t missingGoldens = 0;
+        uint32_t maxDifference = 0;
+        double worstPsnr = std::numeric_limits<double>::infinity();
+
+        // what the writer thread manages when it is never idle
+        double FramesPerSecond() const {
+            return encodeMs + writeMs <= 0 ? 0.0 : framesWritten * 1000.0 / (encodeMs + writeMs);
+        }
+        double MegabytesPerSecond() const {
+            return encodeMs + writeMs <= 0 ? 0.0 : pixelBytes / ((encodeMs + writeMs) * 1000.0);
+        }
+    };
+
+    // Throws std::runtime_error if the directory can't be created.
+    explicit FrameWriter(const Settings& settings);
+    // writes everything still queued first
+    virtual ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Copy a frame out of pixels, rows of rowPitch bytes from the top, and queue it to be written. The pixels can
+    // be reused as soon as this returns.
+    void Submit(uint64_t number, std::span<const std::byte> pixels, uint32_t width, uint32_t height, uint32_t rowPitch, bool bgra);
+
+    // Wait for every frame submitted to be written.
+    void Finish();
+
+    // a copy, as the writer thread keeps updating them
+    Stats GetStats() const;
+
+    static const char* GetFormatName(Format format);
+    // frame000042.png, or .rgba for raw frames
+    static std::filesystem::path GetFileName(uint64_t number, Format format);
+
+private:
+    struct Frame
+    {
+        uint64_t number;
+        uint32_t width;
+        uint32_t height;
+        bool bgra;
+        std::vector<uint8_t> pixels;        // tightly packed
+    };
+
+    void WriterMain();
+    void WriteFrame(Frame& frame);
+    void RethrowError();
+
+    Settings                    m_Settings;
+    std::thread                 m_Thread;
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_FrameQueued;
+    std::condition_variable     m_FrameDone;      // written, or taken off the queue
+    std::deque<Frame>           m_Queue;
+    std::vector<std::vector<uint8_t>> m_SpareBuffers;   // from written frames, for new ones to reuse
+    bool                        m_Writing = false;      // the writer thread has a frame off the queue
+    bool                        m_Stop = false;
+    std::exception_ptr          m_Error;
+    Stats                       m_Stats;
+};
+
+// CPU-only benchmark pushing generated frames through the writer as PNG and raw, reporting the writer's
+// throughput and the render thread's cost per frame, then checking the files read back to what was submitted and
+// that comparing against them as golden images finds the one frame changed on purpose.
+// Run with --bench-capture; --width=W, --height=H (1280x720) and --bench-frames=N (30) change the workload.
+int RunFrameWriterBenchmark();
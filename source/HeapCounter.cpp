@@ -0,0 +1,34 @@
+#include "HeapCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local uint64_t t_Allocations = 0;
+}
+
+uint64_t GetHeapAllocations()
+{
+    return t_Allocations;
+}
+
+// new[] and the nothrow forms call this one, and the matching deletes call the plain delete
+void* operator new(std::size_t size)
+{
+    t_Allocations++;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
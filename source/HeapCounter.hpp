@@ -0,0 +1,12 @@
+/**
+ * Counts heap allocations by replacing the global operator new, so a frame that is supposed to only allocate from
+ * the arenas can be checked to actually do so. The count is per thread: the calling thread's allocations, not those
+ * of workers or the writer thread running at the same time. Over-aligned allocations aren't counted.
+ */
+
+#pragma once
+
+#include <cstdint>  // For uint64_t
+
+// operator new calls made by this thread so far
+uint64_t GetHeapAllocations();
@@ -0,0 +1,236 @@
+#include "Ktx2.hpp"
+#include "Deflate.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+    constexpr uint8_t Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+    constexpr size_t HeaderSize = 80;           // the identifier, the header and the index of the other sections
+    constexpr size_t LevelIndexEntrySize = 24;
+    constexpr std::string_view Writer = "gfx-api-learning TextureCooker";
+
+    // the parts of the data format descriptor that differ between the BC formats
+    struct FormatInfo
+    {
+        BlockFormat format;
+        uint32_t vkFormat;
+        uint32_t srgbVkFormat;                  // 0 if the format has no sRGB version
+        uint32_t colorModel;
+        uint32_t sampleChannels[2];
+        uint32_t sampleCount;
+    };
+    constexpr FormatInfo Formats[] = {
+        { BlockFormat::BC1, 131, 132, 128, { 0, 0 }, 1 },     // VK_FORMAT_BC1_RGB_*, KHR_DF_MODEL_BC1A with its colour channel
+        { BlockFormat::BC4, 139, 0, 131, { 0, 0 }, 1 },       // VK_FORMAT_BC4_UNORM_BLOCK, KHR_DF_MODEL_BC4
+        { BlockFormat::BC5, 141, 0, 132, { 0, 1 }, 2 },       // VK_FORMAT_BC5_UNORM_BLOCK, KHR_DF_MODEL_BC5 with red and green
+        { BlockFormat::BC7, 145, 146, 134, { 0, 0 }, 1 },     // VK_FORMAT_BC7_*, KHR_DF_MODEL_BC7
+    };
+    constexpr uint32_t TransferLinear = 1;
+    constexpr uint32_t TransferSrgb = 2;
+    constexpr uint32_t PrimariesBt709 = 1;
+
+    const FormatInfo& GetFormatInfo(BlockFormat format)
+    {
+        return *std::find_if(std::begin(Formats), std::end(Formats), [format](const FormatInfo& info) {
+            return info.format == format;
+        });
+    }
+
+    bool HasSrgb(BlockFormat format)
+    {
+        return GetFormatInfo(format).srgbVkFormat != 0;
+    }
+
+    void Append32(std::vector<std::byte>& file, uint32_t value)
+    {
+        auto bytes = reinterpret_cast<const std::byte*>(&value);
+        file.insert(file.end(), bytes, bytes + sizeof(value));
+    }
+
+    void Write32(std::vector<std::byte>& file, size_t offset, uint32_t value)
+    {
+        std::memcpy(file.data() + offset, &value, sizeof(value));
+    }
+
+    void Write64(std::vector<std::byte>& file, size_t offset, uint64_t value)
+    {
+        std::memcpy(file.data() + offset, &value, sizeof(value));
+    }
+
+    void PadTo(std::vector<std::byte>& file, size_t alignment)
+    {
+        file.resize((file.size() + alignment - 1) / alignment * alignment, std::byte{ 0 });
+    }
+
+    uint32_t Read32(std::span<const std::byte> file, size_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, file.data() + offset, sizeof(value));
+        return value;
+    }
+
+    uint64_t Read64(std::span<const std::byte> file, size_t offset)
+    {
+        uint64_t value;
+        std::memcpy(&value, file.data() + offset, sizeof(value));
+        return value;
+    }
+
+    [[noreturn]] void Unreadable(const char* reason)
+    {
+        throw std::runtime_error(std::string("can't read KTX2 file: ") + reason);
+    }
+}
+
+uint32_t GetKtx2VkFormat(BlockFormat format, bool srgb)
+{
+    const auto& info = GetFormatInfo(format);
+    return srgb && info.srgbVkFormat != 0 ? info.srgbVkFormat : info.vkFormat;
+}
+
+std::vector<std::byte> WriteKtx2(const Ktx2Description& description, std::span<const std::vector<std::byte>> levels)
+{
+    const auto& info = GetFormatInfo(description.format);
+    bool srgb = description.srgb && HasSrgb(description.format);
+    bool supercompressed = description.supercompression == Ktx2Supercompression::Zlib;
+    uint32_t blockSize = BlockEncoder::GetBlockSize(description.format);
+
+    std::vector<std::byte> file(HeaderSize + LevelIndexEntrySize * levels.size(), std::byte{ 0 });
+    std::memcpy(file.data(), Identifier, sizeof(Identifier));
+    Write32(file, 12, GetKtx2VkFormat(description.format, srgb));
+    Write32(file, 16, 1);                       // typeSize, 1 for block compressed formats
+    Write32(file, 20, description.width);
+    Write32(file, 24, description.height);
+    Write32(file, 28, 0);                       // depth, layers: a 2D texture that isn't an array
+    Write32(file, 32, 0);
+    Write32(file, 36, 1);                       // faces
+    Write32(file, 40, static_cast<uint32_t>(levels.size()));
+    Write32(file, 44, static_cast<uint32_t>(description.supercompression));
+
+    // the data format descriptor: one basic block, with a sample per channel of the blocks
+    size_t dfdOffset = file.size();
+    uint32_t blockWords = 6 + 4 * info.sampleCount;
+    Append32(file, 4 + blockWords * 4);         // the descriptor's total size
+    Append32(file, 0);                          // Khronos vendor, basic descriptor type
+    Append32(file, 2 | (blockWords * 4) << 16); // version 2, and the block's size
+    Append32(file, info.colorModel | PrimariesBt709 << 8 | (srgb ? TransferSrgb : TransferLinear) << 16);
+    Append32(file, 3 | 3 << 8);                 // 4x4 texel blocks, stored as dimension - 1
+    Append32(file, blockSize);                  // bytes in plane 0, and none in the other planes
+    Append32(file, 0);
+    uint32_t bitsPerSample = blockSize * 8 / info.sampleCount;
+    for (uint32_t i = 0; i < info.sampleCount; i++)
+    {
+        Append32(file, (i * bitsPerSample) | (bitsPerSample - 1) << 16 | info.sampleChannels[i] << 24);
+        Append32(file, 0);                      // sample position
+        Append32(file, 0);                      // the full range of the channel
+        Append32(file, ~0u);
+    }
+    Write32(file, 48, static_cast<uint32_t>(dfdOffset));
+    Write32(file, 52, static_cast<uint32_t>(file.size() - dfdOffset));
+
+    // key/value data, saying what wrote the file
+    size_t kvdOffset = file.size();
+    Append32(file, static_cast<uint32_t>(sizeof("KTXwriter") + Writer.size() + 1));
+    for (char c : std::string_view("KTXwriter\0", 10))
+    {
+        file.push_back(static_cast<std::byte>(c));
+    }
+    for (char c : Writer)
+    {
+        file.push_back(static_cast<std::byte>(c));
+    }
+    file.push_back(std::byte{ 0 });
+    PadTo(file, 4);
+    Write32(file, 56, static_cast<uint32_t>(kvdOffset));
+    Write32(file, 60, static_cast<uint32_t>(file.size() - kvdOffset));
+    // no supercompression global data, zlib doesn't need any
+
+    // levels smallest first, each aligned to a block unless they are supercompressed
+    size_t alignment = supercompressed ? 1 : std::max<size_t>(blockSize, 4);
+    for (size_t level = levels.size(); level-- > 0;)
+    {
+        std::vector<std::byte> deflated;
+        std::span<const std::byte> stored = levels[level];
+        if (supercompressed)
+        {
+            deflated = ZlibCompress(levels[level]);
+            stored = deflated;
+        }
+        PadTo(file, alignment);
+        size_t entry = HeaderSize + level * LevelIndexEntrySize;
+        Write64(file, entry, file.size());
+        Write64(file, entry + 8, stored.size());
+        Write64(file, entry + 16, levels[level].size());
+        file.insert(file.end(), stored.begin(), stored.end());
+    }
+    return file;
+}
+
+Ktx2Reader::Ktx2Reader(std::span<const std::byte> file)
+    : m_File(file)
+{
+    if (file.size() < HeaderSize || std::memcmp(file.data(), Identifier, sizeof(Identifier)) != 0)
+    {
+        Unreadable("not a KTX2 file");
+    }
+    uint32_t vkFormat = Read32(file, 12);
+    auto info = std::find_if(std::begin(Formats), std::end(Formats), [vkFormat](const FormatInfo& candidate) {
+        return candidate.vkFormat == vkFormat || candidate.srgbVkFormat == vkFormat;
+    });
+    if (info == std::end(Formats))
+    {
+        Unreadable("not a BC format");
+    }
+    m_Description.format = info->format;
+    m_Description.srgb = info->srgbVkFormat == vkFormat;
+    m_Description.width = Read32(file, 20);
+    m_Description.height = Read32(file, 24);
+    if (m_Description.width == 0 || m_Description.height == 0 || Read32(file, 28) > 1 || Read32(file, 32) > 1 || Read32(file, 36) != 1)
+    {
+        Unreadable("not a 2D texture");
+    }
+    uint32_t scheme = Read32(file, 44);
+    if (scheme != static_cast<uint32_t>(Ktx2Supercompression::None) && scheme != static_cast<uint32_t>(Ktx2Supercompression::Zlib))
+    {
+        Unreadable("unsupported supercompression");
+    }
+    m_Description.supercompression = static_cast<Ktx2Supercompression>(scheme);
+
+    // 0 levels asks the reader to make the mips, which this doesn't do
+    uint32_t levelCount = Read32(file, 40);
+    if (levelCount == 0 || levelCount > 32 || HeaderSize + size_t(levelCount) * LevelIndexEntrySize > file.size())
+    {
+        Unreadable("bad level count");
+    }
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        size_t entry = HeaderSize + level * LevelIndexEntrySize;
+        Level stored{ Read64(file, entry), Read64(file, entry + 8), Read64(file, entry + 16) };
+        uint32_t width = std::max(m_Description.width >> level, 1u);
+        uint32_t height = std::max(m_Description.height >> level, 1u);
+        bool fits = stored.offset <= file.size() && stored.size <= file.size() - stored.offset;
+        bool sized = stored.uncompressedSize == BlockEncoder::GetEncodedSize(m_Description.format, width, height) &&
+            (scheme != 0 || stored.size == stored.uncompressedSize);
+        if (!fits || !sized)
+        {
+            Unreadable("bad level index");
+        }
+        m_Levels.push_back(stored);
+    }
+}
+
+void Ktx2Reader::ReadLevel(uint32_t level, std::span<std::byte> destination) const
+{
+    const auto& stored = m_Levels[level];
+    auto data = m_File.subspan(static_cast<size_t>(stored.offset), static_cast<size_t>(stored.size));
+    if (m_Description.supercompression == Ktx2Supercompression::Zlib)
+    {
+        ZlibDecompress(data, destination.first(static_cast<size_t>(stored.uncompressedSize)));
+        return;
+    }
+    std::memcpy(destination.data(), data.data(), data.size());
+}
@@ -0,0 +1,79 @@
+/**
+ * Reading and writing KTX2 files, the Khronos container for GPU textures, holding block compressed 2D textures.
+ * A file is a header, an index of where each mip level lives, a data format descriptor saying how to read the
+ * blocks, and the levels themselves, smallest first so a streaming reader can have the small mips before the big
+ * ones arrive. Levels can be supercompressed with zlib (scheme 3) on top of the block compression, which makes files
+ * smaller at the cost of inflating them as they load.
+ * Array layers, cube faces, 3D textures and formats other than the BC ones aren't handled. Multi-byte fields are
+ * little-endian in the file, which is assumed to match the host.
+ */
+
+#pragma once
+
+#include "BlockCompression.hpp"
+
+#include <cstddef>  // For std::byte
+#include <cstdint>  // For uint32_t, uint64_t
+#include <span>     // For std::span
+#include <vector>   // For std::vector
+
+enum class Ktx2Supercompression : uint32_t
+{
+    None = 0,
+    Zlib = 3,
+};
+
+struct Ktx2Description
+{
+    BlockFormat format = BlockFormat::BC7;
+    bool srgb = false;                  // BC4 and BC5 have no sRGB formats, so this is ignored for them
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Ktx2Supercompression supercompression = Ktx2Supercompression::None;
+};
+
+// The VkFormat value of a block format, as KTX2 files identify them
+uint32_t GetKtx2VkFormat(BlockFormat format, bool srgb);
+
+// Build a file from mip levels of blocks, largest first, each the size BlockEncoder::GetEncodedSize gives.
+std::vector<std::byte> WriteKtx2(const Ktx2Description& description, std::span<const std::vector<std::byte>> levels);
+
+class Ktx2Reader
+{
+public:
+    // Parse the header and level index of a file in memory, which must outlive the reader.
+    // Throws std::runtime_error if it isn't a KTX2 file this can read.
+    explicit Ktx2Reader(std::span<const std::byte> file);
+    virtual ~Ktx2Reader() {}
+
+    const Ktx2Description& GetDescription() const {
+        return m_Description;
+    }
+    uint32_t GetLevelCount() const {
+        return static_cast<uint32_t>(m_Levels.size());
+    }
+    // of the level's blocks, once inflated
+    size_t GetLevelSize(uint32_t level) const {
+        return static_cast<size_t>(m_Levels[level].uncompressedSize);
+    }
+    // as the level is stored in the file
+    size_t GetStoredLevelSize(uint32_t level) const {
+        return static_cast<size_t>(m_Levels[level].size);
+    }
+
+    // Copy a level's blocks into destination, which must be GetLevelSize(level) bytes, inflating them if the file
+    // is supercompressed. Throws std::runtime_error if they don't inflate.
+    void ReadLevel(uint32_t level, std::span<std::byte> destination) const;
+
+private:
+    struct Level
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t uncompressedSize;
+    };
+
+    std::span<const std::byte>  m_File;
+    Ktx2Description             m_Description;
+    std::vector<Level>          m_Levels;       // largest first
+};
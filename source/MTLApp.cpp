@@ -9,6 +9,7 @@
 #include <Foundation/Foundation.hpp>
 #include <Metal/Metal.hpp>
 #include <QuartzCore/QuartzCore.hpp>
+#include "MTLRHI.hpp"
 
 // this is sketchy
 typedef uint32_t CGDirectDisplayID;
@@ -20,6 +21,8 @@ typedef uint32_t CGDirectDisplayID;
 
 #include <iostream>
 #include <cassert>
+#include <memory>
+#include <span>
 
 #include "shaders/shader_defs.h"
 
@@ -30,7 +33,10 @@ MTL::CommandQueue* commandQueue = nullptr;
 MTL::RenderPassDescriptor* rpd = nullptr;
 MTL::Library* library = nullptr;
 MTL::RenderPipelineState* pipelineState = nullptr;
-MTL::Buffer* vertbuf = nullptr;
+// the triangle is made and drawn through the RHI, the uniforms are bound directly as it has none
+std::unique_ptr<MTLRHIDevice> rhiDevice;
+RHIBuffer vertbuf;
+RHIPipeline trianglePipeline;
 MTL::Buffer* uniformBuf = nullptr;
 
 static UniformBuffer uniformData{.time = 0};
@@ -59,11 +65,21 @@ void MTLApp::inithook(){
 		{.color = {0,1,0,1}, .pos = {0,1}},
 		{.color = {0,0,1,1}, .pos = {1,-1}}
 	};	
-	MTL_CHECK(vertbuf = device->newBuffer(&verts, sizeof(verts), MTL::ResourceOptions{}));
-	
 	MTL_CHECK(uniformBuf = device->newBuffer(&uniformData, sizeof(UniformBuffer), MTL::ResourceOptions{}));
 	
 	commandQueue = device->newCommandQueue();
+	rhiDevice = std::make_unique<MTLRHIDevice>(MTLRHIDevice::Settings{
+		.device = device,
+		.queue = commandQueue,
+		.library = library
+	});
+	vertbuf = rhiDevice->CreateBuffer({
+		.size = sizeof(verts),
+		.usage = RHIBufferUsage::Vertex,
+		.hostVisible = true
+	});
+	rhiDevice->WriteBuffer(vertbuf, 0, std::as_bytes(std::span(verts)));
+	trianglePipeline = rhiDevice->ImportPipeline(pipelineState, RHITopology::TriangleList);
 	rpd = MTL::RenderPassDescriptor::alloc()->init();
 	
 	auto firstAttachment = rpd->colorAttachments()->object(0);
@@ -88,17 +104,22 @@ void MTLApp::tickhook(){
 	rpd->setRenderTargetWidth(WIDTH);
 	rpd->setRenderTargetHeight(HEIGHT);
 	
+	beginSubmitTiming();
 	auto commandBuffer = commandQueue->commandBuffer();
 	auto encoder = commandBuffer->renderCommandEncoder(rpd);
-	encoder->setRenderPipelineState(pipelineState);
-	encoder->setVertexBuffer(vertbuf, 0, 0);
+	MTLRHICommandList rhiCommands(*rhiDevice, encoder);
+	rhiCommands.SetPipeline(trianglePipeline);
+	rhiCommands.SetVertexBuffer(vertbuf, 0);
 	encoder->setVertexBuffer(uniformBuf, 0, 1);
-	encoder->drawPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, 0, 3, 1);
+	for (uint32_t i = 0; i < drawsPerFrame; i++) {
+		rhiCommands.Draw(3, 1, 0);
+	}
 	
 	encoder->endEncoding();
 		
 	commandBuffer->presentDrawable(nextDrawable);
 	commandBuffer->commit();
+	endSubmitTiming();
 	commandBuffer->waitUntilCompleted();
 	encoder->release();
 	commandBuffer->release();
@@ -106,7 +127,9 @@ void MTLApp::tickhook(){
 
 void MTLApp::cleanuphook(){
 	rpd->release();
-	vertbuf->release();
+	rhiDevice->DestroyPipeline(trianglePipeline);
+	rhiDevice->DestroyBuffer(vertbuf);
+	rhiDevice.reset();
 	pipelineState->release();
 	library->release();
 	commandQueue->release();
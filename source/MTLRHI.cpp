@@ -0,0 +1,519 @@
+#if MTL_AVAILABLE
+#include "MTLRHI.hpp"
+
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    MTL::VertexFormat GetVertexFormat(RHIVertexFormat format)
+    {
+        switch (format)
+        {
+        case RHIVertexFormat::Float2:
+            return MTL::VertexFormat::VertexFormatFloat2;
+        case RHIVertexFormat::Float3:
+            return MTL::VertexFormat::VertexFormatFloat3;
+        case RHIVertexFormat::Float4:
+            return MTL::VertexFormat::VertexFormatFloat4;
+        }
+        throw std::runtime_error("unknown vertex format!");
+    }
+
+    MTL::PrimitiveTopologyClass GetTopologyClass(RHITopology topology)
+    {
+        switch (topology)
+        {
+        case RHITopology::TriangleList:
+        case RHITopology::TriangleStrip:
+            return MTL::PrimitiveTopologyClass::PrimitiveTopologyClassTriangle;
+        case RHITopology::LineList:
+            return MTL::PrimitiveTopologyClass::PrimitiveTopologyClassLine;
+        case RHITopology::PointList:
+            return MTL::PrimitiveTopologyClass::PrimitiveTopologyClassPoint;
+        }
+        throw std::runtime_error("unknown topology!");
+    }
+
+    MTL::PrimitiveType GetPrimitiveType(RHITopology topology)
+    {
+        switch (topology)
+        {
+        case RHITopology::TriangleList:
+            return MTL::PrimitiveType::PrimitiveTypeTriangle;
+        case RHITopology::TriangleStrip:
+            return MTL::PrimitiveType::PrimitiveTypeTriangleStrip;
+        case RHITopology::LineList:
+            return MTL::PrimitiveType::PrimitiveTypeLine;
+        case RHITopology::PointList:
+            return MTL::PrimitiveType::PrimitiveTypePoint;
+        }
+        throw std::runtime_error("unknown topology!");
+    }
+
+    MTL::TextureUsage GetTextureUsage(RHITextureUsage usage)
+    {
+        MTL::TextureUsage flags = MTL::TextureUsageUnknown;
+        if (HasFlag(usage, RHITextureUsage::RenderTarget) || HasFlag(usage, RHITextureUsage::DepthStencil)) flags |= MTL::TextureUsageRenderTarget;
+        if (HasFlag(usage, RHITextureUsage::Sampled)) flags |= MTL::TextureUsageShaderRead;
+        if (HasFlag(usage, RHITextureUsage::Storage)) flags |= MTL::TextureUsageShaderRead | MTL::TextureUsageShaderWrite;
+        return flags;
+    }
+
+    std::string GetErrorMessage(NS::Error* error)
+    {
+        return error ? error->localizedDescription()->utf8String() : "unknown error";
+    }
+}
+
+void MTLRHICommandList::EndEncoding()
+{
+    if (!m_CommandBuffer)
+    {
+        throw std::runtime_error("this RHI command list only draws into the render pass it was given!");
+    }
+    if (m_RenderEncoder)
+    {
+        m_RenderEncoder->endEncoding();
+        m_RenderEncoder->release();
+        m_RenderEncoder = nullptr;
+    }
+    if (m_ComputeEncoder)
+    {
+        m_ComputeEncoder->endEncoding();
+        m_ComputeEncoder->release();
+        m_ComputeEncoder = nullptr;
+    }
+    if (m_BlitEncoder)
+    {
+        m_BlitEncoder->endEncoding();
+        m_BlitEncoder->release();
+        m_BlitEncoder = nullptr;
+    }
+}
+
+MTL::CommandBuffer& MTLRHICommandList::GetCommandBuffer()
+{
+    if (!m_CommandBuffer)
+    {
+        throw std::runtime_error("this RHI command list only draws into the render pass it was given!");
+    }
+    return *m_CommandBuffer;
+}
+
+MTL::RenderCommandEncoder& MTLRHICommandList::GetRenderEncoder()
+{
+    if (!m_RenderEncoder)
+    {
+        throw std::runtime_error("RHI draws need a render pass!");
+    }
+    return *m_RenderEncoder;
+}
+
+void MTLRHICommandList::Barrier(RHITexture texture, ResourceState state)
+{
+    // Metal orders the passes using a texture itself, only the state the next render pass looks at is kept
+    m_Device.FindTexture(texture).state = state;
+}
+
+void MTLRHICommandList::BeginRenderPass(const RHIRenderPassDesc& desc)
+{
+    auto& commandBuffer = GetCommandBuffer();
+    EndEncoding();
+
+    auto renderPass = MTL::RenderPassDescriptor::alloc()->init();
+    auto colorAttachment = renderPass->colorAttachments()->object(0);
+    colorAttachment->setTexture(m_Device.FindTexture(desc.colorTarget).texture);
+    colorAttachment->setLoadAction(MTL::LoadAction::LoadActionClear);
+    colorAttachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+    colorAttachment->setClearColor(MTL::ClearColor(desc.clearColor[0], desc.clearColor[1], desc.clearColor[2], desc.clearColor[3]));
+    if (desc.depthTarget.IsValid())
+    {
+        auto& depth = m_Device.FindTexture(desc.depthTarget);
+        auto depthAttachment = renderPass->depthAttachment();
+        depthAttachment->setTexture(depth.texture);
+        // a pass that only tests against depth keeps what an earlier one wrote
+        depthAttachment->setLoadAction(depth.state == ResourceState::DepthRead ? MTL::LoadAction::LoadActionLoad : MTL::LoadAction::LoadActionClear);
+        depthAttachment->setStoreAction(MTL::StoreAction::StoreActionStore);
+        depthAttachment->setClearDepth(desc.clearDepth);
+    }
+    m_RenderEncoder = commandBuffer.renderCommandEncoder(renderPass)->retain();
+    renderPass->release();
+}
+
+void MTLRHICommandList::EndRenderPass()
+{
+    if (m_CommandBuffer && m_RenderEncoder)
+    {
+        EndEncoding();
+    }
+}
+
+void MTLRHICommandList::SetPipeline(RHIPipeline pipeline)
+{
+    auto& data = m_Device.FindPipeline(pipeline);
+    m_Pipeline = pipeline;
+    // compute pipelines are set when Dispatch has an encoder for them
+    if (data.renderPipelineState)
+    {
+        GetRenderEncoder().setRenderPipelineState(data.renderPipelineState);
+    }
+}
+
+void MTLRHICommandList::SetViewport(uint32_t width, uint32_t height)
+{
+    auto& encoder = GetRenderEncoder();
+    encoder.setViewport(MTL::Viewport{ 0.0, 0.0, double(width), double(height), 0.0, 1.0 });
+    encoder.setScissorRect(MTL::ScissorRect{ 0, 0, width, height });
+}
+
+void MTLRHICommandList::SetVertexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    GetRenderEncoder().setVertexBuffer(m_Device.FindBuffer(buffer).buffer, offset, MTLRHIDevice::VertexBufferIndex);
+}
+
+void MTLRHICommandList::SetIndexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    // Metal takes the index buffer with each indexed draw
+    m_IndexBuffer = m_Device.FindBuffer(buffer).buffer;
+    m_IndexOffset = offset;
+}
+
+void MTLRHICommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex)
+{
+    auto primitiveType = m_Device.FindPipeline(m_Pipeline).primitiveType;
+    GetRenderEncoder().drawPrimitives(primitiveType, firstVertex, vertexCount, instanceCount);
+}
+
+void MTLRHICommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex)
+{
+    if (!m_IndexBuffer)
+    {
+        throw std::runtime_error("RHI indexed draws need an index buffer!");
+    }
+    auto primitiveType = m_Device.FindPipeline(m_Pipeline).primitiveType;
+    GetRenderEncoder().drawIndexedPrimitives(primitiveType, indexCount, MTL::IndexType::IndexTypeUInt32, m_IndexBuffer,
+        m_IndexOffset + uint64_t(firstIndex) * sizeof(uint32_t), instanceCount);
+}
+
+void MTLRHICommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    auto& data = m_Device.FindPipeline(m_Pipeline);
+    if (!data.computePipelineState)
+    {
+        throw std::runtime_error("RHI dispatches need a compute pipeline!");
+    }
+    if (!m_ComputeEncoder)
+    {
+        auto& commandBuffer = GetCommandBuffer();
+        EndEncoding();
+        m_ComputeEncoder = commandBuffer.computeCommandEncoder()->retain();
+    }
+    m_ComputeEncoder->setComputePipelineState(data.computePipelineState);
+    m_ComputeEncoder->dispatchThreadgroups(MTL::Size(x, y, z), MTL::Size(data.computePipelineState->threadExecutionWidth(), 1, 1));
+}
+
+void MTLRHICommandList::CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size)
+{
+    if (!m_BlitEncoder)
+    {
+        auto& commandBuffer = GetCommandBuffer();
+        EndEncoding();
+        m_BlitEncoder = commandBuffer.blitCommandEncoder()->retain();
+    }
+    m_BlitEncoder->copyFromBuffer(m_Device.FindBuffer(source).buffer, 0, m_Device.FindBuffer(destination).buffer, 0, size);
+}
+
+MTLRHIDevice::~MTLRHIDevice()
+{
+    Flush();
+    m_Buffers.ForEachLive([](BufferData& data) { data.buffer->release(); });
+    m_Textures.ForEachLive([](TextureData& data) { data.texture->release(); });
+    m_Pipelines.ForEachLive([](PipelineData& data) {
+        if (data.renderPipelineState) data.renderPipelineState->release();
+        if (data.computePipelineState) data.computePipelineState->release();
+    });
+}
+
+MTLRHIDevice::BufferData& MTLRHIDevice::FindBuffer(RHIBuffer buffer)
+{
+    auto data = m_Buffers.Find(buffer);
+    if (!data)
+    {
+        throw std::runtime_error("RHI buffer handle isn't a live buffer!");
+    }
+    return *data;
+}
+
+MTLRHIDevice::TextureData& MTLRHIDevice::FindTexture(RHITexture texture)
+{
+    auto data = m_Textures.Find(texture);
+    if (!data)
+    {
+        throw std::runtime_error("RHI texture handle isn't a live texture!");
+    }
+    return *data;
+}
+
+MTLRHIDevice::PipelineData& MTLRHIDevice::FindPipeline(RHIPipeline pipeline)
+{
+    auto data = m_Pipelines.Find(pipeline);
+    if (!data)
+    {
+        throw std::runtime_error("RHI pipeline handle isn't a live pipeline!");
+    }
+    return *data;
+}
+
+MTL::PixelFormat MTLRHIDevice::GetMTLPixelFormat(RHIFormat format)
+{
+    switch (format)
+    {
+    case RHIFormat::Undefined:
+        return MTL::PixelFormat::PixelFormatInvalid;
+    case RHIFormat::RGBA8Unorm:
+        return MTL::PixelFormat::PixelFormatRGBA8Unorm;
+    case RHIFormat::BGRA8Unorm:
+        return MTL::PixelFormat::PixelFormatBGRA8Unorm;
+    case RHIFormat::RGBA16Float:
+        return MTL::PixelFormat::PixelFormatRGBA16Float;
+    case RHIFormat::D32Float:
+        return MTL::PixelFormat::PixelFormatDepth32Float;
+    }
+    throw std::runtime_error("unknown RHI format!");
+}
+
+RHIBuffer MTLRHIDevice::CreateBuffer(const RHIBufferDesc& desc)
+{
+    // shared storage is what the CPU can write, the rest stays where only the GPU reads it
+    auto options = desc.hostVisible ? MTL::ResourceStorageModeShared : MTL::ResourceStorageModePrivate;
+    BufferData data{
+        .buffer = m_Settings.device->newBuffer(desc.size, options),
+        .size = desc.size,
+    };
+    if (!data.buffer)
+    {
+        throw std::runtime_error(std::format("failed to create a {} byte buffer!", desc.size));
+    }
+    if (desc.hostVisible)
+    {
+        data.mapped = static_cast<std::byte*>(data.buffer->contents());
+    }
+    return m_Buffers.Allocate(data);
+}
+
+void MTLRHIDevice::DestroyBuffer(RHIBuffer buffer)
+{
+    // releasing doesn't wait for the GPU, callers defer it with fences
+    FindBuffer(buffer).buffer->release();
+    m_Buffers.Release(buffer);
+}
+
+void MTLRHIDevice::WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data)
+{
+    auto& bufferData = FindBuffer(buffer);
+    if (!bufferData.mapped || offset + data.size() > bufferData.size)
+    {
+        throw std::runtime_error("WriteBuffer needs a host visible buffer big enough for the data!");
+    }
+    std::memcpy(bufferData.mapped + offset, data.data(), data.size());
+}
+
+RHITexture MTLRHIDevice::CreateTexture(const RHITextureDesc& desc)
+{
+    auto textureDesc = MTL::TextureDescriptor::alloc()->init();
+    textureDesc->setTextureType(MTL::TextureType::TextureType2D);
+    textureDesc->setPixelFormat(GetMTLPixelFormat(desc.format));
+    textureDesc->setWidth(desc.width);
+    textureDesc->setHeight(desc.height);
+    textureDesc->setUsage(GetTextureUsage(desc.usage));
+    textureDesc->setStorageMode(MTL::StorageMode::StorageModePrivate);
+    auto texture = m_Settings.device->newTexture(textureDesc);
+    textureDesc->release();
+    if (!texture)
+    {
+        throw std::runtime_error(std::format("failed to create a {}x{} texture!", desc.width, desc.height));
+    }
+    return m_Textures.Allocate({ .texture = texture });
+}
+
+void MTLRHIDevice::DestroyTexture(RHITexture texture)
+{
+    FindTexture(texture).texture->release();
+    m_Textures.Release(texture);
+}
+
+MTL::Function* MTLRHIDevice::LoadFunction(std::string_view name)
+{
+    auto functionName = NS::String::alloc()->init(std::string(name).c_str(), NS::StringEncoding::UTF8StringEncoding);
+    auto function = m_Settings.library->newFunction(functionName);
+    functionName->release();
+    if (!function)
+    {
+        throw std::runtime_error(std::format("{} isn't a function in the Metal library", name));
+    }
+    return function;
+}
+
+RHIPipeline MTLRHIDevice::CreatePipeline(const RHIPipelineDesc& desc)
+{
+    NS::Error* error = nullptr;
+    if (!desc.computeShader.empty())
+    {
+        auto function = LoadFunction(desc.computeShader);
+        auto computePipelineState = m_Settings.device->newComputePipelineState(function, &error);
+        function->release();
+        if (!computePipelineState)
+        {
+            throw std::runtime_error(std::format("failed to create compute pipeline {}: {}", desc.computeShader, GetErrorMessage(error)));
+        }
+        return m_Pipelines.Allocate({ .computePipelineState = computePipelineState });
+    }
+
+    auto vertexFunction = LoadFunction(desc.vertexShader);
+    auto fragmentFunction = LoadFunction(desc.fragmentShader);
+    auto pipelineDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pipelineDesc->setVertexFunction(vertexFunction);
+    pipelineDesc->setFragmentFunction(fragmentFunction);
+    pipelineDesc->colorAttachments()->object(0)->setPixelFormat(GetMTLPixelFormat(desc.colorFormat));
+    pipelineDesc->setDepthAttachmentPixelFormat(GetMTLPixelFormat(desc.depthFormat));
+    pipelineDesc->setInputPrimitiveTopology(GetTopologyClass(desc.topology));
+
+    MTL::VertexDescriptor* vertexDesc = nullptr;
+    if (desc.vertexStride != 0)
+    {
+        vertexDesc = MTL::VertexDescriptor::alloc()->init();
+        for (size_t i = 0; i < desc.vertexAttributes.size(); i++)
+        {
+            auto attribute = vertexDesc->attributes()->object(i);
+            attribute->setFormat(GetVertexFormat(desc.vertexAttributes[i].format));
+            attribute->setOffset(desc.vertexAttributes[i].offset);
+            attribute->setBufferIndex(VertexBufferIndex);
+        }
+        auto layout = vertexDesc->layouts()->object(VertexBufferIndex);
+        layout->setStride(desc.vertexStride);
+        layout->setStepFunction(MTL::VertexStepFunction::VertexStepFunctionPerVertex);
+        pipelineDesc->setVertexDescriptor(vertexDesc);
+    }
+
+    auto renderPipelineState = m_Settings.device->newRenderPipelineState(pipelineDesc, &error);
+    if (vertexDesc)
+    {
+        vertexDesc->release();
+    }
+    pipelineDesc->release();
+    fragmentFunction->release();
+    vertexFunction->release();
+    if (!renderPipelineState)
+    {
+        throw std::runtime_error(std::format("failed to create pipeline {}/{}: {}", desc.vertexShader, desc.fragmentShader, GetErrorMessage(error)));
+    }
+    return m_Pipelines.Allocate({
+        .renderPipelineState = renderPipelineState,
+        .primitiveType = GetPrimitiveType(desc.topology),
+    });
+}
+
+RHIPipeline MTLRHIDevice::ImportPipeline(MTL::RenderPipelineState* pipelineState, RHITopology topology)
+{
+    return m_Pipelines.Allocate({
+        .renderPipelineState = pipelineState->retain(),
+        .primitiveType = GetPrimitiveType(topology),
+    });
+}
+
+void MTLRHIDevice::DestroyPipeline(RHIPipeline pipeline)
+{
+    auto& data = FindPipeline(pipeline);
+    if (data.renderPipelineState)
+    {
+        data.renderPipelineState->release();
+    }
+    if (data.computePipelineState)
+    {
+        data.computePipelineState->release();
+    }
+    m_Pipelines.Release(pipeline);
+}
+
+RHICommandList* MTLRHIDevice::GetCommandList()
+{
+    MTLRHICommandList* list;
+    if (!m_FreeCommandLists.empty())
+    {
+        list = m_FreeCommandLists.back();
+        m_FreeCommandLists.pop_back();
+    }
+    else
+    {
+        m_CommandLists.push_back(std::unique_ptr<MTLRHICommandList>(new MTLRHICommandList(*this)));
+        list = m_CommandLists.back().get();
+    }
+    // retained until it is known to be complete, not just until the caller's autorelease pool drains
+    list->m_CommandBuffer = m_Settings.queue->commandBuffer()->retain();
+    return list;
+}
+
+uint64_t MTLRHIDevice::ExecuteCommandList(RHICommandList* commandList)
+{
+    auto list = static_cast<MTLRHICommandList*>(commandList);
+    list->EndEncoding();
+    list->m_CommandBuffer->commit();
+    m_InFlight.emplace_back(++m_FenceValue, list->m_CommandBuffer);
+
+    list->m_CommandBuffer = nullptr;
+    list->m_Pipeline = {};
+    list->m_IndexBuffer = nullptr;
+    list->m_IndexOffset = 0;
+    m_FreeCommandLists.push_back(list);
+    return m_FenceValue;
+}
+
+void MTLRHIDevice::RetireCommandBuffers(uint64_t waitForValue)
+{
+    // one queue runs its command buffers in the order they were committed, so they complete in order too
+    while (!m_InFlight.empty())
+    {
+        auto [fenceValue, commandBuffer] = m_InFlight.front();
+        auto status = commandBuffer->status();
+        if (status != MTL::CommandBufferStatus::CommandBufferStatusCompleted && status != MTL::CommandBufferStatus::CommandBufferStatusError)
+        {
+            if (fenceValue > waitForValue)
+            {
+                break;
+            }
+            commandBuffer->waitUntilCompleted();
+        }
+        commandBuffer->release();
+        m_CompletedValue = fenceValue;
+        m_InFlight.pop_front();
+    }
+}
+
+bool MTLRHIDevice::IsFenceComplete(uint64_t fenceValue)
+{
+    RetireCommandBuffers(0);
+    return fenceValue <= m_CompletedValue;
+}
+
+void MTLRHIDevice::WaitForFenceValue(uint64_t fenceValue)
+{
+    RetireCommandBuffers(fenceValue);
+}
+
+void MTLRHIDevice::Flush()
+{
+    RetireCommandBuffers(m_FenceValue);
+}
+
+MTL::Buffer* MTLRHIDevice::GetMTLBuffer(RHIBuffer buffer)
+{
+    return FindBuffer(buffer).buffer;
+}
+
+MTL::Texture* MTLRHIDevice::GetMTLTexture(RHITexture texture)
+{
+    return FindTexture(texture).texture;
+}
+#endif
@@ -0,0 +1,158 @@
+/**
+ * RHI backend on Metal. Host visible buffers use shared storage and everything else is private, and pipelines take
+ * their functions by name from the library the device is given, with vertex attributes at [[attribute(0)]],
+ * [[attribute(1)]], ... and the vertex buffer in slot 0. Command lists are command buffers from the given queue,
+ * opening a render, compute or blit encoder as commands need one, and fence values count the command buffers
+ * committed. Metal tracks hazards between the resources it creates, so barriers only record the texture's state.
+ * Compute shaders don't declare their threadgroup size in Metal, Dispatch runs groups of the pipeline's thread
+ * execution width.
+ */
+
+#pragma once
+#if MTL_AVAILABLE
+
+#include "RHI.hpp"
+
+#include <Metal/Metal.hpp>  // For MTL::Device, MTL::CommandQueue, MTL::Buffer, MTL::Texture
+
+#include <cstdint>      // For uint32_t, uint64_t
+#include <deque>        // For std::deque
+#include <memory>       // For std::unique_ptr
+#include <utility>      // For std::pair
+#include <vector>       // For std::vector
+
+class MTLRHIDevice;
+
+class MTLRHICommandList : public RHICommandList
+{
+public:
+    // Draw into a render pass the caller has begun and ends itself. Anything needing another encoder throws.
+    MTLRHICommandList(MTLRHIDevice& device, MTL::RenderCommandEncoder* encoder) : m_Device(device), m_RenderEncoder(encoder) {}
+
+    void Barrier(RHITexture texture, ResourceState state) final;
+    void BeginRenderPass(const RHIRenderPassDesc& desc) final;
+    void EndRenderPass() final;
+    void SetPipeline(RHIPipeline pipeline) final;
+    void SetViewport(uint32_t width, uint32_t height) final;
+    void SetVertexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void SetIndexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex) final;
+    void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex) final;
+    void Dispatch(uint32_t x, uint32_t y, uint32_t z) final;
+    void CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size) final;
+
+    MTL::CommandBuffer* GetMTLCommandBuffer() const {
+        return m_CommandBuffer;
+    }
+
+private:
+    friend class MTLRHIDevice;
+
+    explicit MTLRHICommandList(MTLRHIDevice& device) : m_Device(device) {}
+
+    // end whichever encoder is open, so another kind can begin. Throws if the list doesn't own its encoders
+    void EndEncoding();
+    MTL::CommandBuffer& GetCommandBuffer();
+    MTL::RenderCommandEncoder& GetRenderEncoder();
+
+    MTLRHIDevice&               m_Device;
+    MTL::CommandBuffer*         m_CommandBuffer = nullptr;  // null when drawing into the caller's render pass
+    MTL::RenderCommandEncoder*  m_RenderEncoder = nullptr;
+    MTL::ComputeCommandEncoder* m_ComputeEncoder = nullptr;
+    MTL::BlitCommandEncoder*    m_BlitEncoder = nullptr;
+    RHIPipeline                 m_Pipeline = {};
+    MTL::Buffer*                m_IndexBuffer = nullptr;
+    uint64_t                    m_IndexOffset = 0;
+};
+
+class MTLRHIDevice : public RHIDevice
+{
+public:
+    static constexpr uint32_t VertexBufferIndex = 0;
+
+    struct Settings
+    {
+        MTL::Device* device = nullptr;
+        MTL::CommandQueue* queue = nullptr;     // command lists are committed to it, it must outlive the device
+        MTL::Library* library = nullptr;        // where pipelines find their functions
+    };
+
+    explicit MTLRHIDevice(const Settings& settings) : m_Settings(settings) {}
+    // waits for every command list committed, then releases whatever is still alive
+    virtual ~MTLRHIDevice();
+
+    const char* GetName() const final {
+        return "Metal";
+    }
+
+    RHIBuffer CreateBuffer(const RHIBufferDesc& desc) final;
+    void DestroyBuffer(RHIBuffer buffer) final;
+    void WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data) final;
+
+    RHITexture CreateTexture(const RHITextureDesc& desc) final;
+    void DestroyTexture(RHITexture texture) final;
+
+    RHIPipeline CreatePipeline(const RHIPipelineDesc& desc) final;
+    // A pipeline made outside the RHI, so command lists can still set it and draw with its topology.
+    // The device retains it until the pipeline is destroyed.
+    RHIPipeline ImportPipeline(MTL::RenderPipelineState* pipelineState, RHITopology topology);
+    void DestroyPipeline(RHIPipeline pipeline) final;
+
+    RHICommandList* GetCommandList() final;
+    uint64_t ExecuteCommandList(RHICommandList* commandList) final;
+
+    bool IsFenceComplete(uint64_t fenceValue) final;
+    void WaitForFenceValue(uint64_t fenceValue) final;
+    void Flush() final;
+
+    MTL::Buffer* GetMTLBuffer(RHIBuffer buffer);
+    MTL::Texture* GetMTLTexture(RHITexture texture);
+
+    static MTL::PixelFormat GetMTLPixelFormat(RHIFormat format);
+
+private:
+    friend class MTLRHICommandList;
+
+    struct BufferData
+    {
+        MTL::Buffer* buffer = nullptr;
+        uint64_t size = 0;
+        std::byte* mapped = nullptr;        // only for host visible buffers
+    };
+
+    struct TextureData
+    {
+        MTL::Texture* texture = nullptr;
+        ResourceState state = ResourceState::Undefined;     // as of the last barrier recorded
+    };
+
+    struct PipelineData
+    {
+        MTL::RenderPipelineState* renderPipelineState = nullptr;
+        MTL::ComputePipelineState* computePipelineState = nullptr;
+        MTL::PrimitiveType primitiveType = MTL::PrimitiveType::PrimitiveTypeTriangle;
+    };
+
+    // Throws std::runtime_error if the handle doesn't refer to a live resource, like using a destroyed one
+    BufferData& FindBuffer(RHIBuffer buffer);
+    TextureData& FindTexture(RHITexture texture);
+    PipelineData& FindPipeline(RHIPipeline pipeline);
+
+    MTL::Function* LoadFunction(std::string_view name);
+    // release the command buffers that have completed, oldest first
+    void RetireCommandBuffers(uint64_t waitForValue);
+
+    Settings                                        m_Settings;
+
+    RHIHandlePool<RHIBuffer, BufferData>            m_Buffers;
+    RHIHandlePool<RHITexture, TextureData>          m_Textures;
+    RHIHandlePool<RHIPipeline, PipelineData>        m_Pipelines;
+
+    std::vector<std::unique_ptr<MTLRHICommandList>> m_CommandLists;     // owns every command list handed out
+    std::vector<MTLRHICommandList*>                 m_FreeCommandLists; // committed, their command buffers are in flight
+
+    std::deque<std::pair<uint64_t, MTL::CommandBuffer*>> m_InFlight;    // committed and not known to be complete
+    uint64_t                                        m_FenceValue = 0;   // of the last command list committed
+    uint64_t                                        m_CompletedValue = 0;
+};
+#endif
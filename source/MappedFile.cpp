@@ -0,0 +1,95 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("failed to open file!");
+    }
+    m_File = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("failed to get file size!");
+    }
+    m_Size = static_cast<size_t>(size.QuadPart);
+    if (m_Size == 0)
+    {
+        return;     // empty files can't be mapped, and don't need to be
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("failed to map file!");
+    }
+    m_Mapping = mapping;
+    m_Data = static_cast<const std::byte*>(view);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data)
+    {
+        UnmapViewOfFile(m_Data);
+        CloseHandle(m_Mapping);
+    }
+    CloseHandle(m_File);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("failed to open file!");
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0)
+    {
+        close(file);
+        throw std::runtime_error("failed to get file size!");
+    }
+    m_Size = static_cast<size_t>(info.st_size);
+    if (m_Size > 0)
+    {
+        void* view = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view == MAP_FAILED)
+        {
+            close(file);
+            throw std::runtime_error("failed to map file!");
+        }
+        m_Data = static_cast<const std::byte*>(view);
+    }
+    // the mapping keeps the file alive by itself
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data)
+    {
+        munmap(const_cast<std::byte*>(m_Data), m_Size);
+    }
+}
+#endif
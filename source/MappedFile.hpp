@@ -0,0 +1,34 @@
+/**
+ * A file mapped read-only into the address space. Pages come in from the OS file cache as they are first touched,
+ * so reading a texture is one copy from the cache straight to wherever it is going, with no buffer to read it into
+ * first and no reading the parts that aren't used. The mapping lasts as long as the object.
+ */
+
+#pragma once
+
+#include <cstddef>      // For std::byte
+#include <filesystem>   // For std::filesystem::path
+#include <span>         // For std::span
+
+class MappedFile
+{
+public:
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    explicit MappedFile(const std::filesystem::path& path);
+    virtual ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> GetData() const {
+        return { m_Data, m_Size };
+    }
+
+private:
+    const std::byte*    m_Data = nullptr;
+    size_t              m_Size = 0;
+#if defined(_WIN32)
+    void*               m_File = nullptr;       // HANDLEs, kept out of the header so it doesn't need Windows.h
+    void*               m_Mapping = nullptr;
+#endif
+};
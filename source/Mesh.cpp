@@ -0,0 +1,59 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+Mesh MakeSphereMesh(uint32_t rings)
+{
+    rings = std::max(rings, 2u);
+    uint32_t segments = rings * 2;
+    Mesh mesh;
+
+    // the seam has two columns of vertices, so texture coordinates can wrap
+    mesh.vertices.reserve(size_t(rings + 1) * (segments + 1));
+    for (uint32_t ring = 0; ring <= rings; ring++)
+    {
+        float theta = std::numbers::pi_v<float> * ring / rings;
+        for (uint32_t segment = 0; segment <= segments; segment++)
+        {
+            float phi = 2 * std::numbers::pi_v<float> * segment / segments;
+            glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            mesh.vertices.push_back({ position, position, { float(segment) / segments, float(ring) / rings } });
+        }
+    }
+
+    // a quad per band and segment, less the triangle of each quad that collapses to a point at the poles
+    mesh.indices.reserve(size_t(rings - 1) * segments * 6);
+    for (uint32_t ring = 0; ring < rings; ring++)
+    {
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            uint32_t a = ring * (segments + 1) + segment;
+            uint32_t b = a + segments + 1;      // one ring further south
+            uint32_t c = b + 1;
+            uint32_t d = a + 1;
+            if (ring != rings - 1)
+            {
+                mesh.indices.insert(mesh.indices.end(), { a, c, b });
+            }
+            if (ring != 0)
+            {
+                mesh.indices.insert(mesh.indices.end(), { a, d, c });
+            }
+        }
+    }
+    return mesh;
+}
+
+uint32_t SelectLod(const Mesh& mesh, float distance, float pixelsPerUnit, float maxPixelError)
+{
+    // errors only grow down the chain, so the first level that would show ends the search
+    float allowedError = maxPixelError * std::max(distance, 1e-4f) / pixelsPerUnit;
+    uint32_t level = 0;
+    while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].error <= allowedError)
+    {
+        level++;
+    }
+    return level;
+}
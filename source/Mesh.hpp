@@ -0,0 +1,43 @@
+/**
+ * Indexed triangle meshes on the CPU, for the tools that process them and the scenes that draw them.
+ * Triangles wind counter-clockwise seen from the front.
+ * A mesh can carry levels of detail (see GenerateLods in MeshSimplifier.hpp), which share its vertices and
+ * each index a range of its index buffer.
+ */
+
+#pragma once
+
+#include <cstdint>      // For uint32_t
+#include <vector>       // For std::vector
+
+#include <glm/glm.hpp>
+
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+struct MeshLod
+{
+    uint32_t firstIndex;        // into Mesh::indices
+    uint32_t indexCount;
+    float error;                // about how far it strays from the full mesh, in the mesh's units
+};
+
+struct Mesh
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;      // three per triangle, every level of detail one after the other
+    std::vector<MeshLod> lods;          // from the full mesh down, empty if the indices are a single mesh
+};
+
+// A sphere of radius 1 around the origin, rings bands from pole to pole with twice as many segments around.
+// That comes to about 4 * rings * rings triangles, so big test meshes are easy to make
+Mesh MakeSphereMesh(uint32_t rings);
+
+// The coarsest level of detail whose error covers at most maxPixelError pixels on screen. distance is from the
+// camera to the closest point of the mesh, and pixelsPerUnit how many pixels one unit covers at a distance of 1,
+// which is projection[1][1] * viewport height / 2.
+uint32_t SelectLod(const Mesh& mesh, float distance, float pixelsPerUnit, float maxPixelError);
@@ -0,0 +1,760 @@
+#include "MeshSimplifier.hpp"
+#include "CommandLine.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <thread>
+
+namespace {
+    constexpr uint32_t NoVertex = ~0u;
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    float GetAttribute(const MeshVertex& vertex, uint32_t attribute)
+    {
+        return attribute < 3 ? vertex.normal[attribute] : vertex.uv[attribute - 3];
+    }
+}
+
+void MeshSimplifier::Quadric::AddPlane(glm::vec3 normal, float distance, float planeWeight)
+{
+    xx += planeWeight * normal.x * normal.x;
+    xy += planeWeight * normal.x * normal.y;
+    xz += planeWeight * normal.x * normal.z;
+    yy += planeWeight * normal.y * normal.y;
+    yz += planeWeight * normal.y * normal.z;
+    zz += planeWeight * normal.z * normal.z;
+    b += planeWeight * distance * normal;
+    c += planeWeight * distance * distance;
+    weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+    xx += other.xx;
+    xy += other.xy;
+    xz += other.xz;
+    yy += other.yy;
+    yz += other.yz;
+    zz += other.zz;
+    b += other.b;
+    c += other.c;
+    weight += other.weight;
+}
+
+float MeshSimplifier::Quadric::Evaluate(glm::vec3 p) const
+{
+    float result = p.x * (xx * p.x + 2 * (xy * p.y + xz * p.z)) + p.y * (yy * p.y + 2 * yz * p.z) + zz * p.z * p.z
+        + 2 * glm::dot(b, p) + c;
+    return std::max(result, 0.0f);     // rounding can take it just below
+}
+
+void MeshSimplifier::AttributeQuadric::Add(glm::vec3 gradient, float offset, float weight)
+{
+    gg[0] += weight * gradient.x * gradient.x;
+    gg[1] += weight * gradient.x * gradient.y;
+    gg[2] += weight * gradient.x * gradient.z;
+    gg[3] += weight * gradient.y * gradient.y;
+    gg[4] += weight * gradient.y * gradient.z;
+    gg[5] += weight * gradient.z * gradient.z;
+    g += weight * gradient;
+    gd += weight * offset * gradient;
+    d += weight * offset;
+    dd += weight * offset * offset;
+}
+
+void MeshSimplifier::AttributeQuadric::Add(const AttributeQuadric& other)
+{
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        gg[i] += other.gg[i];
+    }
+    g += other.g;
+    gd += other.gd;
+    d += other.d;
+    dd += other.dd;
+}
+
+float MeshSimplifier::AttributeQuadric::Evaluate(glm::vec3 p, float attribute, float weight) const
+{
+    // the sum of weight * (dot(gradient, p) + offset - attribute)^2, multiplied out
+    float pgg = p.x * (gg[0] * p.x + 2 * (gg[1] * p.y + gg[2] * p.z)) + p.y * (gg[3] * p.y + 2 * gg[4] * p.z) + gg[5] * p.z * p.z;
+    float result = pgg + 2 * glm::dot(gd, p) + dd - 2 * attribute * (glm::dot(g, p) + d) + attribute * attribute * weight;
+    return std::max(result, 0.0f);
+}
+
+MeshSimplifier::MeshSimplifier()
+    : MeshSimplifier(Settings{})
+{
+}
+
+MeshSimplifier::MeshSimplifier(const Settings& settings)
+    : m_Settings(settings)
+{
+}
+
+void MeshSimplifier::Reset(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices)
+{
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    m_Vertices = vertices;
+    m_Indices.assign(indices.begin(), indices.end() - indices.size() % 3);
+    m_MaxError = 0;
+
+    // weld vertices that share a position, whatever their attributes
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    auto lessPosition = [&](uint32_t a, uint32_t b) {
+        const auto& pa = vertices[a].position;
+        const auto& pb = vertices[b].position;
+        return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+    };
+    std::sort(order.begin(), order.end(), lessPosition);
+    m_Positions.clear();
+    m_PositionOf.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        if (i == 0 || lessPosition(order[i - 1], order[i]))
+        {
+            m_Positions.push_back(vertices[order[i]].position);
+        }
+        m_PositionOf[order[i]] = static_cast<uint32_t>(m_Positions.size() - 1);
+    }
+    uint32_t positionCount = static_cast<uint32_t>(m_Positions.size());
+    m_PositionVertexOffsets.assign(positionCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        m_PositionVertexOffsets[m_PositionOf[vertex] + 1]++;
+    }
+    std::partial_sum(m_PositionVertexOffsets.begin(), m_PositionVertexOffsets.end(), m_PositionVertexOffsets.begin());
+    m_PositionVertices.resize(vertexCount);
+    {
+        auto next = m_PositionVertexOffsets;
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            m_PositionVertices[next[m_PositionOf[vertex]]++] = vertex;
+        }
+    }
+
+    // costs are relative to the mesh's size, so the weights mean the same for every mesh
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+    for (const auto& position : m_Positions)
+    {
+        lo = glm::min(lo, position);
+        hi = glm::max(hi, position);
+    }
+    float radius = positionCount > 0 ? glm::length(hi - lo) * 0.5f : 1.0f;
+    m_ErrorScale = radius > 0 ? 1.0f / (radius * radius) : 1.0f;
+
+    // every triangle's plane goes to its corners' positions, and its attribute gradients to its corners' vertices
+    m_Quadrics.assign(positionCount, {});
+    m_AttributeQuadrics.assign(size_t(vertexCount) * AttributeCount, {});
+    m_AttributeWeights.assign(vertexCount, 0.0f);
+    size_t triangleCount = m_Indices.size() / 3;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* corners = &m_Indices[t * 3];
+        glm::vec3 p0 = vertices[corners[0]].position;
+        glm::vec3 e1 = vertices[corners[1]].position - p0;
+        glm::vec3 e2 = vertices[corners[2]].position - p0;
+        glm::vec3 normal = glm::cross(e1, e2);
+        float doubleArea = glm::length(normal);
+        if (doubleArea == 0)
+        {
+            continue;
+        }
+        normal /= doubleArea;
+        float area = doubleArea * 0.5f;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_Quadrics[m_PositionOf[corners[i]]].AddPlane(normal, -glm::dot(normal, p0), area);
+        }
+
+        // each attribute as a linear function over the triangle: dot(gradient, p) + offset
+        float d11 = glm::dot(e1, e1), d12 = glm::dot(e1, e2), d22 = glm::dot(e2, e2);
+        float determinant = d11 * d22 - d12 * d12;
+        if (determinant <= 0)
+        {
+            continue;
+        }
+        for (uint32_t attribute = 0; attribute < AttributeCount; attribute++)
+        {
+            float a0 = GetAttribute(vertices[corners[0]], attribute);
+            float da1 = GetAttribute(vertices[corners[1]], attribute) - a0;
+            float da2 = GetAttribute(vertices[corners[2]], attribute) - a0;
+            glm::vec3 gradient = e1 * ((d22 * da1 - d12 * da2) / determinant) + e2 * ((d11 * da2 - d12 * da1) / determinant);
+            float offset = a0 - glm::dot(gradient, p0);
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                m_AttributeQuadrics[size_t(corners[i]) * AttributeCount + attribute].Add(gradient, offset, area);
+            }
+        }
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_AttributeWeights[corners[i]] += area;
+        }
+    }
+
+    // open edges get a plane through them at right angles to their triangle, so they don't pull in
+    BuildAdjacency();
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* corners = &m_Indices[t * 3];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t a = m_PositionOf[corners[i]];
+            uint32_t b = m_PositionOf[corners[(i + 1) % 3]];
+            if (!IsBorderEdge(a, b))
+            {
+                continue;
+            }
+            glm::vec3 p0 = m_Positions[m_PositionOf[corners[0]]];
+            glm::vec3 normal = glm::cross(m_Positions[m_PositionOf[corners[1]]] - p0, m_Positions[m_PositionOf[corners[2]]] - p0);
+            glm::vec3 edge = m_Positions[b] - m_Positions[a];
+            glm::vec3 borderNormal = glm::cross(edge, normal);
+            float length = glm::length(borderNormal);
+            if (length == 0)
+            {
+                continue;
+            }
+            borderNormal /= length;
+            float weight = glm::dot(edge, edge) * m_Settings.borderWeight;
+            m_Quadrics[a].AddPlane(borderNormal, -glm::dot(borderNormal, m_Positions[a]), weight);
+            m_Quadrics[b].AddPlane(borderNormal, -glm::dot(borderNormal, m_Positions[a]), weight);
+        }
+    }
+
+    m_VertexRemap.resize(vertexCount);
+    std::iota(m_VertexRemap.begin(), m_VertexRemap.end(), 0);
+    m_Collapses.clear();
+    m_CostsValid = false;
+}
+
+void MeshSimplifier::Simplify(size_t targetTriangles)
+{
+    while (GetTriangleCount() > targetTriangles)
+    {
+        BuildAdjacency();
+
+        // The cheaper direction of every edge that can collapse at all. Only what the last pass touched has changed,
+        // so every other edge keeps its cost from then. Both lists are in edge order, so they can be walked together
+        m_NextCollapses.clear();
+        size_t previous = 0;
+        for (uint64_t edge : m_Edges)
+        {
+            uint32_t a = static_cast<uint32_t>(edge >> 32);
+            uint32_t b = static_cast<uint32_t>(edge);
+            if (m_CostsValid && !m_Touched[a] && !m_Touched[b])
+            {
+                while (previous < m_Collapses.size() && EdgeKey(m_Collapses[previous].from, m_Collapses[previous].to) < edge)
+                {
+                    previous++;
+                }
+                if (previous < m_Collapses.size() && EdgeKey(m_Collapses[previous].from, m_Collapses[previous].to) == edge)
+                {
+                    m_NextCollapses.push_back(m_Collapses[previous]);
+                }
+                continue;
+            }
+            Collapse best, other;
+            bool found = GetCollapse(a, b, best);
+            if (GetCollapse(b, a, other) && (!found || other.cost < best.cost))
+            {
+                best = other;
+                found = true;
+            }
+            if (found)
+            {
+                m_NextCollapses.push_back(best);
+            }
+        }
+        std::swap(m_Collapses, m_NextCollapses);
+        m_CostsValid = true;
+        if (m_Collapses.empty())
+        {
+            break;
+        }
+
+        // Each collapse removes about two triangles. Collapses next to each other can't both happen this pass,
+        // so look a bit past the goal, but no further: more expensive edges are better left for a later pass.
+        // Only that many need sorting, and the collapses themselves stay in edge order for the next pass
+        size_t triangles = GetTriangleCount();
+        size_t goal = (triangles - targetTriangles) / 2 + 1;
+        size_t considered = std::min(goal + goal / 2, m_Collapses.size() - 1) + 1;
+        m_Order.resize(m_Collapses.size());
+        std::iota(m_Order.begin(), m_Order.end(), 0);
+        auto byCost = [this](uint32_t a, uint32_t b) {
+            return m_Collapses[a].cost < m_Collapses[b].cost;
+        };
+        std::nth_element(m_Order.begin(), m_Order.begin() + (considered - 1), m_Order.end(), byCost);
+        std::sort(m_Order.begin(), m_Order.begin() + considered, byCost);
+
+        m_Touched.assign(m_Positions.size(), 0);
+        size_t applied = 0;
+        for (size_t i = 0; i < considered && triangles > targetTriangles; i++)
+        {
+            auto& collapse = m_Collapses[m_Order[i]];
+            if (m_Touched[collapse.from] || m_Touched[collapse.to])
+            {
+                continue;
+            }
+            // stays invalid until something next to it changes, which costs it again
+            if (!IsCollapseValid(collapse.from, collapse.to))
+            {
+                collapse.cost = std::numeric_limits<float>::max();
+                continue;
+            }
+            triangles -= ApplyCollapse(collapse);
+            applied++;
+        }
+        if (applied == 0)
+        {
+            break;
+        }
+
+        // the collapsed triangles are now degenerate, everything else just gets its new vertices
+        size_t write = 0;
+        for (size_t i = 0; i < m_Indices.size(); i += 3)
+        {
+            uint32_t a = m_VertexRemap[m_Indices[i]];
+            uint32_t b = m_VertexRemap[m_Indices[i + 1]];
+            uint32_t c = m_VertexRemap[m_Indices[i + 2]];
+            uint32_t pa = m_PositionOf[a], pb = m_PositionOf[b], pc = m_PositionOf[c];
+            if (pa != pb && pb != pc && pa != pc)
+            {
+                m_Indices[write++] = a;
+                m_Indices[write++] = b;
+                m_Indices[write++] = c;
+            }
+        }
+        m_Indices.resize(write);
+        std::iota(m_VertexRemap.begin(), m_VertexRemap.end(), 0);
+    }
+}
+
+void MeshSimplifier::BuildAdjacency()
+{
+    uint32_t positionCount = static_cast<uint32_t>(m_Positions.size());
+    uint32_t triangleCount = static_cast<uint32_t>(m_Indices.size() / 3);
+
+    m_TriangleOffsets.assign(positionCount + 1, 0);
+    m_Live.assign(m_Vertices.size(), 0);
+    for (uint32_t vertex : m_Indices)
+    {
+        m_TriangleOffsets[m_PositionOf[vertex] + 1]++;
+        m_Live[vertex] = 1;
+    }
+    std::partial_sum(m_TriangleOffsets.begin(), m_TriangleOffsets.end(), m_TriangleOffsets.begin());
+    m_Triangles.resize(m_Indices.size());
+    m_Edges.clear();
+    {
+        auto next = m_TriangleOffsets;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                m_Triangles[next[m_PositionOf[m_Indices[t * 3 + i]]]++] = t;
+                m_Edges.push_back(EdgeKey(m_PositionOf[m_Indices[t * 3 + i]], m_PositionOf[m_Indices[t * 3 + (i + 1) % 3]]));
+            }
+        }
+    }
+
+    // an edge with one triangle is open, one with more than two can't collapse without tearing something
+    std::sort(m_Edges.begin(), m_Edges.end());
+    m_BorderEdges.clear();
+    m_Border.assign(positionCount, 0);
+    m_Locked.assign(positionCount, 0);
+    size_t write = 0;
+    for (size_t i = 0; i < m_Edges.size();)
+    {
+        size_t end = i;
+        while (end < m_Edges.size() && m_Edges[end] == m_Edges[i])
+        {
+            end++;
+        }
+        uint64_t edge = m_Edges[i];
+        uint32_t a = static_cast<uint32_t>(edge >> 32);
+        uint32_t b = static_cast<uint32_t>(edge);
+        if (end - i == 1)
+        {
+            m_BorderEdges.push_back(edge);
+            m_Border[a] = m_Border[b] = 1;
+        }
+        else if (end - i > 2)
+        {
+            m_Locked[a] = m_Locked[b] = 1;
+        }
+        m_Edges[write++] = edge;
+        i = end;
+    }
+    m_Edges.resize(write);
+}
+
+bool MeshSimplifier::IsBorderEdge(uint32_t a, uint32_t b) const
+{
+    return std::binary_search(m_BorderEdges.begin(), m_BorderEdges.end(), EdgeKey(a, b));
+}
+
+uint32_t MeshSimplifier::FindTarget(uint32_t vertex, uint32_t from, uint32_t to) const
+{
+    for (uint32_t i = m_TriangleOffsets[from]; i < m_TriangleOffsets[from + 1]; i++)
+    {
+        const uint32_t* corners = &m_Indices[m_Triangles[i] * 3];
+        if (corners[0] != vertex && corners[1] != vertex && corners[2] != vertex)
+        {
+            continue;
+        }
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (m_PositionOf[corners[c]] == to)
+            {
+                return corners[c];
+            }
+        }
+    }
+    return NoVertex;
+}
+
+bool MeshSimplifier::GetCollapse(uint32_t from, uint32_t to, Collapse& collapse) const
+{
+    // open edges may only shorten, not move inwards
+    if (m_Locked[from] || (m_Border[from] && !IsBorderEdge(from, to)))
+    {
+        return false;
+    }
+
+    glm::vec3 position = m_Positions[to];
+    Quadric quadric = m_Quadrics[from];
+    quadric.Add(m_Quadrics[to]);
+    float error = quadric.weight > 0 ? quadric.Evaluate(position) / quadric.weight : 0.0f;
+
+    // every vertex at from takes on the attributes of the one it turns into
+    float attributeCost = 0;
+    const float weights[AttributeCount] = {
+        m_Settings.normalWeight, m_Settings.normalWeight, m_Settings.normalWeight, m_Settings.uvWeight, m_Settings.uvWeight
+    };
+    for (uint32_t i = m_PositionVertexOffsets[from]; i < m_PositionVertexOffsets[from + 1]; i++)
+    {
+        uint32_t vertex = m_PositionVertices[i];
+        if (!m_Live[vertex])
+        {
+            continue;
+        }
+        // a vertex with no triangle reaching to is on the other side of a seam, and can't follow
+        uint32_t target = FindTarget(vertex, from, to);
+        if (target == NoVertex)
+        {
+            return false;
+        }
+        float weight = m_AttributeWeights[vertex];
+        if (weight <= 0)
+        {
+            continue;
+        }
+        for (uint32_t attribute = 0; attribute < AttributeCount; attribute++)
+        {
+            const auto& attributeQuadric = m_AttributeQuadrics[size_t(vertex) * AttributeCount + attribute];
+            attributeCost += weights[attribute] * attributeQuadric.Evaluate(position, GetAttribute(m_Vertices[target], attribute), weight) / weight;
+        }
+    }
+
+    collapse = { from, to, error * m_ErrorScale + attributeCost, error };
+    return true;
+}
+
+bool MeshSimplifier::IsCollapseValid(uint32_t from, uint32_t to)
+{
+    // the two ends may only share the neighbours on the triangles either side of the edge, otherwise
+    // collapsing it pinches the surface into a non-manifold edge
+    m_Neighbours.clear();
+    for (uint32_t i = m_TriangleOffsets[from]; i < m_TriangleOffsets[from + 1]; i++)
+    {
+        const uint32_t* corners = &m_Indices[m_Triangles[i] * 3];
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t position = m_PositionOf[corners[c]];
+            if (position != from && position != to)
+            {
+                m_Neighbours.push_back(position);
+            }
+        }
+    }
+    std::sort(m_Neighbours.begin(), m_Neighbours.end());
+    m_Neighbours.erase(std::unique(m_Neighbours.begin(), m_Neighbours.end()), m_Neighbours.end());
+    size_t neighbourCount = m_Neighbours.size();
+    for (uint32_t i = m_TriangleOffsets[to]; i < m_TriangleOffsets[to + 1]; i++)
+    {
+        const uint32_t* corners = &m_Indices[m_Triangles[i] * 3];
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t position = m_PositionOf[corners[c]];
+            if (position != from && position != to && std::binary_search(m_Neighbours.begin(), m_Neighbours.begin() + neighbourCount, position))
+            {
+                m_Neighbours.push_back(position);
+            }
+        }
+    }
+    std::sort(m_Neighbours.begin() + neighbourCount, m_Neighbours.end());
+    size_t shared = std::unique(m_Neighbours.begin() + neighbourCount, m_Neighbours.end()) - (m_Neighbours.begin() + neighbourCount);
+    if (shared > (IsBorderEdge(from, to) ? 1u : 2u))
+    {
+        return false;
+    }
+
+    // no triangle that stays may turn over
+    for (uint32_t i = m_TriangleOffsets[from]; i < m_TriangleOffsets[from + 1]; i++)
+    {
+        const uint32_t* corners = &m_Indices[m_Triangles[i] * 3];
+        glm::vec3 before[3], after[3];
+        bool collapses = false;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t position = m_PositionOf[corners[c]];
+            collapses |= position == to;
+            before[c] = m_Positions[position];
+            after[c] = position == from ? m_Positions[to] : before[c];
+        }
+        if (collapses)
+        {
+            continue;
+        }
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normalBefore, normalAfter) <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t MeshSimplifier::ApplyCollapse(const Collapse& collapse)
+{
+    uint32_t from = collapse.from;
+    uint32_t to = collapse.to;
+    for (uint32_t i = m_PositionVertexOffsets[from]; i < m_PositionVertexOffsets[from + 1]; i++)
+    {
+        uint32_t vertex = m_PositionVertices[i];
+        if (!m_Live[vertex])
+        {
+            continue;
+        }
+        uint32_t target = FindTarget(vertex, from, to);
+        m_VertexRemap[vertex] = target;
+        for (uint32_t attribute = 0; attribute < AttributeCount; attribute++)
+        {
+            m_AttributeQuadrics[size_t(target) * AttributeCount + attribute].Add(m_AttributeQuadrics[size_t(vertex) * AttributeCount + attribute]);
+        }
+        m_AttributeWeights[target] += m_AttributeWeights[vertex];
+    }
+    m_Quadrics[to].Add(m_Quadrics[from]);
+    m_MaxError = std::max(m_MaxError, collapse.error);
+
+    // everything around from has changed, so nothing else there collapses until the next pass has looked again
+    size_t removed = 0;
+    m_Touched[from] = m_Touched[to] = 1;
+    for (uint32_t i = m_TriangleOffsets[from]; i < m_TriangleOffsets[from + 1]; i++)
+    {
+        const uint32_t* corners = &m_Indices[m_Triangles[i] * 3];
+        bool collapses = false;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t position = m_PositionOf[corners[c]];
+            m_Touched[position] = 1;
+            collapses |= position == to;
+        }
+        removed += collapses;
+    }
+    return removed;
+}
+
+void GenerateLods(Mesh& mesh, const LodSettings& settings)
+{
+    // start from the full mesh, dropping any levels made before
+    if (!mesh.lods.empty())
+    {
+        mesh.indices.resize(mesh.lods[0].firstIndex + mesh.lods[0].indexCount);
+        mesh.indices.erase(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].firstIndex);
+    }
+    mesh.lods = { MeshLod{ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f } };
+
+    // each level carries on from the last, so it is measured against the full mesh and costs no more than one run
+    MeshSimplifier simplifier(settings.simplifier);
+    simplifier.Reset(mesh.vertices, mesh.indices);
+    size_t triangles = mesh.indices.size() / 3;
+    while (mesh.lods.size() < settings.maxLevels)
+    {
+        auto target = static_cast<size_t>(triangles * settings.reduction);
+        if (target < settings.minTriangles)
+        {
+            break;
+        }
+        simplifier.Simplify(target);
+        // stop once the simplifier is stuck well short of the target, another level would hardly differ
+        size_t simplified = simplifier.GetTriangleCount();
+        if (simplified > (triangles + target) / 2)
+        {
+            break;
+        }
+        auto indices = simplifier.GetIndices();
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(indices.size()), simplifier.GetError() });
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+        triangles = simplified;
+    }
+}
+
+void GenerateLods(std::span<Mesh> meshes, WorkerPool& pool, const LodSettings& settings)
+{
+    pool.ParallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t job) {
+        GenerateLods(meshes[job], settings);
+    });
+}
+
+namespace {
+    // A sphere with bumps on it, so some edges matter more than others. The normals are worked out again from
+    // the triangles, so the seam ends up with a crease in them as well as in the texture coordinates
+    Mesh MakeBumpyMesh(uint32_t rings, uint32_t seed)
+    {
+        auto mesh = MakeSphereMesh(rings);
+        float phase = seed * 1.7f;
+        for (auto& vertex : mesh.vertices)
+        {
+            glm::vec3 p = vertex.position;
+            float bump = std::sin(5 * p.x + phase) * std::sin(4 * p.y + 2 * phase) * std::sin(6 * p.z + 3 * phase);
+            vertex.position = p * (1.0f + 0.15f * bump);
+            vertex.normal = glm::vec3(0.0f);
+        }
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            auto& a = mesh.vertices[mesh.indices[i]];
+            auto& b = mesh.vertices[mesh.indices[i + 1]];
+            auto& c = mesh.vertices[mesh.indices[i + 2]];
+            glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+            a.normal += normal;
+            b.normal += normal;
+            c.normal += normal;
+        }
+        for (auto& vertex : mesh.vertices)
+        {
+            float length = glm::length(vertex.normal);
+            vertex.normal = length > 0 ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+        return mesh;
+    }
+
+    // an empty string if every level is a proper mesh, smaller than the last and no closer to the original
+    std::string Validate(const Mesh& mesh)
+    {
+        if (mesh.lods.empty())
+        {
+            return "no levels";
+        }
+        for (size_t level = 0; level < mesh.lods.size(); level++)
+        {
+            const auto& lod = mesh.lods[level];
+            if (lod.indexCount == 0 || lod.indexCount % 3 != 0 || size_t(lod.firstIndex) + lod.indexCount > mesh.indices.size())
+            {
+                return std::format("level {} has a bad index range", level);
+            }
+            if (level > 0 && (lod.indexCount >= mesh.lods[level - 1].indexCount || lod.error < mesh.lods[level - 1].error))
+            {
+                return std::format("level {} isn't smaller or is more accurate than the one before", level);
+            }
+            for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3)
+            {
+                uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+                if (a >= mesh.vertices.size() || b >= mesh.vertices.size() || c >= mesh.vertices.size())
+                {
+                    return std::format("level {} indexes past the vertices", level);
+                }
+                const auto& pa = mesh.vertices[a].position;
+                const auto& pb = mesh.vertices[b].position;
+                const auto& pc = mesh.vertices[c].position;
+                if (pa == pb || pb == pc || pa == pc)
+                {
+                    return std::format("level {} has a degenerate triangle", level);
+                }
+            }
+        }
+        return {};
+    }
+}
+
+int RunMeshSimplifierBenchmark()
+{
+    uint32_t threadCount = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+    uint32_t meshCount = std::max(CommandLine::GetValue("meshes", 16u), 1u);
+    uint32_t triangles = CommandLine::GetValue("triangles", 50000u);
+
+    std::vector<Mesh> sources;
+    size_t totalTriangles = 0;
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        sources.push_back(MakeBumpyMesh(static_cast<uint32_t>(std::sqrt(triangles / 4.0)), i));
+        totalTriangles += sources.back().indices.size() / 3;
+    }
+    LodSettings settings;
+    std::cout << std::format("{} meshes of {} triangles, levels of {:.0f}% down to {} triangles",
+        meshCount, sources[0].indices.size() / 3, settings.reduction * 100, settings.minTriangles) << std::endl;
+
+    // the same meshes on one thread, then a mesh per job across the pool
+    std::cout << std::format("{:<10} {:>8} {:>12} {:>12}", "meshes", "threads", "ms", "Mtri/s") << std::endl;
+    std::vector<Mesh> serial = sources;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& mesh : serial)
+    {
+        GenerateLods(mesh, settings);
+    }
+    double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::format("{:<10} {:>8} {:>12.2f} {:>12.2f}", "serial", 1, serialMs, totalTriangles / serialMs / 1000) << std::endl;
+
+    std::vector<Mesh> parallel = sources;
+    WorkerPool workers(threadCount);
+    start = std::chrono::steady_clock::now();
+    GenerateLods(parallel, workers, settings);
+    double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::format("{:<10} {:>8} {:>12.2f} {:>12.2f}", "parallel", threadCount, parallelMs, totalTriangles / parallelMs / 1000) << std::endl;
+
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        auto error = Validate(serial[i]);
+        if (!error.empty())
+        {
+            std::cout << std::format("Mesh {} is wrong: {}", i, error) << std::endl;
+            return 1;
+        }
+        // every mesh is simplified the same way whichever thread does it
+        if (serial[i].indices != parallel[i].indices)
+        {
+            std::cout << std::format("Mesh {} came out differently across threads", i) << std::endl;
+            return 1;
+        }
+    }
+
+    const auto& mesh = serial[0];
+    std::cout << std::format("{:<6} {:>10} {:>8} {:>12}", "level", "triangles", "of full", "error") << std::endl;
+    for (size_t level = 0; level < mesh.lods.size(); level++)
+    {
+        const auto& lod = mesh.lods[level];
+        std::cout << std::format("{:<6} {:>10} {:>7.1f}% {:>12.6f}", level, lod.indexCount / 3,
+            100.0 * lod.indexCount / mesh.lods[0].indexCount, lod.error) << std::endl;
+    }
+
+    // what a 1080p view with a 60 degree field of view draws, allowing a pixel of error
+    float pixelsPerUnit = 1.0f / std::tan(glm::radians(30.0f)) * 1080 / 2;
+    std::cout << std::format("{:<10} {:>6} {:>10}", "distance", "level", "triangles") << std::endl;
+    for (float distance = 2.0f; distance <= 512.0f; distance *= 2)
+    {
+        uint32_t level = SelectLod(mesh, distance - 1.15f, pixelsPerUnit, 1.0f);
+        std::cout << std::format("{:<10.0f} {:>6} {:>10}", distance, level, mesh.lods[level].indexCount / 3) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * Mesh simplification for levels of detail, collapsing edges in order of a quadric error metric
+ * ("Surface Simplification Using Quadric Error Metrics", Garland and Heckbert 1997).
+ * Edges collapse onto one of their two vertices, so every level indexes the original vertex buffer and the
+ * levels of a mesh can share it. Normals and texture coordinates have quadrics of their own ("New Quadric Metric
+ * for Simplifying Meshes with Appearance Attributes", Hoppe 1999), so collapses that would smear them cost more,
+ * and vertices split along a seam only ever move along it. Open borders are held in place by extra planes.
+ * Collapses happen in passes: every edge is costed, the cheapest are applied as long as they don't touch each
+ * other, and the mesh is rebuilt before the next pass.
+ * A simplifier keeps its scratch memory between meshes, so keep one per thread when simplifying many.
+ */
+
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <cmath>        // For std::sqrt
+#include <cstdint>      // For uint32_t, uint64_t
+#include <span>         // For std::span
+#include <vector>       // For std::vector
+
+#include <glm/glm.hpp>
+
+class WorkerPool;
+
+class MeshSimplifier
+{
+public:
+    struct Settings
+    {
+        float normalWeight = 0.5f;      // how much bending normals costs next to moving the surface by the mesh's radius
+        float uvWeight = 1.0f;          // the same for stretching texture coordinates
+        float borderWeight = 10.0f;     // how firmly open edges are kept in place
+    };
+
+    MeshSimplifier();
+    explicit MeshSimplifier(const Settings& settings);
+    virtual ~MeshSimplifier() {}
+
+    // Start over from a mesh. Errors are always measured against this one, however many times Simplify runs
+    void Reset(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices);
+
+    // Collapse edges until at most targetTriangles are left, or nothing more can go without folding the mesh over
+    void Simplify(size_t targetTriangles);
+
+    std::span<const uint32_t> GetIndices() const {
+        return m_Indices;
+    }
+    size_t GetTriangleCount() const {
+        return m_Indices.size() / 3;
+    }
+    // about how far the simplified surface strays from the original, in the mesh's units
+    float GetError() const {
+        return std::sqrt(m_MaxError);
+    }
+
+private:
+    // squared distances to a set of planes, weighted by the area they came from
+    struct Quadric
+    {
+        float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+        glm::vec3 b{ 0.0f };
+        float c = 0;
+        float weight = 0;
+
+        void AddPlane(glm::vec3 normal, float distance, float weight);
+        void Add(const Quadric& other);
+        float Evaluate(glm::vec3 p) const;
+    };
+    // squared difference between an attribute and what its triangles' gradients predict at a position
+    struct AttributeQuadric
+    {
+        float gg[6] = {};           // sum of gradient * gradient^T
+        glm::vec3 g{ 0.0f };        // sum of gradients
+        glm::vec3 gd{ 0.0f };       // sum of gradient * offset
+        float d = 0;
+        float dd = 0;
+
+        void Add(glm::vec3 gradient, float offset, float weight);
+        void Add(const AttributeQuadric& other);
+        float Evaluate(glm::vec3 p, float attribute, float weight) const;
+    };
+    static constexpr uint32_t AttributeCount = 5;   // the normal and uv
+
+    struct Collapse
+    {
+        uint32_t from;              // positions, not vertices
+        uint32_t to;
+        float cost;                 // what picks the order, attributes included
+        float error;                // squared distance only
+    };
+
+    // rebuilt every pass, from m_Indices
+    void BuildAdjacency();
+    bool IsBorderEdge(uint32_t a, uint32_t b) const;
+    // the vertex at position to that vertex turns into, following its own triangles so it stays on the same side of any seam.
+    // ~0u if none of its triangles reach to
+    uint32_t FindTarget(uint32_t vertex, uint32_t from, uint32_t to) const;
+    bool GetCollapse(uint32_t from, uint32_t to, Collapse& collapse) const;
+    // checks that need the mesh as it is now: the collapse keeps it manifold and doesn't flip any triangle over
+    bool IsCollapseValid(uint32_t from, uint32_t to);
+    // returns how many triangles it removed
+    size_t ApplyCollapse(const Collapse& collapse);
+
+    Settings                        m_Settings;
+    std::span<const MeshVertex>     m_Vertices;
+    std::vector<uint32_t>           m_Indices;              // the mesh as simplified so far
+    float                           m_ErrorScale = 1.0f;    // one over the squared radius, so costs don't depend on the mesh's size
+    float                           m_MaxError = 0.0f;      // squared
+
+    // vertices that only differ by their attributes share a position, which is what collapses move
+    std::vector<glm::vec3>          m_Positions;
+    std::vector<uint32_t>           m_PositionOf;           // per vertex
+    std::vector<uint32_t>           m_PositionVertexOffsets;
+    std::vector<uint32_t>           m_PositionVertices;     // the vertices at each position
+    std::vector<Quadric>            m_Quadrics;             // per position
+    std::vector<AttributeQuadric>   m_AttributeQuadrics;    // AttributeCount per vertex
+    std::vector<float>              m_AttributeWeights;     // per vertex
+
+    std::vector<uint32_t>           m_TriangleOffsets;      // per position, where its triangles start in m_Triangles
+    std::vector<uint32_t>           m_Triangles;
+    std::vector<uint64_t>           m_Edges;                // every edge between positions once, sorted
+    std::vector<uint64_t>           m_BorderEdges;          // the ones with only one triangle, sorted
+    std::vector<uint8_t>            m_Border;               // per position, on an open edge
+    std::vector<uint8_t>            m_Locked;               // per position, on an edge with more than two triangles
+    std::vector<uint8_t>            m_Live;                 // per vertex, used by a triangle
+    std::vector<uint8_t>            m_Touched;              // per position, changed by this pass
+    std::vector<uint32_t>           m_VertexRemap;          // what each vertex turns into at the end of the pass
+    std::vector<Collapse>           m_Collapses;            // from the last pass, every edge that could collapse, in edge order
+    std::vector<Collapse>           m_NextCollapses;
+    std::vector<uint32_t>           m_Order;                // into m_Collapses, the cheapest first
+    bool                            m_CostsValid = false;   // whether m_Collapses and m_Touched carry over to the next pass
+    std::vector<uint32_t>           m_Neighbours;           // scratch for IsCollapseValid
+};
+
+struct LodSettings
+{
+    uint32_t maxLevels = 8;         // including the full mesh
+    float reduction = 0.5f;         // each level aims for this fraction of the last one's triangles
+    uint32_t minTriangles = 64;     // no levels smaller than this
+    MeshSimplifier::Settings simplifier;
+};
+
+// Replace mesh.lods with a chain from the full mesh (the first level, or all the indices if there are no levels yet)
+// down, appending each level's indices to mesh.indices.
+void GenerateLods(Mesh& mesh, const LodSettings& settings);
+
+// The same for many meshes, a mesh per job across the pool.
+void GenerateLods(std::span<Mesh> meshes, WorkerPool& pool, const LodSettings& settings);
+
+// CPU-only benchmark generating LOD chains for a set of bumpy spheres, on one thread and across a worker pool,
+// checking every level is a valid, smaller mesh. Prints which level SelectLod picks with distance.
+// Run with --bench-lod; --meshes=N, --triangles=N (per mesh) and --bench-threads=N change the workload.
+int RunMeshSimplifierBenchmark();
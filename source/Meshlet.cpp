@@ -0,0 +1,432 @@
+#include "Meshlet.hpp"
+#include "CommandLine.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <tuple>
+
+namespace {
+    constexpr uint32_t NoTriangle = ~0u;
+    constexpr uint8_t NotInMeshlet = 0xff;
+}
+
+MeshletBuilder::MeshletBuilder()
+    : MeshletBuilder(Settings{})
+{
+}
+
+MeshletBuilder::MeshletBuilder(const Settings& settings)
+    : m_MaxVertices(std::clamp(settings.maxVertices, 3u, 255u)),
+    m_MaxTriangles(std::max(settings.maxTriangles, 1u))
+{
+}
+
+MeshletMesh MeshletBuilder::Build(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices)
+{
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    MeshletMesh result;
+    result.vertices.reserve(indices.size() / 2);
+    result.triangles.reserve(indices.size() + 4);
+
+    // which triangles use each vertex, as one array sliced up per vertex
+    m_AdjacencyOffsets.assign(vertexCount + 1, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+    {
+        m_AdjacencyOffsets[indices[i] + 1]++;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        m_AdjacencyOffsets[v + 1] += m_AdjacencyOffsets[v];
+    }
+    m_LiveTriangles.assign(vertexCount, 0);
+    m_Adjacency.resize(triangleCount * 3);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+    {
+        uint32_t v = indices[i];
+        m_Adjacency[m_AdjacencyOffsets[v] + m_LiveTriangles[v]++] = i / 3;
+    }
+    m_Used.assign(triangleCount, 0);
+    m_LocalIndex.assign(vertexCount, NotInMeshlet);
+    m_Vertices = vertices;
+    m_Indices = indices;
+
+    Meshlet meshlet{};
+    uint32_t lastTriangle = NoTriangle;
+    uint32_t nextUnused = 0;
+    for (uint32_t added = 0; added < triangleCount; added++)
+    {
+        uint32_t triangle = NoTriangle;
+        if (meshlet.triangleCount > 0)
+        {
+            // the triangle just added has the closest neighbours, failing that anything next to the meshlet
+            triangle = FindTriangle(indices.subspan(lastTriangle * 3, 3), meshlet.vertexCount);
+            if (triangle == NoTriangle)
+            {
+                triangle = FindTriangle(std::span(result.vertices).subspan(meshlet.vertexOffset), meshlet.vertexCount);
+            }
+            if (triangle == NoTriangle)
+            {
+                FinishMeshlet(meshlet, result);
+            }
+        }
+        if (triangle == NoTriangle)
+        {
+            // start next to the meshlet just finished, or else at the first unused triangle
+            if (!result.meshlets.empty())
+            {
+                const auto& previous = result.meshlets.back();
+                triangle = FindTriangle(std::span(result.vertices).subspan(previous.vertexOffset, previous.vertexCount), 0);
+            }
+            if (triangle == NoTriangle)
+            {
+                while (m_Used[nextUnused])
+                {
+                    nextUnused++;
+                }
+                triangle = nextUnused;
+            }
+        }
+
+        AddTriangle(triangle, meshlet, result);
+        lastTriangle = triangle;
+        if (meshlet.triangleCount == m_MaxTriangles)
+        {
+            FinishMeshlet(meshlet, result);
+        }
+    }
+    if (meshlet.triangleCount > 0)
+    {
+        FinishMeshlet(meshlet, result);
+    }
+
+    // shaders read the triangles as uints
+    result.triangles.resize((result.triangles.size() + 3) & ~size_t(3), 0);
+    m_Vertices = {};
+    m_Indices = {};
+    return result;
+}
+
+uint32_t MeshletBuilder::FindTriangle(std::span<const uint32_t> vertices, uint32_t meshletVertexCount) const
+{
+    uint32_t best = NoTriangle;
+    uint32_t bestNewVertices = 0;
+    float bestScore = 0;
+    for (uint32_t v : vertices)
+    {
+        if (m_LiveTriangles[v] == 0)
+        {
+            continue;
+        }
+        for (uint32_t i = m_AdjacencyOffsets[v]; i < m_AdjacencyOffsets[v + 1]; i++)
+        {
+            uint32_t triangle = m_Adjacency[i];
+            if (m_Used[triangle])
+            {
+                continue;
+            }
+            const uint32_t* corners = &m_Indices[triangle * 3];
+            uint32_t newVertices = 0;
+            uint32_t live = 0;
+            glm::vec3 center(0.0f);
+            for (int corner = 0; corner < 3; corner++)
+            {
+                newVertices += m_LocalIndex[corners[corner]] == NotInMeshlet;
+                live += m_LiveTriangles[corners[corner]];
+                center += m_Vertices[corners[corner]].position;
+            }
+            if (meshletVertexCount + newVertices > m_MaxVertices)
+            {
+                continue;
+            }
+            // Ties go to triangles close to the middle of the meshlet, so it grows round rather than long, and
+            // to triangles whose vertices have few unused triangles left, so it doesn't leave small islands behind.
+            // New meshlets start from the triangle with the fewest unused neighbours, usually in a corner left by the last one
+            float score = meshletVertexCount == 0 ? float(live) : glm::dot(center / 3.0f - m_Center, center / 3.0f - m_Center) * float(live * live);
+            if (best == NoTriangle || std::tie(newVertices, score) < std::tie(bestNewVertices, bestScore))
+            {
+                best = triangle;
+                bestNewVertices = newVertices;
+                bestScore = score;
+            }
+        }
+    }
+    return best;
+}
+
+void MeshletBuilder::AddTriangle(uint32_t triangle, Meshlet& meshlet, MeshletMesh& result)
+{
+    if (meshlet.vertexCount == 0)
+    {
+        m_PositionSum = glm::vec3(0.0f);
+    }
+    for (int corner = 0; corner < 3; corner++)
+    {
+        uint32_t v = m_Indices[triangle * 3 + corner];
+        if (m_LocalIndex[v] == NotInMeshlet)
+        {
+            m_LocalIndex[v] = static_cast<uint8_t>(meshlet.vertexCount++);
+            result.vertices.push_back(v);
+            m_PositionSum += m_Vertices[v].position;
+        }
+        result.triangles.push_back(m_LocalIndex[v]);
+        m_LiveTriangles[v]--;
+    }
+    m_Used[triangle] = 1;
+    meshlet.triangleCount++;
+    m_Center = m_PositionSum / float(meshlet.vertexCount);
+}
+
+void MeshletBuilder::FinishMeshlet(Meshlet& meshlet, MeshletMesh& result)
+{
+    const auto& vertices = m_Vertices;
+    auto meshletVertices = std::span(result.vertices).subspan(meshlet.vertexOffset, meshlet.vertexCount);
+    auto meshletTriangles = std::span(result.triangles).subspan(size_t(meshlet.triangleOffset) * 3, size_t(meshlet.triangleCount) * 3);
+
+    // a sphere around the box around the vertices, which is close enough for culling
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+    for (uint32_t v : meshletVertices)
+    {
+        lo = glm::min(lo, vertices[v].position);
+        hi = glm::max(hi, vertices[v].position);
+    }
+    MeshletBounds bounds{
+        .center = (lo + hi) * 0.5f,
+        .radius = 0.0f,
+        .coneApex = glm::vec3(0.0f),
+        .coneCutoff = 2.0f,
+        .coneAxis = glm::vec3(0.0f),
+        .padding = 0.0f
+    };
+    for (uint32_t v : meshletVertices)
+    {
+        bounds.radius = std::max(bounds.radius, glm::length(vertices[v].position - bounds.center));
+    }
+
+    // the cone's axis is the average face normal, and it's as wide as the normal furthest from that
+    m_Normals.resize(meshlet.triangleCount);
+    glm::vec3 normalSum(0.0f);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+    {
+        const auto& p0 = vertices[meshletVertices[meshletTriangles[t * 3]]].position;
+        const auto& p1 = vertices[meshletVertices[meshletTriangles[t * 3 + 1]]].position;
+        const auto& p2 = vertices[meshletVertices[meshletTriangles[t * 3 + 2]]].position;
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        // degenerate triangles never show, so they don't have to be culled
+        m_Normals[t] = length > 0 ? normal / length : glm::vec3(0.0f);
+        normalSum += m_Normals[t];
+    }
+    float sumLength = glm::length(normalSum);
+    if (sumLength > 0)
+    {
+        auto axis = normalSum / sumLength;
+        float minDot = 1.0f;
+        for (const auto& normal : m_Normals)
+        {
+            if (normal != glm::vec3(0.0f))
+            {
+                minDot = std::min(minDot, glm::dot(normal, axis));
+            }
+        }
+        // past 90 degrees some triangle always faces the camera
+        if (minDot > 0)
+        {
+            // the apex goes behind the plane of every triangle along the axis, so any camera
+            // inside the cone of directions around it sees the back of all of them
+            float apexDistance = 0;
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                if (m_Normals[t] != glm::vec3(0.0f))
+                {
+                    const auto& p0 = vertices[meshletVertices[meshletTriangles[t * 3]]].position;
+                    apexDistance = std::max(apexDistance, glm::dot(bounds.center - p0, m_Normals[t]) / glm::dot(m_Normals[t], axis));
+                }
+            }
+            bounds.coneAxis = axis;
+            bounds.coneApex = bounds.center - axis * apexDistance;
+            bounds.coneCutoff = std::sqrt(1 - minDot * minDot);
+        }
+    }
+
+    result.meshlets.push_back(meshlet);
+    result.bounds.push_back(bounds);
+    for (uint32_t v : meshletVertices)
+    {
+        m_LocalIndex[v] = NotInMeshlet;
+    }
+    meshlet = Meshlet{
+        .vertexOffset = static_cast<uint32_t>(result.vertices.size()),
+        .triangleOffset = static_cast<uint32_t>(result.triangles.size() / 3),
+        .vertexCount = 0,
+        .triangleCount = 0
+    };
+}
+
+namespace {
+    // what a correct build has to satisfy, with a message for the first thing that doesn't
+    std::string Validate(const Mesh& mesh, const MeshletMesh& result, const MeshletBuilder::Settings& settings)
+    {
+        // every triangle exactly once with its winding, compared as sorted lists of triangles rotated to start at their smallest index
+        auto canonical = [](uint32_t a, uint32_t b, uint32_t c) {
+            if (b < a && b < c)
+            {
+                return std::array<uint32_t, 3>{ b, c, a };
+            }
+            if (c < a && c < b)
+            {
+                return std::array<uint32_t, 3>{ c, a, b };
+            }
+            return std::array<uint32_t, 3>{ a, b, c };
+        };
+        std::vector<std::array<uint32_t, 3>> expected, built;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            expected.push_back(canonical(mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]));
+        }
+        for (size_t m = 0; m < result.meshlets.size(); m++)
+        {
+            const auto& meshlet = result.meshlets[m];
+            if (meshlet.vertexCount > settings.maxVertices || meshlet.triangleCount > settings.maxTriangles)
+            {
+                return std::format("meshlet {} has {} vertices and {} triangles", m, meshlet.vertexCount, meshlet.triangleCount);
+            }
+            const auto& bounds = result.bounds[m];
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                uint32_t corners[3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    uint8_t local = result.triangles[(size_t(meshlet.triangleOffset) + t) * 3 + corner];
+                    if (local >= meshlet.vertexCount)
+                    {
+                        return std::format("meshlet {} indexes vertex {} of {}", m, local, meshlet.vertexCount);
+                    }
+                    corners[corner] = result.vertices[meshlet.vertexOffset + local];
+                    if (glm::length(mesh.vertices[corners[corner]].position - bounds.center) > bounds.radius * 1.0001f + 1e-6f)
+                    {
+                        return std::format("meshlet {} has a vertex outside its bounding sphere", m);
+                    }
+                }
+                built.push_back(canonical(corners[0], corners[1], corners[2]));
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(built.begin(), built.end());
+        if (expected != built)
+        {
+            return std::format("the meshlets have {} triangles that don't match the mesh's {}", built.size(), expected.size());
+        }
+
+        // from cameras all around, every triangle of a cone culled meshlet has to face away
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for (int camera = 0; camera < 64; camera++)
+        {
+            glm::vec3 position(unit(rng), unit(rng), unit(rng));
+            position = glm::normalize(position) * (1.5f + 3.0f * std::abs(unit(rng)));
+            for (size_t m = 0; m < result.meshlets.size(); m++)
+            {
+                const auto& bounds = result.bounds[m];
+                if (glm::dot(glm::normalize(bounds.coneApex - position), bounds.coneAxis) < bounds.coneCutoff)
+                {
+                    continue;
+                }
+                const auto& meshlet = result.meshlets[m];
+                for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                {
+                    const uint8_t* local = &result.triangles[(size_t(meshlet.triangleOffset) + t) * 3];
+                    const auto& p0 = mesh.vertices[result.vertices[meshlet.vertexOffset + local[0]]].position;
+                    const auto& p1 = mesh.vertices[result.vertices[meshlet.vertexOffset + local[1]]].position;
+                    const auto& p2 = mesh.vertices[result.vertices[meshlet.vertexOffset + local[2]]].position;
+                    if (glm::dot(glm::cross(p1 - p0, p2 - p0), p0 - position) < -1e-6f)
+                    {
+                        return std::format("meshlet {} was cone culled with a triangle facing the camera", m);
+                    }
+                }
+            }
+        }
+        return {};
+    }
+}
+
+int RunMeshletBenchmark()
+{
+    uint32_t threadCount = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+    uint32_t triangles = CommandLine::GetValue("triangles", 1000000u);
+    uint32_t builds = std::max(CommandLine::GetValue("frames", 5u), 1u);
+
+    auto mesh = MakeSphereMesh(static_cast<uint32_t>(std::sqrt(triangles / 4.0)));
+    double meshTriangles = mesh.indices.size() / 3.0;
+    MeshletBuilder::Settings settings;
+    std::cout << std::format("{} triangles, {} vertices, up to {} vertices and {} triangles per meshlet, {} builds",
+        mesh.indices.size() / 3, mesh.vertices.size(), settings.maxVertices, settings.maxTriangles, builds) << std::endl;
+
+    // one thread on its own, reusing its builder like a tool processing many meshes would
+    MeshletBuilder builder(settings);
+    MeshletMesh result;
+    double bestMs = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < builds; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result = builder.Build(mesh.vertices, mesh.indices);
+        bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    auto error = Validate(mesh, result, settings);
+    if (!error.empty())
+    {
+        std::cout << "Meshlets are wrong: " << error << std::endl;
+        return 1;
+    }
+
+    double vertexFill = 0, triangleFill = 0;
+    for (const auto& meshlet : result.meshlets)
+    {
+        vertexFill += meshlet.vertexCount;
+        triangleFill += meshlet.triangleCount;
+    }
+    vertexFill /= result.meshlets.size();
+    triangleFill /= result.meshlets.size();
+    // vertices on the edge of a meshlet are in more than one, and get transformed once per meshlet
+    std::cout << std::format("{} meshlets, {:.1f} vertices and {:.1f} triangles on average, each vertex transformed {:.2f} times",
+        result.meshlets.size(), vertexFill, triangleFill, double(result.vertices.size()) / mesh.vertices.size()) << std::endl;
+    std::cout << std::format("{:<10} {:>8} {:>12} {:>12}", "build", "threads", "ms", "Mtri/s") << std::endl;
+    std::cout << std::format("{:<10} {:>8} {:>12.2f} {:>12.2f}", "one mesh", 1, bestMs, meshTriangles / bestMs / 1000) << std::endl;
+
+    // a mesh per thread at once, each with its own builder
+    if (threadCount > 1)
+    {
+        WorkerPool workers(threadCount);
+        std::vector<MeshletBuilder> builders(threadCount, MeshletBuilder(settings));
+        double bestParallelMs = std::numeric_limits<double>::max();
+        for (uint32_t i = 0; i < builds; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            workers.ParallelFor(threadCount, [&](uint32_t job) {
+                builders[job].Build(mesh.vertices, mesh.indices);
+            });
+            bestParallelMs = std::min(bestParallelMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::cout << std::format("{:<10} {:>8} {:>12.2f} {:>12.2f}", "per thread", threadCount, bestParallelMs,
+            meshTriangles * threadCount / bestParallelMs / 1000) << std::endl;
+    }
+
+    // what the cones save: from outside the sphere about half of it faces away
+    glm::vec3 camera(0.0f, 0.0f, 3.0f);
+    size_t culled = 0;
+    for (const auto& bounds : result.bounds)
+    {
+        culled += glm::dot(glm::normalize(bounds.coneApex - camera), bounds.coneAxis) >= bounds.coneCutoff;
+    }
+    std::cout << std::format("Cone culling from 3 radii away: {} of {} meshlets ({:.1f}%)", culled, result.meshlets.size(),
+        100.0 * culled / result.meshlets.size()) << std::endl;
+    return 0;
+}
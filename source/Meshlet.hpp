@@ -0,0 +1,89 @@
+/**
+ * Splits meshes into meshlets: clusters of at most 64 vertices and 124 triangles, small enough for one mesh
+ * shader workgroup, each with bounds so whole clusters can be culled before any of their triangles are touched.
+ * Meshlets grow greedily from a seed triangle, always adding the neighbouring triangle that brings in the fewest
+ * new vertices, so they come out compact and reuse their vertices several times. A new meshlet is seeded next to
+ * the last one where possible, which keeps neighbouring meshlets close in memory too.
+ * The bounding cone is for backface culling: every triangle in the meshlet faces away from the camera if
+ *     dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+ * A builder keeps its scratch memory between builds, so keep one per thread when building many meshes.
+ */
+
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <cstdint>      // For uint8_t, uint32_t
+#include <span>         // For std::span
+#include <vector>       // For std::vector
+
+#include <glm/glm.hpp>
+
+struct Meshlet
+{
+    uint32_t vertexOffset;      // into MeshletMesh::vertices
+    uint32_t triangleOffset;    // into MeshletMesh::triangles, counted in triangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+struct MeshletBounds
+{
+    glm::vec3 center;           // bounding sphere
+    float radius;
+    glm::vec3 coneApex;
+    float coneCutoff;           // more than 1 if the triangles face too many ways to ever cull the meshlet
+    glm::vec3 coneAxis;
+    float padding;
+};
+
+struct MeshletMesh
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;      // one per meshlet
+    std::vector<uint32_t> vertices;         // the mesh vertex behind each meshlet vertex
+    std::vector<uint8_t> triangles;         // three meshlet vertex indices per triangle, padded to a multiple of 4 bytes
+};
+
+class MeshletBuilder
+{
+public:
+    struct Settings
+    {
+        uint32_t maxVertices = 64;      // at most 255, the triangles index them with bytes
+        uint32_t maxTriangles = 124;    // 124 * 3 bytes of indices is a whole number of uints
+    };
+
+    MeshletBuilder();
+    explicit MeshletBuilder(const Settings& settings);
+    virtual ~MeshletBuilder() {}
+
+    MeshletMesh Build(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices);
+
+private:
+    // the unused triangle next to any of these vertices that fits in the current meshlet and adds the fewest new
+    // vertices, or ~0u if there isn't one
+    uint32_t FindTriangle(std::span<const uint32_t> vertices, uint32_t meshletVertexCount) const;
+    void AddTriangle(uint32_t triangle, Meshlet& meshlet, MeshletMesh& result);
+    void FinishMeshlet(Meshlet& meshlet, MeshletMesh& result);
+
+    // the mesh being built
+    std::span<const MeshVertex> m_Vertices;
+    std::span<const uint32_t>   m_Indices;
+
+    uint32_t                m_MaxVertices;
+    uint32_t                m_MaxTriangles;
+    std::vector<uint32_t>   m_AdjacencyOffsets;     // where each vertex's triangles start in m_Adjacency
+    std::vector<uint32_t>   m_Adjacency;            // the triangles using each vertex
+    std::vector<uint32_t>   m_LiveTriangles;        // per vertex, triangles using it that aren't in a meshlet yet
+    std::vector<uint8_t>    m_Used;                 // per triangle
+    std::vector<uint8_t>    m_LocalIndex;           // per vertex, its index in the current meshlet or 0xff
+    std::vector<glm::vec3>  m_Normals;              // per triangle of the meshlet being finished
+    glm::vec3               m_PositionSum{ 0.0f };  // of the current meshlet's vertices
+    glm::vec3               m_Center{ 0.0f };       // their average, or the last meshlet's while starting a new one
+};
+
+// CPU-only benchmark building meshlets for a sphere of about a million triangles, on one thread and on every
+// thread at once, checking the meshlets cover the mesh exactly and their bounds are conservative.
+// Run with --bench-meshlets; --triangles=N, --frames=N (builds) and --bench-threads=N change the workload.
+int RunMeshletBenchmark();
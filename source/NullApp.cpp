@@ -0,0 +1,127 @@
+#include "App.hpp"
+#include "NullRHI.hpp"
+#include "FrameArena.hpp"
+
+#include <cstddef>
+#include <format>
+#include <iostream>
+#include <memory>
+
+// the same triangle the other backends draw
+struct NullVertex {
+    float pos[2];
+    float color[3];
+};
+static constexpr NullVertex vertices[] = {
+    {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+    {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+    {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+};
+
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+static std::unique_ptr<NullDevice> device;
+static RHIBuffer vertexBuffer;
+static RHITexture backbuffer;
+static RHIPipeline pipeline;
+static uint64_t frameFenceValues[MAX_FRAMES_IN_FLIGHT];
+static uint32_t currentFrame = 0;
+static std::unique_ptr<FrameArenas> frameArenas;
+
+// what the scene hands the renderer for every draw, rebuilt each frame in the frame's arena
+struct DrawPacket {
+    RHIPipeline pipeline;
+    RHIBuffer vertexBuffer;
+    uint32_t vertexCount;
+};
+
+void NullApp::inithook() {
+    // with no window to close, stop after a fixed number of frames
+    if (frameLimit == 0) {
+        frameLimit = 1000;
+    }
+
+    device = std::make_unique<NullDevice>(NullDevice::Settings{
+        .breakOnError = CommandLine::HasFlag("null-break-on-error")
+    });
+    frameArenas = std::make_unique<FrameArenas>(MAX_FRAMES_IN_FLIGHT);
+
+    vertexBuffer = device->CreateBuffer({
+        .size = sizeof(vertices),
+        .usage = RHIBufferUsage::Vertex,
+        .hostVisible = true
+    });
+    device->WriteBuffer(vertexBuffer, 0, std::as_bytes(std::span(vertices)));
+
+    backbuffer = device->CreateTexture({
+        .width = WIDTH,
+        .height = HEIGHT,
+        .format = RHIFormat::BGRA8Unorm,
+        .usage = RHITextureUsage::RenderTarget
+    });
+
+    RHIVertexAttribute attributes[] = {
+        { .offset = offsetof(NullVertex, pos), .format = RHIVertexFormat::Float2 },
+        { .offset = offsetof(NullVertex, color), .format = RHIVertexFormat::Float3 }
+    };
+    pipeline = device->CreatePipeline({
+        .vertexShader = "vk.vert",
+        .fragmentShader = "vk.frag",
+        .vertexStride = sizeof(NullVertex),
+        .vertexAttributes = attributes,
+        .colorFormat = RHIFormat::BGRA8Unorm
+    });
+}
+
+void NullApp::tickhook() {
+    // wait for the last frame that used this slot
+    device->WaitForFenceValue(frameFenceValues[currentFrame]);
+    frameArenas->BeginFrame(currentFrame);
+    beginSubmitTiming();
+
+    std::pmr::vector<DrawPacket> packets(frameArenas->GetResource());
+    for (uint32_t i = 0; i < drawsPerFrame; i++) {
+        packets.push_back({ pipeline, vertexBuffer, static_cast<uint32_t>(std::size(vertices)) });
+    }
+
+    auto commandList = device->GetCommandList();
+    commandList->Barrier(backbuffer, ResourceState::ColorAttachment);
+    commandList->BeginRenderPass({ .colorTarget = backbuffer });
+    commandList->SetViewport(WIDTH, HEIGHT);
+    RHIPipeline boundPipeline;
+    RHIBuffer boundVertexBuffer;
+    for (const auto& packet : packets) {
+        if (packet.pipeline != boundPipeline) {
+            commandList->SetPipeline(packet.pipeline);
+            boundPipeline = packet.pipeline;
+        }
+        if (packet.vertexBuffer != boundVertexBuffer) {
+            commandList->SetVertexBuffer(packet.vertexBuffer);
+            boundVertexBuffer = packet.vertexBuffer;
+        }
+        commandList->Draw(packet.vertexCount);
+    }
+    commandList->EndRenderPass();
+    commandList->Barrier(backbuffer, ResourceState::Present);
+    frameFenceValues[currentFrame] = device->ExecuteCommandList(commandList);
+    endSubmitTiming();
+
+    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void NullApp::cleanuphook() {
+    device->Flush();
+
+    auto& stats = device->GetStats();
+    std::cout << std::format("Null RHI: {} command lists, {} commands, {} draws, {} render passes, {} barriers, {} validation errors",
+        stats.commandListsExecuted, stats.commands, stats.draws, stats.renderPasses, stats.barriers, stats.validationErrors) << std::endl;
+    auto arenaStats = frameArenas->GetStats();
+    std::cout << std::format("Frame arenas: {} allocations over {} frames, {} KiB peak per frame, {} heap blocks, last grew in frame {}",
+        arenaStats.allocations, arenaStats.frames, arenaStats.peakFrameBytes / 1024, arenaStats.blockAllocations, arenaStats.lastGrowthFrame) << std::endl;
+    frameArenas.reset();
+
+    device->DestroyPipeline(pipeline);
+    device->DestroyTexture(backbuffer);
+    device->DestroyBuffer(vertexBuffer);
+    device.reset();
+}
@@ -0,0 +1,448 @@
+#include "NullRHI.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+namespace {
+    // past this many, errors are only counted
+    constexpr uint64_t MaxPrintedErrors = 10;
+}
+
+void NullCommandList::Reset()
+{
+    m_Commands.clear();     // keeps its capacity, so recycled lists stop allocating
+    m_CommandCount = 0;
+    m_DrawCount = 0;
+    m_DispatchCount = 0;
+    m_InRenderPass = false;
+    m_RenderPass = {};
+    m_Pipeline = {};
+    m_VertexBuffer = {};
+    m_VertexBufferOffset = 0;
+    m_IndexBuffer = {};
+    m_IndexBufferOffset = 0;
+}
+
+void NullCommandList::Barrier(RHITexture texture, ResourceState state)
+{
+    m_CommandCount++;
+    if (m_InRenderPass)
+    {
+        m_Device.ValidationError("Barrier inside a render pass");
+    }
+    if (m_Device.FindTexture(texture))
+    {
+        m_Commands.push_back(BarrierCommand{ texture, state });
+    }
+}
+
+void NullCommandList::BeginRenderPass(const RHIRenderPassDesc& desc)
+{
+    m_CommandCount++;
+    if (m_InRenderPass)
+    {
+        m_Device.ValidationError("BeginRenderPass inside another render pass");
+    }
+    m_InRenderPass = true;
+    m_RenderPass = desc;
+
+    auto color = m_Device.FindTexture(desc.colorTarget);
+    if (color && !HasFlag(color->desc.usage, RHITextureUsage::RenderTarget))
+    {
+        m_Device.ValidationError("Color target was not created with RenderTarget usage");
+    }
+    if (desc.depthTarget.IsValid())
+    {
+        auto depth = m_Device.FindTexture(desc.depthTarget);
+        if (depth && !HasFlag(depth->desc.usage, RHITextureUsage::DepthStencil))
+        {
+            m_Device.ValidationError("Depth target was not created with DepthStencil usage");
+        }
+        if (color && depth && (color->desc.width != depth->desc.width || color->desc.height != depth->desc.height))
+        {
+            m_Device.ValidationError("Color and depth targets are different sizes");
+        }
+    }
+    m_Commands.push_back(BeginRenderPassCommand{ desc });
+}
+
+void NullCommandList::EndRenderPass()
+{
+    m_CommandCount++;
+    if (!m_InRenderPass)
+    {
+        m_Device.ValidationError("EndRenderPass without a render pass");
+    }
+    m_InRenderPass = false;
+}
+
+void NullCommandList::SetPipeline(RHIPipeline pipeline)
+{
+    m_CommandCount++;
+    if (m_Device.FindPipeline(pipeline))
+    {
+        m_Pipeline = pipeline;
+    }
+}
+
+void NullCommandList::SetViewport(uint32_t width, uint32_t height)
+{
+    m_CommandCount++;
+    if (width == 0 || height == 0)
+    {
+        m_Device.ValidationError("Empty viewport");
+    }
+}
+
+void NullCommandList::SetVertexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    m_CommandCount++;
+    auto data = m_Device.FindBuffer(buffer);
+    if (!data)
+    {
+        return;
+    }
+    if (!HasFlag(data->desc.usage, RHIBufferUsage::Vertex))
+    {
+        m_Device.ValidationError("Vertex buffer was not created with Vertex usage");
+    }
+    if (offset >= data->desc.size)
+    {
+        m_Device.ValidationError("Vertex buffer offset is past the end of the buffer");
+    }
+    m_VertexBuffer = buffer;
+    m_VertexBufferOffset = offset;
+}
+
+void NullCommandList::SetIndexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    m_CommandCount++;
+    auto data = m_Device.FindBuffer(buffer);
+    if (!data)
+    {
+        return;
+    }
+    if (!HasFlag(data->desc.usage, RHIBufferUsage::Index))
+    {
+        m_Device.ValidationError("Index buffer was not created with Index usage");
+    }
+    if (offset >= data->desc.size)
+    {
+        m_Device.ValidationError("Index buffer offset is past the end of the buffer");
+    }
+    m_IndexBuffer = buffer;
+    m_IndexBufferOffset = offset;
+}
+
+void NullCommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex)
+{
+    m_CommandCount++;
+    m_DrawCount++;
+    if (!m_InRenderPass)
+    {
+        m_Device.ValidationError("Draw outside a render pass");
+    }
+    auto pipeline = m_Pipeline.IsValid() ? m_Device.FindPipeline(m_Pipeline) : nullptr;
+    if (!pipeline || pipeline->compute)
+    {
+        m_Device.ValidationError("Draw without a graphics pipeline");
+        return;
+    }
+    if (auto color = m_Device.FindTexture(m_RenderPass.colorTarget); color && color->desc.format != pipeline->colorFormat)
+    {
+        m_Device.ValidationError("Pipeline color format doesn't match the render target");
+    }
+    if (pipeline->vertexStride > 0)
+    {
+        auto vertexBuffer = m_VertexBuffer.IsValid() ? m_Device.FindBuffer(m_VertexBuffer) : nullptr;
+        if (!vertexBuffer)
+        {
+            m_Device.ValidationError("Draw without a vertex buffer");
+        }
+        else if (m_VertexBufferOffset + uint64_t(firstVertex + vertexCount) * pipeline->vertexStride > vertexBuffer->desc.size)
+        {
+            m_Device.ValidationError("Draw reads past the end of the vertex buffer");
+        }
+    }
+    if (instanceCount == 0)
+    {
+        m_Device.ValidationError("Draw with no instances");
+    }
+}
+
+void NullCommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex)
+{
+    auto indexBuffer = m_IndexBuffer.IsValid() ? m_Device.FindBuffer(m_IndexBuffer) : nullptr;
+    if (!indexBuffer)
+    {
+        m_Device.ValidationError("DrawIndexed without an index buffer");
+    }
+    else if (m_IndexBufferOffset + uint64_t(firstIndex + indexCount) * sizeof(uint32_t) > indexBuffer->desc.size)
+    {
+        m_Device.ValidationError("DrawIndexed reads past the end of the index buffer");
+    }
+    // which vertices the indices refer to isn't known without reading them, so only check there's a vertex buffer
+    Draw(0, instanceCount, 0);
+}
+
+void NullCommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    m_CommandCount++;
+    m_DispatchCount++;
+    if (m_InRenderPass)
+    {
+        m_Device.ValidationError("Dispatch inside a render pass");
+    }
+    auto pipeline = m_Pipeline.IsValid() ? m_Device.FindPipeline(m_Pipeline) : nullptr;
+    if (!pipeline || !pipeline->compute)
+    {
+        m_Device.ValidationError("Dispatch without a compute pipeline");
+    }
+    if (x == 0 || y == 0 || z == 0)
+    {
+        m_Device.ValidationError("Empty dispatch");
+    }
+}
+
+void NullCommandList::CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size)
+{
+    m_CommandCount++;
+    if (m_InRenderPass)
+    {
+        m_Device.ValidationError("CopyBuffer inside a render pass");
+    }
+    auto src = m_Device.FindBuffer(source);
+    auto dst = m_Device.FindBuffer(destination);
+    if (src && (!HasFlag(src->desc.usage, RHIBufferUsage::CopySrc) || size > src->desc.size))
+    {
+        m_Device.ValidationError("CopyBuffer source is missing CopySrc usage or is too small");
+    }
+    if (dst && (!HasFlag(dst->desc.usage, RHIBufferUsage::CopyDst) || size > dst->desc.size))
+    {
+        m_Device.ValidationError("CopyBuffer destination is missing CopyDst usage or is too small");
+    }
+}
+
+NullDevice::NullDevice(const Settings& settings)
+    : m_Settings(settings)
+{
+}
+
+NullDevice::~NullDevice()
+{
+    if (GetLiveResourceCount() > 0)
+    {
+        std::cout << std::format("Null device destroyed with {} resources still alive", GetLiveResourceCount()) << std::endl;
+    }
+}
+
+void NullDevice::ValidationError(const char* message)
+{
+    m_Stats.validationErrors++;
+    if (m_Stats.validationErrors <= MaxPrintedErrors)
+    {
+        std::cout << "Null RHI validation: " << message << std::endl;
+    }
+    assert(!m_Settings.breakOnError && "Null RHI validation error");
+}
+
+template<typename Handle, typename Data>
+Data* NullDevice::Find(RHIHandlePool<Handle, Data>& pool, Handle handle, const char* what)
+{
+    if (!handle.IsValid())
+    {
+        ValidationError(std::format("Invalid {} handle", what).c_str());
+        return nullptr;
+    }
+    auto data = pool.Find(handle);
+    if (!data)
+    {
+        ValidationError(std::format("Use of a destroyed {}", what).c_str());
+    }
+    return data;
+}
+
+template<typename Handle, typename Data>
+void NullDevice::Release(RHIHandlePool<Handle, Data>& pool, Handle handle, const char* what)
+{
+    // destroying doesn't wait for the GPU, like the real APIs. Callers defer it with fences
+    if (Find(pool, handle, what))
+    {
+        pool.Release(handle);
+    }
+}
+
+size_t NullDevice::GetLiveResourceCount() const
+{
+    return m_Buffers.GetLiveCount() + m_Textures.GetLiveCount() + m_Pipelines.GetLiveCount();
+}
+
+RHIBuffer NullDevice::CreateBuffer(const RHIBufferDesc& desc)
+{
+    if (desc.size == 0)
+    {
+        ValidationError("Empty buffer");
+    }
+    BufferData data{ .desc = desc };
+    if (desc.hostVisible)
+    {
+        data.contents.resize(desc.size);
+    }
+    return m_Buffers.Allocate(std::move(data));
+}
+
+void NullDevice::DestroyBuffer(RHIBuffer buffer)
+{
+    Release(m_Buffers, buffer, "buffer");
+}
+
+void NullDevice::WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data)
+{
+    auto bufferData = FindBuffer(buffer);
+    if (!bufferData)
+    {
+        return;
+    }
+    if (!bufferData->desc.hostVisible)
+    {
+        ValidationError("WriteBuffer to a buffer that isn't host visible");
+        return;
+    }
+    if (offset + data.size() > bufferData->desc.size)
+    {
+        ValidationError("WriteBuffer past the end of the buffer");
+        return;
+    }
+    std::memcpy(bufferData->contents.data() + offset, data.data(), data.size());
+    m_Stats.bytesWritten += data.size();
+}
+
+RHITexture NullDevice::CreateTexture(const RHITextureDesc& desc)
+{
+    if (desc.width == 0 || desc.height == 0 || desc.format == RHIFormat::Undefined)
+    {
+        ValidationError("Texture needs a size and a format");
+    }
+    if (HasFlag(desc.usage, RHITextureUsage::DepthStencil) != (desc.format == RHIFormat::D32Float))
+    {
+        ValidationError("DepthStencil usage needs a depth format, and depth formats need DepthStencil usage");
+    }
+    return m_Textures.Allocate(TextureData{ .desc = desc });
+}
+
+void NullDevice::DestroyTexture(RHITexture texture)
+{
+    Release(m_Textures, texture, "texture");
+}
+
+RHIPipeline NullDevice::CreatePipeline(const RHIPipelineDesc& desc)
+{
+    bool compute = !desc.computeShader.empty();
+    if (compute && (!desc.vertexShader.empty() || !desc.fragmentShader.empty()))
+    {
+        ValidationError("Pipeline has both compute and graphics shaders");
+    }
+    if (!compute && (desc.vertexShader.empty() || desc.colorFormat == RHIFormat::Undefined))
+    {
+        ValidationError("Graphics pipeline needs a vertex shader and a color format");
+    }
+    for (const auto& attribute : desc.vertexAttributes)
+    {
+        if (attribute.offset + GetVertexFormatSize(attribute.format) > desc.vertexStride)
+        {
+            ValidationError("Vertex attribute is outside the vertex stride");
+        }
+    }
+    return m_Pipelines.Allocate(PipelineData{ compute, desc.vertexStride, desc.colorFormat, desc.depthFormat });
+}
+
+void NullDevice::DestroyPipeline(RHIPipeline pipeline)
+{
+    Release(m_Pipelines, pipeline, "pipeline");
+}
+
+RHICommandList* NullDevice::GetCommandList()
+{
+    // a command list can be reused once the GPU is done with the last submission of it
+    auto recycled = m_CommandListRecycler.TryPop([this](uint64_t fenceValue) {
+        return IsFenceComplete(fenceValue);
+    });
+    if (recycled)
+    {
+        (*recycled)->Reset();
+        return *recycled;
+    }
+    m_CommandLists.push_back(std::make_unique<NullCommandList>(*this));
+    return m_CommandLists.back().get();
+}
+
+uint64_t NullDevice::ExecuteCommandList(RHICommandList* commandList)
+{
+    auto list = static_cast<NullCommandList*>(commandList);
+    if (list->m_InRenderPass)
+    {
+        ValidationError("Command list executed with a render pass still open");
+    }
+
+    // texture states are only known in submission order, so check them now
+    for (const auto& command : list->m_Commands)
+    {
+        if (auto barrier = std::get_if<NullCommandList::BarrierCommand>(&command))
+        {
+            if (auto texture = FindTexture(barrier->texture))
+            {
+                texture->state = barrier->state;
+            }
+            m_Stats.barriers++;
+        }
+        else if (auto pass = std::get_if<NullCommandList::BeginRenderPassCommand>(&command))
+        {
+            auto color = FindTexture(pass->desc.colorTarget);
+            if (color && color->state != ResourceState::ColorAttachment)
+            {
+                ValidationError("Color target is not in the ColorAttachment state");
+            }
+            if (pass->desc.depthTarget.IsValid())
+            {
+                auto depth = FindTexture(pass->desc.depthTarget);
+                if (depth && depth->state != ResourceState::DepthAttachment && depth->state != ResourceState::DepthRead)
+                {
+                    ValidationError("Depth target is not in a depth state");
+                }
+            }
+            m_Stats.renderPasses++;
+        }
+    }
+    m_Stats.commandListsExecuted++;
+    m_Stats.commands += list->m_CommandCount;
+    m_Stats.draws += list->m_DrawCount;
+    m_Stats.dispatches += list->m_DispatchCount;
+
+    // the simulated GPU finishes everything but the last few submissions
+    uint64_t fenceValue = ++m_FenceValue;
+    if (m_FenceValue > m_Settings.gpuLatency)
+    {
+        m_CompletedValue = std::max(m_CompletedValue, m_FenceValue - m_Settings.gpuLatency);
+    }
+    m_CommandListRecycler.Push(fenceValue, list);
+    return fenceValue;
+}
+
+bool NullDevice::IsFenceComplete(uint64_t fenceValue)
+{
+    return m_CompletedValue >= fenceValue;
+}
+
+void NullDevice::WaitForFenceValue(uint64_t fenceValue)
+{
+    // nothing runs in the background, waiting just lets the GPU catch up
+    m_CompletedValue = std::max(m_CompletedValue, std::min(fenceValue, m_FenceValue));
+}
+
+void NullDevice::Flush()
+{
+    WaitForFenceValue(m_FenceValue);
+}
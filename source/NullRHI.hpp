@@ -0,0 +1,180 @@
+/**
+ * RHI backend that runs entirely on the CPU, for machines without a GPU.
+ * Command lists are recorded and checked as a GPU driver's validation layer would: handles must be alive, resources
+ * must have been created with the usage they're put to, draws need a pipeline and must stay inside their buffers,
+ * render passes must not nest. Texture states depend on submission order, so they are checked when a command list
+ * is executed by replaying its barriers and passes against the device's view of each texture.
+ * The "GPU" finishes work a configurable number of submissions behind, so fence handling gets exercised too.
+ */
+
+#pragma once
+
+#include "RHI.hpp"
+#include "FenceRecycler.hpp"
+
+#include <cstdint>  // For uint32_t, uint64_t
+#include <memory>   // For std::unique_ptr
+#include <variant>  // For std::variant
+#include <vector>   // For std::vector
+
+class NullDevice;
+
+class NullCommandList : public RHICommandList
+{
+public:
+    NullCommandList(NullDevice& device) : m_Device(device) {}
+
+    void Barrier(RHITexture texture, ResourceState state) final;
+    void BeginRenderPass(const RHIRenderPassDesc& desc) final;
+    void EndRenderPass() final;
+    void SetPipeline(RHIPipeline pipeline) final;
+    void SetViewport(uint32_t width, uint32_t height) final;
+    void SetVertexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void SetIndexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex) final;
+    void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex) final;
+    void Dispatch(uint32_t x, uint32_t y, uint32_t z) final;
+    void CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size) final;
+
+private:
+    friend class NullDevice;
+
+    // only the commands that matter once recording is over are kept
+    struct BarrierCommand
+    {
+        RHITexture texture;
+        ResourceState state;
+    };
+    struct BeginRenderPassCommand
+    {
+        RHIRenderPassDesc desc;
+    };
+    using Command = std::variant<BarrierCommand, BeginRenderPassCommand>;
+
+    // Forget everything recorded, to be used again.
+    void Reset();
+
+    NullDevice&             m_Device;
+    std::vector<Command>    m_Commands;
+
+    // everything recorded, including what isn't kept
+    uint32_t                m_CommandCount = 0;
+    uint32_t                m_DrawCount = 0;
+    uint32_t                m_DispatchCount = 0;
+
+    // state while recording
+    bool                    m_InRenderPass = false;
+    RHIRenderPassDesc       m_RenderPass;
+    RHIPipeline             m_Pipeline;
+    RHIBuffer               m_VertexBuffer;
+    uint64_t                m_VertexBufferOffset = 0;
+    RHIBuffer               m_IndexBuffer;
+    uint64_t                m_IndexBufferOffset = 0;
+};
+
+class NullDevice : public RHIDevice
+{
+public:
+    struct Settings
+    {
+        uint32_t gpuLatency = 2;    // submissions the simulated GPU is behind
+        bool breakOnError = false;  // assert on the first validation error, to catch it in a debugger
+    };
+
+    struct Stats
+    {
+        uint64_t commandListsExecuted = 0;
+        uint64_t commands = 0;
+        uint64_t draws = 0;
+        uint64_t dispatches = 0;
+        uint64_t barriers = 0;
+        uint64_t renderPasses = 0;
+        uint64_t bytesWritten = 0;      // through WriteBuffer
+        uint64_t validationErrors = 0;
+    };
+
+    NullDevice(const Settings& settings);
+    virtual ~NullDevice();
+
+    const char* GetName() const final {
+        return "Null";
+    }
+
+    RHIBuffer CreateBuffer(const RHIBufferDesc& desc) final;
+    void DestroyBuffer(RHIBuffer buffer) final;
+    void WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data) final;
+
+    RHITexture CreateTexture(const RHITextureDesc& desc) final;
+    void DestroyTexture(RHITexture texture) final;
+
+    RHIPipeline CreatePipeline(const RHIPipelineDesc& desc) final;
+    void DestroyPipeline(RHIPipeline pipeline) final;
+
+    RHICommandList* GetCommandList() final;
+    uint64_t ExecuteCommandList(RHICommandList* commandList) final;
+
+    bool IsFenceComplete(uint64_t fenceValue) final;
+    void WaitForFenceValue(uint64_t fenceValue) final;
+    void Flush() final;
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+    // resources created and not yet destroyed
+    size_t GetLiveResourceCount() const;
+
+private:
+    friend class NullCommandList;
+
+    struct BufferData
+    {
+        RHIBufferDesc desc;
+        std::vector<std::byte> contents = {};   // only for host visible buffers
+    };
+
+    struct TextureData
+    {
+        RHITextureDesc desc;
+        ResourceState state = ResourceState::Undefined;
+    };
+
+    // shader names aren't kept, the caller's strings don't have to outlive the pipeline
+    struct PipelineData
+    {
+        bool compute = false;
+        uint32_t vertexStride = 0;
+        RHIFormat colorFormat = RHIFormat::Undefined;
+        RHIFormat depthFormat = RHIFormat::Undefined;
+    };
+
+    // nullptr, with a validation error, if the handle doesn't refer to a live resource
+    template<typename Handle, typename Data>
+    Data* Find(RHIHandlePool<Handle, Data>& pool, Handle handle, const char* what);
+    template<typename Handle, typename Data>
+    void Release(RHIHandlePool<Handle, Data>& pool, Handle handle, const char* what);
+
+    BufferData* FindBuffer(RHIBuffer buffer) {
+        return Find(m_Buffers, buffer, "buffer");
+    }
+    TextureData* FindTexture(RHITexture texture) {
+        return Find(m_Textures, texture, "texture");
+    }
+    PipelineData* FindPipeline(RHIPipeline pipeline) {
+        return Find(m_Pipelines, pipeline, "pipeline");
+    }
+
+    void ValidationError(const char* message);
+
+    Settings                                    m_Settings;
+    Stats                                       m_Stats;
+
+    RHIHandlePool<RHIBuffer, BufferData>        m_Buffers;
+    RHIHandlePool<RHITexture, TextureData>      m_Textures;
+    RHIHandlePool<RHIPipeline, PipelineData>    m_Pipelines;
+
+    std::vector<std::unique_ptr<NullCommandList>> m_CommandLists;    // owns every command list handed out
+    FenceRecycler<NullCommandList*>             m_CommandListRecycler;
+
+    uint64_t                                    m_FenceValue = 0;
+    uint64_t                                    m_CompletedValue = 0;
+};
@@ -0,0 +1,262 @@
+#include "Png.hpp"
+#include "Deflate.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    constexpr uint8_t ColorTypeRgb = 2;
+    constexpr uint8_t ColorTypeRgba = 6;
+
+    enum Filter : uint8_t
+    {
+        FilterNone,
+        FilterSub,
+        FilterUp,
+        FilterAverage,
+        FilterPaeth,
+        FilterCount
+    };
+
+    // CRC-32 as PNG (and zip) use it, a byte at a time from a table
+    const std::array<uint32_t, 256>& GetCrcTable()
+    {
+        static const auto table = [] {
+            std::array<uint32_t, 256> crcs;
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+                }
+                crcs[i] = crc;
+            }
+            return crcs;
+        }();
+        return table;
+    }
+
+    uint32_t Crc32(std::span<const std::byte> data)
+    {
+        const auto& table = GetCrcTable();
+        uint32_t crc = ~0u;
+        for (std::byte value : data)
+        {
+            crc = table[(crc ^ static_cast<uint8_t>(value)) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void AppendBigEndian32(std::vector<std::byte>& file, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            file.push_back(std::byte(value >> shift));
+        }
+    }
+
+    uint32_t ReadBigEndian32(std::span<const std::byte> file, size_t offset)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; i++)
+        {
+            value = (value << 8) | static_cast<uint8_t>(file[offset + i]);
+        }
+        return value;
+    }
+
+    // a chunk is its length, type, data and a CRC of the type and data
+    void AppendChunk(std::vector<std::byte>& file, const char type[4], std::span<const std::byte> data)
+    {
+        AppendBigEndian32(file, static_cast<uint32_t>(data.size()));
+        size_t start = file.size();
+        file.insert(file.end(), reinterpret_cast<const std::byte*>(type), reinterpret_cast<const std::byte*>(type) + 4);
+        file.insert(file.end(), data.begin(), data.end());
+        AppendBigEndian32(file, Crc32(std::span(file).subspan(start)));
+    }
+
+    uint8_t Paeth(uint8_t left, uint8_t up, uint8_t upLeft)
+    {
+        int estimate = int(left) + up - upLeft;
+        int toLeft = std::abs(estimate - left);
+        int toUp = std::abs(estimate - up);
+        int toUpLeft = std::abs(estimate - upLeft);
+        if (toLeft <= toUp && toLeft <= toUpLeft)
+        {
+            return left;
+        }
+        return toUp <= toUpLeft ? up : upLeft;
+    }
+
+    // what a filter predicts a byte to be from the ones to its left and above, which are 0 off the edge
+    uint8_t Predict(Filter filter, uint8_t left, uint8_t up, uint8_t upLeft)
+    {
+        switch (filter)
+        {
+        case FilterSub:
+            return left;
+        case FilterUp:
+            return up;
+        case FilterAverage:
+            return static_cast<uint8_t>((int(left) + up) / 2);
+        case FilterPaeth:
+            return Paeth(left, up, upLeft);
+        default:
+            return 0;
+        }
+    }
+}
+
+std::vector<std::byte> WritePng(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, uint32_t maxChainLength)
+{
+    size_t rowSize = size_t(width) * 4;
+    if (rgba.size() != rowSize * height)
+    {
+        throw std::runtime_error("png pixels don't match the image size!");
+    }
+
+    // each row is its filter type then the filtered bytes, trying every filter and keeping the one whose output
+    // has the smallest sum of absolute (signed) values, which tends to compress best
+    std::vector<std::byte> rows((rowSize + 1) * height);
+    std::vector<uint8_t> candidate(rowSize);
+    std::vector<uint8_t> zeroRow(rowSize, 0);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = rgba.data() + y * rowSize;
+        const uint8_t* above = y > 0 ? row - rowSize : zeroRow.data();
+        auto* out = reinterpret_cast<uint8_t*>(rows.data() + y * (rowSize + 1));
+        uint64_t bestCost = ~0ull;
+        for (uint8_t filter = FilterNone; filter < FilterCount; filter++)
+        {
+            uint64_t cost = 0;
+            for (size_t i = 0; i < rowSize; i++)
+            {
+                uint8_t left = i >= 4 ? row[i - 4] : 0;
+                uint8_t upLeft = i >= 4 ? above[i - 4] : 0;
+                candidate[i] = static_cast<uint8_t>(row[i] - Predict(static_cast<Filter>(filter), left, above[i], upLeft));
+                cost += std::abs(static_cast<int8_t>(candidate[i]));
+            }
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                out[0] = filter;
+                std::memcpy(out + 1, candidate.data(), rowSize);
+            }
+        }
+    }
+
+    std::vector<std::byte> file(reinterpret_cast<const std::byte*>(Signature), reinterpret_cast<const std::byte*>(Signature) + sizeof(Signature));
+    std::vector<std::byte> header;
+    AppendBigEndian32(header, width);
+    AppendBigEndian32(header, height);
+    for (uint8_t value : { uint8_t(8), ColorTypeRgba, uint8_t(0), uint8_t(0), uint8_t(0) })    // depth, colour type, compression, filter method, no interlacing
+    {
+        header.push_back(std::byte(value));
+    }
+    AppendChunk(file, "IHDR", header);
+    AppendChunk(file, "IDAT", ZlibCompress(rows, maxChainLength));
+    AppendChunk(file, "IEND", {});
+    return file;
+}
+
+PngImage ReadPng(std::span<const std::byte> file)
+{
+    if (file.size() < sizeof(Signature) || std::memcmp(file.data(), Signature, sizeof(Signature)) != 0)
+    {
+        throw std::runtime_error("not a png file!");
+    }
+
+    // the header comes first, the image data may be split over any number of chunks
+    PngImage image;
+    uint8_t colorType = 0;
+    std::vector<std::byte> stream;
+    bool ended = false;
+    for (size_t offset = sizeof(Signature); !ended;)
+    {
+        if (offset + 12 > file.size())
+        {
+            throw std::runtime_error("png file is truncated!");
+        }
+        uint32_t length = ReadBigEndian32(file, offset);
+        if (length > file.size() - offset - 12)
+        {
+            throw std::runtime_error("png file is truncated!");
+        }
+        auto type = file.subspan(offset + 4, 4);
+        auto data = file.subspan(offset + 8, length);
+        if (Crc32(file.subspan(offset + 4, length + 4)) != ReadBigEndian32(file, offset + 8 + length))
+        {
+            throw std::runtime_error("png chunk fails its checksum!");
+        }
+        offset += 12 + length;
+
+        if (std::memcmp(type.data(), "IHDR", 4) == 0)
+        {
+            if (length != 13)
+            {
+                throw std::runtime_error("png header is the wrong size!");
+            }
+            image.width = ReadBigEndian32(data, 0);
+            image.height = ReadBigEndian32(data, 4);
+            uint8_t depth = static_cast<uint8_t>(data[8]);
+            colorType = static_cast<uint8_t>(data[9]);
+            uint8_t interlace = static_cast<uint8_t>(data[12]);
+            if (depth != 8 || (colorType != ColorTypeRgb && colorType != ColorTypeRgba) || interlace != 0)
+            {
+                throw std::runtime_error("only 8-bit, non-interlaced RGB and RGBA png files can be read!");
+            }
+        }
+        else if (std::memcmp(type.data(), "IDAT", 4) == 0)
+        {
+            stream.insert(stream.end(), data.begin(), data.end());
+        }
+        else if (std::memcmp(type.data(), "IEND", 4) == 0)
+        {
+            ended = true;
+        }
+        // anything else is ancillary, and skipped
+    }
+    if (colorType == 0 || image.width == 0 || image.height == 0)
+    {
+        throw std::runtime_error("png file has no header!");
+    }
+
+    size_t channels = colorType == ColorTypeRgba ? 4 : 3;
+    size_t rowSize = image.width * channels;
+    std::vector<std::byte> rows((rowSize + 1) * image.height);
+    ZlibDecompress(stream, rows);
+
+    // unfilter in place, each row against the one above it, already unfiltered
+    std::vector<uint8_t> zeroRow(rowSize, 0);
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+    for (uint32_t y = 0; y < image.height; y++)
+    {
+        auto* row = reinterpret_cast<uint8_t*>(rows.data() + y * (rowSize + 1));
+        const uint8_t* above = y > 0 ? row - (rowSize + 1) + 1 : zeroRow.data();
+        uint8_t filter = row[0];
+        if (filter >= FilterCount)
+        {
+            throw std::runtime_error("png row has an unknown filter!");
+        }
+        row++;
+        for (size_t i = 0; i < rowSize; i++)
+        {
+            uint8_t left = i >= channels ? row[i - channels] : 0;
+            uint8_t upLeft = i >= channels ? above[i - channels] : 0;
+            row[i] = static_cast<uint8_t>(row[i] + Predict(static_cast<Filter>(filter), left, above[i], upLeft));
+        }
+        uint8_t* out = image.rgba.data() + size_t(y) * image.width * 4;
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            for (size_t c = 0; c < 4; c++)
+            {
+                out[x * 4 + c] = c < channels ? row[x * channels + c] : 255;
+            }
+        }
+    }
+    return image;
+}
@@ -0,0 +1,28 @@
+/**
+ * Writing and reading PNG files of 8-bit RGBA pixels, for frame captures and the golden images they are checked
+ * against. Each row is filtered with whichever of the five PNG filters leaves the smallest sum of differences, the
+ * usual heuristic, and the rows are compressed with the in-tree zlib. The reader handles the non-interlaced 8-bit
+ * RGB and RGBA files that writes like this produce, not palettes, grey, 16-bit channels or Adam7. PNG stores
+ * multi-byte fields big-endian, which is handled whatever the host is.
+ */
+
+#pragma once
+
+#include <cstddef>  // For std::byte
+#include <cstdint>  // For uint8_t, uint32_t
+#include <span>     // For std::span
+#include <vector>   // For std::vector
+
+struct PngImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;      // tightly packed rows from the top
+};
+
+// Encode tightly packed RGBA8 rows from the top. maxChainLength is passed to ZlibCompress, lower is faster.
+std::vector<std::byte> WritePng(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, uint32_t maxChainLength = 16);
+
+// Decode a file in memory to RGBA8, alpha 255 for RGB files. Throws std::runtime_error if it is corrupt or not a
+// kind of PNG this can read.
+PngImage ReadPng(std::span<const std::byte> file);
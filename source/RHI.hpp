@@ -0,0 +1,273 @@
+/**
+ * Thin rendering hardware interface, the subset of the graphics APIs the apps here use.
+ * Devices create buffers, textures and pipelines and hand out command lists, and track GPU progress with a single
+ * fence value like the D3D12 CommandQueue. Resource states are the render graph's, so a backend that implements
+ * RenderGraphBackend already knows how to translate them.
+ * Handles carry a generation, so a backend can tell a destroyed resource from the one now living in its slot.
+ * Backends: NullDevice (NullRHI.hpp) records on the CPU, VkRHIDevice (VkRHI.hpp) runs on Vulkan,
+ * D3D12RHIDevice (D3D12RHI.hpp) on D3D12 and MTLRHIDevice (MTLRHI.hpp) on Metal.
+ */
+
+#pragma once
+
+#include "RenderGraph.hpp"  // For ResourceState
+
+#include <array>        // For std::array
+#include <cstddef>      // For std::byte
+#include <cstdint>      // For uint32_t, uint64_t
+#include <span>         // For std::span
+#include <string_view>  // For std::string_view
+#include <vector>       // For std::vector
+
+template<typename Tag>
+struct RHIHandle
+{
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    bool IsValid() const {
+        return index != InvalidIndex;
+    }
+    bool operator==(const RHIHandle&) const = default;
+};
+using RHIBuffer = RHIHandle<struct RHIBufferTag>;
+using RHITexture = RHIHandle<struct RHITextureTag>;
+using RHIPipeline = RHIHandle<struct RHIPipelineTag>;
+
+// Where a backend keeps what its handles refer to: slots reused once freed, with a new generation.
+template<typename Handle, typename T>
+class RHIHandlePool
+{
+public:
+    Handle Allocate(T value)
+    {
+        uint32_t index;
+        if (!m_FreeSlots.empty())
+        {
+            index = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_Slots.size());
+            m_Slots.emplace_back();
+        }
+        auto& slot = m_Slots[index];
+        slot.value = std::move(value);
+        slot.alive = true;
+        m_Live++;
+        return { index, slot.generation };
+    }
+
+    // nullptr if the handle doesn't refer to a live slot
+    T* Find(Handle handle)
+    {
+        if (!handle.IsValid() || handle.index >= m_Slots.size())
+        {
+            return nullptr;
+        }
+        auto& slot = m_Slots[handle.index];
+        return slot.alive && slot.generation == handle.generation ? &slot.value : nullptr;
+    }
+
+    // Free a live handle's slot. Returns false if the handle wasn't live
+    bool Release(Handle handle)
+    {
+        if (!Find(handle))
+        {
+            return false;
+        }
+        auto& slot = m_Slots[handle.index];
+        slot.alive = false;
+        slot.generation++;
+        slot.value = {};
+        m_FreeSlots.push_back(handle.index);
+        m_Live--;
+        return true;
+    }
+
+    size_t GetLiveCount() const {
+        return m_Live;
+    }
+
+    // Call function on every live value, to clean up what was never destroyed
+    template<typename Function>
+    void ForEachLive(Function&& function)
+    {
+        for (auto& slot : m_Slots)
+        {
+            if (slot.alive)
+            {
+                function(slot.value);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        T value{};
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    std::vector<Slot>       m_Slots;
+    std::vector<uint32_t>   m_FreeSlots;
+    size_t                  m_Live = 0;
+};
+
+enum class RHIBufferUsage : uint32_t
+{
+    Vertex = 1 << 0,
+    Index = 1 << 1,
+    Uniform = 1 << 2,
+    Storage = 1 << 3,
+    CopySrc = 1 << 4,
+    CopyDst = 1 << 5,
+};
+
+enum class RHITextureUsage : uint32_t
+{
+    RenderTarget = 1 << 0,
+    DepthStencil = 1 << 1,
+    Sampled = 1 << 2,
+    Storage = 1 << 3,
+    CopySrc = 1 << 4,
+    CopyDst = 1 << 5,
+};
+
+constexpr RHIBufferUsage operator|(RHIBufferUsage a, RHIBufferUsage b) {
+    return static_cast<RHIBufferUsage>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+}
+constexpr RHITextureUsage operator|(RHITextureUsage a, RHITextureUsage b) {
+    return static_cast<RHITextureUsage>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+}
+template<typename Flags>
+constexpr bool HasFlag(Flags flags, Flags flag) {
+    return (static_cast<uint32_t>(flags) & static_cast<uint32_t>(flag)) != 0;
+}
+
+enum class RHIFormat : uint8_t
+{
+    Undefined,
+    RGBA8Unorm,
+    BGRA8Unorm,
+    RGBA16Float,
+    D32Float,
+};
+
+enum class RHITopology : uint8_t
+{
+    TriangleList,
+    TriangleStrip,
+    LineList,
+    PointList,
+};
+
+enum class RHIVertexFormat : uint8_t
+{
+    Float2,
+    Float3,
+    Float4,
+};
+
+constexpr uint32_t GetVertexFormatSize(RHIVertexFormat format) {
+    return (static_cast<uint32_t>(format) + 2) * sizeof(float);
+}
+
+// a vertex shader input, read from the vertex buffer at offset within each vertex
+struct RHIVertexAttribute
+{
+    uint32_t offset = 0;
+    RHIVertexFormat format = RHIVertexFormat::Float4;
+};
+
+struct RHIBufferDesc
+{
+    uint64_t size = 0;
+    RHIBufferUsage usage = RHIBufferUsage::Vertex;
+    bool hostVisible = false;       // can be written with WriteBuffer
+};
+
+struct RHITextureDesc
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    RHIFormat format = RHIFormat::Undefined;
+    RHITextureUsage usage = RHITextureUsage::Sampled;
+};
+
+// a graphics pipeline, or a compute pipeline if computeShader is set
+struct RHIPipelineDesc
+{
+    std::string_view vertexShader = {};
+    std::string_view fragmentShader = {};
+    std::string_view computeShader = {};
+    uint32_t vertexStride = 0;      // 0 if the pipeline takes no vertex buffer
+    std::span<const RHIVertexAttribute> vertexAttributes = {};  // at locations 0, 1, ... in the vertex shader
+    RHITopology topology = RHITopology::TriangleList;
+    RHIFormat colorFormat = RHIFormat::Undefined;
+    RHIFormat depthFormat = RHIFormat::Undefined;
+};
+
+struct RHIRenderPassDesc
+{
+    RHITexture colorTarget = {};
+    RHITexture depthTarget = {};    // optional
+    std::array<float, 4> clearColor = { 0, 0, 0, 1 };
+    float clearDepth = 1.0f;
+};
+
+class RHICommandList
+{
+public:
+    virtual ~RHICommandList() {}
+
+    // Move a texture to the state its next use needs.
+    virtual void Barrier(RHITexture texture, ResourceState state) = 0;
+
+    virtual void BeginRenderPass(const RHIRenderPassDesc& desc) = 0;
+    virtual void EndRenderPass() = 0;
+
+    virtual void SetPipeline(RHIPipeline pipeline) = 0;
+    virtual void SetViewport(uint32_t width, uint32_t height) = 0;
+    virtual void SetVertexBuffer(RHIBuffer buffer, uint64_t offset = 0) = 0;
+    virtual void SetIndexBuffer(RHIBuffer buffer, uint64_t offset = 0) = 0;     // 32 bit indices
+    virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0) = 0;
+    virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0) = 0;
+    virtual void Dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) = 0;
+
+    virtual void CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size) = 0;
+};
+
+class RHIDevice
+{
+public:
+    virtual ~RHIDevice() {}
+
+    virtual const char* GetName() const = 0;
+
+    virtual RHIBuffer CreateBuffer(const RHIBufferDesc& desc) = 0;
+    virtual void DestroyBuffer(RHIBuffer buffer) = 0;
+    // Copy data into a host visible buffer.
+    virtual void WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data) = 0;
+
+    virtual RHITexture CreateTexture(const RHITextureDesc& desc) = 0;
+    virtual void DestroyTexture(RHITexture texture) = 0;
+
+    virtual RHIPipeline CreatePipeline(const RHIPipelineDesc& desc) = 0;
+    virtual void DestroyPipeline(RHIPipeline pipeline) = 0;
+
+    // Get a command list ready to record into.
+    virtual RHICommandList* GetCommandList() = 0;
+
+    // Submit a command list from GetCommandList, which may not be used again afterwards.
+    // Returns the fence value to wait for for this command list.
+    virtual uint64_t ExecuteCommandList(RHICommandList* commandList) = 0;
+
+    virtual bool IsFenceComplete(uint64_t fenceValue) = 0;
+    virtual void WaitForFenceValue(uint64_t fenceValue) = 0;
+    virtual void Flush() = 0;
+};
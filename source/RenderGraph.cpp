@@ -0,0 +1,312 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+// states that write to the resource. Using one of these twice in a row still needs a barrier.
+static bool IsWriteState(ResourceState state)
+{
+    switch (state)
+    {
+    case ResourceState::ColorAttachment:
+    case ResourceState::DepthAttachment:
+    case ResourceState::Storage:
+    case ResourceState::TransferDst:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// the state that covers both uses within one pass, or Undefined if there isn't one
+static ResourceState MergeStates(ResourceState a, ResourceState b)
+{
+    if (a == b)
+    {
+        return a;
+    }
+    auto covers = [&](ResourceState wider, ResourceState narrower) {
+        return (a == wider && b == narrower) || (a == narrower && b == wider);
+    };
+    if (covers(ResourceState::Storage, ResourceState::ShaderRead))
+    {
+        return ResourceState::Storage;
+    }
+    if (covers(ResourceState::DepthAttachment, ResourceState::DepthRead))
+    {
+        return ResourceState::DepthAttachment;
+    }
+    return ResourceState::Undefined;
+}
+
+void RenderGraph::PassBuilder::Read(RGResource resource, ResourceState state)
+{
+    Use(resource, state, false);
+}
+
+void RenderGraph::PassBuilder::Write(RGResource resource, ResourceState state)
+{
+    Use(resource, state, true);
+}
+
+void RenderGraph::PassBuilder::Use(RGResource resource, ResourceState state, bool write)
+{
+    // a resource can only be in one state during a pass, so a second declaration is merged into the first
+    auto& pass = m_Graph.m_Passes[m_Pass];
+    uint32_t usage = 1u << static_cast<uint32_t>(state);
+    for (auto& access : pass.accesses)
+    {
+        if (access.resource == resource)
+        {
+            ResourceState merged = MergeStates(access.state, state);
+            if (merged == ResourceState::Undefined)
+            {
+                throw std::runtime_error(std::string("render graph pass ") + pass.name + " uses " + m_Graph.GetName(resource) + " in two states that can't be merged");
+            }
+            access.state = merged;
+            access.write = access.write || write;
+            access.usage |= usage;
+            return;
+        }
+    }
+    pass.accesses.push_back({ resource, state, write, usage });
+}
+
+void RenderGraph::PassBuilder::SideEffects()
+{
+    m_Graph.m_Passes[m_Pass].sideEffects = true;
+}
+
+void RenderGraph::Reset(std::pmr::memory_resource* scratch)
+{
+    // the passes' lists may live in the previous frame's scratch, drop them before it gets reused
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Transients.clear();
+    m_FinalBarriers.clear();
+    m_Stats = {};
+    m_Scratch = scratch;
+}
+
+RGResource RenderGraph::ImportTexture(const char* name, const TextureDesc& desc, ResourceState initialState, ResourceState finalState)
+{
+    m_Resources.push_back(Resource{
+        .name = name,
+        .desc = desc,
+        .imported = true,
+        .initialState = initialState,
+        .finalState = finalState,
+    });
+    return static_cast<RGResource>(m_Resources.size() - 1);
+}
+
+RGResource RenderGraph::CreateTexture(const char* name, const TextureDesc& desc)
+{
+    // transients start and end with undefined contents
+    m_Resources.push_back(Resource{
+        .name = name,
+        .desc = desc,
+        .imported = false,
+        .initialState = ResourceState::Undefined,
+        .finalState = ResourceState::Undefined,
+    });
+    return static_cast<RGResource>(m_Resources.size() - 1);
+}
+
+void* RenderGraph::AllocatePass(const char* name, size_t callableSize, void (*execute)(const void* callable))
+{
+    auto& pass = m_Passes.emplace_back(Pass{
+        .name = name,
+        .accesses = std::pmr::vector<Access>(m_Scratch),
+        .callable = std::pmr::vector<std::max_align_t>((callableSize + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t), m_Scratch),
+        .execute = execute,
+        .barriers = std::pmr::vector<RenderGraphBackend::Barrier>(m_Scratch),
+    });
+    return pass.callable.data();
+}
+
+void RenderGraph::Compile()
+{
+    // cull: walk backwards from the outputs (imported textures),
+    // keeping passes that produce something a later live pass needs
+    std::pmr::vector<bool> needed(m_Resources.size(), false, m_Scratch);
+    for (RGResource i = 0; i < m_Resources.size(); i++)
+    {
+        needed[i] = m_Resources[i].imported;
+    }
+    for (auto pass = m_Passes.rbegin(); pass != m_Passes.rend(); ++pass)
+    {
+        bool live = pass->sideEffects || std::any_of(pass->accesses.begin(), pass->accesses.end(), [&](const Access& access) {
+            return access.write && needed[access.resource];
+        });
+        pass->culled = !live;
+        if (live)
+        {
+            // everything it touches must be produced by earlier passes
+            for (const auto& access : pass->accesses)
+            {
+                needed[access.resource] = true;
+            }
+        }
+    }
+
+    // barriers and lifetimes, in submission order
+    std::pmr::vector<ResourceState> currentState(m_Resources.size(), m_Scratch);
+    for (RGResource i = 0; i < m_Resources.size(); i++)
+    {
+        currentState[i] = m_Resources[i].initialState;
+    }
+    for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+    {
+        auto& pass = m_Passes[passIndex];
+        pass.barriers.clear();
+        if (pass.culled)
+        {
+            m_Stats.culledPasses++;
+            continue;
+        }
+        m_Stats.passes++;
+
+        for (const auto& access : pass.accesses)
+        {
+            auto& resource = m_Resources[access.resource];
+            if (!resource.used)
+            {
+                resource.used = true;
+                resource.lifetime.firstPass = passIndex;
+            }
+            resource.lifetime.lastPass = passIndex;
+            resource.usage |= access.usage;
+
+            // reads after reads in the same state need no synchronization, anything involving a write does
+            auto before = currentState[access.resource];
+            if (before != access.state || IsWriteState(access.state))
+            {
+                // the very first write of a transient doesn't need to wait on anything in this frame,
+                // but the backend still has to order it after whatever used the same memory before
+                pass.barriers.push_back({ access.resource, before, access.state });
+                currentState[access.resource] = access.state;
+            }
+        }
+        if (!pass.barriers.empty())
+        {
+            m_Stats.barriers += static_cast<uint32_t>(pass.barriers.size());
+            m_Stats.barrierBatches++;
+        }
+    }
+
+    // hand imported textures back in the state their owner expects
+    for (RGResource i = 0; i < m_Resources.size(); i++)
+    {
+        const auto& resource = m_Resources[i];
+        if (resource.imported && resource.finalState != ResourceState::Undefined && currentState[i] != resource.finalState)
+        {
+            m_FinalBarriers.push_back({ i, currentState[i], resource.finalState });
+        }
+        else if (!resource.imported && resource.used)
+        {
+            m_Transients.push_back(i);
+        }
+    }
+    if (!m_FinalBarriers.empty())
+    {
+        m_Stats.barriers += static_cast<uint32_t>(m_FinalBarriers.size());
+        m_Stats.barrierBatches++;
+    }
+}
+
+uint64_t RenderGraph::PlaceTransients(std::span<const MemoryRequirements> requirements, std::span<uint64_t> offsets)
+{
+    assert(requirements.size() == m_Transients.size() && offsets.size() == m_Transients.size());
+
+    struct Placement
+    {
+        uint64_t offset;
+        uint64_t size;
+        Lifetime lifetime;
+    };
+    std::pmr::vector<Placement> placed(m_Scratch);
+    placed.reserve(m_Transients.size());
+
+    // place the biggest first, it leaves fewer gaps
+    std::pmr::vector<size_t> order(m_Transients.size(), m_Scratch);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    uint64_t heapSize = 0;
+    m_Stats.transientBytes = 0;
+    for (size_t index : order)
+    {
+        const auto& req = requirements[index];
+        auto lifetime = m_Resources[m_Transients[index]].lifetime;
+        m_Stats.transientBytes += req.size;
+
+        // only textures alive at the same time as this one block memory
+        std::pmr::vector<const Placement*> overlapping(m_Scratch);
+        for (const auto& other : placed)
+        {
+            if (other.lifetime.firstPass <= lifetime.lastPass && lifetime.firstPass <= other.lifetime.lastPass)
+            {
+                overlapping.push_back(&other);
+            }
+        }
+        std::sort(overlapping.begin(), overlapping.end(), [](const Placement* a, const Placement* b) {
+            return a->offset < b->offset;
+        });
+
+        // first gap that fits
+        auto align = [&](uint64_t value) {
+            return (value + req.alignment - 1) / req.alignment * req.alignment;
+        };
+        uint64_t offset = 0;
+        for (const auto* other : overlapping)
+        {
+            if (align(offset) + req.size <= other->offset)
+            {
+                break;
+            }
+            offset = std::max(offset, other->offset + other->size);
+        }
+        offset = align(offset);
+
+        offsets[index] = offset;
+        placed.push_back({ offset, req.size, lifetime });
+        heapSize = std::max(heapSize, offset + req.size);
+    }
+
+    m_Stats.heapBytes = heapSize;
+    return heapSize;
+}
+
+void RenderGraph::Execute(RenderGraphBackend& backend)
+{
+    for (auto& pass : m_Passes)
+    {
+        if (pass.culled)
+        {
+            continue;
+        }
+        if (!pass.barriers.empty())
+        {
+            backend.Barriers(*this, pass.barriers);
+        }
+        pass.execute(pass.callable.data());
+    }
+    if (!m_FinalBarriers.empty())
+    {
+        backend.Barriers(*this, m_FinalBarriers);
+    }
+
+    m_Totals.frames++;
+    m_Totals.passes += m_Stats.passes;
+    m_Totals.culledPasses += m_Stats.culledPasses;
+    m_Totals.barriers += m_Stats.barriers;
+    m_Totals.barrierBatches += m_Stats.barrierBatches;
+    m_Totals.peakTransientBytes = std::max(m_Totals.peakTransientBytes, m_Stats.transientBytes);
+    m_Totals.peakHeapBytes = std::max(m_Totals.peakHeapBytes, m_Stats.heapBytes);
+}
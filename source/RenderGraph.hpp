@@ -0,0 +1,242 @@
+/**
+ * Per-frame render graph.
+ * Passes declare which textures they read and write and in what state. Compile() then
+ * culls passes whose output is never used, works out the minimal set of state
+ * transitions (batched per pass), and the lifetimes of transient textures so that
+ * textures which are never alive at the same time can share memory.
+ * Backends only translate the abstract states into their own barriers.
+ */
+
+#pragma once
+
+#include <cstddef>      // For std::max_align_t
+#include <cstdint>      // For uint32_t, uint64_t
+#include <memory_resource>  // For std::pmr::memory_resource
+#include <new>          // For placement new
+#include <span>         // For std::span
+#include <type_traits>  // For std::is_trivially_copyable_v
+#include <vector>       // For std::vector
+
+// what a texture is being used for
+enum class ResourceState : uint8_t
+{
+    Undefined,          // contents can be discarded
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,          // read-only depth test, or sampled
+    ShaderRead,
+    Storage,            // read/write from a shader (UAV)
+    TransferSrc,
+    TransferDst,
+    Present,
+};
+
+// handle to a texture in the graph, only valid until the next Reset()
+using RGResource = uint32_t;
+
+class RenderGraph;
+
+// implemented by each graphics API
+class RenderGraphBackend
+{
+public:
+    struct Barrier
+    {
+        RGResource resource;
+        ResourceState before;
+        ResourceState after;
+    };
+
+    virtual ~RenderGraphBackend() {}
+
+    // Issue a batch of transitions with as few API calls as possible.
+    virtual void Barriers(const RenderGraph& graph, std::span<const Barrier> barriers) = 0;
+};
+
+class RenderGraph
+{
+public:
+    struct TextureDesc
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t format = 0;        // the backend's native format value (VkFormat, DXGI_FORMAT, ...)
+
+        bool operator==(const TextureDesc&) const = default;
+    };
+
+    // size of a transient texture, as reported by the backend
+    struct MemoryRequirements
+    {
+        uint64_t size;
+        uint64_t alignment;
+    };
+
+    // first and last live pass using a resource
+    struct Lifetime
+    {
+        uint32_t firstPass;
+        uint32_t lastPass;
+
+        bool operator==(const Lifetime&) const = default;
+    };
+
+    // for the last compiled frame
+    struct Stats
+    {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t barriers = 0;
+        uint32_t barrierBatches = 0;
+        uint64_t transientBytes = 0;    // what the transients would need without aliasing
+        uint64_t heapBytes = 0;         // what they need with aliasing
+    };
+
+    // over every executed frame since the graph was created, Reset doesn't clear them
+    struct Totals
+    {
+        uint64_t frames = 0;
+        uint64_t passes = 0;
+        uint64_t culledPasses = 0;
+        uint64_t barriers = 0;
+        uint64_t barrierBatches = 0;
+        uint64_t peakTransientBytes = 0;
+        uint64_t peakHeapBytes = 0;
+    };
+
+    // A pass uses each resource in one state. Declaring it again merges the two where one state covers the other
+    // (Storage covers ShaderRead, DepthAttachment covers DepthRead), anything else throws std::runtime_error.
+    class PassBuilder
+    {
+    public:
+        void Read(RGResource resource, ResourceState state);
+        void Write(RGResource resource, ResourceState state);
+        // the pass does something outside of the graph, never cull it
+        void SideEffects();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+        void Use(RGResource resource, ResourceState state, bool write);
+
+        RenderGraph& m_Graph;
+        uint32_t m_Pass;
+    };
+
+    // Forget all passes and resources. Call at the start of every frame.
+    // Per-pass lists and Compile's temporaries come from scratch until the next Reset, usually a FrameArenas resource.
+    void Reset(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    // A texture owned outside of the graph, like a swapchain image.
+    // Imported textures count as outputs of the graph, so passes writing them are never culled.
+    RGResource ImportTexture(const char* name, const TextureDesc& desc, ResourceState initialState, ResourceState finalState);
+
+    // A texture that only lives for this frame. Its memory may be shared with other transients.
+    RGResource CreateTexture(const char* name, const TextureDesc& desc);
+
+    // setup declares the pass's resources right away, execute records it during Execute.
+    // execute is copied into the scratch memory, so it can only capture handles, pointers and references, not objects
+    // owning anything
+    template<typename Setup, typename ExecuteFunction>
+    void AddPass(const char* name, Setup&& setup, const ExecuteFunction& execute)
+    {
+        static_assert(std::is_trivially_copyable_v<ExecuteFunction> && std::is_trivially_destructible_v<ExecuteFunction>,
+            "pass callbacks live in scratch memory, which never runs destructors");
+        static_assert(alignof(ExecuteFunction) <= alignof(std::max_align_t));
+        void* callable = AllocatePass(name, sizeof(ExecuteFunction), [](const void* stored) {
+            (*static_cast<const ExecuteFunction*>(stored))();
+        });
+        new (callable) ExecuteFunction(execute);
+        PassBuilder builder(*this, static_cast<uint32_t>(m_Passes.size() - 1));
+        setup(builder);
+    }
+
+    // Cull unused passes and work out barriers and transient lifetimes.
+    void Compile();
+
+    // Transients used by passes that survived culling, in the order PlaceTransients expects them.
+    std::span<const RGResource> GetTransients() const {
+        return m_Transients;
+    }
+
+    // Assign each transient an offset in one shared block of memory, overlapping those with disjoint lifetimes.
+    // Returns the size of the block.
+    uint64_t PlaceTransients(std::span<const MemoryRequirements> requirements, std::span<uint64_t> offsets);
+
+    // Run every live pass, issuing each pass's barriers in one batch before it.
+    void Execute(RenderGraphBackend& backend);
+
+    const char* GetName(RGResource resource) const {
+        return m_Resources[resource].name;
+    }
+    const TextureDesc& GetDesc(RGResource resource) const {
+        return m_Resources[resource].desc;
+    }
+    // bitmask of (1 << ResourceState) over every state the resource is used in
+    uint32_t GetUsage(RGResource resource) const {
+        return m_Resources[resource].usage;
+    }
+    Lifetime GetLifetime(RGResource resource) const {
+        return m_Resources[resource].lifetime;
+    }
+    bool IsImported(RGResource resource) const {
+        return m_Resources[resource].imported;
+    }
+    uint32_t GetResourceCount() const {
+        return static_cast<uint32_t>(m_Resources.size());
+    }
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+    const Totals& GetTotals() const {
+        return m_Totals;
+    }
+    // for backends' own per-frame arrays
+    std::pmr::memory_resource* GetScratch() const {
+        return m_Scratch;
+    }
+
+private:
+    struct Access
+    {
+        RGResource resource;
+        ResourceState state;
+        bool write;
+        uint32_t usage;     // every state the pass declared, merged into state
+    };
+
+    struct Pass
+    {
+        const char* name;
+        std::pmr::vector<Access> accesses;
+        std::pmr::vector<std::max_align_t> callable;    // a copy of the execute callback
+        void (*execute)(const void* callable);
+        std::pmr::vector<RenderGraphBackend::Barrier> barriers;  // issued before the pass runs
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    // adds a pass, returning storage for its execute callback
+    void* AllocatePass(const char* name, size_t callableSize, void (*execute)(const void* callable));
+
+    struct Resource
+    {
+        const char* name;
+        TextureDesc desc;
+        bool imported;
+        ResourceState initialState;
+        ResourceState finalState;
+        uint32_t usage = 0;
+        Lifetime lifetime{};
+        bool used = false;
+    };
+
+    std::vector<Pass>                           m_Passes;
+    std::vector<Resource>                       m_Resources;
+    std::vector<RGResource>                     m_Transients;
+    std::vector<RenderGraphBackend::Barrier>    m_FinalBarriers;     // imported textures back to their final state
+    Stats                                       m_Stats;
+    Totals                                      m_Totals;
+    std::pmr::memory_resource*                  m_Scratch = std::pmr::get_default_resource();
+};
@@ -0,0 +1,507 @@
+#include "SoftwareOcclusion.hpp"
+#include "CommandLine.hpp"
+#include "CpuFeatures.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+    constexpr uint32_t BandRows = 16;           // rows rasterized per job
+    constexpr uint32_t TrianglesPerJob = 256;
+    constexpr uint32_t BoundsPerJob = 256;
+
+    // in front of the camera and no closer than the near plane. With reverse-Z, nearer than that is z / w > 1
+    bool InDepthRange(const glm::vec4& clip)
+    {
+        return clip.w > 0 && clip.z <= clip.w;
+    }
+}
+
+SoftwareOcclusion::SoftwareOcclusion(WorkerPool& workers, const Settings& settings)
+    : m_Workers(workers),
+    m_Width(std::max(settings.width, 1u)),
+    m_Height(std::max(settings.height, 1u)),
+    m_Pitch((m_Width + 7) & ~7u),
+    m_Simd(settings.simd && IsSimdSupported()),
+    m_Depth(size_t(m_Pitch) * m_Height, 0.0f)
+{
+}
+
+bool SoftwareOcclusion::IsSimdSupported()
+{
+    return IsAvx2Supported();
+}
+
+bool SoftwareOcclusion::SetupTriangle(const glm::vec4 (&clip)[3], Triangle& triangle) const
+{
+    glm::vec2 screen[3];
+    float depth[3];
+    for (int i = 0; i < 3; i++)
+    {
+        // clipping would only make the occluder smaller, so leave out anything that needs it
+        if (!InDepthRange(clip[i]))
+        {
+            return false;
+        }
+        float invW = 1.0f / clip[i].w;
+        screen[i] = { (clip[i].x * invW * 0.5f + 0.5f) * m_Width, (clip[i].y * invW * 0.5f + 0.5f) * m_Height };
+        depth[i] = clip[i].z * invW;
+    }
+
+    // wind every triangle the same way, so the inside is where all three edge functions are positive
+    float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+    if (area == 0)
+    {
+        return false;
+    }
+    if (area < 0)
+    {
+        std::swap(screen[1], screen[2]);
+    }
+
+    auto lo = glm::min(screen[0], glm::min(screen[1], screen[2]));
+    auto hi = glm::max(screen[0], glm::max(screen[1], screen[2]));
+    triangle.minX = static_cast<int32_t>(std::clamp(std::floor(lo.x), 0.0f, float(m_Width)));
+    triangle.maxX = static_cast<int32_t>(std::clamp(std::ceil(hi.x), 0.0f, float(m_Width)));
+    triangle.minY = static_cast<int32_t>(std::clamp(std::floor(lo.y), 0.0f, float(m_Height)));
+    triangle.maxY = static_cast<int32_t>(std::clamp(std::ceil(hi.y), 0.0f, float(m_Height)));
+    if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+    {
+        return false;
+    }
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        const auto& from = screen[edge];
+        const auto& to = screen[(edge + 1) % 3];
+        // pixel centers exactly on an edge count as inside both triangles sharing it, so meshes have no cracks
+        triangle.a[edge] = from.y - to.y;
+        triangle.b[edge] = to.x - from.x;
+        triangle.c[edge] = (to.y - from.y) * from.x - (to.x - from.x) * from.y;
+    }
+    // the farthest depth anywhere on the triangle, which is at one of its corners
+    triangle.depth = std::min(depth[0], std::min(depth[1], depth[2]));
+    return true;
+}
+
+void SoftwareOcclusion::RenderOccluders(const glm::mat4& viewProjection, std::span<const glm::vec3> triangles)
+{
+    m_ViewProjection = viewProjection;
+    std::fill(m_Depth.begin(), m_Depth.end(), 0.0f);
+
+    // set up every triangle once, in parallel
+    uint32_t triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+    m_Setup.resize(triangleCount);
+    m_Valid.resize(triangleCount);
+    m_Workers.ParallelFor((triangleCount + TrianglesPerJob - 1) / TrianglesPerJob, [&](uint32_t job) {
+        uint32_t end = std::min((job + 1) * TrianglesPerJob, triangleCount);
+        for (uint32_t i = job * TrianglesPerJob; i < end; i++)
+        {
+            glm::vec4 clip[3];
+            for (int corner = 0; corner < 3; corner++)
+            {
+                clip[corner] = viewProjection * glm::vec4(triangles[i * 3 + corner], 1.0f);
+            }
+            m_Valid[i] = SetupTriangle(clip, m_Setup[i]);
+        }
+    });
+    m_Triangles.clear();
+    for (uint32_t i = 0; i < triangleCount; i++)
+    {
+        if (m_Valid[i])
+        {
+            m_Triangles.push_back(m_Setup[i]);
+        }
+    }
+    m_Stats.frames++;
+    m_Stats.triangles += m_Triangles.size();
+    m_Stats.trianglesSkipped += triangleCount - m_Triangles.size();
+
+    // then each band of rows draws every triangle that touches it, so no two threads write the same pixel
+    m_Workers.ParallelFor((m_Height + BandRows - 1) / BandRows, [this](uint32_t band) {
+        RasterizeBand(band * BandRows, std::min((band + 1) * BandRows, m_Height));
+    });
+}
+
+void SoftwareOcclusion::RasterizeBand(uint32_t firstRow, uint32_t endRow)
+{
+    for (const auto& triangle : m_Triangles)
+    {
+        int32_t y0 = std::max(triangle.minY, int32_t(firstRow));
+        int32_t y1 = std::min(triangle.maxY, int32_t(endRow));
+        if (y0 >= y1)
+        {
+            continue;
+        }
+#if AVX2_AVAILABLE
+        if (m_Simd)
+        {
+            RasterizeRowsAvx2(triangle, y0, y1);
+            continue;
+        }
+#endif
+        RasterizeRows(triangle, y0, y1);
+    }
+}
+
+void SoftwareOcclusion::RasterizeRows(const Triangle& triangle, int32_t firstRow, int32_t endRow)
+{
+    for (int32_t y = firstRow; y < endRow; y++)
+    {
+        float py = float(y) + 0.5f;
+        float row[3];
+        for (int edge = 0; edge < 3; edge++)
+        {
+            row[edge] = triangle.b[edge] * py + triangle.c[edge];
+        }
+        float* line = &m_Depth[size_t(y) * m_Pitch];
+        for (int32_t x = triangle.minX; x < triangle.maxX; x++)
+        {
+            float px = float(x) + 0.5f;
+            if (triangle.a[0] * px + row[0] >= 0 && triangle.a[1] * px + row[1] >= 0 && triangle.a[2] * px + row[2] >= 0)
+            {
+                line[x] = std::max(line[x], triangle.depth);
+            }
+        }
+    }
+}
+
+bool SoftwareOcclusion::IsRectVisible(int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float depth) const
+{
+    for (int32_t y = minY; y < maxY; y++)
+    {
+        const float* line = &m_Depth[size_t(y) * m_Pitch];
+        for (int32_t x = minX; x < maxX; x++)
+        {
+            if (line[x] <= depth)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#if AVX2_AVAILABLE
+// The same as RasterizeRows, 8 pixels at a time. The loop starts at a multiple of 8 and
+// masks off the pixels outside the bounding box, so it writes exactly what the scalar loop does
+AVX2_FUNCTION void SoftwareOcclusion::RasterizeRowsAvx2(const Triangle& triangle, int32_t firstRow, int32_t endRow)
+{
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 a0 = _mm256_set1_ps(triangle.a[0]);
+    const __m256 a1 = _mm256_set1_ps(triangle.a[1]);
+    const __m256 a2 = _mm256_set1_ps(triangle.a[2]);
+    const __m256 depth = _mm256_set1_ps(triangle.depth);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i minX = _mm256_set1_epi32(triangle.minX - 1);
+    const __m256i maxX = _mm256_set1_epi32(triangle.maxX);
+    int32_t startX = triangle.minX & ~7;
+
+    for (int32_t y = firstRow; y < endRow; y++)
+    {
+        float py = float(y) + 0.5f;
+        __m256 row0 = _mm256_set1_ps(triangle.b[0] * py + triangle.c[0]);
+        __m256 row1 = _mm256_set1_ps(triangle.b[1] * py + triangle.c[1]);
+        __m256 row2 = _mm256_set1_ps(triangle.b[2] * py + triangle.c[2]);
+        float* line = &m_Depth[size_t(y) * m_Pitch];
+        for (int32_t x = startX; x < triangle.maxX; x += 8)
+        {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), laneOffsets);
+            __m256 inside = _mm256_and_ps(
+                _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), row0), zero, _CMP_GE_OQ),
+                    _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), row1), zero, _CMP_GE_OQ)),
+                _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), row2), zero, _CMP_GE_OQ));
+            __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+            __m256i inBox = _mm256_and_si256(_mm256_cmpgt_epi32(xs, minX), _mm256_cmpgt_epi32(maxX, xs));
+            inside = _mm256_and_ps(inside, _mm256_castsi256_ps(inBox));
+
+            __m256 stored = _mm256_loadu_ps(line + x);
+            _mm256_storeu_ps(line + x, _mm256_blendv_ps(stored, _mm256_max_ps(stored, depth), inside));
+        }
+    }
+}
+
+AVX2_FUNCTION bool SoftwareOcclusion::IsRectVisibleAvx2(int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float depth) const
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 objectDepth = _mm256_set1_ps(depth);
+    const __m256i first = _mm256_set1_epi32(minX - 1);
+    const __m256i end = _mm256_set1_epi32(maxX);
+    int32_t startX = minX & ~7;
+    for (int32_t y = minY; y < maxY; y++)
+    {
+        const float* line = &m_Depth[size_t(y) * m_Pitch];
+        for (int32_t x = startX; x < maxX; x += 8)
+        {
+            __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+            __m256i inRect = _mm256_and_si256(_mm256_cmpgt_epi32(xs, first), _mm256_cmpgt_epi32(end, xs));
+            __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(line + x), objectDepth, _CMP_LE_OQ);
+            if (_mm256_movemask_ps(_mm256_and_ps(farther, _mm256_castsi256_ps(inRect))) != 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+#endif
+
+bool SoftwareOcclusion::IsVisible(const Bounds& bounds) const
+{
+    glm::vec2 lo(std::numeric_limits<float>::max());
+    glm::vec2 hi(std::numeric_limits<float>::lowest());
+    float nearest = 0;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 position(
+            corner & 1 ? bounds.max.x : bounds.min.x,
+            corner & 2 ? bounds.max.y : bounds.min.y,
+            corner & 4 ? bounds.max.z : bounds.min.z);
+        auto clip = m_ViewProjection * glm::vec4(position, 1.0f);
+        // too close to tell, keep it
+        if (!InDepthRange(clip))
+        {
+            return true;
+        }
+        float invW = 1.0f / clip.w;
+        glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * m_Width, (clip.y * invW * 0.5f + 0.5f) * m_Height);
+        lo = glm::min(lo, screen);
+        hi = glm::max(hi, screen);
+        nearest = std::max(nearest, clip.z * invW);
+    }
+
+    // every pixel the box touches, rounded outwards
+    float x0 = std::floor(lo.x), x1 = std::ceil(hi.x), y0 = std::floor(lo.y), y1 = std::ceil(hi.y);
+    if (x1 <= 0 || x0 >= m_Width || y1 <= 0 || y0 >= m_Height)
+    {
+        return false;       // off screen
+    }
+    // plus one more on every side: occluders cover the pixels whose centers they cover, so they can reach up to
+    // half a pixel past their real edge, and the box may only be in the uncovered part of that pixel
+    int32_t minX = static_cast<int32_t>(std::clamp(x0 - 1, 0.0f, float(m_Width)));
+    int32_t maxX = static_cast<int32_t>(std::clamp(x1 + 1, 0.0f, float(m_Width)));
+    int32_t minY = static_cast<int32_t>(std::clamp(y0 - 1, 0.0f, float(m_Height)));
+    int32_t maxY = static_cast<int32_t>(std::clamp(y1 + 1, 0.0f, float(m_Height)));
+#if AVX2_AVAILABLE
+    if (m_Simd)
+    {
+        return IsRectVisibleAvx2(minX, maxX, minY, maxY, nearest);
+    }
+#endif
+    return IsRectVisible(minX, maxX, minY, maxY, nearest);
+}
+
+void SoftwareOcclusion::TestBounds(std::span<const Bounds> bounds, std::span<uint8_t> visible)
+{
+    uint32_t count = static_cast<uint32_t>(std::min(bounds.size(), visible.size()));
+    m_Workers.ParallelFor((count + BoundsPerJob - 1) / BoundsPerJob, [&](uint32_t job) {
+        uint32_t end = std::min((job + 1) * BoundsPerJob, count);
+        for (uint32_t i = job * BoundsPerJob; i < end; i++)
+        {
+            visible[i] = IsVisible(bounds[i]);
+        }
+    });
+    m_Stats.objects += count;
+    m_Stats.objectsCulled += std::count(visible.begin(), visible.begin() + count, uint8_t(0));
+}
+
+namespace {
+    // like the renderer's: reverse-Z, infinite far plane, y pointing down
+    glm::mat4 Projection(float fovY, float aspect, float zNear)
+    {
+        float f = 1.0f / std::tan(fovY / 2);
+        glm::mat4 projection(0.0f);
+        projection[0][0] = f / aspect;
+        projection[1][1] = -f;
+        projection[2][3] = -1.0f;
+        projection[3][2] = zNear;
+        return projection;
+    }
+
+    void AddBox(std::vector<glm::vec3>& triangles, glm::vec3 lo, glm::vec3 hi)
+    {
+        auto corner = [&](int i) {
+            return glm::vec3(i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z);
+        };
+        // two triangles per face, corners numbered by which axes are at their maximum
+        constexpr int faces[6][4] = {
+            { 0, 2, 6, 4 }, { 1, 3, 7, 5 },     // -x, +x
+            { 0, 1, 5, 4 }, { 2, 3, 7, 6 },     // -y, +y
+            { 0, 1, 3, 2 }, { 4, 5, 7, 6 },     // -z, +z
+        };
+        for (const auto& face : faces)
+        {
+            for (int i : { 0, 1, 2, 0, 2, 3 })
+            {
+                triangles.push_back(corner(face[i]));
+            }
+        }
+    }
+
+    // a few hand-placed cases with known answers
+    bool CheckKnownCases(WorkerPool& workers, bool simd)
+    {
+        SoftwareOcclusion occlusion(workers, { .width = 64, .height = 64, .simd = simd });
+        auto viewProjection = Projection(glm::radians(90.0f), 1.0f, 0.1f);     // camera at the origin looking down -z
+        // a wall 10 units away, covering the middle of the screen
+        std::vector<glm::vec3> wall;
+        AddBox(wall, { -5, -5, -10.5f }, { 5, 5, -10 });
+        occlusion.RenderOccluders(viewProjection, wall);
+
+        SoftwareOcclusion::Bounds bounds[] = {
+            { { -1, -1, -21 }, { 1, 1, -19 } },     // behind the wall
+            { { -1, -1, -6 }, { 1, 1, -4 } },       // in front of it
+            { { -1, -1, -11 }, { 1, 1, -9 } },      // poking through it
+            { { 12, -1, -21 }, { 14, 1, -19 } },    // behind, but to the side of it
+            { { 30, -1, -21 }, { 32, 1, -19 } },    // off screen
+            { { -1, -1, 4 }, { 1, 1, 6 } },         // behind the camera
+        };
+        constexpr uint8_t expected[] = { 0, 1, 1, 1, 0, 1 };
+        uint8_t visible[std::size(bounds)];
+        occlusion.TestBounds(bounds, visible);
+        bool passed = std::equal(std::begin(visible), std::end(visible), std::begin(expected));
+        if (!passed)
+        {
+            std::cout << std::format("Known cases failed on the {} path:", occlusion.IsSimdEnabled() ? "AVX2" : "scalar");
+            for (size_t i = 0; i < std::size(bounds); i++)
+            {
+                std::cout << std::format(" {}/{}", visible[i], expected[i]);
+            }
+            std::cout << std::endl;
+        }
+        return passed;
+    }
+
+    struct Result
+    {
+        double rasterMs;
+        double testMs;
+        double culledPercent;
+        std::vector<uint64_t> checksums;    // per frame, of the depth buffer and visibility
+    };
+
+    Result Run(uint32_t threadCount, bool simd, uint32_t frames, std::span<const glm::vec3> occluders, std::span<const SoftwareOcclusion::Bounds> objects)
+    {
+        WorkerPool workers(threadCount);
+        SoftwareOcclusion occlusion(workers, { .simd = simd });
+        auto projection = Projection(glm::radians(60.0f), 16.0f / 9.0f, 0.1f);
+        std::vector<uint8_t> visible(objects.size());
+        Result result{};
+        std::chrono::duration<double, std::milli> rasterTime{}, testTime{};
+
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            // walk down the middle of a street, looking around
+            float t = float(frame) / frames;
+            glm::vec3 eye(3.0f, 1.7f, 80.0f - 160.0f * t);
+            float heading = std::sin(t * 12.0f) * 1.2f;
+            auto view = glm::lookAt(eye, eye + glm::vec3(std::sin(heading), 0.0f, -std::cos(heading)), glm::vec3(0, 1, 0));
+
+            auto start = std::chrono::steady_clock::now();
+            occlusion.RenderOccluders(projection * view, occluders);
+            auto rasterized = std::chrono::steady_clock::now();
+            occlusion.TestBounds(objects, visible);
+            auto tested = std::chrono::steady_clock::now();
+            rasterTime += rasterized - start;
+            testTime += tested - rasterized;
+
+            uint64_t checksum = 1469598103934665603ull;
+            auto mix = [&checksum](uint64_t value) {
+                checksum = (checksum ^ value) * 1099511628211ull;
+            };
+            for (float depth : occlusion.GetDepth())
+            {
+                mix(std::bit_cast<uint32_t>(depth));
+            }
+            for (uint8_t v : visible)
+            {
+                mix(v);
+            }
+            result.checksums.push_back(checksum);
+        }
+        auto& stats = occlusion.GetStats();
+        result.rasterMs = rasterTime.count() / frames;
+        result.testMs = testTime.count() / frames;
+        result.culledPercent = stats.objects > 0 ? 100.0 * stats.objectsCulled / stats.objects : 0.0;
+        return result;
+    }
+}
+
+int RunSoftwareOcclusionBenchmark()
+{
+    uint32_t threadCount = std::max(CommandLine::GetValue("bench-threads", std::thread::hardware_concurrency()), 1u);
+    uint32_t objectCount = CommandLine::GetValue("objects", 50000u);
+    uint32_t frames = std::max(CommandLine::GetValue("frames", 200u), 1u);
+
+    bool simdSupported = SoftwareOcclusion::IsSimdSupported();
+    {
+        WorkerPool workers(threadCount);
+        bool passed = CheckKnownCases(workers, false);
+        if (simdSupported)
+        {
+            passed = CheckKnownCases(workers, true) && passed;
+        }
+        if (!passed)
+        {
+            return 1;
+        }
+    }
+
+    // a grid of city blocks with streets between them, and objects scattered over all of it
+    std::vector<glm::vec3> occluders;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    constexpr int blocks = 16;
+    constexpr float blockSize = 10.0f, streetWidth = 6.0f;
+    constexpr float citySize = blocks * (blockSize + streetWidth);
+    for (int x = 0; x < blocks; x++)
+    {
+        for (int z = 0; z < blocks; z++)
+        {
+            glm::vec3 lo(x * (blockSize + streetWidth) - citySize / 2 + streetWidth, 0.0f, z * (blockSize + streetWidth) - citySize / 2 + streetWidth);
+            AddBox(occluders, lo, lo + glm::vec3(blockSize, 8.0f + unit(rng) * 30.0f, blockSize));
+        }
+    }
+    std::vector<SoftwareOcclusion::Bounds> objects(objectCount);
+    for (auto& object : objects)
+    {
+        glm::vec3 center((unit(rng) - 0.5f) * citySize, unit(rng) * 3.0f, (unit(rng) - 0.5f) * citySize);
+        glm::vec3 extent(0.25f + unit(rng) * 0.75f);
+        object = { center - extent, center + extent };
+    }
+
+    std::cout << std::format("{} occluder triangles, {} objects, {} frames, AVX2 {}", occluders.size() / 3, objectCount, frames,
+        simdSupported ? "supported" : "not supported") << std::endl;
+    std::cout << std::format("{:<8} {:>8} {:>11} {:>11} {:>9}", "path", "threads", "raster ms", "test ms", "culled") << std::endl;
+
+    auto configs = GetSimdBenchmarkConfigs(threadCount);
+
+    std::vector<uint64_t> reference;
+    bool agree = true;
+    for (const auto& config : configs)
+    {
+        auto result = Run(config.threads, config.simd, frames, occluders, objects);
+        std::cout << std::format("{:<8} {:>8} {:>11.3f} {:>11.3f} {:>8.1f}%", config.name, config.threads, result.rasterMs, result.testMs, result.culledPercent) << std::endl;
+        if (reference.empty())
+        {
+            reference = std::move(result.checksums);
+        }
+        else if (result.checksums != reference)
+        {
+            std::cout << std::format("{} on {} threads doesn't match the scalar path", config.name, config.threads) << std::endl;
+            agree = false;
+        }
+    }
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/**
+ * CPU occlusion culling: a few big occluders are rasterized into a small depth buffer, and object bounds are
+ * tested against it before any draws are recorded, so hidden objects never reach the GPU.
+ * Culling is conservative. A pixel takes an occluder's depth if the triangle covers its center, at the farthest
+ * depth of the triangle, and an object is only culled if every pixel around its bounds is closer than its
+ * nearest point. Triangles or bounds crossing the near plane are never used to cull.
+ * Rows of the depth buffer are split into bands rasterized in parallel on a WorkerPool, 8 pixels at a time with
+ * AVX2 where the CPU has it. The scalar path does the same float operations in the same order, so both give
+ * exactly the same results.
+ * Depth follows the renderer's reverse-Z convention: clip z / w is bigger when closer, 0 is infinitely far away.
+ */
+
+#pragma once
+
+#include "WorkerPool.hpp"
+
+#include <cstdint>      // For uint8_t, uint32_t, uint64_t
+#include <span>         // For std::span
+#include <vector>       // For std::vector
+
+#include <glm/glm.hpp>
+
+class SoftwareOcclusion
+{
+public:
+    struct Settings
+    {
+        uint32_t width = 320;
+        uint32_t height = 180;
+        bool simd = true;           // use AVX2 if the CPU supports it
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t triangles = 0;         // occluder triangles rasterized
+        uint64_t trianglesSkipped = 0;  // crossing the near plane, off screen or edge on
+        uint64_t objects = 0;           // bounds tested
+        uint64_t objectsCulled = 0;
+    };
+
+    // world space axis aligned box
+    struct Bounds
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    SoftwareOcclusion(WorkerPool& workers, const Settings& settings);
+    virtual ~SoftwareOcclusion() {}
+
+    // Clear the depth buffer and draw occluders into it. Every three world space vertices are a triangle.
+    void RenderOccluders(const glm::mat4& viewProjection, std::span<const glm::vec3> triangles);
+
+    // visible[i] is 0 if bounds[i] is certainly hidden by, or entirely off screen from, the last RenderOccluders call.
+    void TestBounds(std::span<const Bounds> bounds, std::span<uint8_t> visible);
+
+    // whether this build and CPU have the AVX2 path
+    static bool IsSimdSupported();
+    bool IsSimdEnabled() const {
+        return m_Simd;
+    }
+
+    // rows are GetPitch() floats apart, the pixels past the width are padding
+    std::span<const float> GetDepth() const {
+        return m_Depth;
+    }
+    uint32_t GetPitch() const {
+        return m_Pitch;
+    }
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+private:
+    // a triangle ready to rasterize: edge functions a * x + b * y + c, all positive inside it,
+    // and the one depth it writes
+    struct Triangle
+    {
+        float a[3];
+        float b[3];
+        float c[3];
+        float depth;
+        int32_t minX, maxX;     // pixels [min, max)
+        int32_t minY, maxY;
+    };
+
+    bool SetupTriangle(const glm::vec4 (&clip)[3], Triangle& triangle) const;
+    void RasterizeBand(uint32_t firstRow, uint32_t endRow);
+    bool IsVisible(const Bounds& bounds) const;
+
+    // the inner loops, with an AVX2 version of each on x64
+    void RasterizeRows(const Triangle& triangle, int32_t firstRow, int32_t endRow);
+    void RasterizeRowsAvx2(const Triangle& triangle, int32_t firstRow, int32_t endRow);
+    // whether any pixel in [minX, maxX) x [minY, maxY) is no closer than depth
+    bool IsRectVisible(int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float depth) const;
+    bool IsRectVisibleAvx2(int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float depth) const;
+
+    WorkerPool&             m_Workers;
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    uint32_t                m_Pitch;            // width rounded up to 8
+    bool                    m_Simd;
+    glm::mat4               m_ViewProjection{ 1.0f };
+    std::vector<float>      m_Depth;
+    std::vector<Triangle>   m_Triangles;        // this frame's, with the skipped ones left out
+    std::vector<Triangle>   m_Setup;            // every triangle set up, kept between frames to reuse their memory
+    std::vector<uint8_t>    m_Valid;            // whether each of m_Setup is worth drawing
+    Stats                   m_Stats;
+};
+
+// CPU-only benchmark rasterizing a city block of occluders and testing objects against it, scalar and SIMD,
+// on one thread and many, checking they all agree. Run with --bench-occlusion; --bench-threads=N, --objects=N and
+// --frames=N change the workload.
+int RunSoftwareOcclusionBenchmark();
@@ -0,0 +1,195 @@
+#include "TextureCooker.hpp"
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+    float SrgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // each 8 bit value as a linear 0-1 value, or as itself scaled to 0-1 for linear images
+    std::array<float, 256> MakeToLinearTable(bool srgb)
+    {
+        std::array<float, 256> table;
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            table[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+        }
+        return table;
+    }
+
+    // one level down, each pixel the average of the 2x2 above it. Odd edges repeat their last row or column
+    std::vector<uint8_t> Downsample(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, const std::array<float, 256>& toLinear, bool srgb)
+    {
+        uint32_t nextWidth = std::max(width / 2, 1u);
+        uint32_t nextHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> next(size_t(nextWidth) * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; y++)
+        {
+            uint32_t rows[2] = { std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1) };
+            for (uint32_t x = 0; x < nextWidth; x++)
+            {
+                uint32_t columns[2] = { std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1) };
+                float sums[4] = {};
+                for (uint32_t row : rows)
+                {
+                    for (uint32_t column : columns)
+                    {
+                        const uint8_t* pixel = &rgba[(size_t(row) * width + column) * 4];
+                        for (uint32_t channel = 0; channel < 3; channel++)
+                        {
+                            sums[channel] += toLinear[pixel[channel]];
+                        }
+                        sums[3] += pixel[3] / 255.0f;       // alpha is always linear
+                    }
+                }
+                uint8_t* out = &next[(size_t(y) * nextWidth + x) * 4];
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    float average = sums[channel] / 4.0f;
+                    float encoded = srgb && channel < 3 ? LinearToSrgb(average) : average;
+                    out[channel] = static_cast<uint8_t>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+                }
+            }
+        }
+        return next;
+    }
+}
+
+std::vector<std::vector<uint8_t>> GenerateMips(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, bool srgb)
+{
+    auto toLinear = MakeToLinearTable(srgb);
+    std::vector<std::vector<uint8_t>> levels;
+    levels.emplace_back(rgba.begin(), rgba.begin() + size_t(width) * height * 4);
+    while (width > 1 || height > 1)
+    {
+        levels.push_back(Downsample(levels.back(), width, height, toLinear, srgb));
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return levels;
+}
+
+std::vector<std::byte> CookTexture(BlockEncoder& encoder, std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+    const CookSettings& settings, CookStats* stats)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    CookStats cooked;
+
+    auto start = Clock::now();
+    std::vector<std::vector<uint8_t>> mips;
+    if (settings.mips)
+    {
+        mips = GenerateMips(rgba, width, height, settings.srgb);
+    }
+    else
+    {
+        mips.emplace_back(rgba.begin(), rgba.begin() + size_t(width) * height * 4);
+    }
+    cooked.mipMs = elapsedMs(start);
+
+    start = Clock::now();
+    std::vector<std::vector<std::byte>> levels;
+    for (size_t level = 0; level < mips.size(); level++)
+    {
+        uint32_t levelWidth = std::max(width >> level, 1u);
+        uint32_t levelHeight = std::max(height >> level, 1u);
+        auto& blocks = levels.emplace_back(BlockEncoder::GetEncodedSize(settings.format, levelWidth, levelHeight));
+        encoder.Encode(settings.format, mips[level], levelWidth, levelHeight, blocks);
+        cooked.uncompressedBytes += mips[level].size();
+        cooked.blockBytes += blocks.size();
+    }
+    cooked.encodeMs = elapsedMs(start);
+
+    start = Clock::now();
+    Ktx2Description description{
+        .format = settings.format,
+        .srgb = settings.srgb,
+        .width = width,
+        .height = height,
+        .supercompression = settings.supercompression
+    };
+    auto file = WriteKtx2(description, levels);
+    cooked.writeMs = elapsedMs(start);
+    cooked.fileBytes = file.size();
+
+    if (stats)
+    {
+        *stats = cooked;
+    }
+    return file;
+}
+
+int RunTextureCooker()
+{
+    std::filesystem::path input(*CommandLine::GetValue("cook"));
+    uint32_t width = CommandLine::GetValue("width", 0u);
+    uint32_t height = CommandLine::GetValue("height", 0u);
+
+    CookSettings settings{
+        .srgb = !CommandLine::HasFlag("linear"),
+        .supercompression = CommandLine::HasFlag("zlib") ? Ktx2Supercompression::Zlib : Ktx2Supercompression::None
+    };
+    if (auto format = CommandLine::GetValue("format"))
+    {
+        bool known = false;
+        for (auto candidate : { BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 })
+        {
+            if (*format == BlockEncoder::GetFormatName(candidate))
+            {
+                settings.format = candidate;
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            std::cout << std::format("Unknown format {}, expected bc1, bc4, bc5 or bc7", *format) << std::endl;
+            return 1;
+        }
+    }
+    auto output = input;
+    output.replace_extension(".ktx2");
+    if (auto path = CommandLine::GetValue("out"))
+    {
+        output = std::filesystem::path(*path);
+    }
+
+    std::ifstream file(input, std::ios::binary);
+    std::vector<uint8_t> rgba((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file.is_open() || width == 0 || height == 0 || rgba.size() != size_t(width) * height * 4)
+    {
+        std::cout << std::format("{} isn't {}x{} RGBA8 pixels; pass its size with --width and --height", input.string(), width, height) << std::endl;
+        return 1;
+    }
+
+    WorkerPool workers;
+    BlockEncoder encoder(workers, {});
+    CookStats stats;
+    auto cooked = CookTexture(encoder, rgba, width, height, settings, &stats);
+    std::ofstream(output, std::ios::binary).write(reinterpret_cast<const char*>(cooked.data()), cooked.size());
+
+    std::cout << std::format("{} -> {}: {} {}x{}, {} levels", input.string(), output.string(), BlockEncoder::GetFormatName(settings.format),
+        width, height, settings.mips ? std::bit_width(std::max(width, height)) : 1) << std::endl;
+    std::cout << std::format("{} KiB as RGBA8, {} KiB of blocks, {} KiB file; mips {:.1f} ms, encode {:.1f} ms, write {:.1f} ms",
+        stats.uncompressedBytes / 1024, stats.blockBytes / 1024, stats.fileBytes / 1024, stats.mipMs, stats.encodeMs, stats.writeMs) << std::endl;
+    return 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * The offline half of the compressed texture pipeline: RGBA8 images in, KTX2 files of block compressed mips out,
+ * so loading a texture is copying blocks rather than encoding anything.
+ * Mips are box filtered on the CPU before encoding, since the GPU can't blit into compressed formats. For sRGB
+ * images the averaging happens on linear values, or mips would come out darker than the image.
+ */
+
+#pragma once
+
+#include "BlockCompression.hpp"
+#include "Ktx2.hpp"
+
+#include <cstddef>  // For std::byte
+#include <cstdint>  // For uint8_t, uint32_t, uint64_t
+#include <span>     // For std::span
+#include <vector>   // For std::vector
+
+struct CookSettings
+{
+    BlockFormat format = BlockFormat::BC7;
+    bool srgb = true;
+    bool mips = true;                   // a full chain down to 1x1, or just the image
+    Ktx2Supercompression supercompression = Ktx2Supercompression::None;
+};
+
+struct CookStats
+{
+    double mipMs = 0;
+    double encodeMs = 0;
+    double writeMs = 0;                 // including supercompression
+    uint64_t uncompressedBytes = 0;     // of every level as RGBA8
+    uint64_t blockBytes = 0;            // of every level as blocks, what the GPU holds
+    uint64_t fileBytes = 0;
+};
+
+// The image and its mips as RGBA8, largest first, each level half the size of the one before rounded down.
+std::vector<std::vector<uint8_t>> GenerateMips(std::span<const uint8_t> rgba, uint32_t width, uint32_t height, bool srgb);
+
+// Make a KTX2 file from tightly packed RGBA8 pixels.
+std::vector<std::byte> CookTexture(BlockEncoder& encoder, std::span<const uint8_t> rgba, uint32_t width, uint32_t height,
+    const CookSettings& settings, CookStats* stats = nullptr);
+
+// Cook a raw RGBA8 file from the command line, as there are no image decoders in the tree:
+// --cook=image.rgba --width=W --height=H, with --format=bc1|bc4|bc5|bc7 (bc7 by default), --linear for data that
+// isn't sRGB, --zlib to supercompress and --out=file.ktx2 (the input's name with .ktx2 by default).
+int RunTextureCooker();
@@ -13,22 +13,42 @@
 #include <optional>
 #include <limits> 
 #include <algorithm> 
-#include <fstream>
 #include <vector>
 #include <set>
 #include <filesystem>
 #include <array>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <span>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "VkCommon.hpp"
+#include "VkBindless.hpp"
+#include "VkDescriptorAllocator.hpp"
+#include "VkRenderGraph.hpp"
+#include "VkDeletionQueue.hpp"
+#include "VkFramePacer.hpp"
+#include "VkTimelineQueue.hpp"
+#include "VkCommandBufferPool.hpp"
+#include "VkRHI.hpp"
+#include "VkFrameCapture.hpp"
+#include "VkOverdrawScene.hpp"
+#include "VkOcclusionScene.hpp"
+#include "VkMeshletScene.hpp"
+#include "VkLodScene.hpp"
+#include "VkTextureScene.hpp"
+#include "DynamicResolution.hpp"
+#include "FrameArena.hpp"
+#include "HeapCounter.hpp"
+#include "BlockCompression.hpp"
 
 // grrr...
 #undef min
 #undef max
 
-#define VK_CHECK(a) {auto VK_CHECK_RESULT = a; assert(VK_CHECK_RESULT == VK_SUCCESS);}
-#define VK_CHECK_OPT(a) {auto VK_CHECK_RESULT = a; if(VK_CHECK_RESULT != VK_SUCCESS){std::cout << std::format("VK_CHECK_OPT {}:{} failed",__FILE__,__LINE__) << std::endl;}}
-#define VK_VALID(a) {assert(a != VK_NULL_HANDLE);}
-
 using namespace std;
 
 struct Vertex {
@@ -74,6 +94,7 @@ static struct UniformBufferObject {
 } ubo;
 
 // ideally these would go in some kind of ADT
+static VkApp* global_app = nullptr;
 static VkInstance instance;
 static VkDebugUtilsMessengerEXT debugMessenger;
 static VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
@@ -96,25 +117,201 @@ static VkDescriptorSetLayout descriptorSetLayout;
 static VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 static VkRenderPass renderPass = VK_NULL_HANDLE;
 
-static VkCommandPool commandPool;
-static VkCommandBuffer commandBuffer;
+// swapchain sized depth buffer, recreated along with the swapchain.
+// Depth is reverse-Z: 1 at the near plane, falling towards 0 at infinity, so it's cleared to 0 and tested with GREATER.
+// Floating point depth is most precise near 0, which is where distant geometry ends up, so precision stays roughly even with distance
+static VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+static VkImage depthImage = VK_NULL_HANDLE;
+static VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+static VkImageView depthImageView = VK_NULL_HANDLE;
+
+// --depth-prepass draws opaque geometry depth-only first, so the main pass only shades the visible surface (depth test EQUAL)
+static bool depthPrepassEnabled = false;
+static VkRenderPass depthPrepassRenderPass = VK_NULL_HANDLE;   // only without dynamic rendering
+static VkFramebuffer depthPrepassFramebuffer = VK_NULL_HANDLE;
+
+// dynamic rendering (core in 1.3, VK_KHR_dynamic_rendering before that) begins rendering straight into image views,
+// so there is no render pass or framebuffers to rebuild when the swapchain changes. --no-dynamic-rendering forces the old path
+static bool dynamicRenderingEnabled = false;
+static PFN_vkCmdBeginRendering cmdBeginRendering = nullptr;   // the KHR entrypoints have identical signatures
+static PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+
+// how many frames the CPU may record ahead of the GPU
+// anything the CPU writes per frame needs this many copies
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+static uint32_t currentFrame = 0;
+
+// anything released while running goes through here, and is destroyed once the frames that could use it have finished
+static std::unique_ptr<DeletionQueue> deletionQueue;
+
+// decides the present mode and image count, and when each frame starts (see pacehook)
+static std::unique_ptr<FramePacer> framePacer;
+static bool presentWaitEnabled = false;     // VK_KHR_present_id + VK_KHR_present_wait
+static bool latencyReportEnabled = false;   // --latency-report prints the latency every second
+static std::chrono::steady_clock::time_point lastLatencyReport;
+
+// dynamic resolution (--dynres) renders the scene smaller under load and upscales it to the swapchain
+static std::unique_ptr<DynamicResolution> dynamicResolution;
+static VkQueryPool timestampQueryPool = VK_NULL_HANDLE;    // a begin and end timestamp per frame in flight
+static bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+static float timestampPeriod = 1;                          // nanoseconds per tick
+static uint32_t timestampValidBits = 0;
+
+// particle simulation (--particles) runs on a compute queue, from its own family if the GPU has one,
+// so it overlaps graphics work. --no-async-compute puts it on the graphics queue to compare
+constexpr uint32_t PARTICLE_COUNT = 16384;
+struct Particle {
+    glm::vec2 position;
+    glm::vec2 velocity;
+    glm::vec4 color;
+};  // must match particles.comp
+struct ParticleConstants {
+    float deltaTime;
+    uint32_t count;
+};
+static bool particlesEnabled = false;
+static VkQueue computeQueue;
+static std::unique_ptr<CommandBufferPool> computeCommands;
+static RHIBuffer particleBuffers[2];                // frame N simulates from N-1's buffer into N % 2
+// writing buffer N % 2 is only safe because waiting for frame N's fence slot means frame N - 2, the last to read it, is done
+static_assert(MAX_FRAMES_IN_FLIGHT == std::size(particleBuffers), "The particle buffers are only reused safely with a buffer per frame in flight.");
+static VkDescriptorSetLayout particleSetLayout;
+static VkDescriptorPool particleDescriptorPool;
+static VkDescriptorSet particleDescriptorSets[2];    // one per buffer written
+static VkShaderModule particleCompShaderModule;
+static VkPipelineLayout particleComputeLayout;
+static VkPipeline particleComputePipeline;
+static RHIPipeline particleGraphicsPipeline;
+static uint32_t particleDrawIndex = 0;              // the buffer this frame draws
+static std::chrono::steady_clock::time_point lastSimulationTime;
+
+static std::unique_ptr<TimelineQueue> computeTimeline;
+
+// per-queue timing, to see how much compute overlapped graphics
+static VkQueryPool computeTimestampQueryPool = VK_NULL_HANDLE;
+static bool computeTimestampsWritten[MAX_FRAMES_IN_FLIGHT];
+static uint64_t lastGraphicsTimestamps[2];          // from the previous frame, which compute ran alongside
+static struct {
+    uint64_t frames = 0;
+    double graphicsMs = 0;
+    double computeMs = 0;
+    double overlapMs = 0;
+} queueTimingStats;
+
+// --blocking-resize restores the old idle-and-rebuild path, to compare the hitch
+static bool blockingResize = false;
+static struct {
+    uint32_t count = 0;
+    double totalMs = 0;
+    double worstMs = 0;
+} resizeStats;
+
+// overdraw benchmark (--overdraw=N): N screen-covering layers drawn back to front with an expensive fragment shader
+static uint32_t overdrawLayers = 0;
+static bool pipelineStatisticsEnabled = false;
+
+// occlusion culling benchmark (--occlusion=N): N objects, most of them hidden behind a few big ones, culled on the GPU
+// in two phases against a hierarchical depth buffer. --occlusion-compare turns occlusion culling off for every other
+// block of frames, to time what it saves in the same run
+static uint32_t occlusionObjects = 0;
+static bool occlusionCompare = false;
+
+// --cpu-occlusion culls the occlusion scene on the CPU instead: the big objects are rasterized into a small depth
+// buffer across a worker pool, and only the objects that pass are written into the draw list before recording
+static bool cpuOcclusion = false;
+
+// meshlet benchmark (--meshlets=N): N copies of a dense sphere split into meshlets, culled per meshlet against the frustum
+// and each meshlet's normal cone before any of its vertices are read. Uses task and mesh shaders where VK_EXT_mesh_shader
+// is supported, or --no-mesh-shaders pulls the same meshlets through a vertex shader. --meshlet-compare turns
+// culling off for every other block of frames
+static uint32_t meshletInstances = 0;
+static bool meshletCompare = false;
+static bool meshShadersEnabled = false;
+static PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks = nullptr;
+
+// LOD benchmark (--lod=N): N copies of a dense sphere on a grid stretching away from the camera, with a chain of
+// simplified levels generated at startup. Every frame the CPU picks each copy's level from how big it is on screen,
+// and each level is drawn once, instanced. --lod-compare draws every copy at full detail for every other block of frames
+static uint32_t lodInstances = 0;
+static bool lodCompare = false;
+
+// texture benchmark (--textures=N): N textures uploaded through the staging ring with their mips blitted on the GPU,
+// drawn as a grid of quads on the ground so the far ones sample small mips. Every frame --texture-uploads=M of them
+// (8 by default) are uploaded again, to measure sustained upload bandwidth. --texture-size=S sets their size (512).
+// They are sampled through the bindless heap when it is enabled, and through a descriptor set per texture otherwise.
+// --texture-format=bc1|bc4|bc5|bc7 cooks the sources into KTX2 files of block compressed mips at startup, as an
+// offline step would, then maps the files and uploads every level straight out of them instead of blitting mips.
+// --texture-zlib supercompresses the files. Devices that can't sample BC formats stay on RGBA8.
+// --texture-streaming streams the cooked files (bc7 unless --texture-format picks another) instead of loading them
+// whole: each texture starts with its small mips, and the finer ones are loaded as the shaders ask for them, within
+// --texture-budget=MiB (64). It needs --bindless. The camera travels down the grid and back, so levels come and go
+static uint32_t textureCount = 0;
+static uint32_t textureSize = 512;
+static uint32_t textureUploadsPerFrame = 8;
+static bool samplerAnisotropyEnabled = false;
+static std::optional<BlockFormat> textureBlockFormat;
+static bool textureZlib = false;
+static bool textureStreaming = false;
+static uint32_t textureBudgetMiB = 64;
+
+// frame capture (--capture=dir): at the end of every --capture-every=N frames (1) the swapchain image is copied into
+// a host-visible buffer, which is read once the frame's slot comes round again, so the render loop never waits on
+// the GPU for it. A FrameWriter writes the frames on its own thread, as frame{N}.png in dir (captures by default),
+// or as raw RGBA with --capture-format=raw. --capture-compare=dir checks each against the golden PNG of the same
+// name there. Only swapchains of 8-bit RGBA or BGRA that allow copying from are captured. With --frames=N this
+// renders offline, and the writer's throughput is reported at exit
+static std::optional<FrameWriter::Settings> captureSettings;
+static uint32_t captureEvery = 1;
+static std::unique_ptr<VkFrameCapture> frameCapture;
+
+// the benchmark scenes enabled, in the order they draw
+static std::vector<std::unique_ptr<VkScene>> scenes;
+
+static std::unique_ptr<CommandBufferPool> graphicsCommands;
+
+// the triangle's vertex buffer and the particles are made and drawn through the RHI, on the graphics queue
+static std::unique_ptr<VkRHIDevice> rhiDevice;
 
 // meshdata
-static VkBuffer vertexBuffer;
-static VkDeviceMemory vertexBufferMemory;
+static RHIBuffer vertexBuffer;
 
 // uniform buffer
-static VkBuffer uniformBuffer;
-static VkDeviceMemory uniformBufferMemory;
-void* uniformBufferMapped = nullptr;
+static VkBuffer uniformBuffers[MAX_FRAMES_IN_FLIGHT];
+static VkDeviceMemory uniformBufferMemories[MAX_FRAMES_IN_FLIGHT];
+static void* uniformBuffersMapped[MAX_FRAMES_IN_FLIGHT];
 
 //synchronization primitves
-static VkSemaphore imageAvailableSemaphore;
-static VkSemaphore renderFinishedSemaphore;
-static VkFence inFlightFence;
-
-static VkDescriptorPool descriptorPool;
-static VkDescriptorSet descriptorSet;
+static VkSemaphore imageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT];
+static VkSemaphore renderFinishedSemaphores[MAX_FRAMES_IN_FLIGHT];
+
+// all graphics work goes through a timeline, instead of a fence per frame in flight
+static std::unique_ptr<TimelineQueue> graphicsTimeline;
+static uint64_t frameFenceValues[MAX_FRAMES_IN_FLIGHT];     // timeline value of the last frame submitted from each slot
+
+static std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+
+// scratch memory for data that only lives until the GPU finishes the frame, one set per frame in flight
+static std::unique_ptr<FrameArenas> frameArenas;
+// heap allocations drawFrame makes on the main thread, which should stop once the first frames have grown everything
+static constexpr uint64_t HEAP_WARMUP_FRAMES = 60;
+static uint64_t drawFrameCount = 0;
+static uint64_t drawFrameAllocations = 0;
+static uint64_t steadyStateAllocations = 0;
+static uint64_t steadyStateAllocatingFrames = 0;
+
+// rebuilt every frame, works out the barriers and transient memory between passes
+static RenderGraph renderGraph;
+static std::unique_ptr<VkRenderGraphExecutor> graphExecutor;
+
+// bindless mode (--bindless) replaces the descriptor sets above with one big heap
+static bool bindlessEnabled = false;
+static std::unique_ptr<BindlessHeap> bindlessHeap;
+static BindlessHandle uniformBufferHandles[MAX_FRAMES_IN_FLIGHT];
+
+// per-draw data for the bindless path, must match DrawHandles in vk_bindless.vert
+struct BindlessDrawConstants {
+    BindlessHandle uniformBuffer;
+};
 
 // layers we want
 static const char* const validationLayers[] = {
@@ -166,22 +363,6 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
     }
 }
 
-// helper to read a binary file
-static std::vector<char> readFile(const std::filesystem::path& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error(std::format("failed to open {}",filename.string()));
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    return buffer;
-}
-
 // figure out what swapchains are suported
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -197,7 +378,7 @@ void createInstance() {
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "No Engine",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0
+        .apiVersion = VK_API_VERSION_1_3     // descriptor indexing is core in 1.2, dynamic rendering in 1.3
     };
     VkInstanceCreateInfo instanceCreateInfo{
         .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
@@ -284,6 +465,19 @@ constexpr auto checkDeviceExtensionSupport = [](const VkPhysicalDevice device) -
     return requiredExtensions.empty();
 };
 
+// for extensions we can live without
+static bool hasDeviceExtension(const VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    return std::any_of(availableExtensions.begin(), availableExtensions.end(), [name](auto& extension) {
+        return strcmp(extension.extensionName, name) == 0;
+    });
+}
+
 
 constexpr auto querySwapChainSupport = [](const VkPhysicalDevice device) {
     // inquire surface capabilities
@@ -313,11 +507,155 @@ constexpr auto querySwapChainSupport = [](const VkPhysicalDevice device) {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> computeFamily;      // a compute-only family if there is one, otherwise graphics
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
 };
 
+// find a queue of the right family
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
+    QueueFamilyIndices indices;
+    // Logic to find queue family indices to populate struct with
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+    int i = 0;
+    for (const auto& queueFamily : queueFamilies) {
+        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            indices.graphicsFamily = i;
+        }
+        VkBool32 presentSupport = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (presentSupport) {
+            indices.presentFamily = i;
+        }
+        // a family without graphics is usually a separate hardware queue that runs alongside it
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.computeFamily = i;
+        }
+        i++;
+    }
+    if (!indices.computeFamily) {
+        indices.computeFamily = indices.graphicsFamily;
+    }
+    return indices;
+}
+
+// what we know about a GPU when picking one
+struct DeviceCandidate {
+    VkPhysicalDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::string uuid;
+    std::optional<uint64_t> score;      // empty if the device can't run the app at all
+};
+
+// formatted like 01234567-89ab-cdef-0123-456789abcdef, for --gpu
+std::string formatDeviceUUID(const uint8_t(&uuid)[VK_UUID_SIZE]) {
+    std::string result;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            result += '-';
+        }
+        result += std::format("{:02x}", uuid[i]);
+    }
+    return result;
+}
+
+// higher is better
+std::optional<uint64_t> scoreDevice(VkPhysicalDevice device, const VkPhysicalDeviceProperties& properties) {
+    // hard requirements first
+    auto queueFamilyData = findQueueFamilies(device);
+    if (!queueFamilyData.isComplete() || !checkDeviceExtensionSupport(device)) {
+        return std::nullopt;
+    }
+    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+    if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+        return std::nullopt;
+    }
+    // all synchronization is done with timeline semaphores, core since 1.2
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 features2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &timelineSemaphoreFeatures
+    };
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    if (properties.apiVersion < VK_API_VERSION_1_2 || !timelineSemaphoreFeatures.timelineSemaphore) {
+        return std::nullopt;
+    }
+
+    // the type dominates, everything else breaks ties between GPUs of the same kind
+    uint64_t score = 0;
+    switch (properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        score += 100000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        score += 50000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        score += 20000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:       // software rasterizers like lavapipe, still fine for CI
+        score += 10000;
+        break;
+    default:
+        break;
+    }
+
+    // more dedicated memory, 100 points per GiB of the biggest device local heap
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+    VkDeviceSize largestHeap = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            largestHeap = std::max(largestHeap, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+    score += std::min<uint64_t>(largestHeap >> 30, 64) * 100;
+
+    // presenting from the graphics queue avoids sharing images between queues,
+    // and separate compute or transfer families mean async work can overlap
+    if (queueFamilyData.graphicsFamily == queueFamilyData.presentFamily) {
+        score += 500;
+    }
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    for (const auto& queueFamily : queueFamilies) {
+        if (!(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & (VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT))) {
+            score += 250;
+            break;
+        }
+    }
+
+    // optional features we know how to use
+    bool dynamicRendering = properties.apiVersion >= VK_API_VERSION_1_3 || hasDeviceExtension(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    bool presentWait = hasDeviceExtension(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasDeviceExtension(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    if (dynamicRendering) {
+        score += 1000;
+    }
+    if (BindlessHeap::IsSupported(device)) {
+        score += 1000;
+    }
+    if (presentWait) {
+        score += 500;
+    }
+
+    // and finally limits, as a rough proxy for how capable the hardware is
+    score += properties.limits.maxImageDimension2D / 1024;
+    score += std::min<uint64_t>(properties.limits.maxComputeSharedMemorySize / 1024, 64);
+
+    return score;
+}
+
 QueueFamilyIndices selectPhysicalAndLogicalDevice() {
     // now select and configure a device
     uint32_t deviceCount = 0;
@@ -327,78 +665,161 @@ QueueFamilyIndices selectPhysicalAndLogicalDevice() {
     }
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-    // find a queue of the right family
-    
-    constexpr auto findQueueFamilies = [](VkPhysicalDevice device) -> QueueFamilyIndices {
-        QueueFamilyIndices indices;
-        // Logic to find queue family indices to populate struct with
 
-        uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    std::vector<DeviceCandidate> candidates;
+    for (auto device : devices) {
+        VkPhysicalDeviceIDProperties idProperties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES
+        };
+        VkPhysicalDeviceProperties2 properties2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &idProperties
+        };
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+        candidates.push_back({
+            .device = device,
+            .properties = properties2.properties,
+            .uuid = formatDeviceUUID(idProperties.deviceUUID),
+            .score = scoreDevice(device, properties2.properties)
+        });
+    }
 
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    std::cout << "GPUs:" << std::endl;
+    for (const auto& candidate : candidates) {
+        std::cout << std::format("  {} [{}] {}", candidate.properties.deviceName, candidate.uuid,
+            candidate.score ? std::format("score {}", *candidate.score) : std::string("unsuitable")) << std::endl;
+    }
 
-        int i = 0;
-        for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                indices.graphicsFamily = i;
+    // --gpu=<name or uuid> picks a specific device, for example a software ICD in CI
+    const DeviceCandidate* chosen = nullptr;
+    if (auto requested = CommandLine::GetValue("gpu")) {
+        constexpr auto toLower = [](std::string_view str) {
+            std::string result(str);
+            std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return result;
+        };
+        auto needle = toLower(*requested);
+        for (const auto& candidate : candidates) {
+            if (candidate.uuid == needle || toLower(candidate.properties.deviceName).find(needle) != std::string::npos) {
+                chosen = &candidate;
+                break;
             }
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-            if (presentSupport) {
-                indices.presentFamily = i;
+        }
+        if (chosen == nullptr) {
+            throw std::runtime_error(std::format("no GPU matches --gpu={}", *requested));
+        }
+        if (!chosen->score) {
+            throw std::runtime_error(std::format("{} can't run this app", chosen->properties.deviceName));
+        }
+    }
+    else {
+        for (const auto& candidate : candidates) {
+            if (candidate.score && (chosen == nullptr || *candidate.score > *chosen->score)) {
+                chosen = &candidate;
             }
-            i++;
         }
-        return indices;
-    };
-
-
-    constexpr auto isDeviceSuitable = [](const VkPhysicalDevice device) -> bool {
-        // look for all the features we want
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(device, &deviceProperties);
-
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+        if (chosen == nullptr) {
+            throw std::runtime_error("failed to find a suitable GPU!");
+        }
+    }
+    physicalDevice = chosen->device;
+    {
+        // print what gpu we are using
+        std::cout << std::format("GPU: {}\nDriver {}", chosen->properties.deviceName, chosen->properties.driverVersion) << std::endl;
+    }
 
-        auto queueFamilyData = findQueueFamilies(device);
+    // bindless is opt-in, and falls back to regular descriptor sets if the device can't do it
+    if (CommandLine::HasFlag("bindless")) {
+        bindlessEnabled = BindlessHeap::IsSupported(physicalDevice);
+        std::cout << (bindlessEnabled ? "Bindless descriptors enabled" : "Bindless descriptors not supported, using descriptor sets") << std::endl;
+    }
 
-        auto extensionsSupported = checkDeviceExtensionSupport(device);
+    // dynamic rendering is on by default, and falls back to render pass objects if the device can't do it
+    std::vector<const char*> enabledDeviceExtensions(std::begin(deviceExtensions), std::end(deviceExtensions));
+    bool dynamicRenderingIsCore = false;
+    if (!CommandLine::HasFlag("no-dynamic-rendering")) {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        dynamicRenderingIsCore = props.apiVersion >= VK_API_VERSION_1_3;
+        bool extensionAvailable = dynamicRenderingIsCore || hasDeviceExtension(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
-            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-            swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty() && swapChainAdequate;
+        if (extensionAvailable) {
+            VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingSupport{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+            };
+            VkPhysicalDeviceFeatures2 features2{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &dynamicRenderingSupport
+            };
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+            dynamicRenderingEnabled = dynamicRenderingSupport.dynamicRendering;
+        }
+        if (dynamicRenderingEnabled && !dynamicRenderingIsCore) {
+            enabledDeviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
         }
+    }
+    std::cout << (dynamicRenderingEnabled ? "Dynamic rendering enabled" : "Using render pass objects") << std::endl;
 
-        // right now we don't care so pick any gpu
-        // in the future implement a scoring system to pick the best device
-        return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && queueFamilyData.isComplete() && checkDeviceExtensionSupport(device);
+    // present wait lets the frame pacer see when frames actually reach the screen. It needs present ids to refer to them
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
     };
-    for (const auto& device : devices) {
-        if (isDeviceSuitable(device)) {
-            physicalDevice = device;
-            break;
-        }
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = &presentIdFeatures
+    };
+    if (hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &presentWaitFeatures
+        };
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        presentWaitEnabled = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
     }
-    if (physicalDevice == VK_NULL_HANDLE) {
-        throw std::runtime_error("failed to find a suitable GPU!");
+    if (presentWaitEnabled) {
+        enabledDeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        enabledDeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
     }
-    {
-        // print what gpu we are using
-        VkPhysicalDeviceProperties props;;
-        vkGetPhysicalDeviceProperties(physicalDevice, &props);
-        std::cout << std::format("GPU: {}\nDriver {}", props.deviceName, props.driverVersion) << std::endl;
+    std::cout << (presentWaitEnabled ? "Present wait enabled" : "Present wait not supported, latency isn't measured") << std::endl;
+
+    // the meshlet scene uses task and mesh shaders if it can, and falls back to pulling meshlets through a vertex shader
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    };
+    if (meshletInstances > 0 && !CommandLine::HasFlag("no-mesh-shaders") && hasDeviceExtension(physicalDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &meshShaderFeatures
+        };
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        meshShadersEnabled = meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+    }
+    if (meshShadersEnabled) {
+        enabledDeviceExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
+    if (meshletInstances > 0) {
+        std::cout << (meshShadersEnabled ? "Mesh shaders enabled" : "Mesh shaders not used, drawing meshlets with a vertex shader") << std::endl;
     }
 
     // next create the logical device and the queue
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+    // the particle simulation synchronizes with graphics through the queues' timelines
+    if (CommandLine::HasFlag("particles")) {
+        particlesEnabled = true;
+        if (CommandLine::HasFlag("no-async-compute")) {
+            indices.computeFamily = indices.graphicsFamily;
+        }
+        std::cout << std::format("Particles enabled, simulating on the {} queue", indices.computeFamily == indices.graphicsFamily ? "graphics" : "async compute") << std::endl;
+    }
+
     float queuePriority = 1.0f;     // required even if we only have one queue. Used to cooperatively schedule multiple queues
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (particlesEnabled) {
+        uniqueQueueFamilies.insert(indices.computeFamily.value());
+    }
 
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo{
@@ -409,13 +830,81 @@ QueueFamilyIndices selectPhysicalAndLogicalDevice() {
         };
         queueCreateInfos.push_back(queueCreateInfo);
     }
-    VkPhysicalDeviceFeatures deviceFeatures{};      // we don't yet need anything
+    VkPhysicalDeviceFeatures deviceFeatures{};
+    // the overdraw benchmark counts fragment shader invocations, where the device can
+    if (overdrawLayers > 0) {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery;
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    }
+    // the texture scene samples its far, slanted quads anisotropically where the device can
+    if (textureCount > 0) {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        samplerAnisotropyEnabled = supportedFeatures.samplerAnisotropy;
+        deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+        if (textureBlockFormat && !supportedFeatures.textureCompressionBC) {
+            std::cout << "The device can't sample BC formats, the texture scene uses RGBA8" << std::endl;
+            textureBlockFormat.reset();
+            textureStreaming = false;
+        }
+        if (textureStreaming && !bindlessEnabled) {
+            std::cout << "Texture streaming needs --bindless, disabled" << std::endl;
+            textureStreaming = false;
+        }
+        // the streamed shader reports the levels it wanted with atomicMin, from the fragment stage
+        if (textureStreaming && !supportedFeatures.fragmentStoresAndAtomics) {
+            std::cout << "Texture streaming needs fragment shader atomics, disabled, every texture keeps all its levels" << std::endl;
+            textureStreaming = false;
+        }
+        deviceFeatures.fragmentStoresAndAtomics = static_cast<VkBool32>(textureStreaming);
+        deviceFeatures.textureCompressionBC = static_cast<VkBool32>(textureBlockFormat.has_value());
+    }
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+    };
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+    };
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .timelineSemaphore = VK_TRUE        // required, device selection checked for it
+    };
+    // optional features get chained onto the create info
+    void* featureChain = &timelineSemaphoreFeatures;
+    if (bindlessEnabled) {
+        BindlessHeap::EnableFeatures(deviceFeatures, indexingFeatures);
+        indexingFeatures.pNext = featureChain;
+        featureChain = &indexingFeatures;
+    }
+    if (dynamicRenderingEnabled) {
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        dynamicRenderingFeatures.pNext = featureChain;
+        featureChain = &dynamicRenderingFeatures;
+    }
+    if (presentWaitEnabled) {
+        // already linked to each other, and filled in by the query above
+        presentIdFeatures.pNext = featureChain;
+        featureChain = &presentWaitFeatures;
+    }
+    if (meshShadersEnabled) {
+        // only what the scene uses, the query above may have found more
+        meshShaderFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+            .pNext = featureChain,
+            .taskShader = VK_TRUE,
+            .meshShader = VK_TRUE,
+        };
+        featureChain = &meshShaderFeatures;
+    }
     VkDeviceCreateInfo deviceCreateInfo{
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = featureChain,
         .queueCreateInfoCount = static_cast<decltype(VkDeviceCreateInfo::queueCreateInfoCount)>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),      // could pass an array here if we were making more than one queue
-        .enabledExtensionCount = ARRAYSIZE(deviceExtensions),             // device-specific extensions are ignored on later vulkan versions but we set it anyways
-        .ppEnabledExtensionNames = deviceExtensions,
+        .enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size()),             // device-specific extensions are ignored on later vulkan versions but we set it anyways
+        .ppEnabledExtensionNames = enabledDeviceExtensions.data(),
         .pEnabledFeatures = &deviceFeatures,
     };
     if constexpr (enableValidationLayers) {
@@ -427,11 +916,28 @@ QueueFamilyIndices selectPhysicalAndLogicalDevice() {
     VK_VALID(graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
     VK_VALID(presentQueue);
+    graphicsTimeline = std::make_unique<TimelineQueue>(device, graphicsQueue);
+    if (particlesEnabled) {
+        vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+        VK_VALID(computeQueue);
+        computeTimeline = std::make_unique<TimelineQueue>(device, computeQueue);
+    }
+
+    if (dynamicRenderingEnabled) {
+        cmdBeginRendering = (PFN_vkCmdBeginRendering)vkGetDeviceProcAddr(device, dynamicRenderingIsCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR");
+        cmdEndRendering = (PFN_vkCmdEndRendering)vkGetDeviceProcAddr(device, dynamicRenderingIsCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR");
+        VK_VALID(cmdBeginRendering);
+        VK_VALID(cmdEndRendering);
+    }
+    if (meshShadersEnabled) {
+        cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT");
+        VK_VALID(cmdDrawMeshTasks);
+    }
 
     return indices;
 }
 
-void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
+void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
     // setup surface
     constexpr auto chooseSwapSurfaceFormat = [](const std::vector<VkSurfaceFormatKHR>& availableFormats) -> VkSurfaceFormatKHR {
         // we want BGRA8 SRGB in nonlinear space
@@ -444,15 +950,6 @@ void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
         //otherwise hope the first one is good enough
         return availableFormats[0];
     };
-    constexpr auto chooseSwapPresentMode = [](const std::vector<VkPresentModeKHR>& availablePresentModes) -> VkPresentModeKHR {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;    // use Mailbox on high-perf devices
-            }
-        }
-
-        return VK_PRESENT_MODE_FIFO_KHR;        // otherwise use FIFO when on low-power devices, like a mobile phone
-    };
     auto chooseSwapExtent = [app](const VkSurfaceCapabilitiesKHR& capabilities) ->VkExtent2D {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
             return capabilities.currentExtent;
@@ -476,12 +973,32 @@ void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
     // configure the swap chain stuff
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = framePacer->ChoosePresentMode(swapChainSupport.presentModes);  // see --present-mode
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;  // we want one extra image than necessary to reduce latency (no waiting for the driver)
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    // capture copies out of the swapchain images, which they have to allow, and the writer reads 8-bit RGBA or BGRA
+    if (captureSettings && oldSwapchain == VK_NULL_HANDLE) {
+        bool copyable = swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        bool readable = surfaceFormat.format == VK_FORMAT_B8G8R8A8_SRGB || surfaceFormat.format == VK_FORMAT_B8G8R8A8_UNORM
+            || surfaceFormat.format == VK_FORMAT_R8G8B8A8_SRGB || surfaceFormat.format == VK_FORMAT_R8G8B8A8_UNORM;
+        if (copyable && readable) {
+            VkFrameCapture::Settings settings{
+                .writer = *captureSettings,
+                .every = captureEvery,
+                .framesInFlight = MAX_FRAMES_IN_FLIGHT,
+                .format = surfaceFormat.format
+            };
+            frameCapture = std::make_unique<VkFrameCapture>(physicalDevice, device, *deletionQueue, settings);
+        }
+        else {
+            std::cout << "The swapchain can't be captured, --capture disabled" << std::endl;
+            captureSettings.reset();
+        }
+    }
+
+    uint32_t imageCount = framePacer->ChooseImageCount(swapChainSupport.capabilities);          // see --swap-images
+    if (oldSwapchain == VK_NULL_HANDLE) {
+        std::cout << std::format("Present mode {}, {} swapchain images", FramePacer::GetPresentModeName(presentMode), imageCount) << std::endl;
     }
     VkSwapchainCreateInfoKHR swapchainCreateInfo{
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -491,12 +1008,13 @@ void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
         .imageColorSpace = surfaceFormat.colorSpace,
         .imageExtent = extent,
         .imageArrayLayers = 1,      // always 1 unless we are doing stereoscopic 3D
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,   // use VK_IMAGE_USAGE_TRANSFER_DST_BIT for offscreen rendering
+        // dynamic resolution blits into it, capture copies out of it
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (dynamicResolution ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0u) | (frameCapture ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0u),
         .preTransform = swapChainSupport.capabilities.currentTransform,
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = presentMode,
         .clipped = VK_TRUE,     // we don't care about pixels that are obscured
-        .oldSwapchain = VK_NULL_HANDLE  // future issue
+        .oldSwapchain = oldSwapchain    // lets the driver hand resources over, and retires the old one
     };
     uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
     if (indices.graphicsFamily != indices.presentFamily) {
@@ -511,6 +1029,7 @@ void setupSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
     }
 
     VK_CHECK(vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapChain));
+    deletionQueue->Track(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapChain);
     // remember these values
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
@@ -546,19 +1065,32 @@ void createSwapChainImageViews()
         }
         };
         VK_CHECK(vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]));
+        deletionQueue->Track(VK_OBJECT_TYPE_IMAGE_VIEW, swapChainImageViews[i]);
     }
 }
 
-void cleanupSwapChain() {
-    for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
-        vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
+void retireSwapChain(VkSwapchainKHR swapchain, const std::vector<VkImageView>& imageViews, const std::vector<VkFramebuffer>& framebuffers) {
+    // the views and framebuffers reference the swapchain's images, so they go first
+    for (auto framebuffer : framebuffers) {
+        deletionQueue->Retire(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffer);
     }
 
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+    for (auto imageView : imageViews) {
+        deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE_VIEW, imageView);
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    deletionQueue->Retire(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapchain);
+}
+
+void cleanupSwapChain() {
+    retireSwapChain(swapChain, swapChainImageViews, swapChainFramebuffers);
+    swapChainImageViews.clear();
+    swapChainFramebuffers.clear();
+    swapChain = VK_NULL_HANDLE;
+}
+
+void collectRetiredResources() {
+    deletionQueue->Collect();
 }
 
 
@@ -570,62 +1102,101 @@ void createRenderPass() {
         .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR  // see https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Render_passes (VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) for more info
+        // the render graph transitions the image into and out of the pass, so the layout doesn't change here
+        .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL  // see https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Render_passes for more info
+    };
+
+    // after a pre-pass the depth is already there, and only tested against
+    VkImageLayout depthLayout = depthPrepassEnabled ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkAttachmentDescription depthAttachment{
+        .format = depthFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = depthPrepassEnabled ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,   // nothing reads depth after the main pass
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = depthLayout,
+        .finalLayout = depthLayout
     };
+    VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
 
     //subpass
     VkAttachmentReference colorAttachmentRef{
         .attachment = 0,
         .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     };
+    VkAttachmentReference depthAttachmentRef{
+        .attachment = 1,
+        .layout = depthLayout
+    };
     VkSubpassDescription subpass{
         .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
         .colorAttachmentCount = 1,                  // for MRT bind the textures here
-        .pColorAttachments = &colorAttachmentRef
+        .pColorAttachments = &colorAttachmentRef,
+        .pDepthStencilAttachment = &depthAttachmentRef  // only ever one
     };
 
     // dependencies allow ensuring that passes execute at the right time
     VkSubpassDependency dependency{
         .srcSubpass = VK_SUBPASS_EXTERNAL,
         .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
         .srcAccessMask = 0,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
     };
 
     // full pass
     VkRenderPassCreateInfo renderPassInfo{
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &colorAttachment,
+        .attachmentCount = ARRAYSIZE(attachments),
+        .pAttachments = attachments,
         .subpassCount = 1,
         .pSubpasses = &subpass,
         .dependencyCount = 1,
         .pDependencies = &dependency
     };
     VK_CHECK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
+
+    if (!depthPrepassEnabled) {
+        return;
+    }
+    // the pre-pass clears depth, writes it, and leaves it for the main pass
+    VkAttachmentDescription prepassAttachment{
+        .format = depthFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+    VkAttachmentReference prepassAttachmentRef{
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+    VkSubpassDescription prepassSubpass{
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 0,
+        .pDepthStencilAttachment = &prepassAttachmentRef
+    };
+    VkRenderPassCreateInfo prepassInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &prepassAttachment,
+        .subpassCount = 1,
+        .pSubpasses = &prepassSubpass,
+    };
+    VK_CHECK(vkCreateRenderPass(device, &prepassInfo, nullptr, &depthPrepassRenderPass));
 }
 
 void createGraphicsPipeline() {
     // create the pipelines
-    auto vertShaderCode = readFile("vk.vert.spv");
-    auto fragShaderCode = readFile("vk.frag.spv");
-
-    constexpr auto createShaderModule = [](const std::vector<char>& code) -> VkShaderModule {
-        VkShaderModuleCreateInfo createInfo{
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-            .codeSize = code.size(),    // in bytes, not multiples of uint32
-            .pCode = reinterpret_cast<const uint32_t*>(code.data())
-        };
-        VkShaderModule shaderModule;
-        VK_CHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule));
-        return shaderModule;
-    };
-
-    vertShaderModule = createShaderModule(vertShaderCode);
-    fragShaderModule = createShaderModule(fragShaderCode);
+    // the bindless vertex shader fetches its uniforms out of the heap instead of a fixed binding
+    vertShaderModule = LoadShaderModule(device, bindlessEnabled ? "vk_bindless.vert.spv" : "vk.vert.spv");
+    fragShaderModule = LoadShaderModule(device, "vk.frag.spv");
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -744,6 +1315,16 @@ void createGraphicsPipeline() {
         .blendConstants = {0,0,0,0},        // optional
     };
 
+    // the triangle is flat at z = 0 and drawn over the scene, so it ignores depth
+    VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthCompareOp = VK_COMPARE_OP_GREATER,    // reverse-Z, closer is bigger
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+
     // piepline layout
     // here is were you declare uniforms
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{
@@ -753,11 +1334,33 @@ void createGraphicsPipeline() {
         .pushConstantRangeCount = 0,
         .pPushConstantRanges = nullptr
     };
+    // in bindless mode the only set is the heap, and each draw pushes the handles it needs
+    VkDescriptorSetLayout bindlessSetLayout = bindlessEnabled ? bindlessHeap->GetLayout() : VK_NULL_HANDLE;
+    VkPushConstantRange bindlessPushConstants{
+        .stageFlags = VK_SHADER_STAGE_ALL,
+        .offset = 0,
+        .size = sizeof(BindlessDrawConstants)
+    };
+    if (bindlessEnabled) {
+        pipelineLayoutInfo.pSetLayouts = &bindlessSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &bindlessPushConstants;
+    }
     VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+    deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout);
+
+    // with dynamic rendering the pipeline only needs the attachment formats, not a compatible render pass
+    VkPipelineRenderingCreateInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &swapChainImageFormat,
+        .depthAttachmentFormat = depthFormat,
+    };
 
     // create the pipeline object
     VkGraphicsPipelineCreateInfo pipelineInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = dynamicRenderingEnabled ? &renderingInfo : nullptr,
         .stageCount = 2,
         .pStages = shaderStages,
         .pVertexInputState = &vertexInputInfo,
@@ -765,7 +1368,7 @@ void createGraphicsPipeline() {
         .pViewportState = &viewportState,
         .pRasterizationState = &rasterizer,
         .pMultisampleState = &multisampling,
-        .pDepthStencilState = nullptr,
+        .pDepthStencilState = &depthStencil,
         .pColorBlendState = &colorBlending,
         .pDynamicState = &dynamicState,
         .layout = pipelineLayout,
@@ -775,167 +1378,494 @@ void createGraphicsPipeline() {
         .basePipelineIndex = -1 // optional
     };
     VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline));
+    deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE, graphicsPipeline);
 }
 
 void createFramebuffers(){
     swapChainFramebuffers.resize(swapChainImageViews.size());
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         VkImageView attachments[] = {
-            swapChainImageViews[i]
+            swapChainImageViews[i],
+            depthImageView      // shared, only one frame renders at a time
         };
 
         VkFramebufferCreateInfo framebufferInfo{
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass = renderPass,
-            .attachmentCount = 1,
+            .attachmentCount = ARRAYSIZE(attachments),
             .pAttachments = attachments,
             .width = swapChainExtent.width,
             .height = swapChainExtent.height,
             .layers = 1
         };
         VK_CHECK(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]));
+        deletionQueue->Track(VK_OBJECT_TYPE_FRAMEBUFFER, swapChainFramebuffers[i]);
     }
 }
 
 void createCommandPool(const QueueFamilyIndices& queueFamilyIndices) {
-    VkCommandPoolCreateInfo poolInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,       // use this value if we want to write over the command buffer (ie for generating it every frame)
-        .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()
-    };
-    VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool));
+    // command buffers are recorded fresh every frame, and their pools recycled once the GPU is done with them
+    graphicsCommands = std::make_unique<CommandBufferPool>(device, queueFamilyIndices.graphicsFamily.value(), *graphicsTimeline);
 };
 
 uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    // find a memory type suitable for the buffer
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        // needs to have the right support
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+    return FindMemoryType(physicalDevice, typeFilter, properties);
+}
+
+VkFormat findDepthFormat() {
+    // 32 bit float first, reverse-Z gains little with a fixed point format. Every device supports at least one of these
+    constexpr VkFormat candidates[] = {
+        VK_FORMAT_D32_SFLOAT,
+        VK_FORMAT_D32_SFLOAT_S8_UINT,
+        VK_FORMAT_X8_D24_UNORM_PACK32,
+        VK_FORMAT_D24_UNORM_S8_UINT,
+        VK_FORMAT_D16_UNORM,
+    };
+    for (auto format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
         }
     }
+    throw std::runtime_error("failed to find a depth format");
+}
 
-    throw std::runtime_error("failed to find suitable memory type!");
+VkImageAspectFlags depthAspect() {
+    // views of combined formats used as attachments have to include the stencil too
+    bool hasStencil = depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+    return VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
 }
 
-void createVertexBuffer() {
-    VkBufferCreateInfo bufferInfo{
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = sizeof(vertices),
-        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,  // could have multiple here if the buffer was used in multiple different stages
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,    // only the Graphics queue is using this
+// the depth buffer matches the swapchain, call again whenever it is recreated
+void createDepthResources() {
+    // occlusion culling samples it to build the depth pyramid
+    bool depthPyramidNeeded = occlusionObjects > 0 && !cpuOcclusion;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (depthPyramidNeeded ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = depthFormat,
+        .extent = { swapChainExtent.width, swapChainExtent.height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED      // the render graph transitions it every frame
     };
-    VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &vertexBuffer));
+    VK_CHECK(vkCreateImage(device, &imageInfo, nullptr, &depthImage));
+    deletionQueue->Track(VK_OBJECT_TYPE_IMAGE, depthImage);
 
-    // the buffer doesn't have any memory assigned yet, so now we assign some
     VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, vertexBuffer, &memRequirements);
-
-    // prepare to allocate the memory
+    vkGetImageMemoryRequirements(device, depthImage, &memRequirements);
     VkMemoryAllocateInfo allocInfo{
         .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
         .allocationSize = memRequirements.size,
-        // note that the data might not be on the GPU if we don't use VK_MEMORY_PROPERTY_HOST_COHERENT_BIT. This bit may decrease performance but not in a meaningful way.
-        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &depthImageMemory));
+    deletionQueue->Track(VK_OBJECT_TYPE_DEVICE_MEMORY, depthImageMemory);
+    vkBindImageMemory(device, depthImage, depthImageMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = depthImage,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = depthFormat,
+        .subresourceRange{
+            .aspectMask = depthAspect(),
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
     };
-    // allocate it
-    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &vertexBufferMemory));
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &depthImageView));
+    deletionQueue->Track(VK_OBJECT_TYPE_IMAGE_VIEW, depthImageView);
 
-    // associate it with the buffer
-    vkBindBufferMemory(device, vertexBuffer, vertexBufferMemory, 0);
+    // the pre-pass only has the depth attachment, so it gets a framebuffer of its own
+    if (depthPrepassRenderPass != VK_NULL_HANDLE) {
+        VkFramebufferCreateInfo framebufferInfo{
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = depthPrepassRenderPass,
+            .attachmentCount = 1,
+            .pAttachments = &depthImageView,
+            .width = swapChainExtent.width,
+            .height = swapChainExtent.height,
+            .layers = 1
+        };
+        VK_CHECK(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &depthPrepassFramebuffer));
+        deletionQueue->Track(VK_OBJECT_TYPE_FRAMEBUFFER, depthPrepassFramebuffer);
+    }
 
-    // fill the buffer with data
-    void* data;
-    vkMapMemory(device, vertexBufferMemory, 0, bufferInfo.size, 0, &data);
-    memcpy(data, vertices, (size_t)bufferInfo.size);
-    vkUnmapMemory(device, vertexBufferMemory);
+    for (auto& scene : scenes) {
+        scene->CreateTargets(depthImage, swapChainExtent);
+    }
+}
 
+// frames in flight may still be using the old depth buffer, so it goes through the deletion queue like the swapchain
+void retireDepthResources() {
+    deletionQueue->Retire(VK_OBJECT_TYPE_FRAMEBUFFER, depthPrepassFramebuffer);
+    deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE_VIEW, depthImageView);
+    deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE, depthImage);
+    deletionQueue->Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, depthImageMemory);
+    depthPrepassFramebuffer = VK_NULL_HANDLE;
+    depthImageView = VK_NULL_HANDLE;
+    depthImage = VK_NULL_HANDLE;
+    depthImageMemory = VK_NULL_HANDLE;
+
+    for (auto& scene : scenes) {
+        scene->RetireTargets();
+    }
 }
 
-void createCommandBuffer() {
-    // setup creating the command buffer
-    VkCommandBufferAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = commandPool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
+void createRHIDevice(const QueueFamilyIndices& indices) {
+    VkRHIDevice::Settings settings{
+        .physicalDevice = physicalDevice,
+        .device = device,
+        .queue = graphicsTimeline.get(),
+        .queueFamilyIndex = indices.graphicsFamily.value(),
+        .cmdBeginRendering = cmdBeginRendering,
+        .cmdEndRendering = cmdEndRendering,
+        .renderPass = renderPass,       // its pipelines are drawn in the main pass
     };
-    VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer));
+    if (particlesEnabled) {
+        settings.sharedWith.push_back(indices.computeFamily.value());     // the particles are simulated there
+    }
+    rhiDevice = std::make_unique<VkRHIDevice>(settings);
 }
 
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
-    // start recording commands
-    VkCommandBufferBeginInfo beginInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = 0,
-        .pInheritanceInfo = nullptr,
-    };
-    VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+void createVertexBuffer() {
+    // host visible, so it's written straight from here. It's small enough that reading it over PCIe doesn't matter
+    vertexBuffer = rhiDevice->CreateBuffer({
+        .size = sizeof(vertices),
+        .usage = RHIBufferUsage::Vertex,
+        .hostVisible = true
+    });
+    rhiDevice->WriteBuffer(vertexBuffer, 0, std::as_bytes(std::span(vertices)));
+}
 
-    // setup the pass
-    VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+// depth-only pass over the opaque geometry, so the main pass shades each pixel once
+void recordDepthPrepass(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+    VkClearValue clearDepth{ .depthStencil = { 0.0f, 0 } };     // reverse-Z, 0 is infinitely far away
+    if (dynamicRenderingEnabled) {
+        VkRenderingAttachmentInfo depthAttachment{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+            .imageView = depthImageView,
+            .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .clearValue = clearDepth,
+        };
+        VkRenderingInfo renderingInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+            .renderArea = {
+                .offset = {0, 0},
+                .extent = extent
+            },
+            .layerCount = 1,
+            .colorAttachmentCount = 0,
+            .pDepthAttachment = &depthAttachment,
+        };
+        cmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+    else {
+        VkRenderPassBeginInfo renderPassInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = depthPrepassRenderPass,
+            .framebuffer = depthPrepassFramebuffer,
+            .renderArea = {
+                .offset = {0, 0},
+                .extent = extent
+            },
+            .clearValueCount = 1,
+            .pClearValues = &clearDepth,
+        };
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
 
-    VkRenderPassBeginInfo renderPassInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = renderPass,
-        .framebuffer = swapChainFramebuffers[imageIndex],
-        .renderArea = {
-            .offset = {0, 0},
-            .extent = swapChainExtent
-        },
-        .clearValueCount = 1,
-        .pClearValues = &clearColor,
+    SetViewportAndScissor(commandBuffer, extent);
+    for (auto& scene : scenes) {
+        scene->RecordDepthPrepass(commandBuffer, currentFrame, extent);
+    }
+
+    if (dynamicRenderingEnabled) {
+        cmdEndRendering(commandBuffer);
+    }
+    else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+// draw the scene into target, which is extent big. framebuffer is only used without dynamic rendering
+void recordMainPass(VkCommandBuffer commandBuffer, VkImageView target, VkFramebuffer framebuffer, VkExtent2D extent) {
+    // setup the pass
+    VkClearValue clearValues[] = {
+        { .color = {{0.0f, 0.0f, 0.0f, 1.0f}} },
+        { .depthStencil = { 0.0f, 0 } }     // reverse-Z, 0 is infinitely far away
     };
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (dynamicRenderingEnabled) {
+        // the attachments are described inline, the render graph has already put the images in these layouts
+        VkRenderingAttachmentInfo colorAttachment{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+            .imageView = target,
+            .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .loadOp = occlusionObjects > 0 ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,   // on top of the occlusion scene
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .clearValue = clearValues[0],
+        };
+        // after a pre-pass depth is only tested against. Nothing reads it after this pass either way
+        VkRenderingAttachmentInfo depthAttachment{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+            .imageView = depthImageView,
+            .imageLayout = depthPrepassEnabled ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .loadOp = depthPrepassEnabled || occlusionObjects > 0 ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .clearValue = clearValues[1],
+        };
+        VkRenderingInfo renderingInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+            .renderArea = {
+                .offset = {0, 0},
+                .extent = extent
+            },
+            .layerCount = 1,
+            .colorAttachmentCount = 1,
+            .pColorAttachments = &colorAttachment,
+            .pDepthAttachment = &depthAttachment,
+        };
+        cmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+    else {
+        VkRenderPassBeginInfo renderPassInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = renderPass,
+            .framebuffer = framebuffer,
+            .renderArea = {
+                .offset = {0, 0},
+                .extent = extent
+            },
+            .clearValueCount = ARRAYSIZE(clearValues),
+            .pClearValues = clearValues,
+        };
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    SetViewportAndScissor(commandBuffer, extent);
+
+    // opaque geometry first
+    for (auto& scene : scenes) {
+        scene->Record(commandBuffer, currentFrame, extent);
+    }
 
     // drawing commands
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-    // associate vertex data
-    VkBuffer vertexBuffers[] = { vertexBuffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    // associate vertex data. The triangle's pipeline is bound directly, as the RHI has no descriptors yet
+    VkRHICommandList rhiCommands(*rhiDevice, commandBuffer);
+    rhiCommands.SetVertexBuffer(vertexBuffer, 0);
 
-    // the dynamic properties we have to set (that we declared earlier as dynamic)
-    VkViewport viewport{
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>(swapChainExtent.width),
-        .height = static_cast<float>(swapChainExtent.height),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f
+    if (bindlessEnabled) {
+        // the heap is bound once, draws only differ by the handles they push
+        bindlessHeap->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout);
+        BindlessDrawConstants drawConstants{
+            .uniformBuffer = uniformBufferHandles[currentFrame]
+        };
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(drawConstants), &drawConstants);
+    }
+    else {
+        // the allocator hands back the same set every time these resources are bound
+        DescriptorAllocator::Binding bindings[] = {
+            DescriptorAllocator::Binding::Buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[currentFrame], 0, sizeof(UniformBufferObject))
+        };
+        auto descriptorSet = descriptorAllocator->GetDescriptorSet(descriptorSetLayout, bindings);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    }
+    for (uint32_t i = 0; i < global_app->drawsPerFrame; i++) {
+        rhiCommands.Draw(ARRAYSIZE(vertices), 1, 0);
+    }
+
+    if (particlesEnabled) {
+        // the compute queue has already written this frame's buffer, the submit waits for it
+        rhiCommands.SetPipeline(particleGraphicsPipeline);
+        rhiCommands.SetVertexBuffer(particleBuffers[particleDrawIndex], 0);
+        rhiCommands.Draw(PARTICLE_COUNT, 1, 0);
+    }
+
+    if (dynamicRenderingEnabled) {
+        cmdEndRendering(commandBuffer);
+    }
+    else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+void recordUpscale(VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent, VkImage destination, VkExtent2D destinationExtent) {
+    // a linear filtered blit is the simplest possible upscaler, a better one would be a shader pass here
+    VkImageBlit region{
+        .srcSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .srcOffsets = { {0, 0, 0}, {static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height), 1} },
+        .dstSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .dstOffsets = { {0, 0, 0}, {static_cast<int32_t>(destinationExtent.width), static_cast<int32_t>(destinationExtent.height), 1} },
     };
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+}
 
-    VkRect2D scissor{
-        .offset = {0, 0},
-        .extent = swapChainExtent
+// commandBuffer has already begun recording, and is ended when it's submitted
+void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    if (timestampQueryPool) {
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, currentFrame * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, currentFrame * 2);
+    }
+
+    // describe the frame, the graph works out the barriers between passes
+    renderGraph.Reset(frameArenas->GetResource());
+    RenderGraph::TextureDesc backbufferDesc{
+        .width = swapChainExtent.width,
+        .height = swapChainExtent.height,
+        .format = static_cast<uint32_t>(swapChainImageFormat)
+    };
+    // the old contents don't matter, and it has to end up ready for presentation
+    auto backbuffer = renderGraph.ImportTexture("backbuffer", backbufferDesc, ResourceState::Undefined, ResourceState::Present);
+    graphExecutor->BindImported(backbuffer, swapChainImages[imageIndex], swapChainImageViews[imageIndex]);
+
+    // depth is cleared every frame, so its old contents don't matter either
+    RenderGraph::TextureDesc depthDesc{
+        .width = swapChainExtent.width,
+        .height = swapChainExtent.height,
+        .format = static_cast<uint32_t>(depthFormat)
     };
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    auto depth = renderGraph.ImportTexture("depth", depthDesc, ResourceState::Undefined, ResourceState::DepthAttachment);
+    graphExecutor->BindImported(depth, depthImage, depthImageView);
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-    vkCmdDraw(commandBuffer, ARRAYSIZE(vertices), 1, 0, 0);
+    // the main pass writes depth itself, or tests against what the pre-pass wrote
+    auto useDepth = [depth](RenderGraph::PassBuilder& pass) {
+        if (depthPrepassEnabled) {
+            pass.Read(depth, ResourceState::DepthRead);
+        }
+        else {
+            pass.Write(depth, ResourceState::DepthAttachment);
+        }
+    };
+    VkExtent2D sceneExtent = swapChainExtent;
+
+    if (dynamicResolution) {
+        // the scene target is always swapchain sized and only the corner of it is rendered to,
+        // so changing the scale never reallocates anything
+        VkExtent2D renderExtent{
+            .width = dynamicResolution->Scale(swapChainExtent.width),
+            .height = dynamicResolution->Scale(swapChainExtent.height)
+        };
+        sceneExtent = renderExtent;
+        auto scene = renderGraph.CreateTexture("scene", backbufferDesc);
+
+        if (depthPrepassEnabled) {
+            renderGraph.AddPass("depth prepass",
+                [&](RenderGraph::PassBuilder& pass) {
+                    pass.Write(depth, ResourceState::DepthAttachment);
+                },
+                [&] {
+                    recordDepthPrepass(commandBuffer, renderExtent);
+                }
+            );
+        }
+        renderGraph.AddPass("main",
+            [&](RenderGraph::PassBuilder& pass) {
+                pass.Write(scene, ResourceState::ColorAttachment);
+                useDepth(pass);
+            },
+            [&] {
+                recordMainPass(commandBuffer, graphExecutor->GetImageView(scene), VK_NULL_HANDLE, renderExtent);
+            }
+        );
+        renderGraph.AddPass("upscale",
+            [&](RenderGraph::PassBuilder& pass) {
+                pass.Read(scene, ResourceState::TransferSrc);
+                pass.Write(backbuffer, ResourceState::TransferDst);
+            },
+            [&] {
+                recordUpscale(commandBuffer, graphExecutor->GetImage(scene), renderExtent, swapChainImages[imageIndex], swapChainExtent);
+            }
+        );
+    }
+    else {
+        VkScene::Targets targets{
+            .color = backbuffer,
+            .colorView = swapChainImageViews[imageIndex],
+            .depth = depth,
+            .depthView = depthImageView,
+            .extent = swapChainExtent
+        };
+        for (auto& scene : scenes) {
+            scene->AddPasses(renderGraph, *graphExecutor, commandBuffer, currentFrame, targets);
+        }
+        if (depthPrepassEnabled) {
+            renderGraph.AddPass("depth prepass",
+                [&](RenderGraph::PassBuilder& pass) {
+                    pass.Write(depth, ResourceState::DepthAttachment);
+                },
+                [&] {
+                    recordDepthPrepass(commandBuffer, swapChainExtent);
+                }
+            );
+        }
+        renderGraph.AddPass("main",
+            [&](RenderGraph::PassBuilder& pass) {
+                pass.Write(backbuffer, ResourceState::ColorAttachment);
+                useDepth(pass);
+            },
+            [&] {
+                auto framebuffer = dynamicRenderingEnabled ? VK_NULL_HANDLE : swapChainFramebuffers[imageIndex];
+                recordMainPass(commandBuffer, swapChainImageViews[imageIndex], framebuffer, swapChainExtent);
+            }
+        );
+    }
 
-    vkCmdEndRenderPass(commandBuffer);
+    if (frameCapture) {
+        frameCapture->AddPass(renderGraph, commandBuffer, currentFrame, backbuffer, swapChainImages[imageIndex], swapChainExtent);
+    }
 
-    VK_CHECK(vkEndCommandBuffer(commandBuffer));
+    renderGraph.Compile();
+    graphExecutor->Realize(renderGraph);
+
+    for (auto& scene : scenes) {
+        scene->BeginFrame(commandBuffer, currentFrame);
+    }
+    graphExecutor->Execute(renderGraph, commandBuffer);
+    for (auto& scene : scenes) {
+        scene->EndFrame(commandBuffer, currentFrame, sceneExtent);
+    }
+
+    if (timestampQueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, currentFrame * 2 + 1);
+        timestampsWritten[currentFrame] = true;
+    }
 }
 
 void createSyncObjects() {
+    // frames are tracked on the graphics timeline, only acquire and present still need binary semaphores.
+    // frameFenceValues starts at 0, which the timeline has already reached, so the first frames don't wait
     VkSemaphoreCreateInfo semaphoreInfo{
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
     };
-    VkFenceCreateInfo fenceInfo{
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT       // create it already signaled, so that we won't block forever waiting for a render that won't happen on the first call to drawFrame
-    };
-    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore));
-    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore));
-    VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence));
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]));
+        VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]));
+    }
 }
 
 void recreateSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
@@ -947,17 +1877,40 @@ void recreateSwapChain(VkApp* app, const QueueFamilyIndices& indices) {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device);
+    auto start = std::chrono::steady_clock::now();
 
-    cleanupSwapChain();
+    if (blockingResize) {
+        vkDeviceWaitIdle(device);
+        cleanupSwapChain();
+        deletionQueue->Flush();
+        setupSwapChain(app, indices);
+    }
+    else {
+        // frames already in flight keep using the old images, so don't wait for them
+        auto oldSwapChain = swapChain;
+        auto oldImageViews = std::move(swapChainImageViews);
+        auto oldFramebuffers = std::move(swapChainFramebuffers);
+        swapChainImageViews.clear();
+        swapChainFramebuffers.clear();
+        setupSwapChain(app, indices, oldSwapChain);
+        retireSwapChain(oldSwapChain, oldImageViews, oldFramebuffers);
+    }
 
-    setupSwapChain(app, indices);
+    // after the framebuffers that use it have been retired
+    retireDepthResources();
+    createDepthResources();
     createSwapChainImageViews();
-    createFramebuffers();
+    if (!dynamicRenderingEnabled) {
+        createFramebuffers();   // nothing to rebuild with dynamic rendering
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    resizeStats.count++;
+    resizeStats.totalMs += ms;
+    resizeStats.worstMs = std::max(resizeStats.worstMs, ms);
 }
 
 static QueueFamilyIndices global_indices;
-static VkApp* global_app = nullptr;
 
 // for uniform buffers
 void createDescriptorSetLayout() {
@@ -980,122 +1933,579 @@ void createDescriptorSetLayout() {
     VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout));
 }
 
-// some of this is duplicated from the Vertex Buffer creation process
-void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-    VkBufferCreateInfo bufferInfo{
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = size,
-        .usage = usage,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
-    };
+void createUniformBuffers() {
+    constexpr VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    // the bindless heap stores buffers as storage buffers
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | (bindlessEnabled ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0);
+    // one per frame in flight, so we never write to a buffer the GPU is still reading
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        CreateBuffer(physicalDevice, device, *deletionQueue, bufferSize, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            uniformBuffers[i], uniformBufferMemories[i]);
+        vkMapMemory(device, uniformBufferMemories[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+    }
+}
 
-    VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer));
+void updateUniformBuffer() {
+    // note that small data should be transmitted via pushconstants rather than a buffer
+    ubo.time++;
+    memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+}
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+void createDescriptorAllocator() {
+    // sets are allocated on demand while recording, see recordCommandBuffer
+    descriptorAllocator = std::make_unique<DescriptorAllocator>(device, MAX_FRAMES_IN_FLIGHT);
+}
 
-    VkMemoryAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)
-    };
+void createBindlessHeap() {
+    // as many slots as the scene registers, which the heap clamps to what the device allows. A streamed texture
+    // can be replaced twice a frame (evicted and promoted), and each replaced slot is only released once the
+    // frames using it are done
+    uint32_t maxBuffers = MAX_FRAMES_IN_FLIGHT;
+    uint32_t maxImages = textureCount * (textureStreaming ? 2 * MAX_FRAMES_IN_FLIGHT + 3 : 1);
+    bindlessHeap = std::make_unique<BindlessHeap>(physicalDevice, device, maxBuffers, maxImages);
+}
 
+void registerBindlessResources() {
+    // replaces createDescriptorPool + createDescriptorSets
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        uniformBufferHandles[i] = bindlessHeap->RegisterBuffer(uniformBuffers[i], 0, sizeof(UniformBufferObject));
+    }
+}
 
-    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory))
+FramePacer::Settings parseFramePacingSettings() {
+    FramePacer::Settings settings;
+    if (auto mode = CommandLine::GetValue("present-mode")) {
+        for (auto candidate : { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR }) {
+            if (*mode == FramePacer::GetPresentModeName(candidate)) {
+                settings.presentMode = candidate;
+            }
+        }
+        if (!settings.presentMode) {
+            std::cout << std::format("Unknown present mode {}, expected immediate, mailbox, fifo or fifo-relaxed", *mode) << std::endl;
+        }
+    }
+    settings.imageCount = CommandLine::GetValue("swap-images", settings.imageCount);
+    // --low-latency only lets one frame queue up, and starts each frame just in time for its display slot
+    if (CommandLine::HasFlag("low-latency")) {
+        settings.maxQueuedFrames = 1;
+        settings.lowLatencySleep = true;
+    }
+    settings.maxQueuedFrames = CommandLine::GetValue("max-queued-frames", settings.maxQueuedFrames);
+    if (!presentWaitEnabled && (settings.lowLatencySleep || CommandLine::GetValue("max-queued-frames"))) {
+        std::cout << "Frame pacing needs present wait, frames are only limited by the swapchain and the frames in flight" << std::endl;
+    }
+    latencyReportEnabled = CommandLine::HasFlag("latency-report");
+    if (latencyReportEnabled && !presentWaitEnabled) {
+        std::cout << "--latency-report needs present wait, nothing to report" << std::endl;
+        latencyReportEnabled = false;
+    }
+    return settings;
+}
 
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+void createTimestampQueries(const QueueFamilyIndices& indices) {
+    // a begin and end timestamp around each frame's commands, on each queue that supports them
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // queues on one device share a clock, only how many bits of it are valid can differ.
+    // Use the narrowest so timestamps from both queues can be compared
+    timestampValidBits = queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+    uint32_t computeValidBits = particlesEnabled ? queueFamilies[indices.computeFamily.value()].timestampValidBits : 0;
+    if (timestampValidBits == 0) {
+        return;
+    }
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    timestampPeriod = props.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryPoolInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = MAX_FRAMES_IN_FLIGHT * 2,
+    };
+    VK_CHECK(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool));
+    if (computeValidBits != 0) {
+        timestampValidBits = std::min(timestampValidBits, computeValidBits);
+        VK_CHECK(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &computeTimestampQueryPool));
+    }
 }
 
-void createUniformBuffers() {
-    constexpr VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferMemory);
-    vkMapMemory(device, uniformBufferMemory, 0, bufferSize, 0, &uniformBufferMapped);
+void setupDynamicResolution() {
+    if (!CommandLine::HasFlag("dynres")) {
+        return;
+    }
+    // the scene target changes size every frame, which would mean a framebuffer per size without dynamic rendering
+    if (!dynamicRenderingEnabled) {
+        std::cout << "Dynamic resolution needs dynamic rendering, disabled" << std::endl;
+        return;
+    }
+    // GPU frame time comes from the timestamps around each frame
+    if (timestampQueryPool == VK_NULL_HANDLE) {
+        std::cout << "Graphics queue has no timestamps, dynamic resolution disabled" << std::endl;
+        return;
+    }
+
+    // --frame-budget=<ms> and --dynres-min=<scale> tune the controller
+    DynamicResolution::Settings settings;
+    settings.budgetMs = CommandLine::GetValue("frame-budget", settings.budgetMs);
+    settings.minScale = CommandLine::GetValue("dynres-min", settings.minScale);
+    dynamicResolution = std::make_unique<DynamicResolution>(settings);
+    std::cout << std::format("Dynamic resolution enabled, {:.1f} ms budget, down to {:.0f}% scale", settings.budgetMs, settings.minScale * 100) << std::endl;
 }
 
-void updateUniformBuffer() {
-    // note that small data should be transmitted via pushconstants rather than a buffer
-    ubo.time++;
-    memcpy(uniformBufferMapped, &ubo, sizeof(ubo));
+// turns --occlusion back off if something it relies on is missing
+void setupOcclusionCulling() {
+    if (occlusionObjects == 0) {
+        return;
+    }
+    // the scene's passes begin rendering themselves, and the main pass loads what they drew
+    if (!dynamicRenderingEnabled) {
+        std::cout << "Occlusion culling needs dynamic rendering, disabled" << std::endl;
+        occlusionObjects = 0;
+        return;
+    }
+    // the pyramid and the culling shader assume the scene covers the whole depth buffer
+    if (dynamicResolution) {
+        std::cout << "Occlusion culling doesn't support dynamic resolution, disabled" << std::endl;
+        occlusionObjects = 0;
+        return;
+    }
+    // the main pass would only test against the pre-pass's depth, not the occlusion scene's
+    if (depthPrepassEnabled) {
+        std::cout << "Occlusion culling doesn't combine with the depth pre-pass, disabled" << std::endl;
+        occlusionObjects = 0;
+        return;
+    }
+    // culling on the CPU doesn't need the depth pyramid
+    if (cpuOcclusion) {
+        return;
+    }
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &properties);
+    if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        std::cout << "Depth format can't be sampled, occlusion culling disabled" << std::endl;
+        occlusionObjects = 0;
+    }
+}
+
+// called once the fence for this frame slot has been waited on, so its timestamps are ready.
+// Compute for this frame is done too, since graphics waited for it
+void readTimestamps() {
+    // only the low timestampValidBits bits count, so differences have to wrap at that width
+    uint64_t mask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+    auto toMs = [](uint64_t ticks) {
+        return ticks * timestampPeriod / 1e6;
+    };
+    auto readQueries = [](VkQueryPool pool, uint64_t(&timestamps)[2]) {
+        return vkGetQueryPoolResults(device, pool, currentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    };
+
+    uint64_t graphicsTimestamps[2];
+    bool haveGraphics = timestampsWritten[currentFrame] && readQueries(timestampQueryPool, graphicsTimestamps);
+    timestampsWritten[currentFrame] = false;
+    if (!haveGraphics) {
+        return;
+    }
+    double graphicsMs = toMs((graphicsTimestamps[1] - graphicsTimestamps[0]) & mask);
+    if (dynamicResolution) {
+        dynamicResolution->Update(graphicsMs);
+    }
+    for (auto& scene : scenes) {
+        scene->AddGpuTime(currentFrame, graphicsMs);
+    }
+
+    uint64_t computeTimestamps[2];
+    if (computeTimestampsWritten[currentFrame] && readQueries(computeTimestampQueryPool, computeTimestamps)) {
+        // compute for this frame only has to wait for graphics two frames ago, so it runs alongside the previous frame's graphics
+        auto& previous = lastGraphicsTimestamps;
+        uint64_t overlapStart = std::max(computeTimestamps[0] & mask, previous[0] & mask);
+        uint64_t overlapEnd = std::min(computeTimestamps[1] & mask, previous[1] & mask);
+
+        queueTimingStats.frames++;
+        queueTimingStats.graphicsMs += graphicsMs;
+        queueTimingStats.computeMs += toMs((computeTimestamps[1] - computeTimestamps[0]) & mask);
+        queueTimingStats.overlapMs += overlapEnd > overlapStart ? toMs(overlapEnd - overlapStart) : 0;
+    }
+    computeTimestampsWritten[currentFrame] = false;
+    lastGraphicsTimestamps[0] = graphicsTimestamps[0];
+    lastGraphicsTimestamps[1] = graphicsTimestamps[1];
 }
 
-void createDescriptorPool() {
-    // for constant (uniform) buffers
+void createParticles(const QueueFamilyIndices& indices) {
+    // start with particles scattered over the screen, moving in random directions
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Particle> particles(PARTICLE_COUNT);
+    for (auto& particle : particles) {
+        particle.position = { unit(rng), unit(rng) };
+        particle.velocity = glm::vec2(unit(rng), unit(rng)) * 0.25f;
+        particle.color = { 0.5f + unit(rng) * 0.5f, 0.5f + unit(rng) * 0.5f, 1.0f, 1.0f };
+    }
+
+    // written by compute and read as vertices by graphics, the RHI device shares its buffers with the compute family
+    constexpr VkDeviceSize bufferSize = sizeof(Particle) * PARTICLE_COUNT;
+    for (uint32_t i = 0; i < 2; i++) {
+        particleBuffers[i] = rhiDevice->CreateBuffer({
+            .size = bufferSize,
+            .usage = RHIBufferUsage::Vertex | RHIBufferUsage::Storage,
+            .hostVisible = true
+        });
+        rhiDevice->WriteBuffer(particleBuffers[i], 0, std::as_bytes(std::span(particles)));
+    }
+
+    // binding 0 is last frame's particles, binding 1 is where this frame's go
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        },
+        {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        }
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = ARRAYSIZE(bindings),
+        .pBindings = bindings
+    };
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &particleSetLayout));
+
+    // the two sets never change, so they get their own little pool
     VkDescriptorPoolSize poolSize{
-        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = 1,
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 4
     };
     VkDescriptorPoolCreateInfo poolInfo{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .maxSets = 1,       // these 1's are replaced with the maximum number of frames in flight
+        .maxSets = 2,
         .poolSizeCount = 1,
-        .pPoolSizes = &poolSize,
+        .pPoolSizes = &poolSize
     };
-    VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool));
-}
-
-
-void createDescriptorSets() {
+    VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &particleDescriptorPool));
+    VkDescriptorSetLayout setLayouts[] = { particleSetLayout, particleSetLayout };
     VkDescriptorSetAllocateInfo allocInfo{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = descriptorPool,
-        .descriptorSetCount = 1,    // if multiple frames are in flight, set this to the max number of frames
-        .pSetLayouts = &descriptorSetLayout, // for multiple, supply a pointer with N identical copies of descriptorSetLayout
+        .descriptorPool = particleDescriptorPool,
+        .descriptorSetCount = 2,
+        .pSetLayouts = setLayouts
     };
-    VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+    VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, particleDescriptorSets));
+    for (uint32_t i = 0; i < 2; i++) {
+        VkDescriptorBufferInfo bufferInfos[] = {
+            { .buffer = rhiDevice->GetVkBuffer(particleBuffers[(i + 1) % 2]), .offset = 0, .range = bufferSize },
+            { .buffer = rhiDevice->GetVkBuffer(particleBuffers[i]), .offset = 0, .range = bufferSize }
+        };
+        VkWriteDescriptorSet writes[2];
+        for (uint32_t binding = 0; binding < 2; binding++) {
+            writes[binding] = VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = particleDescriptorSets[i],
+                .dstBinding = binding,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[binding]
+            };
+        }
+        vkUpdateDescriptorSets(device, ARRAYSIZE(writes), writes, 0, nullptr);
+    }
 
-    VkDescriptorBufferInfo bufferInfo{
-        .buffer = uniformBuffer,
+    // compute pipeline
+    particleCompShaderModule = LoadShaderModule(device, "particles.comp.spv");
+    VkPushConstantRange pushConstants{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
         .offset = 0,
-        .range = sizeof(UniformBufferObject)
+        .size = sizeof(ParticleConstants)
+    };
+    VkPipelineLayoutCreateInfo computeLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &particleSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstants
     };
+    VK_CHECK(vkCreatePipelineLayout(device, &computeLayoutInfo, nullptr, &particleComputeLayout));
+    deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE_LAYOUT, particleComputeLayout);
+    VkComputePipelineCreateInfo computePipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = particleCompShaderModule,
+            .pName = "main"
+        },
+        .layout = particleComputeLayout
+    };
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &particleComputePipeline));
+    deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE, particleComputePipeline);
+
+    // graphics pipeline, draws each particle as a point with the regular fragment shader.
+    // Drawn over the scene like the triangle, in the main pass, so made for its formats
+    RHIVertexAttribute attributes[] = {
+        { .offset = offsetof(Particle, position), .format = RHIVertexFormat::Float2 },
+        { .offset = offsetof(Particle, color), .format = RHIVertexFormat::Float4 }
+    };
+    particleGraphicsPipeline = rhiDevice->CreatePipeline({
+        .vertexShader = "particles.vert",
+        .fragmentShader = "vk.frag",
+        .vertexStride = sizeof(Particle),
+        .vertexAttributes = attributes,
+        .topology = RHITopology::PointList,
+    }, swapChainImageFormat, depthFormat);
+
+    // compute gets its own command buffers, from pools on its own family
+    computeCommands = std::make_unique<CommandBufferPool>(device, indices.computeFamily.value(), *computeTimeline);
+
+    lastSimulationTime = std::chrono::steady_clock::now();
+}
 
-    VkWriteDescriptorSet descriptorWrite{
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = descriptorSet,
-        .dstBinding = 0,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .pImageInfo = nullptr,  // optional
-        .pBufferInfo = &bufferInfo,
-        .pTexelBufferView = nullptr
+// simulate frame's particles on the compute queue, returns the compute timeline value graphics has to wait for
+uint64_t submitParticleSimulation(uint64_t frame) {
+    auto now = std::chrono::steady_clock::now();
+    ParticleConstants constants{
+        .deltaTime = std::min(std::chrono::duration<float>(now - lastSimulationTime).count(), 0.1f),     // don't jump after a hitch
+        .count = PARTICLE_COUNT
     };
-    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    lastSimulationTime = now;
+
+    auto commandBuffer = computeCommands->GetCommandBuffer();
+    if (computeTimestampQueryPool) {
+        vkCmdResetQueryPool(commandBuffer, computeTimestampQueryPool, currentFrame * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, computeTimestampQueryPool, currentFrame * 2);
+    }
+    // last frame's dispatch wrote what this one reads. Nothing else orders them when they share a queue
+    VkMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputeLayout, 0, 1, &particleDescriptorSets[frame % 2], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, particleComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (PARTICLE_COUNT + 63) / 64, 1, 1);     // 64 matches local_size_x
+    if (computeTimestampQueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, computeTimestampQueryPool, currentFrame * 2 + 1);
+        computeTimestampsWritten[currentFrame] = true;
+    }
+
+    // the buffer being overwritten was last drawn two frames ago, by the frame that last used this slot, so only wait for that.
+    // Last frame's graphics is free to run at the same time
+    TimelineQueue::Wait wait{
+        .semaphore = graphicsTimeline->GetSemaphore(),
+        .value = frameFenceValues[currentFrame],
+        .stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+    };
+    particleDrawIndex = frame % 2;
+    return computeCommands->ExecuteCommandBuffer(commandBuffer, { &wait, 1 });
+}
+
+// each scene enabled on the command line, in the order they draw. Needs the descriptor allocator and command pool
+void createScenes() {
+    VkSceneContext context{
+        .physicalDevice = physicalDevice,
+        .device = device,
+        .deletionQueue = deletionQueue.get(),
+        .descriptorAllocator = descriptorAllocator.get(),
+        .bindlessHeap = bindlessHeap.get(),
+        .frameArenas = frameArenas.get(),
+        .framesInFlight = MAX_FRAMES_IN_FLIGHT,
+        .colorFormat = swapChainImageFormat,
+        .depthFormat = depthFormat,
+        .cmdBeginRendering = dynamicRenderingEnabled ? cmdBeginRendering : nullptr,
+        .cmdEndRendering = dynamicRenderingEnabled ? cmdEndRendering : nullptr,
+        .renderPass = renderPass,
+        .depthPrepassRenderPass = depthPrepassRenderPass,
+        .depthPrepass = depthPrepassEnabled
+    };
+    if (overdrawLayers > 0) {
+        scenes.push_back(std::make_unique<VkOverdrawScene>(context, VkOverdrawScene::Settings{
+            .layers = overdrawLayers,
+            .pipelineStatistics = pipelineStatisticsEnabled
+        }));
+    }
+    if (occlusionObjects > 0) {
+        scenes.push_back(std::make_unique<VkOcclusionScene>(context, VkOcclusionScene::Settings{
+            .objects = occlusionObjects,
+            .compare = occlusionCompare,
+            .cpu = cpuOcclusion,
+            .depthImage = depthImage,
+            .depthExtent = swapChainExtent
+        }));
+    }
+    if (meshletInstances > 0) {
+        scenes.push_back(std::make_unique<VkMeshletScene>(context, VkMeshletScene::Settings{
+            .instances = meshletInstances,
+            .compare = meshletCompare,
+            .cmdDrawMeshTasks = meshShadersEnabled ? cmdDrawMeshTasks : nullptr
+        }));
+    }
+    if (lodInstances > 0) {
+        scenes.push_back(std::make_unique<VkLodScene>(context, VkLodScene::Settings{
+            .instances = lodInstances,
+            .compare = lodCompare
+        }));
+    }
+    if (textureCount > 0) {
+        scenes.push_back(std::make_unique<VkTextureScene>(context, VkTextureScene::Settings{
+            .count = textureCount,
+            .size = textureSize,
+            .uploadsPerFrame = textureUploadsPerFrame,
+            .blockFormat = textureBlockFormat,
+            .zlib = textureZlib,
+            .streaming = textureStreaming,
+            .budgetMiB = textureBudgetMiB,
+            .anisotropy = samplerAnisotropyEnabled,
+            .timestampPeriod = timestampPeriod,
+            .timestampValidBits = timestampValidBits,
+            .queue = graphicsTimeline.get(),
+            .commands = graphicsCommands.get()
+        }));
+    }
 }
 
 void VkApp::inithook() {
     global_app = this;
+    if (auto directory = CommandLine::GetValue("capture")) {
+        captureSettings.emplace();
+        captureSettings->directory = directory->empty() ? std::string("captures") : std::string(*directory);
+        if (auto format = CommandLine::GetValue("capture-format")) {
+            if (*format == "raw") {
+                captureSettings->format = FrameWriter::Format::Raw;
+            }
+            else if (*format != "png") {
+                std::cout << std::format("Unknown capture format {}, capturing PNG", *format) << std::endl;
+            }
+        }
+        if (auto golden = CommandLine::GetValue("capture-compare")) {
+            captureSettings->goldenDirectory = std::string(*golden);
+        }
+        captureEvery = std::max(CommandLine::GetValue("capture-every", captureEvery), 1u);
+    }
+    blockingResize = CommandLine::HasFlag("blocking-resize");
+    depthPrepassEnabled = CommandLine::HasFlag("depth-prepass");
+    if (CommandLine::HasFlag("overdraw")) {
+        overdrawLayers = CommandLine::GetValue("overdraw", 32u);        // unless --overdraw=N says otherwise
+    }
+    if (CommandLine::HasFlag("occlusion")) {
+        occlusionObjects = CommandLine::GetValue("occlusion", 20000u);  // unless --occlusion=N says otherwise
+    }
+    occlusionCompare = CommandLine::HasFlag("occlusion-compare");
+    cpuOcclusion = CommandLine::HasFlag("cpu-occlusion");
+    if (CommandLine::HasFlag("meshlets")) {
+        meshletInstances = CommandLine::GetValue("meshlets", 64u);      // unless --meshlets=N says otherwise
+    }
+    meshletCompare = CommandLine::HasFlag("meshlet-compare");
+    // the main pass only tests against the pre-pass's depth, which wouldn't have the meshlets in it
+    if (meshletInstances > 0 && depthPrepassEnabled) {
+        std::cout << "The meshlet scene doesn't combine with the depth pre-pass, disabled" << std::endl;
+        meshletInstances = 0;
+    }
+    if (CommandLine::HasFlag("lod")) {
+        lodInstances = CommandLine::GetValue("lod", 1024u);             // unless --lod=N says otherwise
+    }
+    lodCompare = CommandLine::HasFlag("lod-compare");
+    if (lodInstances > 0 && depthPrepassEnabled) {
+        std::cout << "The LOD scene doesn't combine with the depth pre-pass, disabled" << std::endl;
+        lodInstances = 0;
+    }
+    if (CommandLine::HasFlag("textures")) {
+        textureCount = CommandLine::GetValue("textures", 256u);         // unless --textures=N says otherwise
+    }
+    textureSize = CommandLine::GetValue("texture-size", textureSize);
+    textureUploadsPerFrame = CommandLine::GetValue("texture-uploads", textureUploadsPerFrame);
+    if (auto format = CommandLine::GetValue("texture-format")) {
+        for (auto candidate : { BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 }) {
+            if (*format == BlockEncoder::GetFormatName(candidate)) {
+                textureBlockFormat = candidate;
+            }
+        }
+        if (!textureBlockFormat && *format != "rgba8") {
+            std::cout << std::format("Unknown texture format {}, the texture scene uses RGBA8", *format) << std::endl;
+        }
+    }
+    textureZlib = CommandLine::HasFlag("texture-zlib");
+    textureStreaming = CommandLine::HasFlag("texture-streaming");
+    textureBudgetMiB = CommandLine::GetValue("texture-budget", textureBudgetMiB);
+    if (textureStreaming && !textureBlockFormat) {
+        textureBlockFormat = BlockFormat::BC7;      // streaming reads cooked files
+    }
+    if (textureCount > 0 && depthPrepassEnabled) {
+        std::cout << "The texture scene doesn't combine with the depth pre-pass, disabled" << std::endl;
+        textureCount = 0;
+    }
     createInstance();                                               // done
     setupDebugMessenger();                                          // done
     createSurface(this);                                        // done
     auto indices = selectPhysicalAndLogicalDevice(); // done
+    depthFormat = findDepthFormat();
+    deletionQueue = std::make_unique<DeletionQueue>(device, *graphicsTimeline);
+    framePacer = std::make_unique<FramePacer>(device, parseFramePacingSettings(), presentWaitEnabled);
+    createTimestampQueries(indices);
+    setupDynamicResolution();
+    setupOcclusionCulling();
     setupSwapChain(this,indices);                               // done
     createSwapChainImageViews();                                    // done
     global_indices = indices;
 
     // render pass
-    createRenderPass();                                             // done
-    createDescriptorSetLayout();    // uniform buffer               // done
+    if (!dynamicRenderingEnabled) {
+        createRenderPass();                                         // done
+    }
+    createDepthResources();
+    graphExecutor = std::make_unique<VkRenderGraphExecutor>(physicalDevice, device, *deletionQueue);
+    frameArenas = std::make_unique<FrameArenas>(MAX_FRAMES_IN_FLIGHT);
+    if (bindlessEnabled) {
+        createBindlessHeap();       // the pipeline layout needs the heap's layout
+    }
+    else {
+        createDescriptorSetLayout();    // uniform buffer           // done
+    }
     createGraphicsPipeline();                                       // done
-    createFramebuffers();                                           // done, but RHI needs to call this before drawing
+    if (!dynamicRenderingEnabled) {
+        createFramebuffers();                                       // done, but RHI needs to call this before drawing
+    }
 
     // command buffers
     createCommandPool(indices);                     // done
+    createRHIDevice(indices);
     createVertexBuffer();                                           // done
     createUniformBuffers();                                         // done
-    createDescriptorPool();                                         // done
-    createDescriptorSets();                                         // done
-    createCommandBuffer();                                          // done
+    if (bindlessEnabled) {
+        registerBindlessResources();
+    }
+    if (!bindlessEnabled || occlusionObjects > 0 || meshletInstances > 0 || textureStreaming) {
+        createDescriptorAllocator();    // the occlusion, meshlet and streamed texture scenes' sets come from it even in bindless mode
+    }
+    createScenes();                     // the texture scene uploads with the command pool, and registers with the heap
     createSyncObjects();
+    if (particlesEnabled) {
+        createParticles(indices);
+    }
 }
 
 void drawFrame() {
+    // wait for the GPU to finish the last frame that used this slot
+    graphicsTimeline->WaitForFenceValue(frameFenceValues[currentFrame]);
+    frameArenas->BeginFrame(currentFrame);
+    collectRetiredResources();
+    readTimestamps();
+    for (auto& scene : scenes) {
+        scene->ReadBack(currentFrame);
+    }
+    if (frameCapture) {
+        frameCapture->ReadBack(currentFrame);
+    }
+
     // get the next image in the swap chain to use
     uint32_t imageIndex;
-    auto result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-
-    // wait for the previous frame
-    vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    auto result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
     // if the image is out of date, then we recreate the chains
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -1106,37 +2516,49 @@ void drawFrame() {
         throw runtime_error("failed to acquire next swapchain image");
     }
 
-    // reset the fence, we are now submitting work
-    vkResetFences(device, 1, &inFlightFence); 
-
     updateUniformBuffer();      // done
+    if (descriptorAllocator) {
+        descriptorAllocator->BeginFrame(currentFrame);
+    }
+
+    uint64_t frame = deletionQueue->GetSubmittedFrames();  // the frame about to be submitted
+    uint64_t simulationFenceValue = 0;
+    if (particlesEnabled) {
+        simulationFenceValue = submitParticleSimulation(frame);
+    }
+
+    if (frameCapture) {
+        frameCapture->Prepare(currentFrame, swapChainExtent);
+    }
+
+    // the draw lists have to be final before anything is recorded
+    for (auto& scene : scenes) {
+        scene->PrepareFrame(currentFrame, swapChainExtent);
+    }
 
     // populate the command buffer
-    vkResetCommandBuffer(commandBuffer, 0);             // done
+    global_app->beginSubmitTiming();
+    auto commandBuffer = graphicsCommands->GetCommandBuffer();
     recordCommandBuffer(commandBuffer, imageIndex);
 
     // prepare to submit the command buffer 
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-    VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    VkSubmitInfo submitInfo{
-       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-       .waitSemaphoreCount = 1,
-       .pWaitSemaphores = waitSemaphores,
-       .pWaitDstStageMask = waitStages,
-       .commandBufferCount = 1,
-       .pCommandBuffers = &commandBuffer,
-       .signalSemaphoreCount = 1,
-       .pSignalSemaphores = signalSemaphores
-    };
-
-    // submit it to the queue!
-    VK_CHECK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence));
+    // with particles on, also wait for this frame's simulation before reading its vertices
+    TimelineQueue::Wait waits[] = {
+        { imageAvailableSemaphores[currentFrame], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT },
+        { particlesEnabled ? computeTimeline->GetSemaphore() : VK_NULL_HANDLE, simulationFenceValue, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT }
+    };
+    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+
+    // submit it to the queue! The value it signals is what the next use of this slot waits for
+    frameFenceValues[currentFrame] = graphicsCommands->ExecuteCommandBuffer(commandBuffer, { waits, particlesEnabled ? 2u : 1u }, signalSemaphores);
+    deletionQueue->FrameSubmitted();
+    global_app->endSubmitTiming();
 
     // then present it
     VkSwapchainKHR swapChains[] = { swapChain };
     VkPresentInfoKHR presentInfo{
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = framePacer->OnPresent(swapChain),     // tags the present with an id the pacer can wait on
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = signalSemaphores,
         .swapchainCount = 1,
@@ -1151,46 +2573,166 @@ void drawFrame() {
     else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
     }
+
+    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void VkApp::pacehook() {
+    // wait for this frame slot before input is sampled rather than after, so the input isn't stale by the time the frame uses it
+    graphicsTimeline->WaitForFenceValue(frameFenceValues[currentFrame]);
+    framePacer->WaitForNextFrame(swapChain);
+
+    auto now = std::chrono::steady_clock::now();
+    if (latencyReportEnabled && now - lastLatencyReport >= std::chrono::seconds(1)) {
+        auto stats = framePacer->TakeRecentStats();
+        if (stats.frames > 0) {
+            std::cout << std::format("Latency: {:.2f} ms average, {:.2f} ms min, {:.2f} ms max over {} frames",
+                stats.AverageMs(), stats.minMs, stats.maxMs, stats.frames) << std::endl;
+        }
+        lastLatencyReport = now;
+    }
 }
 
 void VkApp::tickhook() {
+    uint64_t allocationsBefore = GetHeapAllocations();
     drawFrame();
+    uint64_t allocations = GetHeapAllocations() - allocationsBefore;
+    drawFrameAllocations += allocations;
+    if (drawFrameCount++ >= HEAP_WARMUP_FRAMES && allocations > 0) {
+        steadyStateAllocations += allocations;
+        steadyStateAllocatingFrames++;
+    }
 }
 
 void VkApp::cleanuphook() {
     vkDeviceWaitIdle(device);
 
+    if (frameCapture) {
+        if (!frameCapture->Finish()) {
+            exitCode = 1;
+        }
+        frameCapture.reset();
+    }
+
     cleanupSwapChain();
+    if (resizeStats.count > 0) {
+        std::cout << std::format("Swapchain recreated {} times ({}): {:.2f} ms average, {:.2f} ms worst",
+            resizeStats.count, blockingResize ? "blocking" : "non-blocking", resizeStats.totalMs / resizeStats.count, resizeStats.worstMs) << std::endl;
+    }
 
     // vertex buffer
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-    vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    rhiDevice->DestroyBuffer(vertexBuffer);
 
     // uniform buffer
-    vkDestroyBuffer(device, uniformBuffer, nullptr);
-    vkFreeMemory(device, uniformBufferMemory, nullptr);
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        deletionQueue->Retire(VK_OBJECT_TYPE_BUFFER, uniformBuffers[i]);
+        deletionQueue->Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, uniformBufferMemories[i]);
+    }
+    // before the descriptor allocator and bindless heap, which the scenes release their sets and slots to
+    for (auto& scene : scenes) {
+        scene->PrintStats();
+    }
+    scenes.clear();
+    if (descriptorAllocator) {
+        auto& stats = descriptorAllocator->GetStats();
+        std::cout << std::format("Descriptor sets: {} allocated, {} pools created, {} pool resets, {:.1f}% cache hit rate",
+            stats.allocations, stats.poolsCreated, stats.poolResets, stats.HitRate() * 100) << std::endl;
+        descriptorAllocator.reset();
+    }
+    bindlessHeap.reset();
+    {
+        auto& totals = renderGraph.GetTotals();
+        std::cout << std::format("Render graph: {} frames, {} passes ({} culled), {} barriers in {} batches, at most {} transient bytes aliased into {}",
+            totals.frames, totals.passes, totals.culledPasses, totals.barriers, totals.barrierBatches, totals.peakTransientBytes, totals.peakHeapBytes) << std::endl;
+        graphExecutor.reset();
+    }
+    {
+        // the graph's last frame still points into the arenas
+        renderGraph.Reset();
+        auto stats = frameArenas->GetStats();
+        std::cout << std::format("Frame arenas: {} allocations over {} frames, {} KiB peak per frame, {} heap blocks, last grew in frame {}",
+            stats.allocations, stats.frames, stats.peakFrameBytes / 1024, stats.blockAllocations, stats.lastGrowthFrame) << std::endl;
+        frameArenas.reset();
+        std::cout << std::format("Heap allocations in drawFrame: {} over {} frames, {} in {} frames after the first {}",
+            drawFrameAllocations, drawFrameCount, steadyStateAllocations, steadyStateAllocatingFrames, HEAP_WARMUP_FRAMES) << std::endl;
+    }
 
-    vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-    vkDestroyFence(device, inFlightFence, nullptr);
+    {
+        auto& stats = framePacer->GetTotalStats();
+        if (stats.frames > 0) {
+            std::cout << std::format("Latency (input to display): {:.2f} ms average, {:.2f} ms worst over {} frames",
+                stats.AverageMs(), stats.maxMs, stats.frames) << std::endl;
+        }
+        framePacer.reset();
+    }
+    if (particlesEnabled) {
+        if (queueTimingStats.frames > 0) {
+            auto frames = static_cast<double>(queueTimingStats.frames);
+            std::cout << std::format("Queue timing: graphics {:.3f} ms, compute {:.3f} ms, {:.3f} ms of compute overlapped graphics ({:.0f}%)",
+                queueTimingStats.graphicsMs / frames, queueTimingStats.computeMs / frames, queueTimingStats.overlapMs / frames,
+                queueTimingStats.computeMs > 0 ? queueTimingStats.overlapMs / queueTimingStats.computeMs * 100 : 0.0) << std::endl;
+        }
+        // the device is idle, so the RHI's resources can go straight away
+        for (uint32_t i = 0; i < 2; i++) {
+            rhiDevice->DestroyBuffer(particleBuffers[i]);
+        }
+        rhiDevice->DestroyPipeline(particleGraphicsPipeline);
+        deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE, particleComputePipeline);
+        deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE_LAYOUT, particleComputeLayout);
+        vkDestroyDescriptorPool(device, particleDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, particleSetLayout, nullptr);
+        vkDestroyShaderModule(device, particleCompShaderModule, nullptr);
+        computeCommands.reset();
+        computeTimeline.reset();
+    }
+    vkDestroyQueryPool(device, computeTimestampQueryPool, nullptr);
+    vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+    if (dynamicResolution) {
+        auto& stats = dynamicResolution->GetStats();
+        std::cout << std::format("Dynamic resolution: {:.0f}% average scale, {:.0f}% lowest, {} of {} frames over the {:.1f} ms budget",
+            stats.AverageScale() * 100, stats.minScale * 100, stats.framesOverBudget, stats.frames, dynamicResolution->GetSettings().budgetMs) << std::endl;
+        dynamicResolution.reset();
+    }
+
+    retireDepthResources();
+
+    deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE, graphicsPipeline);
+    deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout);
+    {
+        // the device is idle, so everything left can go now
+        deletionQueue->Flush();
+        std::cout << std::format("Deletion queue: {} objects pending at peak", deletionQueue->GetPeakPendingCount()) << std::endl;
+        for (size_t i = 0; i < static_cast<size_t>(DeletionQueue::ResourceType::Count); i++) {
+            auto type = static_cast<DeletionQueue::ResourceType>(i);
+            auto& stats = deletionQueue->GetStats(type);
+            if (stats.created == 0 && stats.retired == 0) {
+                continue;
+            }
+            std::cout << std::format("  {}: {} created, {} destroyed, {} leaked, {:.1f} frames deferred on average",
+                DeletionQueue::GetTypeName(type), stats.created, stats.destroyed, stats.Leaked(), stats.AverageFramesDeferred()) << std::endl;
+        }
+        deletionQueue.reset();
+    }
 
-    for (auto imageView : swapChainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
+    {
+        auto stats = graphicsCommands->GetStats();
+        std::cout << std::format("Command buffers: {} requested, {} pools created, {} pool resets ({:.1f}% recycled, {} from other threads, {} contended)",
+            stats.buffersRequested, stats.poolsCreated, stats.poolResets, stats.RecycleRate() * 100, stats.steals, stats.contended) << std::endl;
+        graphicsCommands.reset();
     }
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    rhiDevice.reset();
+    graphicsTimeline.reset();
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+    }
+
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
     vkDestroyShaderModule(device, vertShaderModule, nullptr);
-    for (auto framebuffer : swapChainFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyRenderPass(device, depthPrepassRenderPass, nullptr);
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
     vkDestroyDevice(device,nullptr);
     vkDestroySurfaceKHR(instance,surface,nullptr);
     vkDestroyInstance(instance, nullptr);
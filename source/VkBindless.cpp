@@ -0,0 +1,234 @@
+#if VK_AVAILABLE
+#include "VkBindless.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+BindlessHeap::BindlessHeap(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxBuffers, uint32_t maxImages)
+    : m_Device(device)
+{
+    // update-after-bind descriptors have their own (usually much larger) limits
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &indexingProperties,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    // a combined image sampler counts against both the sampled image and the sampler limits
+    m_Buffers.capacity = std::min({ maxBuffers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+    m_Images.capacity = std::min({ maxImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+    // both arrays are visible to every stage, so together they also have to fit in one stage's resources,
+    // which is shared out in proportion to what was asked for
+    uint64_t perStage = indexingProperties.maxPerStageUpdateAfterBindResources;
+    uint64_t total = uint64_t(m_Buffers.capacity) + m_Images.capacity;
+    if (total > perStage)
+    {
+        m_Buffers.capacity = static_cast<uint32_t>(m_Buffers.capacity * perStage / total);
+        m_Images.capacity = static_cast<uint32_t>(perStage - m_Buffers.capacity);
+    }
+    // pool sizes can't be 0
+    m_Buffers.capacity = std::max(m_Buffers.capacity, 1u);
+    m_Images.capacity = std::max(m_Images.capacity, 1u);
+
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding = BufferBinding,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = m_Buffers.capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        },
+        {
+            .binding = ImageBinding,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = m_Images.capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        },
+    };
+
+    // update-after-bind lets us write new slots while the set is bound by in-flight command buffers,
+    // partially-bound means slots that nothing has been written to yet are not an error as long as they aren't read
+    VkDescriptorBindingFlags bindingFlags[] = {
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(std::size(bindingFlags)),
+        .pBindingFlags = bindingFlags,
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = static_cast<uint32_t>(std::size(bindings)),
+        .pBindings = bindings,
+    };
+    VK_CHECK(vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_Layout));
+
+    // the pool only ever holds this one set
+    VkDescriptorPoolSize poolSizes[] = {
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = m_Buffers.capacity,
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = m_Images.capacity,
+        },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = static_cast<uint32_t>(std::size(poolSizes)),
+        .pPoolSizes = poolSizes,
+    };
+    VK_CHECK(vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_Pool));
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = m_Pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_Layout,
+    };
+    VK_CHECK(vkAllocateDescriptorSets(m_Device, &allocInfo, &m_Set));
+}
+
+BindlessHeap::~BindlessHeap()
+{
+    // destroying the pool frees the set
+    vkDestroyDescriptorPool(m_Device, m_Pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_Device, m_Layout, nullptr);
+}
+
+bool BindlessHeap::IsSupported(VkPhysicalDevice physicalDevice)
+{
+    // we use the core 1.2 version of descriptor indexing rather than the extension
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &indexingFeatures,
+    };
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    // shaders index the arrays with values from push constants, which needs dynamic indexing. The handles are
+    // uniform across a draw, so the non-uniform indexing features aren't needed
+    return features.features.shaderStorageBufferArrayDynamicIndexing
+        && features.features.shaderSampledImageArrayDynamicIndexing
+        && indexingFeatures.runtimeDescriptorArray
+        && indexingFeatures.descriptorBindingPartiallyBound
+        && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind
+        && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+}
+
+void BindlessHeap::EnableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceDescriptorIndexingFeatures& indexingFeatures)
+{
+    features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+}
+
+BindlessHandle BindlessHeap::RegisterBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    BindlessHandle handle = m_Buffers.Allocate();
+
+    VkDescriptorBufferInfo bufferInfo{
+        .buffer = buffer,
+        .offset = offset,
+        .range = range
+    };
+    VkWriteDescriptorSet descriptorWrite{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_Set,
+        .dstBinding = BufferBinding,
+        .dstArrayElement = handle,      // the handle is just the array index
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+
+    return handle;
+}
+
+BindlessHandle BindlessHeap::RegisterImage(VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    BindlessHandle handle = m_Images.Allocate();
+
+    VkDescriptorImageInfo imageInfo{
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = layout
+    };
+    VkWriteDescriptorSet descriptorWrite{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_Set,
+        .dstBinding = ImageBinding,
+        .dstArrayElement = handle,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &imageInfo,
+    };
+    vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+
+    return handle;
+}
+
+void BindlessHeap::ReleaseBuffer(BindlessHandle handle)
+{
+    m_Buffers.Free(handle);
+}
+
+void BindlessHeap::ReleaseImage(BindlessHandle handle)
+{
+    m_Images.Free(handle);
+}
+
+void BindlessHeap::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &m_Set, 0, nullptr);
+}
+
+BindlessHandle BindlessHeap::SlotAllocator::Allocate()
+{
+    if (!freeList.empty())
+    {
+        BindlessHandle handle = freeList.back();
+        freeList.pop_back();
+        return handle;
+    }
+    if (next == capacity)
+    {
+        throw std::runtime_error("bindless heap is full");
+    }
+    return next++;
+}
+
+void BindlessHeap::SlotAllocator::Free(BindlessHandle handle)
+{
+    assert(handle < next && "Handle was not allocated from this heap.");
+    freeList.push_back(handle);
+}
+#endif
@@ -0,0 +1,72 @@
+/**
+ * One large descriptor set ("bindless heap") holding buffers and images in
+ * update-after-bind arrays. Shaders index the arrays with integer handles
+ * passed in push constants, so draws never need their own descriptor sets.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <cstdint>  // For uint32_t
+#include <vector>   // For std::vector
+
+// index into one of the heap's descriptor arrays
+using BindlessHandle = uint32_t;
+
+class BindlessHeap
+{
+public:
+    // array bindings inside the set, see shaders/vk_bindless.vert
+    static constexpr uint32_t BufferBinding = 0;
+    static constexpr uint32_t ImageBinding = 1;
+
+    // the requested sizes are clamped to the device's update-after-bind limits, per array and for a stage's
+    // resources as a whole
+    BindlessHeap(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxBuffers, uint32_t maxImages);
+    virtual ~BindlessHeap();
+
+    // Check for the descriptor indexing features the heap depends on.
+    static bool IsSupported(VkPhysicalDevice physicalDevice);
+    // Turn on those features when creating the logical device.
+    static void EnableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceDescriptorIndexingFeatures& indexingFeatures);
+
+    // Write a storage buffer into the heap.
+    // Returns the handle shaders use to find it.
+    BindlessHandle RegisterBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    // Write a combined image sampler into the heap.
+    BindlessHandle RegisterImage(VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Hand a slot back for reuse. The GPU must no longer be reading it.
+    void ReleaseBuffer(BindlessHandle handle);
+    void ReleaseImage(BindlessHandle handle);
+
+    // The heap only needs to be bound once per command buffer.
+    void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const;
+
+    VkDescriptorSetLayout GetLayout() const {
+        return m_Layout;
+    }
+
+private:
+    // hands out array slots, reusing released ones first
+    struct SlotAllocator
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<BindlessHandle> freeList;
+
+        BindlessHandle Allocate();
+        void Free(BindlessHandle handle);
+    };
+
+    VkDevice                m_Device;
+    VkDescriptorSetLayout   m_Layout = VK_NULL_HANDLE;
+    VkDescriptorPool        m_Pool = VK_NULL_HANDLE;
+    VkDescriptorSet         m_Set = VK_NULL_HANDLE;
+
+    SlotAllocator           m_Buffers;
+    SlotAllocator           m_Images;
+};
+#endif
@@ -0,0 +1,114 @@
+#if VK_AVAILABLE
+#include "VkCommandBufferPool.hpp"
+
+#include <algorithm>
+
+CommandBufferPool::CommandBufferPool(VkDevice device, uint32_t queueFamilyIndex, TimelineQueue& queue)
+    : m_Device(device),
+    m_QueueFamilyIndex(queueFamilyIndex),
+    m_Queue(queue)
+{
+    m_Recording.reserve(ExpectedRecording);
+}
+
+CommandBufferPool::~CommandBufferPool()
+{
+    // the device must be idle. Destroying a pool frees its command buffers
+    m_CommandPools.Drain([this](const CommandPoolEntry& entry) {
+        vkDestroyCommandPool(m_Device, entry.commandPool, nullptr);
+    });
+    for (const auto& entry : m_Recording)
+    {
+        vkDestroyCommandPool(m_Device, entry.commandPool, nullptr);
+    }
+}
+
+CommandBufferPool::CommandPoolEntry CommandBufferPool::CreateCommandPool()
+{
+    // no RESET_COMMAND_BUFFER_BIT, the pool is only ever reset as a whole
+    VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,      // its command buffers are short lived
+        .queueFamilyIndex = m_QueueFamilyIndex
+    };
+    CommandPoolEntry entry{};
+    VK_CHECK(vkCreateCommandPool(m_Device, &poolInfo, nullptr, &entry.commandPool));
+
+    VkCommandBufferAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = entry.commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    VK_CHECK(vkAllocateCommandBuffers(m_Device, &allocInfo, &entry.commandBuffer));
+
+    return entry;
+}
+
+VkCommandBuffer CommandBufferPool::GetCommandBuffer()
+{
+    // before the command buffer can be reused, its pool has to be out of flight
+    auto recycled = m_CommandPools.TryPop([this](uint64_t fenceValue) {
+        return m_Queue.IsFenceComplete(fenceValue);
+    });
+
+    CommandPoolEntry entry;
+    if (recycled)
+    {
+        entry = *recycled;
+        VK_CHECK(vkResetCommandPool(m_Device, entry.commandPool, 0));
+    }
+    else
+    {
+        entry = CreateCommandPool();
+        m_PoolsCreated++;
+    }
+    m_BuffersRequested++;
+
+    VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    VK_CHECK(vkBeginCommandBuffer(entry.commandBuffer, &beginInfo));
+
+    // remember where it came from, so the pool can be recycled on submit
+    std::lock_guard lock(m_RecordingMutex);
+    m_Recording.push_back(entry);
+    return entry.commandBuffer;
+}
+
+uint64_t CommandBufferPool::ExecuteCommandBuffer(VkCommandBuffer commandBuffer, std::span<const TimelineQueue::Wait> waits, std::span<const VkSemaphore> binarySignals)
+{
+    // before it can be executed, it must be closed
+    VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+    VkCommandPool commandPool;
+    {
+        std::lock_guard lock(m_RecordingMutex);
+        auto it = std::find_if(m_Recording.begin(), m_Recording.end(), [commandBuffer](const CommandPoolEntry& entry) {
+            return entry.commandBuffer == commandBuffer;
+        });
+        assert(it != m_Recording.end() && "Command buffer did not come from this pool.");
+        commandPool = it->commandPool;
+        *it = m_Recording.back();
+        m_Recording.pop_back();
+    }
+
+    uint64_t fenceValue = m_Queue.Submit({ &commandBuffer, 1 }, waits, binarySignals);
+    m_CommandPools.Push(fenceValue, { commandPool, commandBuffer });
+
+    return fenceValue;
+}
+
+CommandBufferPool::Stats CommandBufferPool::GetStats()
+{
+    auto recyclerStats = m_CommandPools.GetStats();
+    return {
+        .buffersRequested = m_BuffersRequested,
+        .poolsCreated = m_PoolsCreated,
+        .poolResets = recyclerStats.pops,
+        .steals = recyclerStats.steals,
+        .contended = recyclerStats.contended
+    };
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ * Hands out command buffers for one queue, the Vulkan counterpart of CommandQueue::GetCommandList in the D3D12 backend.
+ * Each command buffer comes with its own VkCommandPool, playing the part of the D3D12 command allocator. Once submitted,
+ * the pool is tagged with the queue's timeline value and reset as a whole when it comes back around, instead of
+ * resetting command buffers one at a time. A command pool may only be used by one thread at a time, which holds
+ * here because a pool is only ever handed to one caller between being taken out of the recycler and submitted.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+#include "VkTimelineQueue.hpp"
+#include "FenceRecycler.hpp"
+
+#include <atomic>           // For std::atomic
+#include <cstdint>          // For uint32_t, uint64_t
+#include <mutex>            // For std::mutex
+#include <span>             // For std::span
+#include <vector>           // For std::vector
+
+class CommandBufferPool
+{
+public:
+    struct Stats
+    {
+        uint64_t buffersRequested = 0;
+        uint64_t poolsCreated = 0;
+        uint64_t poolResets = 0;    // pools recycled instead of created
+        uint64_t steals = 0;        // recycled pools that another thread submitted
+        uint64_t contended = 0;     // times a thread waited for the recycler
+
+        double RecycleRate() const {
+            return buffersRequested == 0 ? 0.0 : static_cast<double>(poolResets) / buffersRequested;
+        }
+    };
+
+    CommandBufferPool(VkDevice device, uint32_t queueFamilyIndex, TimelineQueue& queue);
+    virtual ~CommandBufferPool();
+
+    // Get a command buffer, already begun for one-time submission. It may be called from any thread.
+    VkCommandBuffer GetCommandBuffer();
+
+    // End and submit a command buffer from GetCommandBuffer. It may be called from any thread,
+    // but like any use of a VkQueue, submissions must not overlap.
+    // Returns the fence value to wait for for this command buffer.
+    uint64_t ExecuteCommandBuffer(VkCommandBuffer commandBuffer, std::span<const TimelineQueue::Wait> waits = {}, std::span<const VkSemaphore> binarySignals = {});
+
+    Stats GetStats();
+
+private:
+    // a pool with the one command buffer allocated from it
+    struct CommandPoolEntry
+    {
+        VkCommandPool commandPool;
+        VkCommandBuffer commandBuffer;
+    };
+
+    CommandPoolEntry CreateCommandPool();
+
+    VkDevice                                            m_Device;
+    uint32_t                                            m_QueueFamilyIndex;
+    TimelineQueue&                                      m_Queue;
+
+    FenceRecycler<CommandPoolEntry>                     m_CommandPools;
+
+    // the pools of command buffers between GetCommandBuffer and ExecuteCommandBuffer. Only a handful record at once,
+    // so a flat list that keeps its capacity beats a map adding a node per command buffer
+    static constexpr size_t                             ExpectedRecording = 16;
+    std::mutex                                          m_RecordingMutex;
+    std::vector<CommandPoolEntry>                       m_Recording;
+
+    std::atomic<uint64_t>                               m_BuffersRequested = 0;
+    std::atomic<uint64_t>                               m_PoolsCreated = 0;
+};
+#endif
@@ -0,0 +1,103 @@
+#if VK_AVAILABLE
+#include "VkCommon.hpp"
+#include "VkDeletionQueue.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    // find a memory type suitable for the buffer
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        // needs to have the right support
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory, std::span<const uint32_t> sharedWith)
+{
+    VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+    if (sharedWith.size() > 1) {
+        // concurrent sharing costs a little on some GPUs, but saves ownership transfers every frame
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedWith.size());
+        bufferInfo.pQueueFamilyIndices = sharedWith.data();
+    }
+    VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer));
+    deletionQueue.Track(VK_OBJECT_TYPE_BUFFER, buffer);
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = FindMemoryType(physicalDevice, requirements.memoryTypeBits, properties)
+    };
+    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &memory));
+    deletionQueue.Track(VK_OBJECT_TYPE_DEVICE_MEMORY, memory);
+
+    vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+void UploadBuffer(VkDevice device, VkDeviceMemory memory, std::span<const std::byte> data)
+{
+    void* mapped;
+    VK_CHECK(vkMapMemory(device, memory, 0, data.size(), 0, &mapped));
+    memcpy(mapped, data.data(), data.size());
+    vkUnmapMemory(device, memory);
+}
+
+VkShaderModule LoadShaderModule(VkDevice device, const std::filesystem::path& file)
+{
+    std::ifstream stream(file, std::ios::ate | std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error(std::format("failed to open {}", file.string()));
+    }
+    std::vector<char> code(static_cast<size_t>(stream.tellg()));
+    stream.seekg(0);
+    stream.read(code.data(), code.size());
+
+    VkShaderModuleCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = code.size(),    // in bytes, not multiples of uint32
+        .pCode = reinterpret_cast<const uint32_t*>(code.data())
+    };
+    VkShaderModule shaderModule;
+    VK_CHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule));
+    return shaderModule;
+}
+
+void SetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+    VkViewport viewport{
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = extent
+    };
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+#endif
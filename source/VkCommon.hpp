@@ -0,0 +1,60 @@
+#pragma once
+#if VK_AVAILABLE
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <span>
+#include <type_traits>
+
+#include <vulkan/vulkan.h>
+
+#define VK_CHECK(a) {auto VK_CHECK_RESULT = a; assert(VK_CHECK_RESULT == VK_SUCCESS);}
+#define VK_CHECK_OPT(a) {auto VK_CHECK_RESULT = a; if(VK_CHECK_RESULT != VK_SUCCESS){std::cout << std::format("VK_CHECK_OPT {}:{} failed",__FILE__,__LINE__) << std::endl;}}
+#define VK_VALID(a) {assert(a != VK_NULL_HANDLE);}
+
+// Non-dispatchable handles (VK_DEFINE_NON_DISPATCHABLE_HANDLE) are pointers on 64-bit builds but plain uint64_t on
+// 32-bit ones, so a handle stored without its type goes through these instead of reinterpret_cast.
+template<typename T>
+uint64_t HandleToUint64(T handle)
+{
+    if constexpr (std::is_pointer_v<T>) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    }
+    else {
+        return static_cast<uint64_t>(handle);
+    }
+}
+
+template<typename T>
+T HandleFromUint64(uint64_t value)
+{
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(static_cast<uintptr_t>(value));
+    }
+    else {
+        return static_cast<T>(value);
+    }
+}
+
+class DeletionQueue;
+
+// Find a memory type allowed by typeFilter that has all of the requested properties.
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+// A buffer with a memory allocation of its own, both tracked by deletionQueue. Buffers used from more than one queue
+// family list them in sharedWith.
+void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory, std::span<const uint32_t> sharedWith = {});
+
+// Copy data to the start of host visible, coherent memory, mapping it only for the copy.
+void UploadBuffer(VkDevice device, VkDeviceMemory memory, std::span<const std::byte> data);
+
+// A shader module from a SPIR-V file. Throws std::runtime_error if the file can't be read.
+VkShaderModule LoadShaderModule(VkDevice device, const std::filesystem::path& file);
+
+// Cover extent with the viewport and scissor, for pipelines that have them dynamic.
+void SetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent);
+#endif
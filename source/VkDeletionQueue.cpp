@@ -0,0 +1,131 @@
+#if VK_AVAILABLE
+#include "VkDeletionQueue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+DeletionQueue::DeletionQueue(VkDevice device, TimelineQueue& queue)
+    : m_Device(device),
+    m_Queue(queue)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    Flush();
+}
+
+const char* DeletionQueue::GetTypeName(ResourceType type)
+{
+    switch (type)
+    {
+    case ResourceType::Buffer:
+        return "buffers";
+    case ResourceType::Image:
+        return "images";
+    case ResourceType::ImageView:
+        return "image views";
+    case ResourceType::Framebuffer:
+        return "framebuffers";
+    case ResourceType::Pipeline:
+        return "pipelines";
+    case ResourceType::PipelineLayout:
+        return "pipeline layouts";
+    case ResourceType::DeviceMemory:
+        return "memory blocks";
+    case ResourceType::Swapchain:
+        return "swapchains";
+    default:
+        assert(false && "Invalid resource type.");
+        return "";
+    }
+}
+
+DeletionQueue::ResourceType DeletionQueue::GetType(VkObjectType objectType)
+{
+    switch (objectType)
+    {
+    case VK_OBJECT_TYPE_BUFFER:
+        return ResourceType::Buffer;
+    case VK_OBJECT_TYPE_IMAGE:
+        return ResourceType::Image;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        return ResourceType::ImageView;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        return ResourceType::Framebuffer;
+    case VK_OBJECT_TYPE_PIPELINE:
+        return ResourceType::Pipeline;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        return ResourceType::PipelineLayout;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        return ResourceType::DeviceMemory;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        return ResourceType::Swapchain;
+    default:
+        throw std::runtime_error("the deletion queue can't destroy this type of object");
+    }
+}
+
+void DeletionQueue::Retire(ResourceType type, uint64_t handle)
+{
+    m_Pending.push_back({ type, handle, m_Queue.GetLastSignaledValue(), m_SubmittedFrames });
+    m_PeakPending = std::max(m_PeakPending, m_Pending.size());
+    m_Stats[static_cast<size_t>(type)].retired++;
+}
+
+void DeletionQueue::Collect()
+{
+    // entries are in retirement order, so stop at the first one that may still be in use
+    while (!m_Pending.empty() && m_Queue.IsFenceComplete(m_Pending.front().fenceValue))
+    {
+        Destroy(m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
+
+void DeletionQueue::Flush()
+{
+    for (const auto& entry : m_Pending)
+    {
+        Destroy(entry);
+    }
+    m_Pending.clear();
+}
+
+void DeletionQueue::Destroy(const Entry& entry)
+{
+    auto& stats = m_Stats[static_cast<size_t>(entry.type)];
+    stats.destroyed++;
+    stats.framesDeferred += m_SubmittedFrames - entry.retiredFrame;
+
+    switch (entry.type)
+    {
+    case ResourceType::Buffer:
+        vkDestroyBuffer(m_Device, HandleFromUint64<VkBuffer>(entry.handle), nullptr);
+        break;
+    case ResourceType::Image:
+        vkDestroyImage(m_Device, HandleFromUint64<VkImage>(entry.handle), nullptr);
+        break;
+    case ResourceType::ImageView:
+        vkDestroyImageView(m_Device, HandleFromUint64<VkImageView>(entry.handle), nullptr);
+        break;
+    case ResourceType::Framebuffer:
+        vkDestroyFramebuffer(m_Device, HandleFromUint64<VkFramebuffer>(entry.handle), nullptr);
+        break;
+    case ResourceType::Pipeline:
+        vkDestroyPipeline(m_Device, HandleFromUint64<VkPipeline>(entry.handle), nullptr);
+        break;
+    case ResourceType::PipelineLayout:
+        vkDestroyPipelineLayout(m_Device, HandleFromUint64<VkPipelineLayout>(entry.handle), nullptr);
+        break;
+    case ResourceType::DeviceMemory:
+        vkFreeMemory(m_Device, HandleFromUint64<VkDeviceMemory>(entry.handle), nullptr);
+        break;
+    case ResourceType::Swapchain:
+        vkDestroySwapchainKHR(m_Device, HandleFromUint64<VkSwapchainKHR>(entry.handle), nullptr);
+        break;
+    default:
+        assert(false && "Invalid resource type.");
+    }
+}
+#endif
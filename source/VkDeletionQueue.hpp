@@ -0,0 +1,123 @@
+/**
+ * Defers destroying Vulkan objects until the GPU has finished every frame that could still reference them.
+ * Objects are tagged with the graphics queue's timeline value when they were released, and destroyed once the GPU
+ * has reached it, so resources can be released mid-run without idling the device.
+ * Creations and releases are counted per type, to report leaks and how long objects waited at shutdown.
+ * Objects are passed with their VkObjectType, as on 32-bit builds every non-dispatchable handle is the same uint64_t
+ * type and can't say what it is.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+#include "VkTimelineQueue.hpp"
+
+#include <array>    // For std::array
+#include <cstdint>  // For uint64_t
+#include <deque>    // For std::deque
+
+class DeletionQueue
+{
+public:
+    enum class ResourceType : uint8_t
+    {
+        Buffer,
+        Image,
+        ImageView,
+        Framebuffer,
+        Pipeline,
+        PipelineLayout,
+        DeviceMemory,
+        Swapchain,
+        Count
+    };
+
+    struct TypeStats
+    {
+        uint64_t created = 0;           // passed to Track
+        uint64_t retired = 0;           // passed to Retire
+        uint64_t destroyed = 0;
+        uint64_t framesDeferred = 0;    // summed over everything destroyed
+
+        // tracked objects that were never released
+        uint64_t Leaked() const {
+            return created > retired ? created - retired : 0;
+        }
+        double AverageFramesDeferred() const {
+            return destroyed == 0 ? 0.0 : static_cast<double>(framesDeferred) / destroyed;
+        }
+    };
+
+    DeletionQueue(VkDevice device, TimelineQueue& queue);
+    virtual ~DeletionQueue();
+
+    // Count a newly created object, so it shows up as a leak if it is never retired.
+    template<typename T>
+    void Track(VkObjectType objectType, T handle)
+    {
+        if (handle != VK_NULL_HANDLE)
+        {
+            m_Stats[static_cast<size_t>(GetType(objectType))].created++;
+        }
+    }
+
+    // Release an object. It is destroyed once everything submitted to the queue so far has completed.
+    template<typename T>
+    void Retire(VkObjectType objectType, T handle)
+    {
+        if (handle != VK_NULL_HANDLE)
+        {
+            Retire(GetType(objectType), HandleToUint64(handle));
+        }
+    }
+
+    // Call after each frame's submit, frames are only counted for the stats.
+    void FrameSubmitted() {
+        m_SubmittedFrames++;
+    }
+
+    // Destroy everything the GPU has finished with.
+    void Collect();
+
+    // Destroy everything now. The device must be idle.
+    void Flush();
+
+    uint64_t GetSubmittedFrames() const {
+        return m_SubmittedFrames;
+    }
+    size_t GetPendingCount() const {
+        return m_Pending.size();
+    }
+    size_t GetPeakPendingCount() const {
+        return m_PeakPending;
+    }
+    const TypeStats& GetStats(ResourceType type) const {
+        return m_Stats[static_cast<size_t>(type)];
+    }
+    static const char* GetTypeName(ResourceType type);
+
+private:
+    struct Entry
+    {
+        ResourceType type;
+        uint64_t handle;
+        uint64_t fenceValue;    // submissions up to this value may still reference it
+        uint64_t retiredFrame;
+    };
+
+    static ResourceType GetType(VkObjectType objectType);
+
+    void Retire(ResourceType type, uint64_t handle);
+    void Destroy(const Entry& entry);
+
+    VkDevice            m_Device;
+    TimelineQueue&      m_Queue;
+    uint64_t            m_SubmittedFrames = 0;
+
+    std::deque<Entry>   m_Pending;      // in retirement order, so the oldest are at the front
+    size_t              m_PeakPending = 0;
+
+    std::array<TypeStats, static_cast<size_t>(ResourceType::Count)> m_Stats;
+};
+#endif
@@ -0,0 +1,210 @@
+#if VK_AVAILABLE
+#include "VkDescriptorAllocator.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+DescriptorAllocator::Binding DescriptorAllocator::Binding::Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    return Binding{
+        .binding = binding,
+        .type = type,
+        .bufferInfo = {
+            .buffer = buffer,
+            .offset = offset,
+            .range = range
+        }
+    };
+}
+
+DescriptorAllocator::Binding DescriptorAllocator::Binding::Image(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    return Binding{
+        .binding = binding,
+        .type = type,
+        .imageInfo = {
+            .sampler = sampler,
+            .imageView = view,
+            .imageLayout = layout
+        }
+    };
+}
+
+bool DescriptorAllocator::Binding::operator==(const Binding& other) const
+{
+    return binding == other.binding && type == other.type
+        && bufferInfo.buffer == other.bufferInfo.buffer && bufferInfo.offset == other.bufferInfo.offset && bufferInfo.range == other.bufferInfo.range
+        && imageInfo.sampler == other.imageInfo.sampler && imageInfo.imageView == other.imageInfo.imageView && imageInfo.imageLayout == other.imageInfo.imageLayout;
+}
+
+size_t DescriptorAllocator::CacheKeyHash::operator()(const CacheKeyView& key) const
+{
+    // boost::hash_combine
+    size_t seed = 0;
+    auto combine = [&seed](auto value) {
+        seed ^= std::hash<decltype(value)>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(HandleToUint64(key.layout));
+    for (const auto& binding : key.bindings)
+    {
+        combine(binding.binding);
+        combine(static_cast<uint32_t>(binding.type));
+        combine(HandleToUint64(binding.bufferInfo.buffer));
+        combine(binding.bufferInfo.offset);
+        combine(binding.bufferInfo.range);
+        combine(HandleToUint64(binding.imageInfo.imageView));
+        combine(HandleToUint64(binding.imageInfo.sampler));
+    }
+    return seed;
+}
+
+bool DescriptorAllocator::CacheKeyEqual::operator()(const CacheKeyView& a, const CacheKeyView& b) const
+{
+    return a.layout == b.layout && std::ranges::equal(a.bindings, b.bindings);
+}
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t framesInFlight)
+    : m_Device(device),
+    m_Frames(framesInFlight)
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    // destroying a pool frees every set allocated from it
+    for (auto& frame : m_Frames)
+    {
+        for (auto pool : frame.pools)
+        {
+            vkDestroyDescriptorPool(m_Device, pool, nullptr);
+        }
+    }
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t maxSets)
+{
+    // a rough mix of descriptor types per set, scaled by the number of sets
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxSets * 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxSets * 2 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSets * 4 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxSets },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = 0,     // no FREE_DESCRIPTOR_SET_BIT, sets are only ever released by resetting the whole pool
+        .maxSets = maxSets,
+        .poolSizeCount = static_cast<uint32_t>(std::size(poolSizes)),
+        .pPoolSizes = poolSizes,
+    };
+    VkDescriptorPool pool;
+    VK_CHECK(vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &pool));
+    m_Stats.poolsCreated++;
+    return pool;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < m_Frames.size() && "Frame index out of range.");
+    m_CurrentFrame = frameIndex;
+
+    // the sets in this slot are no longer in use by the GPU, so the pools can be recycled if needed
+    auto& frame = m_Frames[m_CurrentFrame];
+    if (frame.invalidated || frame.cache.size() > MaxCachedSets)
+    {
+        for (auto pool : frame.pools)
+        {
+            VK_CHECK(vkResetDescriptorPool(m_Device, pool, 0));
+            m_Stats.poolResets++;
+        }
+        frame.currentPool = 0;
+        frame.cache.clear();
+        frame.invalidated = false;
+    }
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+    auto& frame = m_Frames[m_CurrentFrame];
+
+    auto tryAllocate = [&](VkDescriptorPool pool, VkDescriptorSet& set) {
+        VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &layout,
+        };
+        auto result = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+        if (result != VK_SUCCESS && result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+        {
+            throw std::runtime_error("failed to allocate descriptor set");
+        }
+        return result == VK_SUCCESS;
+    };
+
+    // the pools this slot already has, moving past the ones that are full
+    VkDescriptorSet set;
+    for (; frame.currentPool < frame.pools.size(); frame.currentPool++)
+    {
+        if (tryAllocate(frame.pools[frame.currentPool], set))
+        {
+            m_Stats.allocations++;
+            return set;
+        }
+    }
+
+    // then one new pool. If the set doesn't fit in an empty pool it never will, so that is an error rather than
+    // another pool
+    frame.pools.push_back(CreatePool(m_NextPoolSets));
+    m_NextPoolSets = std::min(m_NextPoolSets * 2, MaxPoolSets);
+    if (!tryAllocate(frame.pools.back(), set))
+    {
+        throw std::runtime_error("descriptor set layout needs more descriptors than a whole pool holds");
+    }
+    m_Stats.allocations++;
+    return set;
+}
+
+VkDescriptorSet DescriptorAllocator::GetDescriptorSet(VkDescriptorSetLayout layout, std::span<const Binding> bindings)
+{
+    auto& frame = m_Frames[m_CurrentFrame];
+
+    if (auto it = frame.cache.find(CacheKeyView{ layout, bindings }); it != frame.cache.end())
+    {
+        m_Stats.cacheHits++;
+        return it->second;
+    }
+    m_Stats.cacheMisses++;
+
+    VkDescriptorSet set = Allocate(layout);
+
+    m_Writes.clear();
+    for (const auto& binding : bindings)
+    {
+        m_Writes.push_back(VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = set,
+            .dstBinding = binding.binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = binding.type,
+            .pImageInfo = &binding.imageInfo,       // only the one that matches the type is read
+            .pBufferInfo = &binding.bufferInfo,
+        });
+    }
+    vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(m_Writes.size()), m_Writes.data(), 0, nullptr);
+
+    // only a miss copies the bindings into a key the cache owns
+    frame.cache.emplace(CacheKey{ layout, std::vector<Binding>(bindings.begin(), bindings.end()) }, set);
+    return set;
+}
+
+void DescriptorAllocator::Invalidate()
+{
+    for (auto& frame : m_Frames)
+    {
+        frame.invalidated = true;
+    }
+}
+#endif
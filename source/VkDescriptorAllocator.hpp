@@ -0,0 +1,119 @@
+/**
+ * Growable descriptor set allocator with one group of pools per frame in flight.
+ * Sets are cached by layout and the resources written into them, so binding the
+ * same resources again reuses the set instead of allocating and writing a new one.
+ * Pools are recycled with vkResetDescriptorPool rather than freeing sets one at a time.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <cstdint>          // For uint32_t, uint64_t
+#include <span>             // For std::span
+#include <unordered_map>    // For std::unordered_map
+#include <vector>           // For std::vector
+
+class DescriptorAllocator
+{
+public:
+    // one resource to write into a set
+    struct Binding
+    {
+        uint32_t binding;
+        VkDescriptorType type;
+        VkDescriptorBufferInfo bufferInfo{};
+        VkDescriptorImageInfo imageInfo{};
+
+        static Binding Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+        static Binding Image(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout);
+
+        bool operator==(const Binding& other) const;
+    };
+
+    struct Stats
+    {
+        uint64_t allocations = 0;   // sets allocated from a pool
+        uint64_t poolsCreated = 0;  // pool growth
+        uint64_t poolResets = 0;    // vkResetDescriptorPool calls
+        uint64_t cacheHits = 0;
+        uint64_t cacheMisses = 0;
+
+        double HitRate() const {
+            auto lookups = cacheHits + cacheMisses;
+            return lookups == 0 ? 0.0 : static_cast<double>(cacheHits) / lookups;
+        }
+    };
+
+    DescriptorAllocator(VkDevice device, uint32_t framesInFlight);
+    virtual ~DescriptorAllocator();
+
+    // Switch to a frame slot. The GPU must be done with the work
+    // previously recorded for this slot, as its pools may be reset here.
+    void BeginFrame(uint32_t frameIndex);
+
+    // Get a set for the current frame slot with these resources written into it.
+    VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout, std::span<const Binding> bindings);
+
+    // Forget all cached sets, for example after a resource they reference has been destroyed.
+    // Each frame slot resets its pools the next time it begins.
+    void Invalidate();
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+protected:
+    VkDescriptorPool CreatePool(uint32_t maxSets);
+    VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+private:
+    // what a lookup hashes and compares, so a cache hit doesn't copy the bindings
+    struct CacheKeyView
+    {
+        VkDescriptorSetLayout layout;
+        std::span<const Binding> bindings;
+    };
+    struct CacheKey
+    {
+        VkDescriptorSetLayout layout;
+        std::vector<Binding> bindings;
+
+        operator CacheKeyView() const {
+            return { layout, bindings };
+        }
+    };
+    struct CacheKeyHash
+    {
+        using is_transparent = void;
+        size_t operator()(const CacheKeyView& key) const;
+    };
+    struct CacheKeyEqual
+    {
+        using is_transparent = void;
+        bool operator()(const CacheKeyView& a, const CacheKeyView& b) const;
+    };
+
+    // everything owned by one frame in flight
+    struct FrameSlot
+    {
+        std::vector<VkDescriptorPool> pools;
+        size_t currentPool = 0;     // pools before this one are full
+        std::unordered_map<CacheKey, VkDescriptorSet, CacheKeyHash, CacheKeyEqual> cache;
+        bool invalidated = false;
+    };
+
+    // a slot caching more than this many sets is reset, so stale entries can't grow forever
+    static constexpr size_t MaxCachedSets = 4096;
+    static constexpr uint32_t InitialPoolSets = 64;
+    static constexpr uint32_t MaxPoolSets = 4096;
+
+    VkDevice                m_Device;
+    std::vector<FrameSlot>  m_Frames;
+    uint32_t                m_CurrentFrame = 0;
+    uint32_t                m_NextPoolSets = InitialPoolSets;
+    Stats                   m_Stats;
+    std::vector<VkWriteDescriptorSet> m_Writes;     // reused by every cache miss
+};
+#endif
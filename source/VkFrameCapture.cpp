@@ -0,0 +1,179 @@
+#if VK_AVAILABLE
+#include "VkFrameCapture.hpp"
+#include "VkDeletionQueue.hpp"
+
+#include <algorithm>
+#include <format>
+#include <iostream>
+
+VkFrameCapture::VkFrameCapture(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue, const Settings& settings)
+    : m_PhysicalDevice(physicalDevice),
+    m_Device(device),
+    m_DeletionQueue(deletionQueue),
+    m_Settings(settings),
+    m_Writer(std::make_unique<FrameWriter>(settings.writer)),
+    m_Slots(settings.framesInFlight)
+{
+}
+
+VkFrameCapture::~VkFrameCapture()
+{
+    for (const auto& slot : m_Slots) {
+        if (slot.buffer != VK_NULL_HANDLE) {
+            m_DeletionQueue.Retire(VK_OBJECT_TYPE_BUFFER, slot.buffer);
+            m_DeletionQueue.Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, slot.memory);
+        }
+    }
+}
+
+bool VkFrameCapture::IsCaptured() const
+{
+    return m_DeletionQueue.GetSubmittedFrames() % m_Settings.every == 0;
+}
+
+void VkFrameCapture::Prepare(uint32_t slotIndex, VkExtent2D extent)
+{
+    auto& slot = m_Slots[slotIndex];
+    VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+    if (!IsCaptured() || slot.size >= size) {
+        return;
+    }
+    if (slot.buffer != VK_NULL_HANDLE) {
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_BUFFER, slot.buffer);
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, slot.memory);
+    }
+    VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+    VK_CHECK(vkCreateBuffer(m_Device, &bufferInfo, nullptr, &slot.buffer));
+    m_DeletionQueue.Track(VK_OBJECT_TYPE_BUFFER, slot.buffer);
+
+    // cached where the buffer can have it, as the CPU reads every byte. Only the types the buffer allows count
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_Device, slot.buffer, &requirements);
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+    constexpr VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & cached) == cached) {
+            wanted = cached;
+            break;
+        }
+    }
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = FindMemoryType(m_PhysicalDevice, requirements.memoryTypeBits, wanted)
+    };
+    VK_CHECK(vkAllocateMemory(m_Device, &allocInfo, nullptr, &slot.memory));
+    m_DeletionQueue.Track(VK_OBJECT_TYPE_DEVICE_MEMORY, slot.memory);
+    vkBindBufferMemory(m_Device, slot.buffer, slot.memory, 0);
+    // what ReadBack checks for coherence, which the type found may have even where it wasn't asked for
+    slot.memoryProperties = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags;
+
+    void* data;
+    vkMapMemory(m_Device, slot.memory, 0, VK_WHOLE_SIZE, 0, &data);
+    slot.mapped = static_cast<std::byte*>(data);
+    slot.size = size;
+}
+
+void VkFrameCapture::AddPass(RenderGraph& graph, VkCommandBuffer commandBuffer, uint32_t slotIndex, RGResource backbuffer, VkImage image, VkExtent2D extent)
+{
+    if (!IsCaptured()) {
+        return;
+    }
+    auto& slot = m_Slots[slotIndex];
+    VkBuffer buffer = slot.buffer;
+    graph.AddPass("capture",
+        [&](RenderGraph::PassBuilder& pass) {
+            pass.Read(backbuffer, ResourceState::TransferSrc);
+            pass.SideEffects();     // writes the readback buffer, which the graph can't see
+        },
+        [=] {
+            VkBufferImageCopy region{
+                .bufferOffset = 0,
+                .bufferRowLength = 0,       // tightly packed
+                .bufferImageHeight = 0,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                },
+                .imageOffset = { 0, 0, 0 },
+                .imageExtent = { extent.width, extent.height, 1 }
+            };
+            vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+            // the CPU reads it after the frame's fence value is reached
+            VkBufferMemoryBarrier barrier{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = buffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE
+            };
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+    );
+    slot.written = true;
+    slot.frame = m_DeletionQueue.GetSubmittedFrames();
+    slot.extent = extent;
+}
+
+void VkFrameCapture::ReadBack(uint32_t slotIndex)
+{
+    auto& slot = m_Slots[slotIndex];
+    if (!slot.written) {
+        return;
+    }
+    if (!(slot.memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        VkMappedMemoryRange range{
+            .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .memory = slot.memory,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+        };
+        vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+    }
+    bool bgra = m_Settings.format == VK_FORMAT_B8G8R8A8_SRGB || m_Settings.format == VK_FORMAT_B8G8R8A8_UNORM;
+    m_Writer->Submit(slot.frame, std::span(slot.mapped, slot.size), slot.extent.width, slot.extent.height, slot.extent.width * 4, bgra);
+    slot.written = false;
+}
+
+bool VkFrameCapture::Finish()
+{
+    // the frames still in flight are done now, and go to the writer oldest first
+    std::vector<uint32_t> slots;
+    for (uint32_t i = 0; i < m_Slots.size(); i++) {
+        if (m_Slots[i].written) {
+            slots.push_back(i);
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [this](uint32_t a, uint32_t b) { return m_Slots[a].frame < m_Slots[b].frame; });
+    for (uint32_t slot : slots) {
+        ReadBack(slot);
+    }
+    m_Writer->Finish();
+
+    const auto& settings = m_Settings.writer;
+    auto stats = m_Writer->GetStats();
+    std::cout << std::format("Capture: {} frames to {} as {}, {} KiB each; {:.2f} ms each on the writer thread ({:.1f} frames/s, {:.0f} MB/s), {:.3f} ms each on the render thread, {} waits for the writer",
+        stats.framesWritten, settings.directory.string(), FrameWriter::GetFormatName(settings.format),
+        stats.framesWritten > 0 ? stats.fileBytes / stats.framesWritten / 1024 : 0, stats.framesWritten > 0 ? (stats.encodeMs + stats.writeMs) / stats.framesWritten : 0.0,
+        stats.FramesPerSecond(), stats.MegabytesPerSecond(), stats.framesWritten > 0 ? stats.submitMs / stats.framesWritten : 0.0, stats.submitWaits) << std::endl;
+    if (settings.goldenDirectory.empty()) {
+        return true;
+    }
+    std::cout << std::format("Capture compare: {} frames against {}, {} mismatched, {} without a golden image; max difference {}, worst PSNR {:.1f} dB",
+        stats.compared, settings.goldenDirectory.string(), stats.mismatches, stats.missingGoldens, stats.maxDifference, stats.worstPsnr) << std::endl;
+    // a frame without a golden image to check it against fails too, so a wrong directory can't pass
+    return stats.mismatches == 0 && stats.missingGoldens == 0;
+}
+#endif
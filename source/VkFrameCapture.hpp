@@ -0,0 +1,78 @@
+/**
+ * Frame capture (--capture=dir): at the end of every Nth frame the swapchain image is copied into a host-visible
+ * buffer, which is read once the frame's slot comes round again, so the render loop never waits on the GPU for it.
+ * A FrameWriter writes the frames on its own thread, and with a golden directory compares them as well. Each frame
+ * slot has its own readback buffer, grown to fit the swapchain as it is resized.
+ * The swapchain has to allow copying from its images, in 8-bit RGBA or BGRA.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+#include "RenderGraph.hpp"
+#include "FrameWriter.hpp"
+
+#include <cstddef>  // For std::byte
+#include <cstdint>  // For uint32_t, uint64_t
+#include <memory>   // For std::unique_ptr
+#include <vector>   // For std::vector
+
+class DeletionQueue;
+
+class VkFrameCapture
+{
+public:
+    struct Settings
+    {
+        FrameWriter::Settings writer = {};
+        uint32_t every = 1;                         // capture every Nth frame
+        uint32_t framesInFlight = 1;
+        VkFormat format = VK_FORMAT_B8G8R8A8_SRGB;  // the swapchain's
+    };
+
+    VkFrameCapture(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue, const Settings& settings);
+    // the readback buffers are retired, so the GPU may still be copying into them
+    virtual ~VkFrameCapture();
+
+    VkFrameCapture(const VkFrameCapture&) = delete;
+    VkFrameCapture& operator=(const VkFrameCapture&) = delete;
+
+    // Before recording a frame into slot: grows the slot's readback buffer to fit extent if the frame is captured.
+    // The slot's last capture has to have been read already
+    void Prepare(uint32_t slot, VkExtent2D extent);
+    // copy the finished frame into the slot's readback buffer, after every other pass touching the backbuffer.
+    // Adds nothing if the frame isn't captured
+    void AddPass(RenderGraph& graph, VkCommandBuffer commandBuffer, uint32_t slot, RGResource backbuffer, VkImage image, VkExtent2D extent);
+    // Once the slot's frame has finished, hands its capture to the writer, which copies it out before the slot's
+    // next frame can overwrite it
+    void ReadBack(uint32_t slot);
+
+    // Once the GPU is idle: hands over the frames still in flight oldest first, waits for the writer and prints
+    // what it did. Returns false if a frame didn't match its golden image, or had none to compare with
+    bool Finish();
+
+private:
+    struct Slot
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkMemoryPropertyFlags memoryProperties = 0;     // of the type memory was allocated from
+        std::byte* mapped = nullptr;
+        VkDeviceSize size = 0;
+        bool written = false;
+        uint64_t frame = 0;
+        VkExtent2D extent = {};
+    };
+
+    // whether the frame being prepared or recorded is captured
+    bool IsCaptured() const;
+
+    VkPhysicalDevice                m_PhysicalDevice;
+    VkDevice                        m_Device;
+    DeletionQueue&                  m_DeletionQueue;
+    Settings                        m_Settings;
+    std::unique_ptr<FrameWriter>    m_Writer;
+    std::vector<Slot>               m_Slots;                    // per frame in flight
+};
+#endif
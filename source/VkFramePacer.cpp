@@ -0,0 +1,184 @@
+#if VK_AVAILABLE
+#include "VkFramePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+    // how long to block on a single present before giving up on measuring it, for example when minimized
+    constexpr uint64_t PresentWaitTimeoutNs = 100'000'000;
+
+    // slack left when sleeping, to absorb scheduler jitter and GPU time we don't measure
+    constexpr double SleepMarginMs = 2.0;
+
+    // weight of the newest sample in the running averages
+    constexpr double SmoothingFactor = 0.1;
+
+    double Smooth(double average, double sample)
+    {
+        return average == 0 ? sample : average + (sample - average) * SmoothingFactor;
+    }
+}
+
+void FramePacer::LatencyStats::Add(double ms)
+{
+    frames++;
+    totalMs += ms;
+    minMs = std::min(minMs, ms);
+    maxMs = std::max(maxMs, ms);
+}
+
+FramePacer::FramePacer(VkDevice device, const Settings& settings, bool presentWaitEnabled)
+    : m_Device(device),
+    m_Settings(settings),
+    m_PresentWaitEnabled(presentWaitEnabled)
+{
+    m_Settings.maxQueuedFrames = std::max(m_Settings.maxQueuedFrames, 1u);
+    if (m_PresentWaitEnabled)
+    {
+        m_WaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_Device, "vkWaitForPresentKHR");
+        m_PresentWaitEnabled = m_WaitForPresent != nullptr;
+    }
+}
+
+const char* FramePacer::GetPresentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    default:
+        return "unknown";
+    }
+}
+
+VkPresentModeKHR FramePacer::ChoosePresentMode(const std::vector<VkPresentModeKHR>& availableModes) const
+{
+    auto isAvailable = [&availableModes](VkPresentModeKHR mode) {
+        return std::find(availableModes.begin(), availableModes.end(), mode) != availableModes.end();
+    };
+    if (m_Settings.presentMode && isAvailable(*m_Settings.presentMode))
+    {
+        return *m_Settings.presentMode;
+    }
+    if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR))
+    {
+        return VK_PRESENT_MODE_MAILBOX_KHR;     // use Mailbox on high-perf devices
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;            // always supported
+}
+
+uint32_t FramePacer::ChooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const
+{
+    // one extra image than necessary by default, so we never wait on the driver for one
+    uint32_t imageCount = m_Settings.imageCount != 0 ? m_Settings.imageCount : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0)
+    {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);  // 0 means no limit
+    }
+    return imageCount;
+}
+
+void FramePacer::FrameDisplayed(const PendingFrame& frame, Clock::time_point time)
+{
+    double latencyMs = std::chrono::duration<double, std::milli>(time - frame.inputTime).count();
+    m_RecentStats.Add(latencyMs);
+    m_TotalStats.Add(latencyMs);
+
+    if (m_LastDisplayTime)
+    {
+        double intervalMs = std::chrono::duration<double, std::milli>(time - *m_LastDisplayTime).count();
+        m_FrameIntervalMs = Smooth(m_FrameIntervalMs, intervalMs);
+    }
+    m_LastDisplayTime = time;
+}
+
+void FramePacer::WaitForNextFrame(VkSwapchainKHR swapchain)
+{
+    if (swapchain != m_Swapchain)
+    {
+        // recreated since the last present, what's still queued belonged to the old one
+        m_Pending.clear();
+    }
+
+    if (m_PresentWaitEnabled)
+    {
+        // keep at most maxQueuedFrames between input sampling and the display.
+        // Anything presented to an older swapchain can't be waited on anymore, so it goes unmeasured
+        while (!m_Pending.empty() && m_Pending.front().presentId < m_SwapchainFirstId)
+        {
+            m_Pending.pop_front();
+        }
+        while (m_Pending.size() >= m_Settings.maxQueuedFrames)
+        {
+            auto frame = m_Pending.front();
+            m_Pending.pop_front();
+            if (m_WaitForPresent(m_Device, swapchain, frame.presentId, PresentWaitTimeoutNs) == VK_SUCCESS)
+            {
+                FrameDisplayed(frame, Clock::now());
+            }
+        }
+        // pick up anything else that has already made it to the screen
+        while (!m_Pending.empty() && m_WaitForPresent(m_Device, swapchain, m_Pending.front().presentId, 0) == VK_SUCCESS)
+        {
+            FrameDisplayed(m_Pending.front(), Clock::now());
+            m_Pending.pop_front();
+        }
+    }
+
+    // there are only display times to work from with present wait
+    if (m_Settings.lowLatencySleep && m_LastDisplayTime && m_FrameIntervalMs > 0)
+    {
+        // the next free display slot is one interval after everything still queued,
+        // so start just early enough for the CPU work to make it
+        double slotMs = m_FrameIntervalMs * (m_Pending.size() + 1);
+        double leadMs = m_CpuTimeMs + SleepMarginMs;
+        auto wakeTime = *m_LastDisplayTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(slotMs - leadMs));
+
+        // never sleep longer than a frame, the estimates may be stale after a hitch
+        auto latestWake = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_FrameIntervalMs));
+        std::this_thread::sleep_until(std::min(wakeTime, latestWake));
+    }
+
+    m_InputTime = Clock::now();
+}
+
+const void* FramePacer::OnPresent(VkSwapchainKHR swapchain)
+{
+    auto now = Clock::now();
+    m_CpuTimeMs = Smooth(m_CpuTimeMs, std::chrono::duration<double, std::milli>(now - m_InputTime).count());
+
+    uint64_t presentId = ++m_LastPresentId;
+    if (swapchain != m_Swapchain)
+    {
+        m_Swapchain = swapchain;
+        m_SwapchainFirstId = presentId;
+    }
+    if (!m_PresentWaitEnabled)
+    {
+        return nullptr;
+    }
+    m_Pending.push_back({ presentId, m_InputTime });
+    m_PresentIdValue = presentId;
+    m_PresentIdInfo = VkPresentIdKHR{
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &m_PresentIdValue
+    };
+    return &m_PresentIdInfo;
+}
+
+FramePacer::LatencyStats FramePacer::TakeRecentStats()
+{
+    auto stats = m_RecentStats;
+    m_RecentStats = {};
+    return stats;
+}
+#endif
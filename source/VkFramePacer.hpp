@@ -0,0 +1,104 @@
+/**
+ * Controls how far the CPU runs ahead of the display, trading throughput for input-to-photon latency.
+ * Chooses the present mode and swapchain image count, tags presents with VK_KHR_present_id and waits on them
+ * with VK_KHR_present_wait where available, and can sleep just before input is sampled so each frame starts as late as it can.
+ * Latency is measured per frame, from input sampling until the frame is seen on screen. Without present wait there is
+ * no way to see that, so nothing is measured and frames are only paced by the swapchain and the frames in flight.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <chrono>   // For std::chrono::steady_clock
+#include <cstdint>  // For uint32_t, uint64_t
+#include <deque>    // For std::deque
+#include <limits>   // For std::numeric_limits
+#include <optional> // For std::optional
+#include <vector>   // For std::vector
+
+class FramePacer
+{
+public:
+    struct Settings
+    {
+        std::optional<VkPresentModeKHR> presentMode;    // unset prefers mailbox, then fifo
+        uint32_t imageCount = 0;                        // 0 uses one more than the surface minimum
+        uint32_t maxQueuedFrames = 2;                   // frames allowed between input sampling and display, needs present wait
+        bool lowLatencySleep = false;                   // sleep before input sampling to start the frame just in time, needs present wait
+    };
+
+    struct LatencyStats
+    {
+        uint64_t frames = 0;
+        double totalMs = 0;
+        double minMs = std::numeric_limits<double>::max();
+        double maxMs = 0;
+
+        void Add(double ms);
+        double AverageMs() const {
+            return frames == 0 ? 0.0 : totalMs / frames;
+        }
+    };
+
+    // presentWaitEnabled means VK_KHR_present_id and VK_KHR_present_wait were enabled on the device.
+    FramePacer(VkDevice device, const Settings& settings, bool presentWaitEnabled);
+    virtual ~FramePacer() = default;
+
+    VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availableModes) const;
+    uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const;
+
+    // Block until the next frame should start, then mark the moment input is sampled.
+    void WaitForNextFrame(VkSwapchainKHR swapchain);
+
+    // Call when presenting a frame. Returns the struct to chain onto VkPresentInfoKHR::pNext, or nullptr.
+    const void* OnPresent(VkSwapchainKHR swapchain);
+
+    bool IsPresentWaitEnabled() const {
+        return m_PresentWaitEnabled;
+    }
+
+    // Latency since the last call, to report periodically. Always empty without present wait.
+    LatencyStats TakeRecentStats();
+    const LatencyStats& GetTotalStats() const {
+        return m_TotalStats;
+    }
+
+    static const char* GetPresentModeName(VkPresentModeKHR mode);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingFrame
+    {
+        uint64_t presentId;
+        Clock::time_point inputTime;
+    };
+
+    void FrameDisplayed(const PendingFrame& frame, Clock::time_point time);
+
+    VkDevice                    m_Device;
+    Settings                    m_Settings;
+    bool                        m_PresentWaitEnabled;
+    PFN_vkWaitForPresentKHR     m_WaitForPresent = nullptr;
+
+    // ids only have to increase per swapchain, and only the current swapchain's ids can be waited on
+    VkSwapchainKHR              m_Swapchain = VK_NULL_HANDLE;
+    uint64_t                    m_SwapchainFirstId = 1;
+    uint64_t                    m_LastPresentId = 0;
+    uint64_t                    m_PresentIdValue = 0;
+    VkPresentIdKHR              m_PresentIdInfo{};
+
+    std::deque<PendingFrame>    m_Pending;          // presented, but not yet seen on screen
+    Clock::time_point           m_InputTime;
+
+    // running estimates for the just-in-time sleep
+    std::optional<Clock::time_point> m_LastDisplayTime;
+    double                      m_FrameIntervalMs = 0;
+    double                      m_CpuTimeMs = 0;
+
+    LatencyStats                m_RecentStats;
+    LatencyStats                m_TotalStats;
+};
+#endif
@@ -0,0 +1,197 @@
+#if VK_AVAILABLE
+#include "VkLodScene.hpp"
+#include "MeshSimplifier.hpp"
+#include "FrameArena.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+
+constexpr uint32_t LOD_COMPARE_FRAMES = 120;
+constexpr uint32_t LOD_SPHERE_RINGS = 96;       // about 37k triangles per sphere, like the meshlet scene
+constexpr float LOD_SPACING = 3.0f;
+constexpr float LOD_NEAR = 0.1f;
+constexpr float LOD_PIXEL_ERROR = 1.0f;         // how far a level may stray from the full mesh on screen, in pixels
+
+VkLodScene::VkLodScene(const VkSceneContext& context, const Settings& settings)
+    : VkScene(context),
+    m_Settings(settings),
+    m_SelectionUsed(context.framesInFlight)
+{
+    // generated at startup, the same simplifier --bench-lod measures
+    m_Mesh = MakeSphereMesh(LOD_SPHERE_RINGS);
+    auto generateStart = std::chrono::steady_clock::now();
+    GenerateLods(m_Mesh, LodSettings{});
+    double generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generateStart).count();
+    auto levels = m_Mesh.lods.size();
+
+    m_InstancesPerRow = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_Settings.instances))));
+    m_Positions.resize(m_Settings.instances);
+    m_Levels.resize(m_Settings.instances);
+    for (uint32_t i = 0; i < m_Settings.instances; i++) {
+        float x = (i % m_InstancesPerRow - 0.5f * (m_InstancesPerRow - 1)) * LOD_SPACING;
+        m_Positions[i] = glm::vec3(x, 0.0f, -float(i / m_InstancesPerRow) * LOD_SPACING);
+    }
+    for (auto& stats : m_Stats) {
+        stats.levelInstances.assign(levels, 0);
+    }
+
+    // only written once, like the meshlet scene's buffers
+    VkDeviceMemory memory;
+    CreateFilledBuffer(std::as_bytes(std::span(m_Mesh.vertices)), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VertexBuffer, memory);
+    CreateFilledBuffer(std::as_bytes(std::span(m_Mesh.indices)), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer, memory);
+    CreateMappedBuffers(sizeof(glm::vec4) * m_Settings.instances, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_InstanceBuffers, m_InstancesMapped);
+    m_LevelCounts.assign(m_Context.framesInFlight, std::vector<uint32_t>(levels, 0));
+
+    m_Layout = CreatePipelineLayout({}, VK_SHADER_STAGE_VERTEX_BIT, sizeof(Constants));
+
+    // the meshlet scene's fragment shader, colouring by level instead of by meshlet
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        ShaderStage(VK_SHADER_STAGE_VERTEX_BIT, LoadShader("lod.vert.spv")),
+        ShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, LoadShader("meshlet.frag.spv")),
+    };
+    VkVertexInputBindingDescription bindingDescriptions[] = {
+        { .binding = 0, .stride = sizeof(MeshVertex), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX },
+        { .binding = 1, .stride = sizeof(glm::vec4), .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE }
+    };
+    VkVertexInputAttributeDescription attributeDescriptions[] = {
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(MeshVertex, position) },
+        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(MeshVertex, normal) },
+        { .location = 2, .binding = 1, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = 0 }
+    };
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = static_cast<uint32_t>(std::size(bindingDescriptions)),
+        .pVertexBindingDescriptions = bindingDescriptions,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(attributeDescriptions)),
+        .pVertexAttributeDescriptions = attributeDescriptions
+    };
+    // the projection flips y, so the sphere's counter-clockwise outside stays counter-clockwise on screen.
+    // Drawn in the main pass, so it has to match it
+    m_Pipeline = CreatePipeline({
+        .stages = shaderStages,
+        .layout = m_Layout,
+        .vertexInput = &vertexInputInfo,
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+    });
+
+    std::string chain;
+    for (const auto& lod : m_Mesh.lods) {
+        chain += std::format("{}{}", chain.empty() ? "" : " > ", lod.indexCount / 3);
+    }
+    std::cout << std::format("LOD scene: {} instances, {} levels of {} triangles, generated in {:.1f} ms{}",
+        m_Settings.instances, levels, chain, generateMs,
+        m_Settings.compare ? std::format(", full detail every other {} frames", LOD_COMPARE_FRAMES) : "") << std::endl;
+}
+
+VkLodScene::Camera VkLodScene::GetCamera(VkExtent2D extent) const
+{
+    float x = std::sin(GetFrame() * 0.005f) * m_InstancesPerRow * LOD_SPACING * 0.3f;
+    glm::vec3 position(x, 3.0f, 4.0f);
+    return {
+        glm::lookAt(position, position + glm::vec3(0.0f, -0.15f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        ReverseZInfinitePerspective(glm::radians(60.0f), static_cast<float>(extent.width) / extent.height, LOD_NEAR),
+        position
+    };
+}
+
+void VkLodScene::PrepareFrame(uint32_t slot, VkExtent2D extent)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool selecting = !m_Settings.compare || (GetFrame() / LOD_COMPARE_FRAMES) % 2 == 0;
+    m_Extent = extent;
+    auto camera = GetCamera(extent);
+    // how many pixels one unit covers one unit in front of the camera
+    float pixelsPerUnit = std::abs(camera.projection[1][1]) * extent.height * 0.5f;
+
+    auto& counts = m_LevelCounts[slot];
+    std::fill(counts.begin(), counts.end(), 0u);
+    for (uint32_t i = 0; i < m_Settings.instances; i++) {
+        // the sphere's closest point, which is where its error shows most
+        float distance = glm::length(m_Positions[i] - camera.position) - 1.0f;
+        m_Levels[i] = selecting ? SelectLod(m_Mesh, distance, pixelsPerUnit, LOD_PIXEL_ERROR) : 0;
+        counts[m_Levels[i]]++;
+    }
+    std::pmr::vector<uint32_t> offsets(counts.size(), m_Context.frameArenas->GetResource());
+    uint64_t triangles = 0;
+    for (size_t level = 0, offset = 0; level < counts.size(); level++) {
+        offsets[level] = static_cast<uint32_t>(offset);
+        offset += counts[level];
+        triangles += uint64_t(counts[level]) * m_Mesh.lods[level].indexCount / 3;
+    }
+    for (uint32_t i = 0; i < m_Settings.instances; i++) {
+        m_InstancesMapped[slot][offsets[m_Levels[i]]++] = glm::vec4(m_Positions[i], static_cast<float>(m_Levels[i]));
+    }
+    m_SelectionUsed[slot] = selecting;
+
+    auto& stats = m_Stats[selecting];
+    stats.frames++;
+    stats.triangles += triangles;
+    for (size_t level = 0; level < counts.size(); level++) {
+        stats.levelInstances[level] += counts[level];
+    }
+    stats.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// one instanced draw per level, each reading its own range of the shared index buffer. The camera is the one the
+// levels were picked with, whatever resolution the scene is rendered at
+void VkLodScene::Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D /*extent*/)
+{
+    auto camera = GetCamera(m_Extent);
+    Constants constants{
+        .view = camera.view,
+        .projection = camera.projection
+    };
+    VkBuffer buffers[] = { m_VertexBuffer, m_InstanceBuffers[slot] };
+    VkDeviceSize offsets[] = { 0, 0 };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+    vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(std::size(buffers)), buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdPushConstants(commandBuffer, m_Layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    const auto& counts = m_LevelCounts[slot];
+    for (uint32_t level = 0, firstInstance = 0; level < counts.size(); level++) {
+        if (counts[level] > 0) {
+            const auto& lod = m_Mesh.lods[level];
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, counts[level], lod.firstIndex, 0, firstInstance);
+        }
+        firstInstance += counts[level];
+    }
+}
+
+void VkLodScene::AddGpuTime(uint32_t slot, double ms)
+{
+    auto& stats = m_Stats[m_SelectionUsed[slot]];
+    stats.timedFrames++;
+    stats.gpuMs += ms;
+}
+
+void VkLodScene::PrintStats() const
+{
+    for (uint32_t selecting = 0; selecting < 2; selecting++) {
+        const auto& stats = m_Stats[selecting];
+        if (stats.frames == 0) {
+            continue;
+        }
+        auto frames = static_cast<double>(stats.frames);
+        uint64_t fullTriangles = uint64_t(m_Settings.instances) * m_Mesh.lods[0].indexCount / 3;
+        std::cout << std::format("LOD scene ({} instances, {}): {:.0f} of {} triangles drawn per frame, picked in {:.3f} ms",
+            m_Settings.instances, selecting ? "LOD selection" : "full detail", stats.triangles / frames, fullTriangles, stats.cpuMs / frames);
+        if (stats.timedFrames > 0) {
+            std::cout << std::format(", {:.3f} ms GPU per frame", stats.gpuMs / stats.timedFrames);
+        }
+        std::cout << ", instances per level:";
+        for (auto count : stats.levelInstances) {
+            std::cout << std::format(" {:.0f}", count / frames);
+        }
+        std::cout << std::endl;
+    }
+}
+#endif
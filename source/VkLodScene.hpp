@@ -0,0 +1,79 @@
+/**
+ * LOD benchmark (--lod=N): N copies of a dense sphere on a grid stretching away from the camera, with a chain of
+ * simplified levels generated at startup. Every frame the CPU picks each copy's level from how big it is on screen,
+ * and each level is drawn once, instanced. --lod-compare draws every copy at full detail for every other block of
+ * frames.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkScene.hpp"
+#include "Mesh.hpp"
+
+#include <cstdint>  // For uint32_t, uint64_t
+#include <vector>   // For std::vector
+
+class VkLodScene : public VkScene
+{
+public:
+    struct Settings
+    {
+        uint32_t instances = 64;
+        bool compare = false;
+    };
+
+    VkLodScene(const VkSceneContext& context, const Settings& settings);
+    virtual ~VkLodScene() {}
+
+    // Picks every instance's level and writes the instances grouped by level into the slot's buffer.
+    // The GPU finished with the slot when its fence was waited on
+    void PrepareFrame(uint32_t slot, VkExtent2D extent) final;
+    void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    void AddGpuTime(uint32_t slot, double ms) final;
+    void PrintStats() const final;
+
+private:
+    struct Constants
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+    };  // must match lod.vert
+
+    struct Camera
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 position;
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t triangles = 0;
+        std::vector<uint64_t> levelInstances;
+        double cpuMs = 0;
+        uint64_t timedFrames = 0;
+        double gpuMs = 0;
+    };
+
+    // sliding along the front row, looking down the grid
+    Camera GetCamera(VkExtent2D extent) const;
+
+    Settings                            m_Settings;
+    Mesh                                m_Mesh;                 // every level's indices back to back
+    uint32_t                            m_InstancesPerRow = 1;
+    std::vector<glm::vec3>              m_Positions;
+    std::vector<uint32_t>               m_Levels;               // picked this frame, per instance
+    VkExtent2D                          m_Extent = {};          // the camera's, as of the last frame prepared
+    VkBuffer                            m_VertexBuffer = VK_NULL_HANDLE;
+    VkBuffer                            m_IndexBuffer = VK_NULL_HANDLE;
+    std::vector<VkBuffer>               m_InstanceBuffers;      // positions grouped by level, written by the CPU
+    std::vector<glm::vec4*>             m_InstancesMapped;      // w is the level
+    std::vector<std::vector<uint32_t>>  m_LevelCounts;          // instances of each level, per frame in flight
+    std::vector<bool>                   m_SelectionUsed;
+    VkPipelineLayout                    m_Layout = VK_NULL_HANDLE;
+    VkPipeline                          m_Pipeline = VK_NULL_HANDLE;
+    Stats                               m_Stats[2];             // [0] everything at full detail, [1] picking levels
+};
+#endif
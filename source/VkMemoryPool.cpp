@@ -0,0 +1,162 @@
+#if VK_AVAILABLE
+#include "VkMemoryPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+DeviceMemoryPool::DeviceMemoryPool(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+    : m_PhysicalDevice(physicalDevice),
+    m_Device(device),
+    m_BlockSize(blockSize)
+{
+}
+
+DeviceMemoryPool::~DeviceMemoryPool()
+{
+    for (auto& block : m_Blocks)
+    {
+        if (block.memory != VK_NULL_HANDLE)
+        {
+            vkFreeMemory(m_Device, block.memory, nullptr);
+        }
+    }
+}
+
+DeviceMemoryPool::Allocation DeviceMemoryPool::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties)
+{
+    uint32_t memoryType = FindMemoryType(m_PhysicalDevice, requirements.memoryTypeBits, properties);
+
+    Allocation allocation{ .size = requirements.size };
+    bool found = false;
+    if (requirements.size <= m_BlockSize)
+    {
+        for (uint32_t i = 0; i < m_Blocks.size() && !found; i++)
+        {
+            auto& block = m_Blocks[i];
+            if (block.memory != VK_NULL_HANDLE && !block.dedicated && block.memoryType == memoryType && TryAllocate(block, requirements, allocation.offset))
+            {
+                allocation.block = i;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            allocation.block = CreateBlock(memoryType, m_BlockSize, false);
+            found = TryAllocate(m_Blocks[allocation.block], requirements, allocation.offset);
+        }
+    }
+    else
+    {
+        // the whole block is this one resource
+        allocation.block = CreateBlock(memoryType, requirements.size, true);
+        found = TryAllocate(m_Blocks[allocation.block], requirements, allocation.offset);
+    }
+    if (!found)
+    {
+        throw std::runtime_error("failed to sub-allocate device memory!");
+    }
+    allocation.memory = m_Blocks[allocation.block].memory;
+
+    m_Stats.allocations++;
+    m_Stats.bytesInUse += allocation.size;
+    m_Stats.peakBytesInUse = std::max(m_Stats.peakBytesInUse, m_Stats.bytesInUse);
+    return allocation;
+}
+
+void DeviceMemoryPool::Free(const Allocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    auto& block = m_Blocks[allocation.block];
+    m_Stats.frees++;
+    m_Stats.bytesInUse -= allocation.size;
+
+    if (block.dedicated)
+    {
+        vkFreeMemory(m_Device, block.memory, nullptr);
+        m_Stats.bytesReserved -= block.size;
+        block = {};
+        m_FreeBlockSlots.push_back(allocation.block);
+        return;
+    }
+
+    // merge with the free ranges on either side, so the block doesn't fragment into slivers
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size = allocation.size;
+    auto next = block.freeRanges.lower_bound(offset);
+    if (next != block.freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = block.freeRanges.erase(next);
+    }
+    if (next != block.freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    block.freeRanges.emplace(offset, size);
+}
+
+bool DeviceMemoryPool::TryAllocate(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset)
+{
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+    {
+        auto [start, length] = *it;
+        VkDeviceSize aligned = (start + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+        if (aligned + requirements.size > start + length)
+        {
+            continue;
+        }
+        // whatever is left before and after the resource stays free
+        block.freeRanges.erase(it);
+        if (aligned > start)
+        {
+            block.freeRanges.emplace(start, aligned - start);
+        }
+        VkDeviceSize end = aligned + requirements.size;
+        if (end < start + length)
+        {
+            block.freeRanges.emplace(end, start + length - end);
+        }
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+uint32_t DeviceMemoryPool::CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated)
+{
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryType
+    };
+    Block block{
+        .memoryType = memoryType,
+        .size = size,
+        .dedicated = dedicated
+    };
+    VK_CHECK(vkAllocateMemory(m_Device, &allocInfo, nullptr, &block.memory));
+    block.freeRanges.emplace(0, size);
+
+    m_Stats.blocksCreated++;
+    m_Stats.dedicatedBlocks += dedicated ? 1 : 0;
+    m_Stats.bytesReserved += size;
+
+    if (!m_FreeBlockSlots.empty())
+    {
+        uint32_t index = m_FreeBlockSlots.back();
+        m_FreeBlockSlots.pop_back();
+        m_Blocks[index] = std::move(block);
+        return index;
+    }
+    m_Blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(m_Blocks.size() - 1);
+}
+#endif
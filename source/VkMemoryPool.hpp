@@ -0,0 +1,76 @@
+/**
+ * Sub-allocates images (or buffers) out of large VkDeviceMemory blocks, instead of a vkAllocateMemory per resource.
+ * Drivers cap how many allocations can exist at once (maxMemoryAllocationCount, often 4096) and each one is slow,
+ * so a scene with many textures can't give each its own. Blocks are kept per memory type, and each block keeps its
+ * free ranges sorted by offset so neighbours merge back together when freed. Anything bigger than a block gets a
+ * dedicated block of its own, released as soon as it is freed.
+ * Keep buffers and images in separate pools, so bufferImageGranularity never has to be considered.
+ * Freeing doesn't wait for the GPU: free an allocation only once nothing in flight uses the resource bound to it.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <cstdint>  // For uint32_t, uint64_t
+#include <map>      // For std::map
+#include <vector>   // For std::vector
+
+class DeviceMemoryPool
+{
+public:
+    struct Allocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t block = 0;         // index into the pool's blocks
+    };
+
+    struct Stats
+    {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t blocksCreated = 0;     // vkAllocateMemory calls, dedicated blocks included
+        uint64_t dedicatedBlocks = 0;
+        VkDeviceSize bytesInUse = 0;    // the sizes live allocations asked for. Gaps left to align them stay free
+        VkDeviceSize peakBytesInUse = 0;
+        VkDeviceSize bytesReserved = 0; // in blocks that currently exist
+    };
+
+    DeviceMemoryPool(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64ull << 20);
+    virtual ~DeviceMemoryPool();
+
+    // Find room for a resource with these requirements in memory with these properties, growing the pool if needed.
+    Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties);
+    // Hand the range back. The GPU must no longer be using whatever was bound to it.
+    void Free(const Allocation& allocation);
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;     // null once a dedicated block has been released
+        uint32_t memoryType = 0;
+        VkDeviceSize size = 0;
+        bool dedicated = false;
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;    // offset to size
+    };
+
+    // first fit, splitting the range it takes from
+    bool TryAllocate(Block& block, const VkMemoryRequirements& requirements, VkDeviceSize& offset);
+    uint32_t CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated);
+
+    VkPhysicalDevice        m_PhysicalDevice;
+    VkDevice                m_Device;
+    VkDeviceSize            m_BlockSize;
+
+    std::vector<Block>      m_Blocks;
+    std::vector<uint32_t>   m_FreeBlockSlots;   // released dedicated blocks, for the next one to reuse
+    Stats                   m_Stats;
+};
+#endif
@@ -0,0 +1,175 @@
+#if VK_AVAILABLE
+#include "VkMeshletScene.hpp"
+#include "VkDescriptorAllocator.hpp"
+#include "VkDeletionQueue.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+
+constexpr uint32_t MESHLET_COMPARE_FRAMES = 120;
+constexpr uint32_t MESHLET_SPHERE_RINGS = 96;       // about 37k triangles per sphere
+constexpr uint32_t MESHLETS_PER_TASK = 32;          // must match local_size_x in meshlet.task
+constexpr float MESHLET_SPACING = 3.0f;
+constexpr float MESHLET_NEAR = 0.1f;
+
+VkMeshletScene::VkMeshletScene(const VkSceneContext& context, const Settings& settings)
+    : VkScene(context),
+    m_Settings(settings),
+    m_CountersWritten(context.framesInFlight),
+    m_CullingUsed(context.framesInFlight)
+{
+    // built at startup, the same builder --bench-meshlets measures
+    auto mesh = MakeSphereMesh(MESHLET_SPHERE_RINGS);
+    auto buildStart = std::chrono::steady_clock::now();
+    MeshletBuilder builder(m_Settings.builder);
+    auto meshlets = builder.Build(mesh.vertices, mesh.indices);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    m_MeshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+    m_InstancesPerRow = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_Settings.instances))));
+
+    // only written once, like the occlusion scene's objects
+    VkDeviceMemory memory;
+    CreateFilledBuffer(std::as_bytes(std::span(meshlets.meshlets)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Buffers[0], memory);
+    CreateFilledBuffer(std::as_bytes(std::span(meshlets.bounds)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Buffers[1], memory);
+    CreateFilledBuffer(std::as_bytes(std::span(meshlets.vertices)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Buffers[2], memory);
+    CreateFilledBuffer(std::as_bytes(std::span(meshlets.triangles)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Buffers[3], memory);
+    CreateFilledBuffer(std::as_bytes(std::span(mesh.vertices)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Buffers[4], memory);
+    CreateMappedBuffers(sizeof(Counters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_CounterBuffers, m_CountersMapped);
+    for (auto* counters : m_CountersMapped) {
+        *counters = {};
+    }
+
+    // everything is read by whichever stages do the geometry
+    VkShaderStageFlags stages = UsesMeshShaders() ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutBinding bindings[6];
+    for (uint32_t i = 0; i < std::size(bindings); i++) {
+        bindings[i] = {
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = stages
+        };
+    }
+    m_SetLayout = CreateSetLayout(bindings);
+    m_Layout = CreatePipelineLayout(std::span(&m_SetLayout, 1), stages, sizeof(Constants));
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+    if (UsesMeshShaders()) {
+        shaderStages.push_back(ShaderStage(VK_SHADER_STAGE_TASK_BIT_EXT, LoadShader("meshlet.task.spv")));
+        shaderStages.push_back(ShaderStage(VK_SHADER_STAGE_MESH_BIT_EXT, LoadShader("meshlet.mesh.spv")));
+    }
+    else {
+        shaderStages.push_back(ShaderStage(VK_SHADER_STAGE_VERTEX_BIT, LoadShader("meshlet.vert.spv")));
+    }
+    shaderStages.push_back(ShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, LoadShader("meshlet.frag.spv")));
+
+    // mesh shader pipelines have no vertex input or input assembly, the vertex shader path has no vertex buffers.
+    // The projection flips y, so the sphere's counter-clockwise outside stays counter-clockwise on screen.
+    // Drawn in the main pass, so it has to match it
+    m_Pipeline = CreatePipeline({
+        .stages = shaderStages,
+        .layout = m_Layout,
+        .meshShaders = UsesMeshShaders(),
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+    });
+
+    size_t triangles = mesh.indices.size() / 3;
+    std::cout << std::format("Meshlet scene: {} instances of {} triangles in {} meshlets ({:.1f} triangles, {:.1f} vertices each), built in {:.1f} ms, {}{}",
+        m_Settings.instances, triangles, m_MeshletCount, double(triangles) / m_MeshletCount, double(meshlets.vertices.size()) / m_MeshletCount, buildMs,
+        UsesMeshShaders() ? "task and mesh shaders" : "vertex shader",
+        m_Settings.compare ? std::format(", culling off every other {} frames", MESHLET_COMPARE_FRAMES) : "") << std::endl;
+}
+
+// every instance of the mesh, with the task shader culling meshlets or the vertex shader collapsing them
+void VkMeshletScene::Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent)
+{
+    bool culling = !m_Settings.compare || (GetFrame() / MESHLET_COMPARE_FRAMES) % 2 == 0;
+    m_CullingUsed[slot] = culling;
+
+    // the camera circles the grid of spheres, looking down at it
+    float angle = GetFrame() * 0.005f;
+    float distance = std::max(m_InstancesPerRow * MESHLET_SPACING * 0.6f, 4.0f);
+    glm::vec3 position(std::cos(angle) * distance, distance * 0.4f, std::sin(angle) * distance);
+    auto projection = ReverseZInfinitePerspective(glm::radians(60.0f), static_cast<float>(extent.width) / extent.height, MESHLET_NEAR);
+    Constants constants{
+        .view = glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        .p00 = projection[0][0],
+        .p11 = -projection[1][1],
+        .zNear = MESHLET_NEAR,
+        .meshletCount = m_MeshletCount,
+        .cameraPosition = position,
+        .instancesPerRow = m_InstancesPerRow,
+        .instanceSpacing = MESHLET_SPACING,
+        .culling = culling ? 1u : 0u
+    };
+    DescriptorAllocator::Binding bindings[] = {
+        DescriptorAllocator::Binding::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers[0], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers[1], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers[2], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers[3], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_CounterBuffers[slot], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers[4], 0, VK_WHOLE_SIZE)
+    };
+    auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_SetLayout, bindings);
+    VkShaderStageFlags stages = UsesMeshShaders() ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Layout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_Layout, stages, 0, sizeof(constants), &constants);
+    if (UsesMeshShaders()) {
+        // a task workgroup per 32 meshlets of each instance
+        m_Settings.cmdDrawMeshTasks(commandBuffer, (m_MeshletCount + MESHLETS_PER_TASK - 1) / MESHLETS_PER_TASK, m_Settings.instances, 1);
+        m_CountersWritten[slot] = true;
+    }
+    else {
+        // every meshlet is an instance with room for its largest possible triangle count
+        vkCmdDraw(commandBuffer, m_Settings.builder.maxTriangles * 3, m_MeshletCount * m_Settings.instances, 0, 0);
+    }
+}
+
+void VkMeshletScene::ReadBack(uint32_t slot)
+{
+    if (!m_CountersWritten[slot]) {
+        return;
+    }
+    auto& counters = *m_CountersMapped[slot];
+    auto& stats = m_Stats[m_CullingUsed[slot]];
+    stats.frames++;
+    stats.tested += counters.tested;
+    stats.frustumCulled += counters.frustumCulled;
+    stats.coneCulled += counters.coneCulled;
+    counters = {};
+    m_CountersWritten[slot] = false;
+}
+
+void VkMeshletScene::AddGpuTime(uint32_t slot, double ms)
+{
+    auto& stats = m_Stats[m_CullingUsed[slot]];
+    stats.timedFrames++;
+    stats.gpuMs += ms;
+}
+
+void VkMeshletScene::PrintStats() const
+{
+    for (uint32_t culling = 0; culling < 2; culling++) {
+        const auto& stats = m_Stats[culling];
+        if (stats.timedFrames == 0) {
+            continue;
+        }
+        std::cout << std::format("Meshlet scene ({} instances, {}): {:.3f} ms GPU per frame",
+            m_Settings.instances, culling ? "meshlet culling" : "no culling", stats.gpuMs / stats.timedFrames);
+        // only the task shader counts what it culls
+        if (stats.frames > 0) {
+            auto frames = static_cast<double>(stats.frames);
+            std::cout << std::format(", {:.0f} of {:.0f} meshlets drawn per frame, {:.0f} outside the frustum, {:.0f} facing away",
+                (stats.tested - stats.frustumCulled - stats.coneCulled) / frames, stats.tested / frames, stats.frustumCulled / frames, stats.coneCulled / frames);
+        }
+        std::cout << std::endl;
+    }
+}
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Meshlet benchmark (--meshlets=N): N copies of a dense sphere split into meshlets, culled per meshlet against the
+ * frustum and each meshlet's normal cone before any of its vertices are read. Uses task and mesh shaders where
+ * VK_EXT_mesh_shader is supported, or --no-mesh-shaders pulls the same meshlets through a vertex shader.
+ * --meshlet-compare turns culling off for every other block of frames.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkScene.hpp"
+#include "Meshlet.hpp"
+
+#include <cstdint>  // For uint32_t, uint64_t
+#include <vector>   // For std::vector
+
+class VkMeshletScene : public VkScene
+{
+public:
+    struct Settings
+    {
+        uint32_t instances = 64;
+        bool compare = false;
+        PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks = nullptr;  // null draws with the vertex shader
+        MeshletBuilder::Settings builder = {};
+    };
+
+    VkMeshletScene(const VkSceneContext& context, const Settings& settings);
+    virtual ~VkMeshletScene() {}
+
+    void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    // the counters are host visible, so they are cleared here for the slot's next frame
+    void ReadBack(uint32_t slot) final;
+    void AddGpuTime(uint32_t slot, double ms) final;
+    void PrintStats() const final;
+
+private:
+    struct Constants
+    {
+        glm::mat4 view;
+        float p00;
+        float p11;
+        float zNear;
+        uint32_t meshletCount;
+        glm::vec3 cameraPosition;
+        uint32_t instancesPerRow;
+        float instanceSpacing;
+        uint32_t culling;
+    };  // must match meshlet.task, meshlet.mesh and meshlet.vert
+
+    struct Counters
+    {
+        uint32_t tested;
+        uint32_t frustumCulled;
+        uint32_t coneCulled;
+    };  // must match Stats in meshlet.task
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t tested = 0;
+        uint64_t frustumCulled = 0;
+        uint64_t coneCulled = 0;
+        uint64_t timedFrames = 0;
+        double gpuMs = 0;
+    };
+
+    bool UsesMeshShaders() const {
+        return m_Settings.cmdDrawMeshTasks != nullptr;
+    }
+
+    Settings                    m_Settings;
+    uint32_t                    m_MeshletCount = 0;         // in one instance
+    uint32_t                    m_InstancesPerRow = 1;
+    VkBuffer                    m_Buffers[5] = {};          // meshlets, bounds, meshlet vertices, triangles and vertices
+    std::vector<VkBuffer>       m_CounterBuffers;           // per frame in flight
+    std::vector<Counters*>      m_CountersMapped;
+    std::vector<bool>           m_CountersWritten;
+    std::vector<bool>           m_CullingUsed;
+    VkDescriptorSetLayout       m_SetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout            m_Layout = VK_NULL_HANDLE;
+    VkPipeline                  m_Pipeline = VK_NULL_HANDLE;
+    Stats                       m_Stats[2];                 // [0] drawing every meshlet, [1] with culling
+};
+#endif
@@ -0,0 +1,597 @@
+#if VK_AVAILABLE
+#include "VkOcclusionScene.hpp"
+#include "VkDescriptorAllocator.hpp"
+#include "VkDeletionQueue.hpp"
+#include "VkRenderGraph.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <random>
+
+constexpr uint32_t OCCLUSION_COMPARE_FRAMES = 120;
+constexpr uint32_t OCCLUDER_STRIDE = 50;        // every 50th object is one of the big ones
+constexpr float OCCLUSION_NEAR = 0.1f;
+
+VkOcclusionScene::VkOcclusionScene(const VkSceneContext& context, const Settings& settings)
+    : VkScene(context),
+    m_Settings(settings),
+    m_CountersWritten(context.framesInFlight),
+    m_CullingUsed(context.framesInFlight)
+{
+    // a few big objects near the camera, with lots of small ones scattered behind them
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Object> objects(m_Settings.objects);
+    for (uint32_t i = 0; i < m_Settings.objects; i++) {
+        if (i % OCCLUDER_STRIDE == 0) {
+            objects[i].sphere = { unit(rng) * 40.0f, unit(rng) * 4.0f, -20.0f + unit(rng) * 5.0f, 4.5f + unit(rng) * 1.5f };
+        }
+        else {
+            objects[i].sphere = { unit(rng) * 60.0f, unit(rng) * 10.0f, -110.0f + unit(rng) * 85.0f, 0.65f + unit(rng) * 0.35f };
+        }
+    }
+    VkDeviceMemory memory;
+    CreateFilledBuffer(std::as_bytes(std::span(objects)), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_ObjectBuffer, memory);
+
+    // only the GPU touches these, apart from the counts read back after each frame
+    CreateBuffer(sizeof(uint32_t) * m_Settings.objects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_VisibilityBuffer, memory);
+    CreateBuffer(sizeof(VkDrawIndirectCommand) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DrawBuffer, memory);
+    CreateBuffer(sizeof(uint32_t) * m_Settings.objects * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_IndexBuffer, memory);
+    CreateMappedBuffers(sizeof(Counters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_CounterBuffers, m_CountersMapped);
+
+    if (m_Settings.cpu) {
+        for (const auto& object : objects) {
+            glm::vec3 center(object.sphere);
+            glm::vec3 radius(object.sphere.w);
+            m_Bounds.push_back({ center - radius, center + radius });
+        }
+        for (uint32_t i = 0; i < m_Settings.objects; i += OCCLUDER_STRIDE) {
+            m_Occluders.push_back(objects[i]);
+        }
+        m_Visible.resize(m_Settings.objects);
+        // written every frame, so it lives where the CPU can write it directly
+        CreateMappedBuffers(sizeof(uint32_t) * m_Settings.objects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_CpuIndexBuffers, m_CpuIndicesMapped);
+        m_CpuDrawCounts.resize(m_Context.framesInFlight);
+        m_WorkerPool = std::make_unique<WorkerPool>();
+        m_SoftwareOcclusion = std::make_unique<SoftwareOcclusion>(*m_WorkerPool, SoftwareOcclusion::Settings{});
+    }
+
+    // the shaders only use texelFetch, which ignores filtering, but sampled images still need a sampler
+    VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod = VK_LOD_CLAMP_NONE
+    };
+    VK_CHECK(vkCreateSampler(m_Context.device, &samplerInfo, nullptr, &m_Sampler));
+
+    // sets come from the descriptor allocator while recording, these only describe them
+    constexpr auto binding = [](uint32_t index, VkDescriptorType type, VkShaderStageFlags stages) {
+        return VkDescriptorSetLayoutBinding{
+            .binding = index,
+            .descriptorType = type,
+            .descriptorCount = 1,
+            .stageFlags = stages
+        };
+    };
+    VkDescriptorSetLayoutBinding cullBindings[] = {
+        binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),     // objects
+        binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),     // visibility
+        binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),     // draw commands
+        binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),     // visible indices
+        binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),     // stats
+        binding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)  // depth pyramid
+    };
+    m_CullSetLayout = CreateSetLayout(cullBindings);
+    VkDescriptorSetLayoutBinding pyramidBindings[] = {
+        binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),
+        binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+    };
+    m_PyramidSetLayout = CreateSetLayout(pyramidBindings);
+    VkDescriptorSetLayoutBinding drawBindings[] = {
+        binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+    };
+    m_DrawSetLayout = CreateSetLayout(drawBindings);
+
+    // the two compute pipelines
+    m_CullLayout = CreatePipelineLayout(std::span(&m_CullSetLayout, 1), VK_SHADER_STAGE_COMPUTE_BIT, sizeof(CullConstants));
+    m_CullPipeline = CreateComputePipeline(LoadShader("occlusion_cull.comp.spv"), m_CullLayout);
+    m_PyramidLayout = CreatePipelineLayout(std::span(&m_PyramidSetLayout, 1), 0, 0);
+    m_PyramidPipeline = CreateComputePipeline(LoadShader("depth_pyramid.comp.spv"), m_PyramidLayout);
+
+    // the objects get the overdraw scene's expensive fragment shader, so every hidden one that is still drawn costs something
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        ShaderStage(VK_SHADER_STAGE_VERTEX_BIT, LoadShader("occlusion.vert.spv")),
+        ShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, LoadShader("overdraw.frag.spv")),
+    };
+    m_DrawLayout = CreatePipelineLayout(std::span(&m_DrawSetLayout, 1), VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawConstants));
+    // no vertex buffers, the quads are made from gl_VertexIndex and the object list.
+    // Only ever drawn with dynamic rendering, which VkApp checks before creating the scene
+    m_DrawPipeline = CreatePipeline({
+        .stages = shaderStages,
+        .layout = m_DrawLayout,
+        .alwaysDynamicRendering = true,
+    });
+
+    CreateTargets(m_Settings.depthImage, m_Settings.depthExtent);
+
+    auto culling = m_Settings.cpu
+        ? std::format("culled on {} CPU threads{}", m_WorkerPool->GetThreadCount(), m_SoftwareOcclusion->IsSimdEnabled() ? " with AVX2" : "")
+        : std::format("{}x{} depth pyramid with {} levels", m_PyramidExtent.width, m_PyramidExtent.height, m_PyramidLevelViews.size());
+    std::cout << std::format("Occlusion scene: {} objects, {}{}", m_Settings.objects, culling,
+        m_Settings.compare ? std::format(", occlusion culling off every other {} frames", OCCLUSION_COMPARE_FRAMES) : "") << std::endl;
+}
+
+VkOcclusionScene::~VkOcclusionScene()
+{
+    RetireTargets();
+    vkDestroySampler(m_Context.device, m_Sampler, nullptr);
+}
+
+// the hierarchical depth buffer, rebuilt from the depth buffer every frame
+void VkOcclusionScene::CreateTargets(VkImage depthImage, VkExtent2D extent)
+{
+    m_DepthExtent = extent;
+    // culling on the CPU doesn't need the depth pyramid
+    if (m_Settings.cpu) {
+        return;
+    }
+
+    m_PyramidExtent = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+    uint32_t levels = 1;
+    for (auto levelExtent = m_PyramidExtent; levelExtent.width > 1 || levelExtent.height > 1; levels++) {
+        levelExtent = { (levelExtent.width + 1) / 2, (levelExtent.height + 1) / 2 };
+    }
+
+    auto device = m_Context.device;
+    auto* deletionQueue = m_Context.deletionQueue;
+    VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .extent = { m_PyramidExtent.width, m_PyramidExtent.height, 1 },
+        .mipLevels = levels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    VK_CHECK(vkCreateImage(device, &imageInfo, nullptr, &m_Pyramid));
+    deletionQueue->Track(VK_OBJECT_TYPE_IMAGE, m_Pyramid);
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, m_Pyramid, &memRequirements);
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memRequirements.size,
+        .memoryTypeIndex = FindMemoryType(m_Context.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &m_PyramidMemory));
+    deletionQueue->Track(VK_OBJECT_TYPE_DEVICE_MEMORY, m_PyramidMemory);
+    vkBindImageMemory(device, m_Pyramid, m_PyramidMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = m_Pyramid,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .subresourceRange{
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = levels,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_PyramidView));
+    deletionQueue->Track(VK_OBJECT_TYPE_IMAGE_VIEW, m_PyramidView);
+    m_PyramidLevelViews.resize(levels);
+    for (uint32_t level = 0; level < levels; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_PyramidLevelViews[level]));
+        deletionQueue->Track(VK_OBJECT_TYPE_IMAGE_VIEW, m_PyramidLevelViews[level]);
+    }
+
+    // level 0 is built by sampling the depth buffer
+    viewInfo.image = depthImage;
+    viewInfo.format = m_Context.depthFormat;
+    viewInfo.subresourceRange = {
+        .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+    };
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_DepthSampledView));
+    deletionQueue->Track(VK_OBJECT_TYPE_IMAGE_VIEW, m_DepthSampledView);
+}
+
+// frames in flight may still be using the old pyramid, so it goes through the deletion queue like the depth buffer
+void VkOcclusionScene::RetireTargets()
+{
+    if (m_Pyramid == VK_NULL_HANDLE) {
+        return;
+    }
+    auto* deletionQueue = m_Context.deletionQueue;
+    deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE_VIEW, m_DepthSampledView);
+    for (auto view : m_PyramidLevelViews) {
+        deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE_VIEW, view);
+    }
+    deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE_VIEW, m_PyramidView);
+    deletionQueue->Retire(VK_OBJECT_TYPE_IMAGE, m_Pyramid);
+    deletionQueue->Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, m_PyramidMemory);
+    m_DepthSampledView = VK_NULL_HANDLE;
+    m_PyramidLevelViews.clear();
+    m_PyramidView = VK_NULL_HANDLE;
+    m_Pyramid = VK_NULL_HANDLE;
+    m_PyramidMemory = VK_NULL_HANDLE;
+    // cached sets still point at the old views, and new views may get the same handles
+    m_Context.descriptorAllocator->Invalidate();
+}
+
+VkOcclusionScene::Camera VkOcclusionScene::GetCamera() const
+{
+    float x = std::sin(GetFrame() * 0.01f) * 20.0f;
+    glm::mat4 view(1.0f);
+    view[3] = glm::vec4(-x, 0.0f, 0.0f, 1.0f);     // looking down -z, only the position changes
+    return {
+        view,
+        ReverseZInfinitePerspective(glm::radians(60.0f), static_cast<float>(m_DepthExtent.width) / m_DepthExtent.height, OCCLUSION_NEAR)
+    };
+}
+
+bool VkOcclusionScene::CullingThisFrame() const
+{
+    return !m_Settings.compare || (GetFrame() / OCCLUSION_COMPARE_FRAMES) % 2 == 0;
+}
+
+// Frames that only compare against frustum culling rasterize nothing
+void VkOcclusionScene::PrepareFrame(uint32_t slot, VkExtent2D /*extent*/)
+{
+    if (!m_Settings.cpu) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto camera = GetCamera();
+    bool culling = CullingThisFrame();
+
+    // the same quads occlusion.vert draws. The camera never turns, so they stay facing down z
+    m_OccluderTriangles.clear();
+    if (culling) {
+        for (const auto& occluder : m_Occluders) {
+            glm::vec3 center(occluder.sphere);
+            float size = occluder.sphere.w * 0.7f;
+            glm::vec3 corners[] = {
+                center + glm::vec3(-size, -size, 0.0f), center + glm::vec3(size, -size, 0.0f),
+                center + glm::vec3(size, size, 0.0f), center + glm::vec3(-size, size, 0.0f)
+            };
+            for (int corner : { 0, 1, 2, 0, 2, 3 }) {
+                m_OccluderTriangles.push_back(corners[corner]);
+            }
+        }
+    }
+    m_SoftwareOcclusion->RenderOccluders(camera.projection * camera.view, m_OccluderTriangles);
+    m_SoftwareOcclusion->TestBounds(m_Bounds, m_Visible);
+
+    // the GPU finished with this slot's list when its fence was waited on
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < m_Settings.objects; i++) {
+        if (m_Visible[i]) {
+            m_CpuIndicesMapped[slot][count++] = i;
+        }
+    }
+    m_CpuDrawCounts[slot] = count;
+    m_CullingUsed[slot] = culling;
+
+    auto& stats = m_CpuStats[culling];
+    stats.frames++;
+    stats.drawn += count;
+    stats.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void VkOcclusionScene::RecordCull(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t phase)
+{
+    // the graph only tracks textures, so the buffers get their barriers here
+    if (phase == 0) {
+        // wait for last frame's culling and draws to be done with them
+        VkMemoryBarrier previousFrame{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &previousFrame, 0, nullptr, 0, nullptr);
+
+        if (!m_VisibilityCleared) {
+            // nothing was visible before the first frame, so phase 1 finds and draws everything
+            vkCmdFillBuffer(commandBuffer, m_VisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+            m_VisibilityCleared = true;
+        }
+        // the culling shader counts instances up from zero. Phase 1's list is the second half of the index buffer
+        VkDrawIndirectCommand draws[] = {
+            { .vertexCount = 6, .instanceCount = 0, .firstVertex = 0, .firstInstance = 0 },
+            { .vertexCount = 6, .instanceCount = 0, .firstVertex = 0, .firstInstance = m_Settings.objects }
+        };
+        vkCmdUpdateBuffer(commandBuffer, m_DrawBuffer, 0, sizeof(draws), draws);
+        vkCmdFillBuffer(commandBuffer, m_CounterBuffers[slot], 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier cleared{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cleared, 0, nullptr, 0, nullptr);
+        m_CullingUsed[slot] = CullingThisFrame();
+    }
+
+    auto camera = GetCamera();
+    CullConstants constants{
+        .view = camera.view,
+        .p00 = camera.projection[0][0],
+        .p11 = -camera.projection[1][1],
+        .zNear = OCCLUSION_NEAR,
+        .objectCount = m_Settings.objects,
+        .depthSize = { m_DepthExtent.width, m_DepthExtent.height },
+        .phase = phase,
+        .occlusionCulling = m_CullingUsed[slot] ? 1u : 0u
+    };
+    DescriptorAllocator::Binding bindings[] = {
+        DescriptorAllocator::Binding::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_ObjectBuffer, 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_VisibilityBuffer, 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_DrawBuffer, 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_IndexBuffer, 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_CounterBuffers[slot], 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Image(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_PyramidView, m_Sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+    };
+    auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_CullSetLayout, bindings);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_CullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (m_Settings.objects + 63) / 64, 1, 1);
+
+    // the draw reads the commands and lists, the next phase adds to the counts, and the CPU reads the counts after the frame
+    VkMemoryBarrier culled{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &culled, 0, nullptr, 0, nullptr);
+    if (phase == 1) {
+        m_CountersWritten[slot] = true;
+    }
+}
+
+void VkOcclusionScene::RecordDraw(VkCommandBuffer commandBuffer, uint32_t slot, const Targets& targets, uint32_t phase)
+{
+    VkAttachmentLoadOp loadOp = phase == 0 ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = targets.colorView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = loadOp,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = { .color = {{0.0f, 0.0f, 0.0f, 1.0f}} },
+    };
+    // the pyramid is built from this, and the main pass carries on from it
+    VkRenderingAttachmentInfo depthAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = targets.depthView,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .loadOp = loadOp,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = { .depthStencil = { 0.0f, 0 } },    // reverse-Z, 0 is infinitely far away
+    };
+    VkRenderingInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = targets.extent
+        },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = &depthAttachment,
+    };
+    m_Context.cmdBeginRendering(commandBuffer, &renderingInfo);
+    SetViewportAndScissor(commandBuffer, targets.extent);
+
+    auto camera = GetCamera();
+    DrawConstants constants{
+        .view = camera.view,
+        .projection = camera.projection
+    };
+    DescriptorAllocator::Binding bindings[] = {
+        DescriptorAllocator::Binding::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_ObjectBuffer, 0, VK_WHOLE_SIZE),
+        DescriptorAllocator::Binding::Buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Settings.cpu ? m_CpuIndexBuffers[slot] : m_IndexBuffer, 0, VK_WHOLE_SIZE)
+    };
+    auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_DrawSetLayout, bindings);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_DrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    if (m_Settings.cpu) {
+        vkCmdDraw(commandBuffer, 6, m_CpuDrawCounts[slot], 0, 0);
+    }
+    else {
+        // the instance count is whatever the culling shader counted, the CPU never sees it
+        vkCmdDrawIndirect(commandBuffer, m_DrawBuffer, phase * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+    }
+
+    m_Context.cmdEndRendering(commandBuffer);
+}
+
+void VkOcclusionScene::RecordDepthPyramid(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipeline);
+    auto extent = m_PyramidExtent;
+    for (uint32_t level = 0; level < m_PyramidLevelViews.size(); level++) {
+        DescriptorAllocator::Binding bindings[] = {
+            level == 0
+                ? DescriptorAllocator::Binding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_DepthSampledView, m_Sampler, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)
+                : DescriptorAllocator::Binding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_PyramidLevelViews[level - 1], m_Sampler, VK_IMAGE_LAYOUT_GENERAL),
+            DescriptorAllocator::Binding::Image(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_PyramidLevelViews[level], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
+        };
+        auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_PyramidSetLayout, bindings);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+
+        // the next level reads this one. The whole pyramid stays in GENERAL until the graph moves it on
+        VkMemoryBarrier written{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &written, 0, nullptr, 0, nullptr);
+        extent = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+    }
+}
+
+void VkOcclusionScene::AddPasses(RenderGraph& graph, VkRenderGraphExecutor& executor, VkCommandBuffer commandBuffer, uint32_t slot, const Targets& targets)
+{
+    // the execute callbacks run after this function has returned, so they capture by value
+    auto target = targets.color;
+    auto depth = targets.depth;
+    // culled on the CPU before recording, so there's only the drawing left
+    if (m_Settings.cpu) {
+        graph.AddPass("occlusion draw",
+            [=](RenderGraph::PassBuilder& pass) {
+                pass.Write(target, ResourceState::ColorAttachment);
+                pass.Write(depth, ResourceState::DepthAttachment);
+            },
+            [=, this] {
+                RecordDraw(commandBuffer, slot, targets, 0);
+            }
+        );
+        return;
+    }
+
+    RenderGraph::TextureDesc pyramidDesc{
+        .width = m_PyramidExtent.width,
+        .height = m_PyramidExtent.height,
+        .format = static_cast<uint32_t>(VK_FORMAT_R32_SFLOAT)
+    };
+    // rebuilt from scratch every frame
+    auto pyramid = graph.ImportTexture("depth pyramid", pyramidDesc, ResourceState::Undefined, ResourceState::ShaderRead);
+    executor.BindImported(pyramid, m_Pyramid, m_PyramidView);
+
+    graph.AddPass("occlusion cull early",
+        [=](RenderGraph::PassBuilder& pass) {
+            // the pyramid is bound for both phases, though only phase 1 samples it
+            pass.Read(pyramid, ResourceState::ShaderRead);
+            pass.SideEffects();     // writes the draw buffers, which the graph can't see
+        },
+        [=, this] {
+            RecordCull(commandBuffer, slot, 0);
+        }
+    );
+    graph.AddPass("occlusion draw early",
+        [=](RenderGraph::PassBuilder& pass) {
+            pass.Write(target, ResourceState::ColorAttachment);
+            pass.Write(depth, ResourceState::DepthAttachment);
+        },
+        [=, this] {
+            RecordDraw(commandBuffer, slot, targets, 0);
+        }
+    );
+    graph.AddPass("depth pyramid",
+        [=](RenderGraph::PassBuilder& pass) {
+            pass.Read(depth, ResourceState::DepthRead);
+            pass.Write(pyramid, ResourceState::Storage);
+        },
+        [=, this] {
+            RecordDepthPyramid(commandBuffer);
+        }
+    );
+    graph.AddPass("occlusion cull late",
+        [=](RenderGraph::PassBuilder& pass) {
+            pass.Read(pyramid, ResourceState::ShaderRead);
+            pass.SideEffects();
+        },
+        [=, this] {
+            RecordCull(commandBuffer, slot, 1);
+        }
+    );
+    graph.AddPass("occlusion draw late",
+        [=](RenderGraph::PassBuilder& pass) {
+            pass.Write(target, ResourceState::ColorAttachment);
+            pass.Write(depth, ResourceState::DepthAttachment);
+        },
+        [=, this] {
+            RecordDraw(commandBuffer, slot, targets, 1);
+        }
+    );
+}
+
+void VkOcclusionScene::ReadBack(uint32_t slot)
+{
+    if (!m_CountersWritten[slot]) {
+        return;
+    }
+    const auto& counters = *m_CountersMapped[slot];
+    auto& stats = m_Stats[m_CullingUsed[slot]];
+    stats.frames++;
+    stats.drawnEarly += counters.drawnEarly;
+    stats.drawnLate += counters.drawnLate;
+    stats.frustumCulled += counters.frustumCulled;
+    stats.occlusionCulled += counters.occlusionCulled;
+    m_CountersWritten[slot] = false;
+}
+
+void VkOcclusionScene::AddGpuTime(uint32_t slot, double ms)
+{
+    auto& stats = m_Stats[m_CullingUsed[slot]];
+    stats.timedFrames++;
+    stats.gpuMs += ms;
+}
+
+void VkOcclusionScene::PrintStats() const
+{
+    for (uint32_t culling = 0; culling < 2; culling++) {
+        const auto& stats = m_Stats[culling];
+        if (stats.frames == 0) {
+            continue;
+        }
+        auto frames = static_cast<double>(stats.frames);
+        std::cout << std::format("Occlusion scene ({} objects, {}): {:.0f} drawn per frame ({:.0f} visible last frame, {:.0f} disoccluded), {:.0f} outside the frustum, {:.0f} occluded, {:.3f} ms GPU per frame",
+            m_Settings.objects, culling ? "occlusion culling" : "frustum culling only", (stats.drawnEarly + stats.drawnLate) / frames,
+            stats.drawnEarly / frames, stats.drawnLate / frames, stats.frustumCulled / frames, stats.occlusionCulled / frames,
+            stats.timedFrames > 0 ? stats.gpuMs / stats.timedFrames : 0.0) << std::endl;
+    }
+    for (uint32_t culling = 0; culling < 2; culling++) {
+        const auto& stats = m_CpuStats[culling];
+        if (stats.frames == 0) {
+            continue;
+        }
+        auto frames = static_cast<double>(stats.frames);
+        const auto& gpuStats = m_Stats[culling];
+        std::cout << std::format("Occlusion scene ({} objects, {} on the CPU): {:.0f} drawn per frame, {:.3f} ms CPU, {:.3f} ms GPU per frame",
+            m_Settings.objects, culling ? "occlusion culling" : "frustum culling only", stats.drawn / frames, stats.cpuMs / frames,
+            gpuStats.timedFrames > 0 ? gpuStats.gpuMs / gpuStats.timedFrames : 0.0) << std::endl;
+    }
+    if (m_SoftwareOcclusion) {
+        const auto& stats = m_SoftwareOcclusion->GetStats();
+        std::cout << std::format("Software occlusion: {} occluder triangles rasterized, {} skipped, {} of {} bounds culled",
+            stats.triangles, stats.trianglesSkipped, stats.objectsCulled, stats.objects) << std::endl;
+    }
+    // GPU time only. Both halves of --occlusion-compare build the pyramid when culling on the GPU, so this is what skipping the hidden objects saved
+    if (m_Stats[0].timedFrames > 0 && m_Stats[1].timedFrames > 0) {
+        double withoutMs = m_Stats[0].gpuMs / m_Stats[0].timedFrames;
+        double withMs = m_Stats[1].gpuMs / m_Stats[1].timedFrames;
+        std::cout << std::format("Occlusion culling saved {:.3f} ms GPU per frame ({:.0f}%)", withoutMs - withMs, withoutMs > 0 ? (withoutMs - withMs) / withoutMs * 100 : 0.0) << std::endl;
+    }
+}
+#endif
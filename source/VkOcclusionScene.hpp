@@ -0,0 +1,159 @@
+/**
+ * Occlusion culling benchmark (--occlusion=N): N objects, most of them hidden behind a few big ones, culled on the GPU
+ * in two phases against a hierarchical depth buffer. Phase 0 draws what was visible last frame, the depth pyramid is
+ * built from that, and phase 1 tests everything against it and draws what turned out to be visible as well.
+ * --cpu-occlusion culls on the CPU instead: the big objects are rasterized into a small depth buffer across a worker
+ * pool, and only the objects that pass are written into the draw list before recording. --occlusion-compare turns
+ * occlusion culling off for every other block of frames, to time what it saves in the same run.
+ * The scene draws ahead of the main pass with dynamic rendering, clearing the targets the main pass then loads.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkScene.hpp"
+#include "SoftwareOcclusion.hpp"
+
+#include <cstdint>  // For uint8_t, uint32_t, uint64_t
+#include <memory>   // For std::unique_ptr
+#include <vector>   // For std::vector
+
+class VkOcclusionScene : public VkScene
+{
+public:
+    struct Settings
+    {
+        uint32_t objects = 10000;
+        bool compare = false;
+        bool cpu = false;                           // --cpu-occlusion
+        VkImage depthImage = VK_NULL_HANDLE;        // the depth buffer to build the first pyramid from, it must be sampled
+        VkExtent2D depthExtent = {};
+    };
+
+    // the targets are created for the depth buffer in settings
+    VkOcclusionScene(const VkSceneContext& context, const Settings& settings);
+    virtual ~VkOcclusionScene();
+
+    void CreateTargets(VkImage depthImage, VkExtent2D extent) final;
+    void RetireTargets() final;
+    // --cpu-occlusion: rasterize the big objects and write everything that isn't behind them into the slot's draw list
+    void PrepareFrame(uint32_t slot, VkExtent2D extent) final;
+    void AddPasses(RenderGraph& graph, VkRenderGraphExecutor& executor, VkCommandBuffer commandBuffer, uint32_t slot, const Targets& targets) final;
+    void ReadBack(uint32_t slot) final;
+    void AddGpuTime(uint32_t slot, double ms) final;
+    void PrintStats() const final;
+
+private:
+    struct Object
+    {
+        glm::vec4 sphere;       // world space center and radius
+    };  // must match Object in occlusion_cull.comp and occlusion.vert
+
+    struct Counters
+    {
+        uint32_t drawnEarly;
+        uint32_t drawnLate;
+        uint32_t frustumCulled;
+        uint32_t occlusionCulled;
+    };  // must match Stats in occlusion_cull.comp
+
+    struct CullConstants
+    {
+        glm::mat4 view;
+        float p00;
+        float p11;
+        float zNear;
+        uint32_t objectCount;
+        glm::uvec2 depthSize;
+        uint32_t phase;
+        uint32_t occlusionCulling;
+    };  // must match occlusion_cull.comp
+
+    struct DrawConstants
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+    };  // must match occlusion.vert
+
+    struct Camera
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t drawnEarly = 0;
+        uint64_t drawnLate = 0;
+        uint64_t frustumCulled = 0;
+        uint64_t occlusionCulled = 0;
+        uint64_t timedFrames = 0;
+        double gpuMs = 0;
+    };
+
+    struct CpuStats
+    {
+        uint64_t frames = 0;
+        uint64_t drawn = 0;
+        double cpuMs = 0;
+    };
+
+    // slides from side to side, so objects keep coming out from behind the big ones
+    Camera GetCamera() const;
+    // whether this frame tests occlusion, or only the frustum to compare against
+    bool CullingThisFrame() const;
+
+    // phase 0 picks what was visible last frame, phase 1 tests everything against this frame's depth pyramid
+    void RecordCull(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t phase);
+    // draws the objects one culling phase picked. Phase 0 starts the frame, phase 1 adds to it
+    void RecordDraw(VkCommandBuffer commandBuffer, uint32_t slot, const Targets& targets, uint32_t phase);
+    // each level of the pyramid from the one below it, level 0 from the depth buffer
+    void RecordDepthPyramid(VkCommandBuffer commandBuffer);
+
+    Settings                            m_Settings;
+    VkExtent2D                          m_DepthExtent = {};
+    VkBuffer                            m_ObjectBuffer = VK_NULL_HANDLE;
+    VkBuffer                            m_VisibilityBuffer = VK_NULL_HANDLE;    // what phase 1 found visible, for the next frame's phase 0
+    bool                                m_VisibilityCleared = false;
+    VkBuffer                            m_DrawBuffer = VK_NULL_HANDLE;          // a VkDrawIndirectCommand per phase
+    VkBuffer                            m_IndexBuffer = VK_NULL_HANDLE;         // the objects each phase draws
+    std::vector<VkBuffer>               m_CounterBuffers;                       // per frame in flight
+    std::vector<Counters*>              m_CountersMapped;
+    std::vector<bool>                   m_CountersWritten;
+    std::vector<bool>                   m_CullingUsed;                          // whether each slot's frame tested occlusion
+
+    // farthest depth under each texel, level 0 is half the depth buffer's size. Only when culling on the GPU
+    VkImage                             m_Pyramid = VK_NULL_HANDLE;
+    VkDeviceMemory                      m_PyramidMemory = VK_NULL_HANDLE;
+    VkImageView                         m_PyramidView = VK_NULL_HANDLE;         // every level, for culling
+    std::vector<VkImageView>            m_PyramidLevelViews;                    // one per level, for building it
+    VkExtent2D                          m_PyramidExtent = {};
+    VkImageView                         m_DepthSampledView = VK_NULL_HANDLE;    // only the depth aspect, as sampled views can't have two
+    VkSampler                           m_Sampler = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout               m_CullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout               m_PyramidSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout               m_DrawSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout                    m_CullLayout = VK_NULL_HANDLE;
+    VkPipelineLayout                    m_PyramidLayout = VK_NULL_HANDLE;
+    VkPipelineLayout                    m_DrawLayout = VK_NULL_HANDLE;
+    VkPipeline                          m_CullPipeline = VK_NULL_HANDLE;
+    VkPipeline                          m_PyramidPipeline = VK_NULL_HANDLE;
+    VkPipeline                          m_DrawPipeline = VK_NULL_HANDLE;
+
+    // only with --cpu-occlusion
+    std::unique_ptr<WorkerPool>         m_WorkerPool;
+    std::unique_ptr<SoftwareOcclusion>  m_SoftwareOcclusion;
+    std::vector<SoftwareOcclusion::Bounds> m_Bounds;                            // around each object's sphere
+    std::vector<Object>                 m_Occluders;                            // the big ones
+    std::vector<glm::vec3>              m_OccluderTriangles;                    // rebuilt every frame, as they face the camera
+    std::vector<uint8_t>                m_Visible;
+    std::vector<VkBuffer>               m_CpuIndexBuffers;                      // the draw list, written by the CPU
+    std::vector<uint32_t*>              m_CpuIndicesMapped;
+    std::vector<uint32_t>               m_CpuDrawCounts;
+
+    Stats                               m_Stats[2];         // [0] with only frustum culling, [1] with occlusion culling too
+    CpuStats                            m_CpuStats[2];      // like m_Stats
+};
+#endif
@@ -0,0 +1,120 @@
+#if VK_AVAILABLE
+#include "VkOverdrawScene.hpp"
+
+#include <format>
+#include <iostream>
+
+VkOverdrawScene::VkOverdrawScene(const VkSceneContext& context, const Settings& settings)
+    : VkScene(context),
+    m_Settings(settings),
+    m_QueriedPixels(context.framesInFlight)
+{
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        ShaderStage(VK_SHADER_STAGE_VERTEX_BIT, LoadShader("overdraw.vert.spv")),
+        ShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, LoadShader("overdraw.frag.spv")),
+    };
+    m_Layout = CreatePipelineLayout({}, VK_SHADER_STAGE_VERTEX_BIT, sizeof(Constants));
+    // no vertex buffers, the quads are made from gl_VertexIndex and gl_InstanceIndex.
+    // Tests and writes depth itself, or after a pre-pass only shades the fragments that ended up closest
+    m_Pipeline = CreatePipeline({
+        .stages = shaderStages,
+        .layout = m_Layout,
+        .depthWrite = !m_Context.depthPrepass,
+        .depthCompareOp = m_Context.depthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_GREATER,
+    });
+
+    if (m_Context.depthPrepass) {
+        // the same vertex shader with no fragment shader or color target, all it does is test and write depth
+        m_PrepassPipeline = CreatePipeline({
+            .stages = std::span(shaderStages, 1),
+            .layout = m_Layout,
+            .depthOnly = true,
+        });
+    }
+
+    // fragment shader invocations divided by pixels is how many times each pixel was shaded
+    if (m_Settings.pipelineStatistics) {
+        VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+            .queryCount = m_Context.framesInFlight,
+            .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT,
+        };
+        VK_CHECK(vkCreateQueryPool(m_Context.device, &queryPoolInfo, nullptr, &m_QueryPool));
+    }
+    std::cout << std::format("Overdraw scene: {} layers, depth pre-pass {}", m_Settings.layers, m_Context.depthPrepass ? "on" : "off") << std::endl;
+}
+
+VkOverdrawScene::~VkOverdrawScene()
+{
+    vkDestroyQueryPool(m_Context.device, m_QueryPool, nullptr);
+}
+
+void VkOverdrawScene::BeginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    // count fragment shader invocations over the whole frame, to see how much was shaded more than once
+    if (m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, slot, 1);
+        vkCmdBeginQuery(commandBuffer, m_QueryPool, slot, 0);
+    }
+}
+
+void VkOverdrawScene::EndFrame(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent)
+{
+    if (m_QueryPool) {
+        vkCmdEndQuery(commandBuffer, m_QueryPool, slot);
+        m_QueriedPixels[slot] = uint64_t(extent.width) * extent.height;
+    }
+}
+
+void VkOverdrawScene::RecordLayers(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkExtent2D extent)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    Constants constants{
+        .projection = ReverseZInfinitePerspective(glm::radians(90.0f), static_cast<float>(extent.width) / extent.height, 0.1f),
+        .layerCount = m_Settings.layers
+    };
+    vkCmdPushConstants(commandBuffer, m_Layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    vkCmdDraw(commandBuffer, 6, m_Settings.layers, 0, 0);     // the quads are generated in the vertex shader
+}
+
+void VkOverdrawScene::RecordDepthPrepass(VkCommandBuffer commandBuffer, uint32_t, VkExtent2D extent)
+{
+    RecordLayers(commandBuffer, m_PrepassPipeline, extent);
+}
+
+void VkOverdrawScene::Record(VkCommandBuffer commandBuffer, uint32_t, VkExtent2D extent)
+{
+    RecordLayers(commandBuffer, m_Pipeline, extent);
+}
+
+void VkOverdrawScene::ReadBack(uint32_t slot)
+{
+    if (!m_QueryPool || m_QueriedPixels[slot] == 0) {
+        return;
+    }
+    uint64_t invocations;
+    if (vkGetQueryPoolResults(m_Context.device, m_QueryPool, slot, 1, sizeof(invocations), &invocations, sizeof(invocations), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        m_Stats.frames++;
+        m_Stats.fragmentInvocations += invocations;
+        m_Stats.pixels += m_QueriedPixels[slot];
+    }
+    m_QueriedPixels[slot] = 0;
+}
+
+void VkOverdrawScene::AddGpuTime(uint32_t, double ms)
+{
+    m_Stats.timedFrames++;
+    m_Stats.gpuMs += ms;
+}
+
+void VkOverdrawScene::PrintStats() const
+{
+    std::cout << std::format("Overdraw ({} layers, depth pre-pass {}): {:.3f} ms GPU per frame",
+        m_Settings.layers, m_Context.depthPrepass ? "on" : "off", m_Stats.timedFrames > 0 ? m_Stats.gpuMs / m_Stats.timedFrames : 0.0);
+    if (m_Stats.pixels > 0) {
+        std::cout << std::format(", {:.2f} fragment shader invocations per pixel", static_cast<double>(m_Stats.fragmentInvocations) / m_Stats.pixels);
+    }
+    std::cout << std::endl;
+}
+#endif
@@ -0,0 +1,63 @@
+/**
+ * Overdraw benchmark (--overdraw=N): N screen-covering layers drawn back to front with an expensive fragment shader.
+ * With the depth pre-pass the layers are drawn depth-only first, so the main pass only shades the closest one. Where
+ * the device can count fragment shader invocations, dividing them by the pixels rendered shows how many times each
+ * pixel was shaded.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkScene.hpp"
+
+#include <cstdint>  // For uint32_t, uint64_t
+#include <vector>   // For std::vector
+
+class VkOverdrawScene : public VkScene
+{
+public:
+    struct Settings
+    {
+        uint32_t layers = 32;
+        bool pipelineStatistics = false;    // the device can query fragment shader invocations
+    };
+
+    VkOverdrawScene(const VkSceneContext& context, const Settings& settings);
+    virtual ~VkOverdrawScene();
+
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t slot) final;
+    void EndFrame(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    void RecordDepthPrepass(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    void ReadBack(uint32_t slot) final;
+    void AddGpuTime(uint32_t slot, double ms) final;
+    void PrintStats() const final;
+
+private:
+    struct Constants
+    {
+        glm::mat4 projection;
+        uint32_t layerCount;
+    };  // must match overdraw.vert
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t fragmentInvocations = 0;
+        uint64_t pixels = 0;
+        uint64_t timedFrames = 0;
+        double gpuMs = 0;
+    };
+
+    // the layers, with either the pre-pass or the main pipeline bound
+    void RecordLayers(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkExtent2D extent);
+
+    Settings                m_Settings;
+    VkPipelineLayout        m_Layout = VK_NULL_HANDLE;
+    VkPipeline              m_Pipeline = VK_NULL_HANDLE;
+    VkPipeline              m_PrepassPipeline = VK_NULL_HANDLE;     // only with the depth pre-pass
+    VkQueryPool             m_QueryPool = VK_NULL_HANDLE;           // fragment shader invocations, one per frame in flight
+    std::vector<uint64_t>   m_QueriedPixels;                        // how many pixels each slot's frame rendered, 0 if nothing was queried
+    Stats                   m_Stats;
+};
+#endif
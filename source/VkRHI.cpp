@@ -0,0 +1,621 @@
+#if VK_AVAILABLE
+#include "VkRHI.hpp"
+#include "VkRenderGraph.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    VkBufferUsageFlags GetBufferUsage(RHIBufferUsage usage)
+    {
+        VkBufferUsageFlags flags = 0;
+        if (HasFlag(usage, RHIBufferUsage::Vertex)) flags |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        if (HasFlag(usage, RHIBufferUsage::Index)) flags |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        if (HasFlag(usage, RHIBufferUsage::Uniform)) flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        if (HasFlag(usage, RHIBufferUsage::Storage)) flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        if (HasFlag(usage, RHIBufferUsage::CopySrc)) flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        if (HasFlag(usage, RHIBufferUsage::CopyDst)) flags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        return flags;
+    }
+
+    VkImageUsageFlags GetTextureUsage(RHITextureUsage usage)
+    {
+        VkImageUsageFlags flags = 0;
+        if (HasFlag(usage, RHITextureUsage::RenderTarget)) flags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (HasFlag(usage, RHITextureUsage::DepthStencil)) flags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (HasFlag(usage, RHITextureUsage::Sampled)) flags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (HasFlag(usage, RHITextureUsage::Storage)) flags |= VK_IMAGE_USAGE_STORAGE_BIT;
+        if (HasFlag(usage, RHITextureUsage::CopySrc)) flags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        if (HasFlag(usage, RHITextureUsage::CopyDst)) flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        return flags;
+    }
+
+    VkFormat GetVertexFormat(RHIVertexFormat format)
+    {
+        switch (format)
+        {
+        case RHIVertexFormat::Float2:
+            return VK_FORMAT_R32G32_SFLOAT;
+        case RHIVertexFormat::Float3:
+            return VK_FORMAT_R32G32B32_SFLOAT;
+        case RHIVertexFormat::Float4:
+            return VK_FORMAT_R32G32B32A32_SFLOAT;
+        }
+        throw std::runtime_error("unknown vertex format!");
+    }
+
+    VkPrimitiveTopology GetTopology(RHITopology topology)
+    {
+        switch (topology)
+        {
+        case RHITopology::TriangleList:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        case RHITopology::TriangleStrip:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+        case RHITopology::LineList:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case RHITopology::PointList:
+            return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        }
+        throw std::runtime_error("unknown topology!");
+    }
+}
+
+void VkRHICommandList::Barrier(RHITexture texture, ResourceState state)
+{
+    auto& data = m_Device.FindTexture(texture);
+    auto before = VkRenderGraphExecutor::GetStateInfo(data.state);
+    auto after = VkRenderGraphExecutor::GetStateInfo(state);
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = before.access,
+        .dstAccessMask = after.access,
+        .oldLayout = before.layout,
+        .newLayout = after.layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = data.image,
+        .subresourceRange{
+            .aspectMask = VkRenderGraphExecutor::GetAspect(data.format),
+            .baseMipLevel = 0,
+            .levelCount = VK_REMAINING_MIP_LEVELS,
+            .baseArrayLayer = 0,
+            .layerCount = VK_REMAINING_ARRAY_LAYERS
+        }
+    };
+    vkCmdPipelineBarrier(m_CommandBuffer, before.stages, after.stages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    data.state = state;
+}
+
+void VkRHICommandList::BeginRenderPass(const RHIRenderPassDesc& desc)
+{
+    if (!m_Device.m_Settings.cmdBeginRendering)
+    {
+        throw std::runtime_error("RHI render passes need dynamic rendering!");
+    }
+    auto& color = m_Device.FindTexture(desc.colorTarget);
+    VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = color.view,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = { .color = {{ desc.clearColor[0], desc.clearColor[1], desc.clearColor[2], desc.clearColor[3] }} },
+    };
+    VkRenderingAttachmentInfo depthAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .clearValue = { .depthStencil = { desc.clearDepth, 0 } },
+    };
+    if (desc.depthTarget.IsValid())
+    {
+        auto& depth = m_Device.FindTexture(desc.depthTarget);
+        depthAttachment.imageView = depth.view;
+        // a pass that only tests against depth keeps it read-only
+        if (depth.state == ResourceState::DepthRead)
+        {
+            depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        }
+    }
+    VkRenderingInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = { color.width, color.height }
+        },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = desc.depthTarget.IsValid() ? &depthAttachment : nullptr,
+    };
+    m_Device.m_Settings.cmdBeginRendering(m_CommandBuffer, &renderingInfo);
+}
+
+void VkRHICommandList::EndRenderPass()
+{
+    m_Device.m_Settings.cmdEndRendering(m_CommandBuffer);
+}
+
+void VkRHICommandList::SetPipeline(RHIPipeline pipeline)
+{
+    auto& data = m_Device.FindPipeline(pipeline);
+    vkCmdBindPipeline(m_CommandBuffer, data.bindPoint, data.pipeline);
+}
+
+void VkRHICommandList::SetViewport(uint32_t width, uint32_t height)
+{
+    // the scissor always covers the viewport
+    VkViewport viewport{
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(width),
+        .height = static_cast<float>(height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+    VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = { width, height }
+    };
+    vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
+}
+
+void VkRHICommandList::SetVertexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    VkBuffer vertexBuffer = m_Device.FindBuffer(buffer).buffer;
+    VkDeviceSize vertexOffset = offset;
+    vkCmdBindVertexBuffers(m_CommandBuffer, 0, 1, &vertexBuffer, &vertexOffset);
+}
+
+void VkRHICommandList::SetIndexBuffer(RHIBuffer buffer, uint64_t offset)
+{
+    vkCmdBindIndexBuffer(m_CommandBuffer, m_Device.FindBuffer(buffer).buffer, offset, VK_INDEX_TYPE_UINT32);
+}
+
+void VkRHICommandList::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex)
+{
+    vkCmdDraw(m_CommandBuffer, vertexCount, instanceCount, firstVertex, 0);
+}
+
+void VkRHICommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex)
+{
+    vkCmdDrawIndexed(m_CommandBuffer, indexCount, instanceCount, firstIndex, 0, 0);
+}
+
+void VkRHICommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    vkCmdDispatch(m_CommandBuffer, x, y, z);
+}
+
+void VkRHICommandList::CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size)
+{
+    VkBufferCopy region{
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = size
+    };
+    vkCmdCopyBuffer(m_CommandBuffer, m_Device.FindBuffer(source).buffer, m_Device.FindBuffer(destination).buffer, 1, &region);
+}
+
+VkRHIDevice::VkRHIDevice(const Settings& settings)
+    : m_Settings(settings),
+    m_CommandBuffers(settings.device, settings.queueFamilyIndex, *settings.queue)
+{
+    // buffers are shared with these on top of the device's own queue family
+    std::erase(m_Settings.sharedWith, m_Settings.queueFamilyIndex);
+    if (!m_Settings.sharedWith.empty())
+    {
+        m_Settings.sharedWith.insert(m_Settings.sharedWith.begin(), m_Settings.queueFamilyIndex);
+    }
+}
+
+VkRHIDevice::~VkRHIDevice()
+{
+    m_Buffers.ForEachLive([this](BufferData& data) { Destroy(data); });
+    m_Textures.ForEachLive([this](TextureData& data) { Destroy(data); });
+    m_Pipelines.ForEachLive([this](PipelineData& data) { Destroy(data); });
+}
+
+VkRHIDevice::BufferData& VkRHIDevice::FindBuffer(RHIBuffer buffer)
+{
+    auto data = m_Buffers.Find(buffer);
+    if (!data)
+    {
+        throw std::runtime_error("RHI buffer handle isn't a live buffer!");
+    }
+    return *data;
+}
+
+VkRHIDevice::TextureData& VkRHIDevice::FindTexture(RHITexture texture)
+{
+    auto data = m_Textures.Find(texture);
+    if (!data)
+    {
+        throw std::runtime_error("RHI texture handle isn't a live texture!");
+    }
+    return *data;
+}
+
+VkRHIDevice::PipelineData& VkRHIDevice::FindPipeline(RHIPipeline pipeline)
+{
+    auto data = m_Pipelines.Find(pipeline);
+    if (!data)
+    {
+        throw std::runtime_error("RHI pipeline handle isn't a live pipeline!");
+    }
+    return *data;
+}
+
+VkFormat VkRHIDevice::GetVkFormat(RHIFormat format)
+{
+    switch (format)
+    {
+    case RHIFormat::Undefined:
+        return VK_FORMAT_UNDEFINED;
+    case RHIFormat::RGBA8Unorm:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case RHIFormat::BGRA8Unorm:
+        return VK_FORMAT_B8G8R8A8_UNORM;
+    case RHIFormat::RGBA16Float:
+        return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case RHIFormat::D32Float:
+        return VK_FORMAT_D32_SFLOAT;
+    }
+    throw std::runtime_error("unknown RHI format!");
+}
+
+RHIBuffer VkRHIDevice::CreateBuffer(const RHIBufferDesc& desc)
+{
+    BufferData data{ .size = desc.size };
+    VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = desc.size,
+        .usage = GetBufferUsage(desc.usage),
+        .sharingMode = m_Settings.sharedWith.empty() ? VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT,
+        .queueFamilyIndexCount = static_cast<uint32_t>(m_Settings.sharedWith.size()),
+        .pQueueFamilyIndices = m_Settings.sharedWith.data(),
+    };
+    VK_CHECK(vkCreateBuffer(m_Settings.device, &bufferInfo, nullptr, &data.buffer));
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_Settings.device, data.buffer, &memRequirements);
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memRequirements.size,
+        .memoryTypeIndex = FindMemoryType(m_Settings.physicalDevice, memRequirements.memoryTypeBits,
+            desc.hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    VK_CHECK(vkAllocateMemory(m_Settings.device, &allocInfo, nullptr, &data.memory));
+    VK_CHECK(vkBindBufferMemory(m_Settings.device, data.buffer, data.memory, 0));
+
+    // host visible buffers stay mapped, WriteBuffer is a memcpy
+    if (desc.hostVisible)
+    {
+        void* mapped;
+        VK_CHECK(vkMapMemory(m_Settings.device, data.memory, 0, desc.size, 0, &mapped));
+        data.mapped = static_cast<std::byte*>(mapped);
+    }
+    return m_Buffers.Allocate(data);
+}
+
+void VkRHIDevice::DestroyBuffer(RHIBuffer buffer)
+{
+    // destroying doesn't wait for the GPU, callers defer it with fences
+    Destroy(FindBuffer(buffer));
+    m_Buffers.Release(buffer);
+}
+
+void VkRHIDevice::WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data)
+{
+    auto& bufferData = FindBuffer(buffer);
+    if (!bufferData.mapped || offset + data.size() > bufferData.size)
+    {
+        throw std::runtime_error("WriteBuffer needs a host visible buffer big enough for the data!");
+    }
+    std::memcpy(bufferData.mapped + offset, data.data(), data.size());
+}
+
+RHITexture VkRHIDevice::CreateTexture(const RHITextureDesc& desc)
+{
+    TextureData data{
+        .format = GetVkFormat(desc.format),
+        .width = desc.width,
+        .height = desc.height,
+    };
+    VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = data.format,
+        .extent = { desc.width, desc.height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = GetTextureUsage(desc.usage),
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    VK_CHECK(vkCreateImage(m_Settings.device, &imageInfo, nullptr, &data.image));
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_Settings.device, data.image, &memRequirements);
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memRequirements.size,
+        .memoryTypeIndex = FindMemoryType(m_Settings.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    VK_CHECK(vkAllocateMemory(m_Settings.device, &allocInfo, nullptr, &data.memory));
+    VK_CHECK(vkBindImageMemory(m_Settings.device, data.image, data.memory, 0));
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = data.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = data.format,
+        .subresourceRange{
+            .aspectMask = VkRenderGraphExecutor::GetAspect(data.format),
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    VK_CHECK(vkCreateImageView(m_Settings.device, &viewInfo, nullptr, &data.view));
+    return m_Textures.Allocate(data);
+}
+
+void VkRHIDevice::DestroyTexture(RHITexture texture)
+{
+    Destroy(FindTexture(texture));
+    m_Textures.Release(texture);
+}
+
+VkShaderModule VkRHIDevice::LoadShader(std::string_view name)
+{
+    auto path = m_Settings.shaderDirectory / (std::string(name) + ".spv");
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error(std::format("failed to open {}", path.string()));
+    }
+    std::vector<char> code(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(code.data(), code.size());
+
+    VkShaderModuleCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = code.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(code.data())
+    };
+    VkShaderModule shaderModule;
+    VK_CHECK(vkCreateShaderModule(m_Settings.device, &createInfo, nullptr, &shaderModule));
+    return shaderModule;
+}
+
+RHIPipeline VkRHIDevice::CreatePipeline(const RHIPipelineDesc& desc)
+{
+    return CreatePipeline(desc, GetVkFormat(desc.colorFormat), GetVkFormat(desc.depthFormat));
+}
+
+RHIPipeline VkRHIDevice::CreatePipeline(const RHIPipelineDesc& desc, VkFormat colorFormat, VkFormat depthFormat)
+{
+    // nothing is bound but the pipeline and vertex buffers, so the layout is empty
+    PipelineData data;
+    VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+    };
+    VK_CHECK(vkCreatePipelineLayout(m_Settings.device, &layoutInfo, nullptr, &data.layout));
+
+    if (!desc.computeShader.empty())
+    {
+        VkShaderModule computeShader = LoadShader(desc.computeShader);
+        VkComputePipelineCreateInfo pipelineInfo{
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = computeShader,
+                .pName = "main"
+            },
+            .layout = data.layout
+        };
+        VK_CHECK(vkCreateComputePipelines(m_Settings.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &data.pipeline));
+        vkDestroyShaderModule(m_Settings.device, computeShader, nullptr);
+        data.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+        return m_Pipelines.Allocate(data);
+    }
+
+    VkShaderModule shaders[] = { LoadShader(desc.vertexShader), LoadShader(desc.fragmentShader) };
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = shaders[0],
+            .pName = "main"
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = shaders[1],
+            .pName = "main"
+        }
+    };
+    VkVertexInputBindingDescription binding{
+        .binding = 0,
+        .stride = desc.vertexStride,
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    };
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    for (uint32_t location = 0; location < desc.vertexAttributes.size(); location++)
+    {
+        attributes.push_back({
+            .location = location,
+            .binding = 0,
+            .format = GetVertexFormat(desc.vertexAttributes[location].format),
+            .offset = desc.vertexAttributes[location].offset
+        });
+    }
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = desc.vertexStride > 0 ? 1u : 0u,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+        .pVertexAttributeDescriptions = attributes.data()
+    };
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = GetTopology(desc.topology)
+    };
+    VkPipelineViewportStateCreateInfo viewportState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1       // both set by SetViewport
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .lineWidth = 1.0f
+    };
+    VkPipelineMultisampleStateCreateInfo multisampling{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .minSampleShading = 1.0f
+    };
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = VK_FALSE,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+    VkPipelineColorBlendStateCreateInfo colorBlending{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    // the RHI has no depth state yet, a depth target is only there to match the pass
+    VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+    };
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStates)),
+        .pDynamicStates = dynamicStates
+    };
+    VkPipelineRenderingCreateInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat,
+        .depthAttachmentFormat = depthFormat,
+    };
+    bool dynamicRendering = m_Settings.cmdBeginRendering != nullptr;
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = dynamicRendering ? &renderingInfo : nullptr,
+        .stageCount = static_cast<uint32_t>(std::size(shaderStages)),
+        .pStages = shaderStages,
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = data.layout,
+        .renderPass = dynamicRendering ? VK_NULL_HANDLE : m_Settings.renderPass,
+        .subpass = 0,
+        .basePipelineIndex = -1
+    };
+    VK_CHECK(vkCreateGraphicsPipelines(m_Settings.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &data.pipeline));
+    for (auto shader : shaders)
+    {
+        vkDestroyShaderModule(m_Settings.device, shader, nullptr);
+    }
+    return m_Pipelines.Allocate(data);
+}
+
+void VkRHIDevice::DestroyPipeline(RHIPipeline pipeline)
+{
+    Destroy(FindPipeline(pipeline));
+    m_Pipelines.Release(pipeline);
+}
+
+void VkRHIDevice::Destroy(BufferData& data)
+{
+    vkDestroyBuffer(m_Settings.device, data.buffer, nullptr);
+    vkFreeMemory(m_Settings.device, data.memory, nullptr);
+}
+
+void VkRHIDevice::Destroy(TextureData& data)
+{
+    vkDestroyImageView(m_Settings.device, data.view, nullptr);
+    vkDestroyImage(m_Settings.device, data.image, nullptr);
+    vkFreeMemory(m_Settings.device, data.memory, nullptr);
+}
+
+void VkRHIDevice::Destroy(PipelineData& data)
+{
+    vkDestroyPipeline(m_Settings.device, data.pipeline, nullptr);
+    vkDestroyPipelineLayout(m_Settings.device, data.layout, nullptr);
+}
+
+RHICommandList* VkRHIDevice::GetCommandList()
+{
+    // the command buffer's pool is what waits for the GPU, the list wrapping it can be reused straight away
+    VkCommandBuffer commandBuffer = m_CommandBuffers.GetCommandBuffer();
+    if (!m_FreeCommandLists.empty())
+    {
+        auto list = m_FreeCommandLists.back();
+        m_FreeCommandLists.pop_back();
+        list->m_CommandBuffer = commandBuffer;
+        return list;
+    }
+    m_CommandLists.push_back(std::make_unique<VkRHICommandList>(*this, commandBuffer));
+    return m_CommandLists.back().get();
+}
+
+uint64_t VkRHIDevice::ExecuteCommandList(RHICommandList* commandList)
+{
+    auto list = static_cast<VkRHICommandList*>(commandList);
+    uint64_t fenceValue = m_CommandBuffers.ExecuteCommandBuffer(list->m_CommandBuffer);
+    list->m_CommandBuffer = VK_NULL_HANDLE;
+    m_FreeCommandLists.push_back(list);
+    return fenceValue;
+}
+
+bool VkRHIDevice::IsFenceComplete(uint64_t fenceValue)
+{
+    return m_Settings.queue->IsFenceComplete(fenceValue);
+}
+
+void VkRHIDevice::WaitForFenceValue(uint64_t fenceValue)
+{
+    m_Settings.queue->WaitForFenceValue(fenceValue);
+}
+
+void VkRHIDevice::Flush()
+{
+    m_Settings.queue->Flush();
+}
+
+VkBuffer VkRHIDevice::GetVkBuffer(RHIBuffer buffer)
+{
+    return FindBuffer(buffer).buffer;
+}
+
+VkImage VkRHIDevice::GetVkImage(RHITexture texture)
+{
+    return FindTexture(texture).image;
+}
+#endif
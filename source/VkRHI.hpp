@@ -0,0 +1,152 @@
+/**
+ * RHI backend on Vulkan. Buffers and textures get a memory allocation each, host visible buffers stay mapped, and
+ * pipelines load <name>.spv from the shader directory and have no descriptor sets. Command lists are command buffers
+ * from a CommandBufferPool on the queue the device is given, so fence values are that queue's timeline values.
+ * Render passes use dynamic rendering. Without it, pipelines are built for a render pass the caller begins itself,
+ * and command lists can only draw inside it.
+ * Texture states are tracked as barriers are recorded, so command lists using the same texture have to be submitted
+ * in the order they were recorded. The native handles are there for whatever the RHI doesn't cover yet.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "RHI.hpp"
+#include "VkCommon.hpp"
+#include "VkCommandBufferPool.hpp"
+#include "VkTimelineQueue.hpp"
+
+#include <cstdint>      // For uint32_t, uint64_t
+#include <filesystem>   // For std::filesystem::path
+#include <memory>       // For std::unique_ptr
+#include <vector>       // For std::vector
+
+class VkRHIDevice;
+
+class VkRHICommandList : public RHICommandList
+{
+public:
+    // Record into a command buffer that has already begun, which the caller submits itself.
+    VkRHICommandList(VkRHIDevice& device, VkCommandBuffer commandBuffer) : m_Device(device), m_CommandBuffer(commandBuffer) {}
+
+    void Barrier(RHITexture texture, ResourceState state) final;
+    void BeginRenderPass(const RHIRenderPassDesc& desc) final;
+    void EndRenderPass() final;
+    void SetPipeline(RHIPipeline pipeline) final;
+    void SetViewport(uint32_t width, uint32_t height) final;
+    void SetVertexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void SetIndexBuffer(RHIBuffer buffer, uint64_t offset) final;
+    void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex) final;
+    void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex) final;
+    void Dispatch(uint32_t x, uint32_t y, uint32_t z) final;
+    void CopyBuffer(RHIBuffer source, RHIBuffer destination, uint64_t size) final;
+
+    VkCommandBuffer GetVkCommandBuffer() const {
+        return m_CommandBuffer;
+    }
+
+private:
+    friend class VkRHIDevice;
+
+    VkRHIDevice&    m_Device;
+    VkCommandBuffer m_CommandBuffer;
+};
+
+class VkRHIDevice : public RHIDevice
+{
+public:
+    struct Settings
+    {
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        TimelineQueue* queue = nullptr;         // command lists are submitted here, it must outlive the device
+        uint32_t queueFamilyIndex = 0;          // of queue
+        std::vector<uint32_t> sharedWith = {};  // other queue families buffers are used on as well
+        std::filesystem::path shaderDirectory = {};
+        PFN_vkCmdBeginRendering cmdBeginRendering = nullptr;    // the dynamic rendering entry points, if the device has them
+        PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+        VkRenderPass renderPass = VK_NULL_HANDLE;               // without dynamic rendering, the pass pipelines are drawn in
+    };
+
+    explicit VkRHIDevice(const Settings& settings);
+    // destroys whatever is still alive, so the GPU has to be done with it
+    virtual ~VkRHIDevice();
+
+    const char* GetName() const final {
+        return "Vulkan";
+    }
+
+    RHIBuffer CreateBuffer(const RHIBufferDesc& desc) final;
+    void DestroyBuffer(RHIBuffer buffer) final;
+    void WriteBuffer(RHIBuffer buffer, uint64_t offset, std::span<const std::byte> data) final;
+
+    RHITexture CreateTexture(const RHITextureDesc& desc) final;
+    void DestroyTexture(RHITexture texture) final;
+
+    RHIPipeline CreatePipeline(const RHIPipelineDesc& desc) final;
+    // A pipeline for targets whose formats RHIFormat doesn't have, like the swapchain's.
+    RHIPipeline CreatePipeline(const RHIPipelineDesc& desc, VkFormat colorFormat, VkFormat depthFormat);
+    void DestroyPipeline(RHIPipeline pipeline) final;
+
+    RHICommandList* GetCommandList() final;
+    uint64_t ExecuteCommandList(RHICommandList* commandList) final;
+
+    bool IsFenceComplete(uint64_t fenceValue) final;
+    void WaitForFenceValue(uint64_t fenceValue) final;
+    void Flush() final;
+
+    VkBuffer GetVkBuffer(RHIBuffer buffer);
+    VkImage GetVkImage(RHITexture texture);
+
+    static VkFormat GetVkFormat(RHIFormat format);
+
+private:
+    friend class VkRHICommandList;
+
+    struct BufferData
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint64_t size = 0;
+        std::byte* mapped = nullptr;        // only for host visible buffers
+    };
+
+    struct TextureData
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        ResourceState state = ResourceState::Undefined;     // as of the last barrier recorded
+    };
+
+    struct PipelineData
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    };
+
+    // Throws std::runtime_error if the handle doesn't refer to a live resource, like using a destroyed one
+    BufferData& FindBuffer(RHIBuffer buffer);
+    TextureData& FindTexture(RHITexture texture);
+    PipelineData& FindPipeline(RHIPipeline pipeline);
+
+    VkShaderModule LoadShader(std::string_view name);
+    void Destroy(BufferData& data);
+    void Destroy(TextureData& data);
+    void Destroy(PipelineData& data);
+
+    Settings                                        m_Settings;
+    CommandBufferPool                               m_CommandBuffers;
+
+    RHIHandlePool<RHIBuffer, BufferData>            m_Buffers;
+    RHIHandlePool<RHITexture, TextureData>          m_Textures;
+    RHIHandlePool<RHIPipeline, PipelineData>        m_Pipelines;
+
+    std::vector<std::unique_ptr<VkRHICommandList>> m_CommandLists;      // owns every command list handed out
+    std::vector<VkRHICommandList*>                  m_FreeCommandLists; // submitted, their command buffers are the pool's again
+};
+#endif
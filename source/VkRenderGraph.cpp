@@ -0,0 +1,261 @@
+#if VK_AVAILABLE
+#include "VkRenderGraph.hpp"
+
+#include <algorithm>
+
+namespace {
+    bool IsDepthFormat(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool HasStencil(VkFormat format)
+    {
+        return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    VkImageUsageFlags GetImageUsage(uint32_t usageMask)
+    {
+        auto uses = [usageMask](ResourceState state) {
+            return (usageMask & (1u << static_cast<uint32_t>(state))) != 0;
+        };
+        VkImageUsageFlags usage = 0;
+        if (uses(ResourceState::ColorAttachment)) usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (uses(ResourceState::DepthAttachment)) usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (uses(ResourceState::DepthRead)) usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (uses(ResourceState::ShaderRead)) usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (uses(ResourceState::Storage)) usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        if (uses(ResourceState::TransferSrc)) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        if (uses(ResourceState::TransferDst)) usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        return usage;
+    }
+}
+
+VkRenderGraphExecutor::StateInfo VkRenderGraphExecutor::GetStateInfo(ResourceState state)
+{
+    switch (state)
+    {
+    case ResourceState::Undefined:
+        // only ever a source. The memory may have belonged to an aliased transient or a previous frame,
+        // so wait for everything before it and treat it as written
+        return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceState::ColorAttachment:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    case ResourceState::DepthAttachment:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    case ResourceState::DepthRead:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    case ResourceState::ShaderRead:
+        return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case ResourceState::Storage:
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceState::TransferSrc:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    case ResourceState::TransferDst:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    case ResourceState::Present:
+        // presentation is ordered by the semaphore, not the barrier
+        return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+    }
+    assert(false && "Invalid resource state.");
+    return {};
+}
+
+VkImageAspectFlags VkRenderGraphExecutor::GetAspect(VkFormat format)
+{
+    if (!IsDepthFormat(format))
+    {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+    return VK_IMAGE_ASPECT_DEPTH_BIT | (HasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+VkRenderGraphExecutor::VkRenderGraphExecutor(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue)
+    : m_PhysicalDevice(physicalDevice),
+    m_Device(device),
+    m_DeletionQueue(deletionQueue)
+{
+}
+
+VkRenderGraphExecutor::~VkRenderGraphExecutor()
+{
+    RetireTransients();
+}
+
+void VkRenderGraphExecutor::BindImported(RGResource resource, VkImage image, VkImageView view)
+{
+    if (m_Resources.size() <= resource)
+    {
+        m_Resources.resize(resource + 1);
+    }
+    m_Resources[resource] = { image, view };
+}
+
+void VkRenderGraphExecutor::RetireTransients()
+{
+    for (auto& transient : m_TransientImages)
+    {
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE_VIEW, transient.view);
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE, transient.image);
+    }
+    m_TransientImages.clear();
+    m_TransientKeys.clear();
+    m_DeletionQueue.Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, m_TransientMemory);
+    m_TransientMemory = VK_NULL_HANDLE;
+}
+
+void VkRenderGraphExecutor::Realize(RenderGraph& graph)
+{
+    m_Resources.resize(std::max<size_t>(m_Resources.size(), graph.GetResourceCount()));
+
+    auto transients = graph.GetTransients();
+    auto getKey = [&graph](RGResource resource) {
+        return TransientKey{ graph.GetDesc(resource), graph.GetUsage(resource), graph.GetLifetime(resource) };
+    };
+
+    // the frame usually looks exactly like the last one, so keep everything. Compared in place, as this runs every frame
+    bool changed = transients.size() != m_TransientKeys.size();
+    for (size_t i = 0; i < transients.size() && !changed; i++)
+    {
+        changed = !(getKey(transients[i]) == m_TransientKeys[i]);
+    }
+    if (changed)
+    {
+        // transient layouts only change on resize or when passes are added or removed.
+        // The old images may still be in use by frames in flight, so they are destroyed once those finish
+        RetireTransients();
+        for (auto resource : transients)
+        {
+            m_TransientKeys.push_back(getKey(resource));
+        }
+        const auto& keys = m_TransientKeys;
+
+        std::vector<RenderGraph::MemoryRequirements> requirements;
+        uint32_t memoryTypeBits = ~0u;
+        for (const auto& key : keys)
+        {
+            VkImageCreateInfo imageInfo{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .flags = VK_IMAGE_CREATE_ALIAS_BIT,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = static_cast<VkFormat>(key.desc.format),
+                .extent = { key.desc.width, key.desc.height, 1 },
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = GetImageUsage(key.usage),
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            };
+            PhysicalImage transient;
+            VK_CHECK(vkCreateImage(m_Device, &imageInfo, nullptr, &transient.image));
+            m_DeletionQueue.Track(VK_OBJECT_TYPE_IMAGE, transient.image);
+            m_TransientImages.push_back(transient);
+
+            VkMemoryRequirements memRequirements;
+            vkGetImageMemoryRequirements(m_Device, transient.image, &memRequirements);
+            requirements.push_back({ memRequirements.size, memRequirements.alignment });
+            memoryTypeBits &= memRequirements.memoryTypeBits;
+        }
+
+        if (!keys.empty())
+        {
+            // one block for every transient, with non-overlapping lifetimes sharing the same bytes
+            std::vector<uint64_t> offsets(keys.size());
+            uint64_t heapSize = graph.PlaceTransients(requirements, offsets);
+
+            VkMemoryAllocateInfo allocInfo{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize = heapSize,
+                .memoryTypeIndex = FindMemoryType(m_PhysicalDevice, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+            };
+            VK_CHECK(vkAllocateMemory(m_Device, &allocInfo, nullptr, &m_TransientMemory));
+            m_DeletionQueue.Track(VK_OBJECT_TYPE_DEVICE_MEMORY, m_TransientMemory);
+
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                auto& transient = m_TransientImages[i];
+                VK_CHECK(vkBindImageMemory(m_Device, transient.image, m_TransientMemory, offsets[i]));
+
+                auto format = static_cast<VkFormat>(keys[i].desc.format);
+                VkImageViewCreateInfo viewInfo{
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                    .image = transient.image,
+                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                    .format = format,
+                    .subresourceRange{
+                        .aspectMask = GetAspect(format),
+                        .baseMipLevel = 0,
+                        .levelCount = 1,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                    }
+                };
+                VK_CHECK(vkCreateImageView(m_Device, &viewInfo, nullptr, &transient.view));
+                m_DeletionQueue.Track(VK_OBJECT_TYPE_IMAGE_VIEW, transient.view);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < transients.size(); i++)
+    {
+        m_Resources[transients[i]] = m_TransientImages[i];
+    }
+}
+
+void VkRenderGraphExecutor::Execute(RenderGraph& graph, VkCommandBuffer commandBuffer)
+{
+    m_CommandBuffer = commandBuffer;
+    graph.Execute(*this);
+    m_CommandBuffer = VK_NULL_HANDLE;
+}
+
+void VkRenderGraphExecutor::Barriers(const RenderGraph& graph, std::span<const Barrier> barriers)
+{
+    // one vkCmdPipelineBarrier for the whole batch
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::pmr::vector<VkImageMemoryBarrier> imageBarriers(graph.GetScratch());
+    imageBarriers.reserve(barriers.size());
+
+    for (const auto& barrier : barriers)
+    {
+        auto before = GetStateInfo(barrier.before);
+        auto after = GetStateInfo(barrier.after);
+        srcStages |= before.stages;
+        dstStages |= after.stages;
+
+        imageBarriers.push_back(VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = before.access,
+            .dstAccessMask = after.access,
+            .oldLayout = before.layout,
+            .newLayout = after.layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = m_Resources[barrier.resource].image,
+            .subresourceRange{
+                .aspectMask = GetAspect(static_cast<VkFormat>(graph.GetDesc(barrier.resource).format)),
+                .baseMipLevel = 0,
+                .levelCount = VK_REMAINING_MIP_LEVELS,
+                .baseArrayLayer = 0,
+                .layerCount = VK_REMAINING_ARRAY_LAYERS
+            }
+        });
+    }
+
+    vkCmdPipelineBarrier(m_CommandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+#endif
@@ -0,0 +1,81 @@
+/**
+ * Runs a RenderGraph on a Vulkan command buffer.
+ * Translates graph states into pipeline barriers and image layouts,
+ * and backs the graph's transient textures with images bound into one aliased block of memory.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+#include "RenderGraph.hpp"
+#include "VkDeletionQueue.hpp"
+
+#include <vector>   // For std::vector
+
+class VkRenderGraphExecutor : public RenderGraphBackend
+{
+public:
+    // Replaced transients are handed to deletionQueue, which must outlive the executor.
+    VkRenderGraphExecutor(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue);
+    virtual ~VkRenderGraphExecutor();
+
+    // Tell the executor which image an imported texture refers to this frame.
+    void BindImported(RGResource resource, VkImage image, VkImageView view);
+
+    // Create (or reuse from last frame) images and memory for the compiled graph's transients.
+    void Realize(RenderGraph& graph);
+
+    // Record every live pass of a compiled and realized graph.
+    void Execute(RenderGraph& graph, VkCommandBuffer commandBuffer);
+
+    VkImage GetImage(RGResource resource) const {
+        return m_Resources[resource].image;
+    }
+    VkImageView GetImageView(RGResource resource) const {
+        return m_Resources[resource].view;
+    }
+
+    void Barriers(const RenderGraph& graph, std::span<const Barrier> barriers) override;
+
+    // how a resource state maps onto Vulkan's synchronization model, also used by the RHI backend
+    struct StateInfo
+    {
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+    };
+    static StateInfo GetStateInfo(ResourceState state);
+    static VkImageAspectFlags GetAspect(VkFormat format);
+
+private:
+    struct PhysicalImage
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+
+    // everything that has to match for last frame's transients to be reused as-is
+    struct TransientKey
+    {
+        RenderGraph::TextureDesc desc;
+        uint32_t usage;
+        RenderGraph::Lifetime lifetime;
+
+        bool operator==(const TransientKey&) const = default;
+    };
+
+    void RetireTransients();
+
+    VkPhysicalDevice            m_PhysicalDevice;
+    VkDevice                    m_Device;
+    DeletionQueue&              m_DeletionQueue;
+    VkCommandBuffer             m_CommandBuffer = VK_NULL_HANDLE;
+
+    std::vector<PhysicalImage>  m_Resources;    // indexed by RGResource
+
+    std::vector<TransientKey>   m_TransientKeys;
+    std::vector<PhysicalImage>  m_TransientImages;
+    VkDeviceMemory              m_TransientMemory = VK_NULL_HANDLE;
+};
+#endif
@@ -0,0 +1,81 @@
+#if VK_AVAILABLE
+#include "VkSamplerCache.hpp"
+
+#include <functional>
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+    // boost::hash_combine, like DescriptorAllocator's cache
+    size_t seed = 0;
+    auto combine = [&seed](auto value) {
+        seed ^= std::hash<decltype(value)>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(static_cast<uint32_t>(key.flags));
+    combine(static_cast<uint32_t>(key.magFilter));
+    combine(static_cast<uint32_t>(key.minFilter));
+    combine(static_cast<uint32_t>(key.mipmapMode));
+    combine(static_cast<uint32_t>(key.addressModeU));
+    combine(static_cast<uint32_t>(key.addressModeV));
+    combine(static_cast<uint32_t>(key.addressModeW));
+    combine(key.mipLodBias);
+    combine(static_cast<uint32_t>(key.anisotropyEnable));
+    combine(key.maxAnisotropy);
+    combine(static_cast<uint32_t>(key.compareEnable));
+    combine(static_cast<uint32_t>(key.compareOp));
+    combine(key.minLod);
+    combine(key.maxLod);
+    combine(static_cast<uint32_t>(key.borderColor));
+    combine(static_cast<uint32_t>(key.unnormalizedCoordinates));
+    return seed;
+}
+
+SamplerCache::SamplerCache(VkDevice device)
+    : m_Device(device)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+    for (auto& [key, sampler] : m_Samplers)
+    {
+        vkDestroySampler(m_Device, sampler, nullptr);
+    }
+}
+
+VkSampler SamplerCache::GetSampler(const VkSamplerCreateInfo& info)
+{
+    assert(info.pNext == nullptr && "Sampler extension structs aren't part of the cache key.");
+    m_Stats.requests++;
+
+    Key key{
+        .flags = info.flags,
+        .magFilter = info.magFilter,
+        .minFilter = info.minFilter,
+        .mipmapMode = info.mipmapMode,
+        .addressModeU = info.addressModeU,
+        .addressModeV = info.addressModeV,
+        .addressModeW = info.addressModeW,
+        .mipLodBias = info.mipLodBias,
+        .anisotropyEnable = info.anisotropyEnable,
+        // the rest are ignored unless their feature is turned on, so they mustn't split the cache
+        .maxAnisotropy = info.anisotropyEnable ? info.maxAnisotropy : 1.0f,
+        .compareEnable = info.compareEnable,
+        .compareOp = info.compareEnable ? info.compareOp : VK_COMPARE_OP_NEVER,
+        .minLod = info.minLod,
+        .maxLod = info.maxLod,
+        .borderColor = info.borderColor,
+        .unnormalizedCoordinates = info.unnormalizedCoordinates
+    };
+    auto it = m_Samplers.find(key);
+    if (it != m_Samplers.end())
+    {
+        return it->second;
+    }
+
+    VkSampler sampler;
+    VK_CHECK(vkCreateSampler(m_Device, &info, nullptr, &sampler));
+    m_Stats.created++;
+    m_Samplers.emplace(key, sampler);
+    return sampler;
+}
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Hands out one VkSampler per distinct sampler description, however many textures ask for it.
+ * Devices only allow so many samplers to exist at once (maxSamplerAllocationCount, as low as 4000), and
+ * most textures want one of a handful of filter and address mode combinations, so creating a sampler per
+ * texture wastes them. Samplers live until the cache is destroyed.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <cstdint>          // For uint64_t
+#include <unordered_map>    // For std::unordered_map
+
+class SamplerCache
+{
+public:
+    struct Stats
+    {
+        uint64_t requests = 0;
+        uint64_t created = 0;
+
+        double HitRate() const {
+            return requests == 0 ? 0.0 : static_cast<double>(requests - created) / requests;
+        }
+    };
+
+    explicit SamplerCache(VkDevice device);
+    virtual ~SamplerCache();
+
+    // Get the sampler for this description, creating it the first time. Extension structs (pNext) aren't supported.
+    VkSampler GetSampler(const VkSamplerCreateInfo& info);
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+private:
+    // the fields of VkSamplerCreateInfo that make samplers differ
+    struct Key
+    {
+        VkSamplerCreateFlags flags;
+        VkFilter magFilter;
+        VkFilter minFilter;
+        VkSamplerMipmapMode mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float mipLodBias;
+        VkBool32 anisotropyEnable;
+        float maxAnisotropy;
+        VkBool32 compareEnable;
+        VkCompareOp compareOp;
+        float minLod;
+        float maxLod;
+        VkBorderColor borderColor;
+        VkBool32 unnormalizedCoordinates;
+
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    VkDevice                                    m_Device;
+    std::unordered_map<Key, VkSampler, KeyHash> m_Samplers;
+    Stats                                       m_Stats;
+};
+#endif
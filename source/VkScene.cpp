@@ -0,0 +1,212 @@
+#if VK_AVAILABLE
+#include "VkScene.hpp"
+#include "VkDeletionQueue.hpp"
+
+#include <cmath>
+
+VkScene::~VkScene()
+{
+    for (auto [buffer, memory] : m_Buffers) {
+        m_Context.deletionQueue->Retire(VK_OBJECT_TYPE_BUFFER, buffer);
+        m_Context.deletionQueue->Retire(VK_OBJECT_TYPE_DEVICE_MEMORY, memory);
+    }
+    for (auto pipeline : m_Pipelines) {
+        m_Context.deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE, pipeline);
+    }
+    for (auto layout : m_PipelineLayouts) {
+        m_Context.deletionQueue->Retire(VK_OBJECT_TYPE_PIPELINE_LAYOUT, layout);
+    }
+    for (auto layout : m_SetLayouts) {
+        vkDestroyDescriptorSetLayout(m_Context.device, layout, nullptr);
+    }
+    for (auto module : m_ShaderModules) {
+        vkDestroyShaderModule(m_Context.device, module, nullptr);
+    }
+}
+
+glm::mat4 VkScene::ReverseZInfinitePerspective(float fovY, float aspect, float zNear)
+{
+    float f = 1.0f / std::tan(fovY / 2);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = f / aspect;
+    projection[1][1] = -f;
+    projection[2][3] = -1.0f;       // w is the distance in front of the camera
+    projection[3][2] = zNear;
+    return projection;
+}
+
+uint64_t VkScene::GetFrame() const
+{
+    return m_Context.deletionQueue->GetSubmittedFrames();
+}
+
+VkShaderModule VkScene::LoadShader(const std::filesystem::path& file)
+{
+    m_ShaderModules.push_back(LoadShaderModule(m_Context.device, file));
+    return m_ShaderModules.back();
+}
+
+VkPipelineShaderStageCreateInfo VkScene::ShaderStage(VkShaderStageFlagBits stage, VkShaderModule module)
+{
+    return VkPipelineShaderStageCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = stage,
+        .module = module,
+        .pName = "main"
+    };
+}
+
+VkDescriptorSetLayout VkScene::CreateSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    // sets come from the descriptor allocator while recording, layouts only describe them
+    VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    };
+    VkDescriptorSetLayout layout;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &layout));
+    m_SetLayouts.push_back(layout);
+    return layout;
+}
+
+VkPipelineLayout VkScene::CreatePipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts, VkShaderStageFlags pushStages, uint32_t pushConstantSize)
+{
+    VkPushConstantRange pushConstants{
+        .stageFlags = pushStages,
+        .offset = 0,
+        .size = pushConstantSize
+    };
+    VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+        .pSetLayouts = setLayouts.data(),
+        .pushConstantRangeCount = pushConstantSize > 0 ? 1u : 0u,
+        .pPushConstantRanges = &pushConstants
+    };
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(m_Context.device, &layoutInfo, nullptr, &layout));
+    m_Context.deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE_LAYOUT, layout);
+    m_PipelineLayouts.push_back(layout);
+    return layout;
+}
+
+VkPipeline VkScene::CreatePipeline(const PipelineDesc& desc)
+{
+    VkPipelineVertexInputStateCreateInfo noVertexInput{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = desc.topology
+    };
+    VkPipelineViewportStateCreateInfo viewportState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1       // both dynamic, like the main pipeline
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = desc.cullMode,
+        .frontFace = desc.frontFace,
+        .lineWidth = 1.0f
+    };
+    VkPipelineMultisampleStateCreateInfo multisampling{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .minSampleShading = 1.0f
+    };
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = VK_FALSE,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+    VkPipelineColorBlendStateCreateInfo colorBlending{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = desc.depthOnly ? 0u : 1u,
+        .pAttachments = &colorBlendAttachment
+    };
+    VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VkBool32(desc.depthTest),
+        .depthWriteEnable = VkBool32(desc.depthWrite),
+        .depthCompareOp = desc.depthCompareOp,
+    };
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStates)),
+        .pDynamicStates = dynamicStates
+    };
+    // with dynamic rendering the pipeline only needs the attachment formats, not a compatible render pass
+    VkPipelineRenderingCreateInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = desc.depthOnly ? 0u : 1u,
+        .pColorAttachmentFormats = &m_Context.colorFormat,
+        .depthAttachmentFormat = m_Context.depthFormat,
+    };
+    bool useDynamicRendering = m_Context.cmdBeginRendering != nullptr || desc.alwaysDynamicRendering;
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = useDynamicRendering ? &renderingInfo : nullptr,
+        .stageCount = static_cast<uint32_t>(desc.stages.size()),
+        .pStages = desc.stages.data(),
+        .pVertexInputState = desc.meshShaders ? nullptr : desc.vertexInput ? desc.vertexInput : &noVertexInput,
+        .pInputAssemblyState = desc.meshShaders ? nullptr : &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = desc.layout,
+        // without dynamic rendering, the pass it is drawn in
+        .renderPass = useDynamicRendering ? VK_NULL_HANDLE : desc.depthOnly ? m_Context.depthPrepassRenderPass : m_Context.renderPass,
+        .subpass = 0,
+        .basePipelineIndex = -1
+    };
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(m_Context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    m_Context.deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE, pipeline);
+    m_Pipelines.push_back(pipeline);
+    return pipeline;
+}
+
+VkPipeline VkScene::CreateComputePipeline(VkShaderModule module, VkPipelineLayout layout)
+{
+    VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = ShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, module),
+        .layout = layout
+    };
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateComputePipelines(m_Context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    m_Context.deletionQueue->Track(VK_OBJECT_TYPE_PIPELINE, pipeline);
+    m_Pipelines.push_back(pipeline);
+    return pipeline;
+}
+
+void VkScene::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    ::CreateBuffer(m_Context.physicalDevice, m_Context.device, *m_Context.deletionQueue, size, usage, properties, buffer, memory);
+    m_Buffers.emplace_back(buffer, memory);
+}
+
+void VkScene::CreateFilledBuffer(std::span<const std::byte> data, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    CreateBuffer(data.size(), usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+    UploadBuffer(m_Context.device, memory, data);
+}
+
+void* VkScene::CreateMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer)
+{
+    VkDeviceMemory memory;
+    CreateBuffer(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+    void* mapped;
+    VK_CHECK(vkMapMemory(m_Context.device, memory, 0, size, 0, &mapped));
+    return mapped;
+}
+#endif
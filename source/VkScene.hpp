@@ -0,0 +1,148 @@
+/**
+ * The benchmark scenes VkApp can draw next to its triangle, each behind an option of its own (--overdraw, --occlusion,
+ * --meshlets, --lod, --textures). A scene creates what it draws with in its constructor and releases it in its
+ * destructor, records into the passes the app sets up, reads its counters back once a frame slot's fence has been
+ * waited on, and prints what it measured at exit. What scenes share with the app comes in a VkSceneContext.
+ * Shader modules, set layouts, pipeline layouts, pipelines and buffers made through the helpers here belong to the
+ * scene and are released with it; the ones the deletion queue tracks go through it.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+#include "RenderGraph.hpp"
+
+#include <glm/glm.hpp>  // For glm::mat4
+
+#include <cstdint>      // For uint32_t, uint64_t
+#include <filesystem>   // For std::filesystem::path
+#include <span>         // For std::span
+#include <utility>      // For std::pair
+#include <vector>       // For std::vector
+
+class BindlessHeap;
+class DeletionQueue;
+class DescriptorAllocator;
+class FrameArenas;
+class VkRenderGraphExecutor;
+
+struct VkSceneContext
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    DeletionQueue* deletionQueue = nullptr;             // its count of submitted frames is what the scenes animate by
+    DescriptorAllocator* descriptorAllocator = nullptr; // only null if no scene asks for descriptor sets
+    BindlessHeap* bindlessHeap = nullptr;               // null without --bindless
+    FrameArenas* frameArenas = nullptr;                 // per frame scratch memory
+    uint32_t framesInFlight = 1;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;         // the main pass's targets
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    PFN_vkCmdBeginRendering cmdBeginRendering = nullptr;    // null without dynamic rendering
+    PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+    VkRenderPass renderPass = VK_NULL_HANDLE;               // the main pass, only without dynamic rendering
+    VkRenderPass depthPrepassRenderPass = VK_NULL_HANDLE;
+    bool depthPrepass = false;                          // the main pass only tests against depth the pre-pass wrote
+};
+
+class VkScene
+{
+public:
+    // what a scene drawing ahead of the main pass draws into, which the main pass carries on from
+    struct Targets
+    {
+        RGResource color = 0;
+        VkImageView colorView = VK_NULL_HANDLE;
+        RGResource depth = 0;
+        VkImageView depthView = VK_NULL_HANDLE;
+        VkExtent2D extent = {};
+    };
+
+    explicit VkScene(const VkSceneContext& context) : m_Context(context) {}
+    // Only once the GPU is done with the scene, the shader modules and set layouts are destroyed straight away
+    virtual ~VkScene();
+
+    VkScene(const VkScene&) = delete;
+    VkScene& operator=(const VkScene&) = delete;
+
+    // Resources sized by the depth buffer, created again after RetireTargets whenever the swapchain is recreated.
+    // A scene needing them creates the first ones from its settings
+    virtual void CreateTargets(VkImage /*depthImage*/, VkExtent2D /*extent*/) {}
+    virtual void RetireTargets() {}
+
+    // CPU work for the frame about to be recorded in slot, before anything is recorded
+    virtual void PrepareFrame(uint32_t /*slot*/, VkExtent2D /*extent*/) {}
+    // Around everything the frame records, outside any pass. extent is what the scene was rendered at
+    virtual void BeginFrame(VkCommandBuffer /*commandBuffer*/, uint32_t /*slot*/) {}
+    virtual void EndFrame(VkCommandBuffer /*commandBuffer*/, uint32_t /*slot*/, VkExtent2D /*extent*/) {}
+    // Passes of the scene's own, added ahead of the main pass. The execute callbacks run after this returns
+    virtual void AddPasses(RenderGraph& /*graph*/, VkRenderGraphExecutor& /*executor*/, VkCommandBuffer /*commandBuffer*/, uint32_t /*slot*/, const Targets& /*targets*/) {}
+    // Draws in the depth pre-pass and the main pass, with the viewport and scissor already covering extent
+    virtual void RecordDepthPrepass(VkCommandBuffer /*commandBuffer*/, uint32_t /*slot*/, VkExtent2D /*extent*/) {}
+    virtual void Record(VkCommandBuffer /*commandBuffer*/, uint32_t /*slot*/, VkExtent2D /*extent*/) {}
+    // Once the frame last recorded in slot has finished: its counters, and how long the GPU took over the whole frame
+    virtual void ReadBack(uint32_t /*slot*/) {}
+    virtual void AddGpuTime(uint32_t /*slot*/, double /*ms*/) {}
+
+    virtual void PrintStats() const = 0;
+
+    // Reverse-Z perspective with the far plane at infinity, for Vulkan's 0 to 1 depth range with y pointing down.
+    // Depth comes out as zNear / distance, so nothing is ever clipped for being too far away
+    static glm::mat4 ReverseZInfinitePerspective(float fovY, float aspect, float zNear);
+
+protected:
+    // what the scenes' graphics pipelines choose, the rest of their state is the same for all of them
+    struct PipelineDesc
+    {
+        std::span<const VkPipelineShaderStageCreateInfo> stages;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        const VkPipelineVertexInputStateCreateInfo* vertexInput = nullptr;     // nullptr has no vertex buffers
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        bool meshShaders = false;           // no vertex input or input assembly at all
+        VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+        VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+        bool depthTest = true;
+        bool depthWrite = true;
+        VkCompareOp depthCompareOp = VK_COMPARE_OP_GREATER;    // reverse-Z, closer is bigger
+        bool depthOnly = false;             // no color target, drawn in the depth pre-pass
+        bool alwaysDynamicRendering = false;        // only ever drawn with dynamic rendering, whatever the main pass uses
+    };
+
+    // frames submitted so far, the frame being prepared or recorded
+    uint64_t GetFrame() const;
+
+    VkShaderModule LoadShader(const std::filesystem::path& file);
+    // a shader stage running main()
+    static VkPipelineShaderStageCreateInfo ShaderStage(VkShaderStageFlagBits stage, VkShaderModule module);
+    VkDescriptorSetLayout CreateSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings);
+    // with a push constant range for pushStages if pushConstantSize isn't 0
+    VkPipelineLayout CreatePipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts, VkShaderStageFlags pushStages, uint32_t pushConstantSize);
+    // A pipeline drawing into the main pass's targets (or just its depth), with the viewport and scissor dynamic
+    VkPipeline CreatePipeline(const PipelineDesc& desc);
+    VkPipeline CreateComputePipeline(VkShaderModule module, VkPipelineLayout layout);
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory);
+    // A host visible buffer holding data, for what is only written once. Host visible memory is good enough for that
+    void CreateFilledBuffer(std::span<const std::byte> data, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory);
+    // A host visible buffer per frame in flight, mapped for as long as the scene lives
+    template<typename T>
+    void CreateMappedBuffers(VkDeviceSize size, VkBufferUsageFlags usage, std::vector<VkBuffer>& buffers, std::vector<T*>& mapped)
+    {
+        buffers.resize(m_Context.framesInFlight);
+        mapped.resize(m_Context.framesInFlight);
+        for (uint32_t i = 0; i < m_Context.framesInFlight; i++) {
+            mapped[i] = static_cast<T*>(CreateMappedBuffer(size, usage, buffers[i]));
+        }
+    }
+
+    VkSceneContext  m_Context;
+
+private:
+    void* CreateMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer);
+
+    std::vector<VkShaderModule>                         m_ShaderModules;
+    std::vector<VkDescriptorSetLayout>                  m_SetLayouts;
+    std::vector<VkPipelineLayout>                       m_PipelineLayouts;
+    std::vector<VkPipeline>                             m_Pipelines;
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>>    m_Buffers;
+};
+#endif
@@ -0,0 +1,322 @@
+#if VK_AVAILABLE
+#include "VkTextureScene.hpp"
+#include "VkBindless.hpp"
+#include "VkDescriptorAllocator.hpp"
+#include "VkSamplerCache.hpp"
+#include "VkTextureStreamer.hpp"
+#include "VkTimelineQueue.hpp"
+#include "MappedFile.hpp"
+#include "TextureCooker.hpp"
+#include "WorkerPool.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+constexpr uint32_t TEXTURE_SOURCES = 8;         // distinct CPU-side images the textures are filled from
+constexpr float TEXTURE_SPACING = 1.2f;
+
+VkTextureScene::VkTextureScene(const VkSceneContext& context, const Settings& settings)
+    : VkScene(context),
+    m_Settings(settings),
+    m_FeedbackWritten(context.framesInFlight)
+{
+    // the textures are filled from a few patterns, each a checkerboard over a gradient in its own colour
+    uint32_t size = m_Settings.size;
+    m_Sources.resize(TEXTURE_SOURCES);
+    for (uint32_t i = 0; i < TEXTURE_SOURCES; i++) {
+        auto& pixels = m_Sources[i];
+        pixels.resize(size_t(size) * size * 4);
+        glm::vec3 tint = glm::fract(glm::vec3(0.37f, 0.61f, 0.83f) * float(i + 1));
+        uint32_t checkSize = std::max(size / 16, 1u);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                float gradient = 0.4f + 0.6f * float(x + y) / (2 * size);
+                float check = ((x / checkSize + y / checkSize) % 2) ? 1.0f : 0.3f;
+                auto* texel = &pixels[(size_t(y) * size + x) * 4];
+                for (int c = 0; c < 3; c++) {
+                    texel[c] = std::byte(static_cast<uint8_t>(255 * tint[c] * gradient * check));
+                }
+                texel[3] = std::byte(255);
+            }
+        }
+    }
+
+    TextureManager::Settings managerSettings;
+    managerSettings.timestampPeriod = m_Settings.timestampValidBits > 0 ? m_Settings.timestampPeriod : 0;
+    managerSettings.timestampValidBits = m_Settings.timestampValidBits;
+    m_Manager = std::make_unique<TextureManager>(m_Context.physicalDevice, m_Context.device, *m_Settings.queue, *m_Settings.commands, *m_Context.deletionQueue, managerSettings);
+    m_SamplerCache = std::make_unique<SamplerCache>(m_Context.device);
+
+    // most textures tile, every fourth clamps, so many textures share two samplers
+    VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .anisotropyEnable = static_cast<VkBool32>(m_Settings.anisotropy),
+        .maxAnisotropy = 8.0f,
+        .minLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,
+    };
+    VkSamplerCreateInfo clampInfo = samplerInfo;
+    clampInfo.addressModeU = clampInfo.addressModeV = clampInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    if (m_Settings.blockFormat) {
+        CookSources();
+    }
+
+    // loading starts from mapping the files, their pages are read in as the levels are copied out
+    auto* bindlessHeap = m_Context.bindlessHeap;
+    auto uploadStart = std::chrono::steady_clock::now();
+    if (m_Settings.streaming) {
+        TextureStreamer::Settings streamerSettings;
+        streamerSettings.budget = VkDeviceSize(m_Settings.budgetMiB) << 20;
+        m_Streamer = std::make_unique<TextureStreamer>(*m_Manager, bindlessHeap, streamerSettings);
+    }
+    else if (m_Settings.blockFormat) {
+        for (uint32_t i = 0; i < TEXTURE_SOURCES; i++) {
+            m_Files.push_back(std::make_unique<MappedFile>(GetCookedFile(i)));
+            m_Readers.emplace_back(m_Files.back()->GetData());
+        }
+    }
+    for (uint32_t i = 0; i < m_Settings.count; i++) {
+        if (m_Streamer) {
+            m_Samplers.push_back(m_SamplerCache->GetSampler(i % 4 == 3 ? clampInfo : samplerInfo));
+            m_Streamer->Add(GetCookedFile(i % TEXTURE_SOURCES), m_Samplers.back());
+            continue;
+        }
+        TextureHandle texture;
+        if (m_Settings.blockFormat) {
+            const auto& reader = m_Readers[i % TEXTURE_SOURCES];
+            const auto& description = reader.GetDescription();
+            auto format = static_cast<VkFormat>(GetKtx2VkFormat(description.format, description.srgb));
+            texture = m_Manager->Create(description.width, description.height, format, reader.GetLevelCount());
+            UploadFile(texture, reader);
+        }
+        else {
+            texture = m_Manager->Create(size, size, VK_FORMAT_R8G8B8A8_SRGB);
+            m_Manager->Upload(texture, m_Sources[i % TEXTURE_SOURCES]);
+        }
+        m_Textures.push_back(texture);
+        m_Samplers.push_back(m_SamplerCache->GetSampler(i % 4 == 3 ? clampInfo : samplerInfo));
+        if (bindlessHeap) {
+            m_Manager->RegisterBindless(texture, *bindlessHeap, m_Samplers.back());
+        }
+    }
+    m_Settings.queue->WaitForFenceValue(m_Manager->Flush());
+    m_StartupUpload.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+    m_StartupUpload.bytes = m_Manager->GetStats().bytesUploaded;
+    m_InstancesPerRow = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_Settings.count))));
+
+    // one combined image sampler per draw without the heap, the heap's own layout with it
+    if (!bindlessHeap) {
+        VkDescriptorSetLayoutBinding binding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+        };
+        m_SetLayout = CreateSetLayout(std::span(&binding, 1));
+    }
+    // streaming adds a set for the feedback buffer, which starts out with nothing requested
+    if (m_Settings.streaming) {
+        VkDescriptorSetLayoutBinding binding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+        };
+        m_FeedbackSetLayout = CreateSetLayout(std::span(&binding, 1));
+        CreateMappedBuffers(sizeof(uint32_t) * m_Settings.count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_FeedbackBuffers, m_FeedbackMapped);
+        for (auto* feedback : m_FeedbackMapped) {
+            std::fill_n(feedback, m_Settings.count, TextureStreamer::NotRequested);
+        }
+    }
+    VkDescriptorSetLayout setLayouts[] = { bindlessHeap ? bindlessHeap->GetLayout() : m_SetLayout, m_FeedbackSetLayout };
+    m_Layout = CreatePipelineLayout(std::span(setLayouts, m_Settings.streaming ? 2 : 1), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(Constants));
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        ShaderStage(VK_SHADER_STAGE_VERTEX_BIT, LoadShader("textured.vert.spv")),
+        ShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, LoadShader(m_Settings.streaming ? "textured_streamed.frag.spv" : bindlessHeap ? "textured_bindless.frag.spv" : "textured.frag.spv")),
+    };
+    // the quads are generated in the vertex shader. Drawn in the main pass, so it has to match it
+    m_Pipeline = CreatePipeline({
+        .stages = shaderStages,
+        .layout = m_Layout,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+    });
+
+    const auto& memory = m_Manager->GetMemoryStats();
+    const auto& samplers = m_SamplerCache->GetStats();
+    std::cout << std::format("Texture scene: {} {} textures of {}x{} with mips, {} MiB in {} memory blocks, {} through {}, {}",
+        m_Settings.count, m_Settings.blockFormat ? BlockEncoder::GetFormatName(*m_Settings.blockFormat) : "rgba8", size, size, memory.bytesInUse >> 20, memory.blocksCreated,
+        samplers.created == 1 ? "1 sampler" : std::format("{} samplers", samplers.created),
+        bindlessHeap ? "the bindless heap" : "descriptor sets", m_Settings.streaming ? "streamed" : std::format("{} re-uploaded per frame", m_Settings.uploadsPerFrame)) << std::endl;
+    if (m_Streamer) {
+        const auto& stats = m_Streamer->GetStats();
+        std::cout << std::format("Texture streaming: {} MiB budget, {} KiB of tails resident against {} MiB for every level",
+            m_Settings.budgetMiB, stats.residentBytes >> 10, stats.fullBytes >> 20) << std::endl;
+    }
+    if (!m_Readers.empty()) {
+        // against the same textures and mips as RGBA8
+        VkDeviceSize blockBytes = 0, rgba8Bytes = 0;
+        for (uint32_t level = 0; level < m_Readers[0].GetLevelCount(); level++) {
+            uint32_t levelSize = std::max(size >> level, 1u);
+            blockBytes += m_Readers[0].GetLevelSize(level);
+            rgba8Bytes += TextureManager::GetLevelSize(VK_FORMAT_R8G8B8A8_SRGB, levelSize, levelSize);
+        }
+        std::cout << std::format("Texture files: {} sources cooked in {:.1f} ms, {} KiB on disk{}; {} MiB of blocks against {} MiB as RGBA8, {:.1f}% saved",
+            TEXTURE_SOURCES, m_Cook.ms, m_Cook.fileBytes >> 10, m_Settings.zlib ? " with zlib" : "", (blockBytes * m_Settings.count) >> 20,
+            (rgba8Bytes * m_Settings.count) >> 20, 100.0 * (1.0 - double(blockBytes) / rgba8Bytes)) << std::endl;
+    }
+}
+
+VkTextureScene::~VkTextureScene()
+{
+    // the streamer and the readers still have the cooked files open
+    m_Streamer.reset();
+    m_Readers.clear();
+    m_Files.clear();
+    if (!m_CookDirectory.empty()) {
+        std::filesystem::remove_all(m_CookDirectory);
+    }
+}
+
+void VkTextureScene::CookSources()
+{
+    auto start = std::chrono::steady_clock::now();
+    WorkerPool workers;
+    BlockEncoder encoder(workers, {});
+    CookSettings settings{
+        .format = *m_Settings.blockFormat,
+        .srgb = true,
+        .supercompression = m_Settings.zlib ? Ktx2Supercompression::Zlib : Ktx2Supercompression::None
+    };
+    m_CookDirectory = std::filesystem::temp_directory_path() / "gfx-api-learning-textures";
+    std::filesystem::create_directories(m_CookDirectory);
+    for (uint32_t i = 0; i < TEXTURE_SOURCES; i++) {
+        auto pixels = std::span(reinterpret_cast<const uint8_t*>(m_Sources[i].data()), m_Sources[i].size());
+        auto file = CookTexture(encoder, pixels, m_Settings.size, m_Settings.size, settings);
+        std::ofstream(GetCookedFile(i), std::ios::binary).write(reinterpret_cast<const char*>(file.data()), file.size());
+        m_Cook.fileBytes += file.size();
+    }
+    m_Cook.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::filesystem::path VkTextureScene::GetCookedFile(uint32_t source) const
+{
+    return m_CookDirectory / std::format("source{}.ktx2", source);
+}
+
+void VkTextureScene::UploadFile(TextureHandle texture, const Ktx2Reader& reader)
+{
+    m_Manager->UploadLevels(texture, [&reader](uint32_t level, std::span<std::byte> destination) {
+        reader.ReadLevel(level, destination);
+    });
+}
+
+void VkTextureScene::PrepareFrame(uint32_t /*slot*/, VkExtent2D /*extent*/)
+{
+    if (m_Streamer) {
+        m_Streamer->Update();
+        return;
+    }
+    for (uint32_t i = 0; i < m_Settings.uploadsPerFrame; i++) {
+        uint32_t texture = m_NextUpload++ % m_Settings.count;
+        // a different source each time around, so the change shows
+        uint32_t source = (texture + m_NextUpload / m_Settings.count) % TEXTURE_SOURCES;
+        if (m_Settings.blockFormat) {
+            UploadFile(m_Textures[texture], m_Readers[source]);
+        }
+        else {
+            m_Manager->Upload(m_Textures[texture], m_Sources[source]);
+        }
+    }
+    m_Manager->Flush();
+}
+
+// a quad per texture, on the ground stretching away from the camera
+void VkTextureScene::Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent)
+{
+    float depth = m_InstancesPerRow * TEXTURE_SPACING;
+    // streaming travels halfway down the grid and back, so the textures near the camera keep changing
+    float travel = m_Settings.streaming ? 0.25f * depth * (1.0f - std::cos(GetFrame() * 0.005f)) : 0.0f;
+    glm::vec3 position(0.0f, 1.5f, 1.0f - travel);
+    auto view = glm::lookAt(position, glm::vec3(0.0f, 0.0f, -depth * 0.5f - travel), glm::vec3(0.0f, 1.0f, 0.0f));
+    auto projection = ReverseZInfinitePerspective(glm::radians(60.0f), static_cast<float>(extent.width) / extent.height, 0.1f);
+
+    auto* bindlessHeap = m_Context.bindlessHeap;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+    if (bindlessHeap) {
+        bindlessHeap->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Layout);
+    }
+    if (m_Settings.streaming) {
+        DescriptorAllocator::Binding binding = DescriptorAllocator::Binding::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_FeedbackBuffers[slot], 0, VK_WHOLE_SIZE);
+        auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_FeedbackSetLayout, std::span(&binding, 1));
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Layout, 1, 1, &descriptorSet, 0, nullptr);
+        m_FeedbackWritten[slot] = true;
+    }
+    Constants constants{
+        .viewProjection = projection * view,
+        .instancesPerRow = m_InstancesPerRow,
+        .spacing = TEXTURE_SPACING,
+        .feedbackPhase = static_cast<uint32_t>(GetFrame() % 16)
+    };
+    for (uint32_t i = 0; i < m_Settings.count; i++) {
+        const auto& texture = m_Manager->Get(m_Streamer ? m_Streamer->GetTexture(i) : m_Textures[i]);
+        if (m_Streamer) {
+            constants.residentLevel = m_Streamer->GetResidentLevel(i);
+        }
+        if (bindlessHeap) {
+            constants.texture = texture.bindless;
+        }
+        else {
+            DescriptorAllocator::Binding binding = DescriptorAllocator::Binding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                texture.view, m_Samplers[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            auto descriptorSet = m_Context.descriptorAllocator->GetDescriptorSet(m_SetLayout, std::span(&binding, 1));
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Layout, 0, 1, &descriptorSet, 0, nullptr);
+        }
+        constants.instance = i;
+        vkCmdPushConstants(commandBuffer, m_Layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+        vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+    }
+}
+
+void VkTextureScene::ReadBack(uint32_t slot)
+{
+    if (m_FeedbackWritten[slot]) {
+        m_Streamer->ReportFeedback(std::span(m_FeedbackMapped[slot], m_Settings.count));
+        std::fill_n(m_FeedbackMapped[slot], m_Settings.count, TextureStreamer::NotRequested);
+        m_FeedbackWritten[slot] = false;
+    }
+    m_Manager->Collect();
+}
+
+void VkTextureScene::PrintStats() const
+{
+    const auto& stats = m_Manager->GetStats();
+    const auto& memory = m_Manager->GetMemoryStats();
+    std::cout << std::format("Texture uploads: {} MiB at startup in {:.1f} ms ({:.0f} MB/s), then {} uploads in {} batches, {:.3f} ms CPU each, {:.0f} MB/s on the GPU, {} staging waits",
+        m_StartupUpload.bytes >> 20, m_StartupUpload.ms, m_StartupUpload.ms > 0 ? m_StartupUpload.bytes / (m_StartupUpload.ms * 1000.0) : 0.0,
+        stats.uploads - m_Settings.count, stats.batches, stats.uploads > 0 ? stats.cpuMs / stats.uploads : 0.0, stats.GpuMegabytesPerSecond(), stats.stagingWaits) << std::endl;
+    std::cout << std::format("Texture memory: {} MiB peak in {} blocks ({} MiB reserved), {} mip levels generated, {} textures without mips; samplers: {} requests, {} created",
+        memory.peakBytesInUse >> 20, memory.blocksCreated, memory.bytesReserved >> 20, stats.mipLevelsGenerated, stats.withoutMips,
+        m_SamplerCache->GetStats().requests, m_SamplerCache->GetStats().created) << std::endl;
+    if (m_Streamer) {
+        const auto& streaming = m_Streamer->GetStats();
+        std::cout << std::format("Texture streaming: {} loads, {} promoted, {} stale, {} evictions, {} cut short by the budget; {} MiB read at {:.0f} MB/s, {} MiB uploaded; {} MiB resident, {} MiB peak of {} MiB budget, {} MiB for every level",
+            streaming.loadsRequested, streaming.promotions, streaming.staleLoads, streaming.evictions, streaming.budgetMisses,
+            streaming.bytesRead >> 20, streaming.ReadMegabytesPerSecond(), streaming.bytesUploaded >> 20,
+            streaming.residentBytes >> 20, streaming.peakResidentBytes >> 20, m_Settings.budgetMiB, streaming.fullBytes >> 20) << std::endl;
+    }
+}
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Texture benchmark (--textures=N): N textures uploaded through the staging ring with their mips blitted on the GPU,
+ * drawn as a grid of quads on the ground so the far ones sample small mips. Every frame some of them are uploaded
+ * again, to measure sustained upload bandwidth. They are sampled through the bindless heap when there is one, and
+ * through a descriptor set per texture otherwise.
+ * With a block format the sources are cooked into KTX2 files of block compressed mips at startup, as an offline step
+ * would, then the files are mapped and every level is uploaded straight out of them instead of blitting mips.
+ * Streaming loads the cooked files bit by bit instead of whole: each texture starts with its small mips, and the finer
+ * ones are loaded as the shaders ask for them, within a budget. It needs the bindless heap. The camera travels down
+ * the grid and back, so levels come and go.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkScene.hpp"
+#include "VkTextures.hpp"
+#include "BlockCompression.hpp"
+#include "Ktx2.hpp"
+
+#include <cstddef>      // For std::byte
+#include <cstdint>      // For uint32_t, uint64_t
+#include <filesystem>   // For std::filesystem::path
+#include <memory>       // For std::unique_ptr
+#include <optional>     // For std::optional
+#include <vector>       // For std::vector
+
+class CommandBufferPool;
+class MappedFile;
+class SamplerCache;
+class TextureStreamer;
+class TimelineQueue;
+
+class VkTextureScene : public VkScene
+{
+public:
+    struct Settings
+    {
+        uint32_t count = 256;
+        uint32_t size = 512;
+        uint32_t uploadsPerFrame = 8;                   // without streaming
+        std::optional<BlockFormat> blockFormat = {};    // RGBA8 without one
+        bool zlib = false;                              // supercompress the cooked files
+        bool streaming = false;                         // needs a block format and the bindless heap
+        uint32_t budgetMiB = 64;                        // for streaming
+        bool anisotropy = false;                        // the device has samplerAnisotropy enabled
+        float timestampPeriod = 0;                      // 0 doesn't time uploads on the GPU
+        uint32_t timestampValidBits = 0;
+        TimelineQueue* queue = nullptr;                 // the graphics queue, uploads are submitted to it
+        CommandBufferPool* commands = nullptr;          // the graphics queue's
+    };
+
+    // uploads every texture and waits for them to be done
+    VkTextureScene(const VkSceneContext& context, const Settings& settings);
+    // removes the cooked files
+    virtual ~VkTextureScene();
+
+    // this frame's share of re-uploads or streaming, submitted ahead of the frame so it samples the new contents
+    void PrepareFrame(uint32_t slot, VkExtent2D extent) final;
+    void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkExtent2D extent) final;
+    // hands the frame's feedback to the streamer, and clears it for the slot's next frame
+    void ReadBack(uint32_t slot) final;
+    void PrintStats() const final;
+
+private:
+    struct Constants
+    {
+        glm::mat4 viewProjection;
+        uint32_t instance;
+        uint32_t texture;           // bindless handle, unused without the heap
+        uint32_t instancesPerRow;
+        float spacing;
+        uint32_t residentLevel;     // streaming: the finest level the texture has resident
+        uint32_t feedbackPhase;     // streaming: which pixel of each 4x4 writes feedback
+    };  // must match textured.vert, textured_bindless.frag and textured_streamed.frag
+
+    // what an offline step would have done, the sources cooked into a KTX2 file each
+    void CookSources();
+    void UploadFile(TextureHandle texture, const Ktx2Reader& reader);
+    std::filesystem::path GetCookedFile(uint32_t source) const;
+
+    Settings                                    m_Settings;
+    std::unique_ptr<SamplerCache>               m_SamplerCache;
+    std::unique_ptr<TextureManager>             m_Manager;
+    std::unique_ptr<TextureStreamer>            m_Streamer;             // only with streaming
+    std::vector<std::vector<std::byte>>         m_Sources;
+    std::vector<TextureHandle>                  m_Textures;             // without streaming
+    std::vector<VkSampler>                      m_Samplers;             // per texture, from the cache
+    uint32_t                                    m_InstancesPerRow = 1;
+    uint32_t                                    m_NextUpload = 0;
+    VkDescriptorSetLayout                       m_SetLayout = VK_NULL_HANDLE;           // without the bindless heap
+    VkDescriptorSetLayout                       m_FeedbackSetLayout = VK_NULL_HANDLE;   // only with streaming
+    VkPipelineLayout                            m_Layout = VK_NULL_HANDLE;
+    VkPipeline                                  m_Pipeline = VK_NULL_HANDLE;
+    std::filesystem::path                       m_CookDirectory;
+    std::vector<std::unique_ptr<MappedFile>>    m_Files;                // per source, mapped for as long as the scene lives
+    std::vector<Ktx2Reader>                     m_Readers;
+    // the finest level each texture was sampled at, per frame in flight, read back once the frame is done
+    std::vector<VkBuffer>                       m_FeedbackBuffers;
+    std::vector<uint32_t*>                      m_FeedbackMapped;
+    std::vector<bool>                           m_FeedbackWritten;
+
+    struct
+    {
+        uint64_t bytes = 0;
+        double ms = 0;
+    } m_StartupUpload;      // every texture's first upload, waited for on the CPU
+
+    struct
+    {
+        double ms = 0;
+        uint64_t fileBytes = 0;
+    } m_Cook;
+};
+#endif
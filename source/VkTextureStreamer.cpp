@@ -0,0 +1,331 @@
+#if VK_AVAILABLE
+#include "VkTextureStreamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+TextureStreamer::File::File(const std::filesystem::path& path)
+    : mapping(path),
+    reader(mapping.GetData())
+{
+    const auto& description = reader.GetDescription();
+    format = static_cast<VkFormat>(GetKtx2VkFormat(description.format, description.srgb));
+    bytesFrom.resize(reader.GetLevelCount() + 1);
+    for (uint32_t level = reader.GetLevelCount(); level-- > 0;)
+    {
+        bytesFrom[level] = bytesFrom[level + 1] + reader.GetLevelSize(level);
+    }
+}
+
+TextureStreamer::TextureStreamer(TextureManager& textures, BindlessHeap* heap, const Settings& settings)
+    : m_Textures(textures),
+    m_Heap(heap),
+    m_Settings(settings)
+{
+    m_IoThread = std::thread(&TextureStreamer::IoMain, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_LoadRequested.notify_one();
+    m_IoThread.join();
+    // the textures are the manager's, and go with it
+}
+
+uint32_t TextureStreamer::Add(const std::filesystem::path& path, VkSampler sampler)
+{
+    auto& file = m_FilesByPath[path.string()];
+    if (file == nullptr)
+    {
+        m_Files.push_back(std::make_unique<File>(path));
+        file = m_Files.back().get();
+    }
+    const auto& description = file->reader.GetDescription();
+    uint32_t levelCount = file->reader.GetLevelCount();
+
+    // the tail starts at the first level no bigger than residentTailSize, or the last level if none are
+    uint32_t tailLevel = 0;
+    while (tailLevel + 1 < levelCount && std::max(description.width >> tailLevel, description.height >> tailLevel) > m_Settings.residentTailSize)
+    {
+        tailLevel++;
+    }
+    Entry entry{
+        .file = file,
+        .sampler = sampler,
+        .texture = m_Textures.Create(std::max(description.width >> tailLevel, 1u), std::max(description.height >> tailLevel, 1u), file->format, levelCount - tailLevel),
+        .residentLevel = tailLevel,
+        .tailLevel = tailLevel,
+        .wantedLevel = tailLevel,
+    };
+    // small enough to read on this thread
+    m_Textures.UploadLevels(entry.texture, [&](uint32_t level, std::span<std::byte> destination) {
+        file->reader.ReadLevel(tailLevel + level, destination);
+    });
+    if (m_Heap)
+    {
+        m_Textures.RegisterBindless(entry.texture, *m_Heap, sampler);
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_Entries.size());
+    entry.lru = m_Lru.insert(m_Lru.end(), index);
+    m_Entries.push_back(entry);
+    m_Stats.residentBytes += file->bytesFrom[tailLevel];
+    m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_Stats.residentBytes);
+    m_Stats.fullBytes += file->bytesFrom[0];
+    return index;
+}
+
+void TextureStreamer::ReportFeedback(std::span<const uint32_t> requestedLevels)
+{
+    assert(requestedLevels.size() >= m_Entries.size() && "Feedback needs a level for every texture.");
+    m_Frame++;
+    m_Wanted.clear();
+    for (uint32_t i = 0; i < m_Entries.size(); i++)
+    {
+        if (requestedLevels[i] == NotRequested)
+        {
+            continue;
+        }
+        auto& entry = m_Entries[i];
+        entry.wantedLevel = std::min(requestedLevels[i], entry.tailLevel);
+        entry.lastRequestedFrame = m_Frame;
+        m_Lru.splice(m_Lru.end(), m_Lru, entry.lru);
+        if (!entry.loading && entry.wantedLevel < entry.residentLevel)
+        {
+            m_Wanted.push_back(i);
+        }
+    }
+    std::stable_sort(m_Wanted.begin(), m_Wanted.end(), [this](uint32_t a, uint32_t b) {
+        return m_Entries[a].residentLevel - m_Entries[a].wantedLevel > m_Entries[b].residentLevel - m_Entries[b].wantedLevel;
+    });
+}
+
+void TextureStreamer::Update()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        std::move(m_Completed.begin(), m_Completed.end(), std::back_inserter(m_Ready));
+        m_Completed.clear();
+    }
+
+    // finished loads, oldest first, as many as the frame's upload allowance takes
+    VkDeviceSize uploaded = 0;
+    while (!m_Ready.empty() && uploaded < m_Settings.uploadBytesPerFrame)
+    {
+        Load load = std::move(m_Ready.front());
+        m_Ready.pop_front();
+        m_PendingLoads--;
+        if (load.error)
+        {
+            std::rethrow_exception(load.error);
+        }
+        m_Stats.ioMs += load.ms;
+        m_Stats.bytesRead += load.data.size();
+
+        auto& entry = m_Entries[load.entry];
+        entry.loading = false;
+        if (entry.residentLevel != load.endLevel)
+        {
+            m_Stats.staleLoads++;
+            continue;
+        }
+        // as many of the loaded levels as fit, finest first
+        uint32_t level = load.firstLevel;
+        while (level < load.endLevel && !MakeRoom(entry.file->bytesFrom[level] - entry.file->bytesFrom[entry.residentLevel], load.entry))
+        {
+            level++;
+        }
+        if (level != load.firstLevel)
+        {
+            m_Stats.budgetMisses++;
+        }
+        if (level == load.endLevel)
+        {
+            continue;
+        }
+        VkDeviceSize bytes = entry.file->bytesFrom[level] - entry.file->bytesFrom[load.endLevel];
+        SetResidentLevel(load.entry, level, &load);
+        m_Stats.promotions++;
+        m_Stats.bytesUploaded += bytes;
+        uploaded += bytes;
+    }
+
+    // new loads for what the latest feedback wants, only as fine as could be made room for
+    VkDeviceSize available = m_Settings.budget - std::min(m_Settings.budget, m_Stats.residentBytes) + GetReclaimableBytes(~0u);
+    for (uint32_t index : m_Wanted)
+    {
+        if (m_PendingLoads >= m_Settings.maxPendingLoads)
+        {
+            break;
+        }
+        auto& entry = m_Entries[index];
+        if (entry.loading || entry.wantedLevel >= entry.residentLevel)
+        {
+            continue;
+        }
+        uint32_t level = entry.wantedLevel;
+        while (level < entry.residentLevel && entry.file->bytesFrom[level] - entry.file->bytesFrom[entry.residentLevel] > available)
+        {
+            level++;
+        }
+        if (level != entry.wantedLevel)
+        {
+            m_Stats.budgetMisses++;
+        }
+        if (level == entry.residentLevel)
+        {
+            continue;
+        }
+        available -= entry.file->bytesFrom[level] - entry.file->bytesFrom[entry.residentLevel];
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Requests.push_back({ .entry = index, .file = entry.file, .firstLevel = level, .endLevel = entry.residentLevel });
+        }
+        m_LoadRequested.notify_one();
+        entry.loading = true;
+        m_PendingLoads++;
+        m_Stats.loadsRequested++;
+    }
+    m_Wanted.clear();
+
+    // the replaced textures are destroyed after the batch copying out of them is submitted, so that's one submission
+    m_Textures.Flush();
+    for (auto texture : m_Retired)
+    {
+        m_Textures.Destroy(texture);
+    }
+    m_Retired.clear();
+}
+
+void TextureStreamer::IoMain()
+{
+    std::unique_lock lock(m_Mutex);
+    for (;;)
+    {
+        m_LoadRequested.wait(lock, [this] { return m_Stop || !m_Requests.empty(); });
+        if (m_Stop)
+        {
+            return;
+        }
+        Load load = std::move(m_Requests.front());
+        m_Requests.pop_front();
+        lock.unlock();
+
+        // the mapping's pages are first touched here, so page faults land on this thread
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            size_t size = 0;
+            for (uint32_t level = load.firstLevel; level < load.endLevel; level++)
+            {
+                load.offsets.push_back(size);
+                size += load.file->reader.GetLevelSize(level);
+            }
+            load.data.resize(size);
+            for (uint32_t level = load.firstLevel; level < load.endLevel; level++)
+            {
+                size_t offset = load.offsets[level - load.firstLevel];
+                load.file->reader.ReadLevel(level, std::span(load.data.data() + offset, load.file->reader.GetLevelSize(level)));
+            }
+        }
+        catch (...)
+        {
+            load.error = std::current_exception();
+        }
+        load.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        m_Completed.push_back(std::move(load));
+    }
+}
+
+uint32_t TextureStreamer::GetEvictionLevel(const Entry& entry) const
+{
+    if (entry.lastRequestedFrame + FeedbackWindow <= m_Frame)
+    {
+        return entry.tailLevel;
+    }
+    return std::max(entry.wantedLevel, entry.residentLevel);
+}
+
+VkDeviceSize TextureStreamer::GetReclaimableBytes(uint32_t exclude) const
+{
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < m_Entries.size(); i++)
+    {
+        if (i != exclude)
+        {
+            const auto& entry = m_Entries[i];
+            bytes += entry.file->bytesFrom[entry.residentLevel] - entry.file->bytesFrom[GetEvictionLevel(entry)];
+        }
+    }
+    return bytes;
+}
+
+bool TextureStreamer::MakeRoom(VkDeviceSize bytes, uint32_t exclude)
+{
+    if (m_Stats.residentBytes + bytes <= m_Settings.budget)
+    {
+        return true;
+    }
+    // not evicting anything unless it is enough
+    if (m_Stats.residentBytes + bytes > m_Settings.budget + GetReclaimableBytes(exclude))
+    {
+        return false;
+    }
+    // unused textures come before the ones with levels to spare, and both are least recently requested first
+    for (bool unused : { true, false })
+    {
+        for (uint32_t index : m_Lru)
+        {
+            if (m_Stats.residentBytes + bytes <= m_Settings.budget)
+            {
+                return true;
+            }
+            const auto& entry = m_Entries[index];
+            bool isUnused = entry.lastRequestedFrame + FeedbackWindow <= m_Frame;
+            uint32_t level = GetEvictionLevel(entry);
+            if (index != exclude && isUnused == unused && level > entry.residentLevel)
+            {
+                SetResidentLevel(index, level, nullptr);
+                m_Stats.evictions++;
+            }
+        }
+    }
+    return m_Stats.residentBytes + bytes <= m_Settings.budget;
+}
+
+void TextureStreamer::SetResidentLevel(uint32_t index, uint32_t level, const Load* load)
+{
+    auto& entry = m_Entries[index];
+    const auto& description = entry.file->reader.GetDescription();
+    uint32_t levelCount = entry.file->reader.GetLevelCount();
+    TextureHandle texture = m_Textures.Create(std::max(description.width >> level, 1u), std::max(description.height >> level, 1u), entry.file->format, levelCount - level);
+
+    // levels the old texture didn't have come from the load, the rest are copied across
+    uint32_t shared = std::max(level, entry.residentLevel);
+    if (level < shared)
+    {
+        assert(load && load->firstLevel <= level && load->endLevel == shared && "Loading levels without the load.");
+        m_Textures.UploadLevels(texture, [&](uint32_t textureLevel, std::span<std::byte> destination) {
+            memcpy(destination.data(), load->data.data() + load->offsets[level + textureLevel - load->firstLevel], destination.size());
+        }, 0, shared - level);
+    }
+    m_Textures.CopyLevels(entry.texture, shared - entry.residentLevel, texture, shared - level, levelCount - shared);
+    if (m_Heap)
+    {
+        m_Textures.RegisterBindless(texture, *m_Heap, entry.sampler);
+    }
+
+    m_Retired.push_back(entry.texture);
+    m_Stats.residentBytes = m_Stats.residentBytes - entry.file->bytesFrom[entry.residentLevel] + entry.file->bytesFrom[level];
+    m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_Stats.residentBytes);
+    entry.texture = texture;
+    entry.residentLevel = level;
+}
+#endif
@@ -0,0 +1,177 @@
+/**
+ * Texture streaming: only the mip levels something is sampling are kept on the GPU, under a fixed budget, so huge
+ * texture sets fit in bounded memory. Textures come from KTX2 files, mapped once however many textures share them.
+ * Each texture always has its tail resident, the levels of residentTailSize and smaller, and the rest of its chain
+ * is loaded as feedback asks for it. Feedback is the finest level each texture was sampled at in a frame, written
+ * by the shaders into a buffer the app reads back once the frame is done.
+ * A background thread copies (or inflates) requested levels out of the mapped files, so the render thread never
+ * waits on a page fault. Update uploads what it has finished, a limited number of bytes a frame, into a new texture
+ * holding the finer chain. Levels the old and new texture share are copied on the GPU rather than loaded again, and
+ * the old texture is destroyed once the GPU is done with it, so the texture's handle (and bindless index) changes.
+ * When a load doesn't fit the budget, the least recently requested textures give up their levels first: the ones
+ * nothing sampled lately go back to their tail, then the ones holding finer levels than they were last asked for.
+ * Residency is counted in the size of the levels, not the memory the pool gives them. Not thread-safe.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "Ktx2.hpp"
+#include "MappedFile.hpp"
+#include "VkTextures.hpp"
+
+#include <condition_variable>   // For std::condition_variable
+#include <cstddef>              // For std::byte
+#include <cstdint>              // For uint32_t, uint64_t
+#include <deque>                // For std::deque
+#include <exception>            // For std::exception_ptr
+#include <filesystem>           // For std::filesystem::path
+#include <list>                 // For std::list
+#include <memory>               // For std::unique_ptr
+#include <mutex>                // For std::mutex
+#include <span>                 // For std::span
+#include <string>               // For std::string
+#include <thread>               // For std::thread
+#include <unordered_map>        // For std::unordered_map
+#include <vector>               // For std::vector
+
+class TextureStreamer
+{
+public:
+    // in the feedback, for a texture nothing sampled
+    static constexpr uint32_t NotRequested = ~0u;
+    // frames without feedback before a texture counts as unused. Shaders only write feedback for some pixels each
+    // frame, so small textures can go a few frames without any
+    static constexpr uint64_t FeedbackWindow = 16;
+
+    struct Settings
+    {
+        VkDeviceSize budget = 64ull << 20;              // for every streamed texture's levels together
+        VkDeviceSize uploadBytesPerFrame = 8ull << 20;  // of loaded levels handed to the GPU by one Update
+        uint32_t residentTailSize = 64;                 // levels this size and smaller are always resident
+        uint32_t maxPendingLoads = 16;                  // with the I/O thread at once
+    };
+
+    struct Stats
+    {
+        uint64_t loadsRequested = 0;
+        uint64_t promotions = 0;            // loads uploaded, making a texture finer
+        uint64_t staleLoads = 0;            // thrown away, the texture's residency changed while they were loading
+        uint64_t evictions = 0;             // textures dropped to coarser levels to make room
+        uint64_t budgetMisses = 0;          // loads cut short, or not made, for lack of room
+        uint64_t bytesRead = 0;             // out of the files, by the I/O thread
+        uint64_t bytesUploaded = 0;
+        double ioMs = 0;                    // the I/O thread's time reading
+        VkDeviceSize residentBytes = 0;
+        VkDeviceSize peakResidentBytes = 0;
+        VkDeviceSize fullBytes = 0;         // every level of every texture, what having them all resident would take
+
+        double ReadMegabytesPerSecond() const {
+            return ioMs <= 0 ? 0.0 : bytesRead / (ioMs * 1000.0);
+        }
+    };
+
+    // Textures are registered with heap when it isn't null.
+    TextureStreamer(TextureManager& textures, BindlessHeap* heap, const Settings& settings);
+    virtual ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Stream a texture out of a KTX2 file, which stays mapped for as long as the streamer lives. Only its tail is
+    // loaded now, and uploaded with the next Update. Returns the index feedback refers to it by, counting up from 0.
+    // Throws std::runtime_error if the file can't be mapped or read.
+    uint32_t Add(const std::filesystem::path& path, VkSampler sampler);
+
+    // Take a frame's feedback: for each texture in order, the finest level sampled, or NotRequested. Textures
+    // wanting finer levels than they have are queued to load, the ones furthest short first.
+    void ReportFeedback(std::span<const uint32_t> requestedLevels);
+
+    // Upload the loads the I/O thread has finished, hand it the next ones, and submit. Call once a frame, before
+    // recording anything that samples the textures.
+    void Update();
+
+    TextureHandle GetTexture(uint32_t index) const {
+        return m_Entries[index].texture;
+    }
+    // the finest level resident, which is the texture's level 0
+    uint32_t GetResidentLevel(uint32_t index) const {
+        return m_Entries[index].residentLevel;
+    }
+    uint32_t GetCount() const {
+        return static_cast<uint32_t>(m_Entries.size());
+    }
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+private:
+    struct File
+    {
+        explicit File(const std::filesystem::path& path);
+
+        MappedFile mapping;
+        Ktx2Reader reader;
+        VkFormat format;
+        std::vector<VkDeviceSize> bytesFrom;    // of every level from each one down to 1x1
+    };
+    struct Entry
+    {
+        const File* file;
+        VkSampler sampler;
+        TextureHandle texture;
+        uint32_t residentLevel;             // the finest on the GPU
+        uint32_t tailLevel;                 // always resident, from this one down
+        uint32_t wantedLevel;               // the finest the latest feedback asked for
+        uint64_t lastRequestedFrame = 0;
+        bool loading = false;
+        std::list<uint32_t>::iterator lru;
+    };
+    // levels [firstLevel, endLevel) of an entry, read into memory by the I/O thread
+    struct Load
+    {
+        uint32_t entry;
+        const File* file;
+        uint32_t firstLevel;
+        uint32_t endLevel;                  // the entry's residentLevel when it was asked for
+        std::vector<std::byte> data;
+        std::vector<size_t> offsets;        // of each level in data
+        double ms = 0;
+        std::exception_ptr error;
+    };
+
+    void IoMain();
+    // the level an entry could drop to if room were needed, its residentLevel if it has nothing to give
+    uint32_t GetEvictionLevel(const Entry& entry) const;
+    // bytes eviction could free, not counting the entry excluded
+    VkDeviceSize GetReclaimableBytes(uint32_t exclude) const;
+    // Evict least recently requested first until bytes more fit in the budget. Returns whether they do.
+    bool MakeRoom(VkDeviceSize bytes, uint32_t exclude);
+    // Swap an entry's texture for one from level down, the levels it didn't have coming from load.
+    void SetResidentLevel(uint32_t index, uint32_t level, const Load* load);
+
+    TextureManager&             m_Textures;
+    BindlessHeap*               m_Heap;
+    Settings                    m_Settings;
+
+    std::vector<std::unique_ptr<File>>          m_Files;
+    std::unordered_map<std::string, const File*> m_FilesByPath;
+    std::vector<Entry>          m_Entries;
+    std::list<uint32_t>         m_Lru;                  // entries, least recently requested first
+    std::vector<uint32_t>       m_Wanted;               // entries the latest feedback wants loads for, in order
+    std::deque<Load>            m_Ready;                // finished, waiting for upload room
+    std::vector<TextureHandle>  m_Retired;              // replaced this Update, destroyed once it has submitted
+    uint64_t                    m_Frame = 0;            // feedback reported so far
+    uint32_t                    m_PendingLoads = 0;     // requested and not yet uploaded or dropped
+
+    // shared with the I/O thread
+    std::thread                 m_IoThread;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_LoadRequested;
+    std::deque<Load>            m_Requests;
+    std::deque<Load>            m_Completed;
+    bool                        m_Stop = false;
+
+    Stats                       m_Stats;
+};
+#endif
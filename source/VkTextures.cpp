@@ -0,0 +1,545 @@
+#if VK_AVAILABLE
+#include "VkTextures.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace
+{
+    // copies into the ring start on this, which covers every texel size and the 4 bytes buffer copies need
+    constexpr VkDeviceSize StagingAlignment = 16;
+
+    void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t mipCount,
+        VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        VkImageMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = srcAccess,
+            .dstAccessMask = dstAccess,
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = baseMip,
+                .levelCount = mipCount,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // wherever textures end up being read from
+    constexpr VkPipelineStageFlags ShaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+}
+
+uint32_t TextureManager::GetTexelSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+        return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+uint32_t TextureManager::GetBlockSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+VkDeviceSize TextureManager::GetLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    if (uint32_t blockSize = GetBlockSize(format))
+    {
+        return VkDeviceSize((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+    }
+    return VkDeviceSize(width) * height * GetTexelSize(format);
+}
+
+TextureManager::TextureManager(VkPhysicalDevice physicalDevice, VkDevice device, TimelineQueue& queue, CommandBufferPool& commands,
+    DeletionQueue& deletionQueue, const Settings& settings)
+    : m_PhysicalDevice(physicalDevice),
+    m_Device(device),
+    m_Queue(queue),
+    m_Commands(commands),
+    m_DeletionQueue(deletionQueue),
+    m_Settings(settings),
+    m_MemoryPool(physicalDevice, device, settings.blockSize)
+{
+    // the ring stays mapped for as long as the manager lives
+    VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = m_Settings.stagingSize,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    VK_CHECK(vkCreateBuffer(m_Device, &bufferInfo, nullptr, &m_StagingBuffer));
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_Device, m_StagingBuffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = FindMemoryType(m_PhysicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    };
+    VK_CHECK(vkAllocateMemory(m_Device, &allocInfo, nullptr, &m_StagingMemory));
+    VK_CHECK(vkBindBufferMemory(m_Device, m_StagingBuffer, m_StagingMemory, 0));
+    void* mapped;
+    VK_CHECK(vkMapMemory(m_Device, m_StagingMemory, 0, m_Settings.stagingSize, 0, &mapped));
+    m_StagingMapped = static_cast<std::byte*>(mapped);
+
+    if (m_Settings.timestampPeriod > 0)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = MaxTimedBatches * 2,
+        };
+        VK_CHECK(vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &m_QueryPool));
+    }
+}
+
+TextureManager::~TextureManager()
+{
+    // textures destroyed while frames still used them are waiting on those frames, so their memory and bindless
+    // slots go back before the pool and the heap do
+    m_Queue.WaitForFenceValue(Flush());
+    Collect();
+    // the images go with the deletion queue's next flush. Their memory can be freed first, as long as they aren't used again
+    for (auto& texture : m_Textures)
+    {
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE_VIEW, texture.view);
+        m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE, texture.image);
+    }
+    vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+    vkDestroyBuffer(m_Device, m_StagingBuffer, nullptr);
+    vkFreeMemory(m_Device, m_StagingMemory, nullptr);
+    // the memory pool frees its blocks after this
+}
+
+TextureHandle TextureManager::Create(uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels)
+{
+    uint32_t fullChain = std::bit_width(std::max(width, height));
+    mipLevels = mipLevels == 0 ? fullChain : std::min(mipLevels, fullChain);
+
+    // mips are made by blitting with linear filtering, which not every format supports. Block compressed formats
+    // never do, and bring their own mips
+    if (mipLevels > 1 && GetBlockSize(format) == 0)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &properties);
+        VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if ((properties.optimalTilingFeatures & needed) != needed)
+        {
+            mipLevels = 1;
+            m_Stats.withoutMips++;
+        }
+    }
+
+    Texture texture{
+        .format = format,
+        .extent = { width, height },
+        .mipLevels = mipLevels
+    };
+    VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = { width, height, 1 },
+        .mipLevels = mipLevels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        // each level is blitted from the one above
+        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    VK_CHECK(vkCreateImage(m_Device, &imageInfo, nullptr, &texture.image));
+    m_DeletionQueue.Track(VK_OBJECT_TYPE_IMAGE, texture.image);
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_Device, texture.image, &requirements);
+    texture.memory = m_MemoryPool.Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VK_CHECK(vkBindImageMemory(m_Device, texture.image, texture.memory.memory, texture.memory.offset));
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = texture.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = mipLevels,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    VK_CHECK(vkCreateImageView(m_Device, &viewInfo, nullptr, &texture.view));
+    m_DeletionQueue.Track(VK_OBJECT_TYPE_IMAGE_VIEW, texture.view);
+    m_Stats.texturesCreated++;
+
+    if (!m_FreeHandles.empty())
+    {
+        TextureHandle handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+        m_Textures[handle] = texture;
+        return handle;
+    }
+    m_Textures.push_back(texture);
+    return static_cast<TextureHandle>(m_Textures.size() - 1);
+}
+
+void TextureManager::Upload(TextureHandle handle, std::span<const std::byte> pixels)
+{
+    auto start = std::chrono::steady_clock::now();
+    const auto& texture = m_Textures[handle];
+    assert(GetTexelSize(texture.format) != 0 && "Block compressed textures are uploaded with UploadLevels.");
+    assert(pixels.size() == VkDeviceSize(texture.extent.width) * texture.extent.height * GetTexelSize(texture.format) && "Upload expects all of mip 0, tightly packed.");
+
+    // reserving may submit the batch to make room, so it comes before recording anything
+    VkDeviceSize offset = ReserveStaging(pixels.size());
+    memcpy(m_StagingMapped + offset, pixels.data(), pixels.size());
+    auto commandBuffer = GetBatchCommandBuffer();
+
+    // the old contents are thrown away, but earlier frames may still be sampling them
+    imageBarrier(commandBuffer, texture.image, 0, texture.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        ShaderStages, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkBufferImageCopy region{
+        .bufferOffset = offset,
+        .bufferRowLength = 0,       // tightly packed
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { texture.extent.width, texture.extent.height, 1 }
+    };
+    vkCmdCopyBufferToImage(commandBuffer, m_StagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    RecordMips(commandBuffer, texture);
+
+    m_BatchBytes += pixels.size();
+    m_Stats.uploads++;
+    m_Stats.bytesUploaded += pixels.size();
+    m_Stats.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TextureManager::UploadLevels(TextureHandle handle, const LevelWriter& writeLevel, uint32_t firstLevel, uint32_t levelCount)
+{
+    auto start = std::chrono::steady_clock::now();
+    const auto& texture = m_Textures[handle];
+    assert(firstLevel < texture.mipLevels && "UploadLevels starts past the last level.");
+    uint32_t endLevel = levelCount == ~0u ? texture.mipLevels : firstLevel + levelCount;
+    assert(endLevel <= texture.mipLevels && "UploadLevels runs past the last level.");
+
+    // one reservation for every level, each starting aligned
+    std::vector<VkDeviceSize> offsets(texture.mipLevels);
+    VkDeviceSize total = 0;
+    for (uint32_t level = firstLevel; level < endLevel; level++)
+    {
+        offsets[level] = total;
+        VkDeviceSize size = GetLevelSize(texture.format, std::max(texture.extent.width >> level, 1u), std::max(texture.extent.height >> level, 1u));
+        total = (total + size + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+    }
+    VkDeviceSize base = ReserveStaging(total);
+
+    std::vector<VkBufferImageCopy> regions;
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = firstLevel; level < endLevel; level++)
+    {
+        uint32_t width = std::max(texture.extent.width >> level, 1u);
+        uint32_t height = std::max(texture.extent.height >> level, 1u);
+        VkDeviceSize size = GetLevelSize(texture.format, width, height);
+        writeLevel(level, std::span(m_StagingMapped + base + offsets[level], static_cast<size_t>(size)));
+        regions.push_back({
+            .bufferOffset = base + offsets[level],
+            .bufferRowLength = 0,   // tightly packed
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = { width, height, 1 }
+        });
+        bytes += size;
+    }
+
+    auto commandBuffer = GetBatchCommandBuffer();
+    imageBarrier(commandBuffer, texture.image, firstLevel, endLevel - firstLevel, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        ShaderStages, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyBufferToImage(commandBuffer, m_StagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()), regions.data());
+    imageBarrier(commandBuffer, texture.image, firstLevel, endLevel - firstLevel, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, ShaderStages, VK_ACCESS_SHADER_READ_BIT);
+
+    m_BatchBytes += bytes;
+    m_Stats.uploads++;
+    m_Stats.bytesUploaded += bytes;
+    m_Stats.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TextureManager::CopyLevels(TextureHandle sourceHandle, uint32_t sourceLevel, TextureHandle destinationHandle, uint32_t destinationLevel, uint32_t levelCount)
+{
+    const auto& source = m_Textures[sourceHandle];
+    const auto& destination = m_Textures[destinationHandle];
+    assert(source.format == destination.format && "CopyLevels copies between textures of one format.");
+    assert(sourceLevel + levelCount <= source.mipLevels && destinationLevel + levelCount <= destination.mipLevels && "CopyLevels runs past the last level.");
+
+    std::vector<VkImageCopy> regions;
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint32_t width = std::max(destination.extent.width >> (destinationLevel + i), 1u);
+        uint32_t height = std::max(destination.extent.height >> (destinationLevel + i), 1u);
+        assert(width == std::max(source.extent.width >> (sourceLevel + i), 1u) && height == std::max(source.extent.height >> (sourceLevel + i), 1u) && "CopyLevels needs levels of the same size.");
+        regions.push_back({
+            .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, sourceLevel + i, 0, 1 },
+            .srcOffset = { 0, 0, 0 },
+            .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, destinationLevel + i, 0, 1 },
+            .dstOffset = { 0, 0, 0 },
+            .extent = { width, height, 1 }
+        });
+        bytes += GetLevelSize(destination.format, width, height);
+    }
+
+    // the source is only read, and goes back to being sampled after
+    auto commandBuffer = GetBatchCommandBuffer();
+    imageBarrier(commandBuffer, source.image, sourceLevel, levelCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        ShaderStages, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    imageBarrier(commandBuffer, destination.image, destinationLevel, levelCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        ShaderStages, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyImage(commandBuffer, source.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()), regions.data());
+    imageBarrier(commandBuffer, source.image, sourceLevel, levelCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, ShaderStages, VK_ACCESS_SHADER_READ_BIT);
+    imageBarrier(commandBuffer, destination.image, destinationLevel, levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, ShaderStages, VK_ACCESS_SHADER_READ_BIT);
+    m_Stats.bytesCopied += bytes;
+}
+
+void TextureManager::RecordMips(VkCommandBuffer commandBuffer, const Texture& texture)
+{
+    // each level is read once to make the next, then left for shaders
+    int32_t width = static_cast<int32_t>(texture.extent.width);
+    int32_t height = static_cast<int32_t>(texture.extent.height);
+    for (uint32_t level = 1; level < texture.mipLevels; level++)
+    {
+        imageBarrier(commandBuffer, texture.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        int32_t nextWidth = std::max(width / 2, 1);
+        int32_t nextHeight = std::max(height / 2, 1);
+        VkImageBlit blit{
+            .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 },
+            .srcOffsets = { { 0, 0, 0 }, { width, height, 1 } },
+            .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+            .dstOffsets = { { 0, 0, 0 }, { nextWidth, nextHeight, 1 } },
+        };
+        vkCmdBlitImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit, VK_FILTER_LINEAR);
+        imageBarrier(commandBuffer, texture.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, ShaderStages, VK_ACCESS_SHADER_READ_BIT);
+        width = nextWidth;
+        height = nextHeight;
+        m_Stats.mipLevelsGenerated++;
+    }
+    // the last level was only ever written
+    imageBarrier(commandBuffer, texture.image, texture.mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, ShaderStages, VK_ACCESS_SHADER_READ_BIT);
+}
+
+VkCommandBuffer TextureManager::GetBatchCommandBuffer()
+{
+    if (m_Batch != VK_NULL_HANDLE)
+    {
+        return m_Batch;
+    }
+    m_Batch = m_Commands.GetCommandBuffer();
+    m_BatchBytes = 0;
+    m_BatchQuery = ~0u;
+    // only time the batch if its pair of queries isn't still waiting to be read
+    if (m_QueryPool != VK_NULL_HANDLE && m_TimedBatches.size() < MaxTimedBatches)
+    {
+        m_BatchQuery = m_NextQuery * 2;
+        m_NextQuery = (m_NextQuery + 1) % MaxTimedBatches;
+        vkCmdResetQueryPool(m_Batch, m_QueryPool, m_BatchQuery, 2);
+        vkCmdWriteTimestamp(m_Batch, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, m_BatchQuery);
+    }
+    return m_Batch;
+}
+
+uint64_t TextureManager::Flush()
+{
+    if (m_Batch == VK_NULL_HANDLE)
+    {
+        return m_Queue.GetLastSignaledValue();
+    }
+    if (m_BatchQuery != ~0u)
+    {
+        vkCmdWriteTimestamp(m_Batch, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, m_BatchQuery + 1);
+    }
+    uint64_t fenceValue = m_Commands.ExecuteCommandBuffer(m_Batch);
+    m_Batch = VK_NULL_HANDLE;
+    m_Stats.batches++;
+
+    // the batch's ranges are the newest
+    for (auto it = m_StagingRanges.rbegin(); it != m_StagingRanges.rend() && it->fenceValue == 0; ++it)
+    {
+        it->fenceValue = fenceValue;
+    }
+    if (m_BatchQuery != ~0u)
+    {
+        m_TimedBatches.push_back({ m_BatchQuery, fenceValue, m_BatchBytes });
+    }
+    return fenceValue;
+}
+
+VkDeviceSize TextureManager::ReserveStaging(VkDeviceSize size)
+{
+    if (size > m_Settings.stagingSize)
+    {
+        throw std::runtime_error("texture upload is bigger than the staging buffer!");
+    }
+    for (;;)
+    {
+        // reclaim what the GPU has finished with
+        while (!m_StagingRanges.empty() && m_StagingRanges.front().fenceValue != 0 && m_Queue.IsFenceComplete(m_StagingRanges.front().fenceValue))
+        {
+            m_StagingRanges.pop_front();
+        }
+
+        // the ranges in use run from the oldest's offset up to the head, possibly wrapping past the end
+        std::optional<VkDeviceSize> offset;
+        if (m_StagingRanges.empty())
+        {
+            offset = 0;
+        }
+        else
+        {
+            VkDeviceSize tail = m_StagingRanges.front().offset;
+            if (m_StagingHead > tail)
+            {
+                if (m_StagingHead + size <= m_Settings.stagingSize)
+                {
+                    offset = m_StagingHead;
+                }
+                else if (size <= tail)
+                {
+                    offset = 0;     // wrap, leaving the end of the ring unused this time around
+                }
+            }
+            else if (m_StagingHead + size <= tail)
+            {
+                offset = m_StagingHead;
+            }
+        }
+        if (offset)
+        {
+            m_StagingHead = (*offset + size + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+            m_StagingRanges.push_back({ *offset, size, 0 });
+            return *offset;
+        }
+
+        // full: submit what's waiting so it can finish, and wait for the oldest batch
+        Flush();
+        m_Stats.stagingWaits++;
+        m_Queue.WaitForFenceValue(m_StagingRanges.front().fenceValue);
+    }
+}
+
+void TextureManager::Destroy(TextureHandle handle)
+{
+    // the batch may be writing to it, so it has to be submitted before the image is retired
+    Flush();
+    auto& texture = m_Textures[handle];
+    m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE_VIEW, texture.view);
+    m_DeletionQueue.Retire(VK_OBJECT_TYPE_IMAGE, texture.image);
+    m_PendingFrees.push_back({ m_Queue.GetLastSignaledValue(), texture.memory, texture.bindless });
+    texture = {};
+    m_FreeHandles.push_back(handle);
+    m_Stats.texturesDestroyed++;
+}
+
+BindlessHandle TextureManager::RegisterBindless(TextureHandle handle, BindlessHeap& heap, VkSampler sampler)
+{
+    assert((m_BindlessHeap == nullptr || m_BindlessHeap == &heap) && "Textures can only be registered with one heap.");
+    m_BindlessHeap = &heap;
+    auto& texture = m_Textures[handle];
+    if (texture.bindless == NoBindlessHandle)
+    {
+        texture.bindless = heap.RegisterImage(texture.view, sampler);
+    }
+    return texture.bindless;
+}
+
+void TextureManager::Collect()
+{
+    while (!m_PendingFrees.empty() && m_Queue.IsFenceComplete(m_PendingFrees.front().fenceValue))
+    {
+        const auto& pending = m_PendingFrees.front();
+        m_MemoryPool.Free(pending.memory);
+        if (pending.bindless != NoBindlessHandle)
+        {
+            m_BindlessHeap->ReleaseImage(pending.bindless);
+        }
+        m_PendingFrees.pop_front();
+    }
+
+    // only the low timestampValidBits bits count, so differences have to wrap at that width
+    uint64_t mask = m_Settings.timestampValidBits >= 64 ? ~0ull : (1ull << m_Settings.timestampValidBits) - 1;
+    while (!m_TimedBatches.empty() && m_Queue.IsFenceComplete(m_TimedBatches.front().fenceValue))
+    {
+        const auto& batch = m_TimedBatches.front();
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(m_Device, m_QueryPool, batch.query, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+        {
+            m_Stats.timedBatches++;
+            m_Stats.timedBytes += batch.bytes;
+            m_Stats.gpuMs += ((timestamps[1] - timestamps[0]) & mask) * m_Settings.timestampPeriod / 1e6;
+        }
+        m_TimedBatches.pop_front();
+    }
+}
+#endif
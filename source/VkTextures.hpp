@@ -0,0 +1,193 @@
+/**
+ * Sampled textures for the Vulkan backend. Images get their memory from a DeviceMemoryPool, their pixels through
+ * a persistently mapped staging ring, and their mip chains from blits on the GPU.
+ * Uploads are recorded into one command buffer until Flush submits it, so uploading many textures costs one
+ * submission. Each upload copies the pixels into the ring, copies them into mip 0, and blits every level down from
+ * the one above, leaving the whole image in SHADER_READ_ONLY_OPTIMAL. Block compressed formats can't be blitted to, so
+ * their mips are made offline and every level is copied in by UploadLevels instead. Levels can also be copied from one
+ * texture to another on the GPU, which is how a streamer swaps a texture for one with more or fewer mips without
+ * reading the levels they share again. The ring's space comes back as the GPU finishes each batch, and an upload
+ * that doesn't fit waits for the oldest one.
+ * Textures can be written into the bindless heap, and stay there until destroyed. Not thread-safe.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkBindless.hpp"
+#include "VkCommandBufferPool.hpp"
+#include "VkCommon.hpp"
+#include "VkDeletionQueue.hpp"
+#include "VkMemoryPool.hpp"
+#include "VkTimelineQueue.hpp"
+
+#include <cstddef>      // For std::byte
+#include <cstdint>      // For uint32_t, uint64_t
+#include <deque>        // For std::deque
+#include <functional>   // For std::function
+#include <span>         // For std::span
+#include <vector>       // For std::vector
+
+// index into the manager's textures
+using TextureHandle = uint32_t;
+
+class TextureManager
+{
+public:
+    static constexpr BindlessHandle NoBindlessHandle = ~0u;
+
+    struct Settings
+    {
+        VkDeviceSize stagingSize = 64ull << 20;     // the largest single upload
+        VkDeviceSize blockSize = 64ull << 20;       // of the image memory pool
+        float timestampPeriod = 0;                  // nanoseconds per tick, 0 doesn't time batches on the GPU
+        uint32_t timestampValidBits = 64;
+    };
+
+    struct Texture
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        uint32_t mipLevels = 0;
+        DeviceMemoryPool::Allocation memory;
+        BindlessHandle bindless = NoBindlessHandle;
+    };
+
+    struct Stats
+    {
+        uint64_t texturesCreated = 0;
+        uint64_t texturesDestroyed = 0;
+        uint64_t uploads = 0;
+        uint64_t bytesUploaded = 0;         // written by the CPU: mip 0 for Upload, the levels given for UploadLevels
+        uint64_t bytesCopied = 0;           // by CopyLevels, without leaving the GPU
+        uint64_t mipLevelsGenerated = 0;
+        uint64_t withoutMips = 0;           // textures whose format can't be blitted with linear filtering
+        uint64_t batches = 0;               // submissions
+        uint64_t stagingWaits = 0;          // uploads that waited for the ring to drain
+        double cpuMs = 0;                   // in Upload, copying into the ring and recording
+        uint64_t timedBatches = 0;
+        uint64_t timedBytes = 0;            // uploaded by the timed batches
+        double gpuMs = 0;                   // the timed batches, from their first command to their last
+
+        // what the GPU copies at while it is uploading, not counting the time between batches
+        double GpuMegabytesPerSecond() const {
+            return gpuMs <= 0 ? 0.0 : timedBytes / (gpuMs * 1000.0);
+        }
+    };
+
+    TextureManager(VkPhysicalDevice physicalDevice, VkDevice device, TimelineQueue& queue, CommandBufferPool& commands,
+        DeletionQueue& deletionQueue, const Settings& settings);
+    virtual ~TextureManager();
+
+    // Create a 2D texture. mipLevels 0 means a full chain down to 1x1.
+    // It has no contents until the first Upload, or UploadLevels for block compressed formats.
+    TextureHandle Create(uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels = 0);
+
+    // Replace a texture's contents with tightly packed rows of mip 0, and regenerate the rest of its mips.
+    // Textures may be uploaded to again while earlier frames are still sampling them.
+    void Upload(TextureHandle texture, std::span<const std::byte> pixels);
+
+    // writes one level, tightly packed, into its place in the staging ring
+    using LevelWriter = std::function<void(uint32_t level, std::span<std::byte> destination)>;
+
+    // Replace levels of a texture with ones made ahead of time, largest first, nothing blitted. The levels are
+    // written straight into the ring, so a loader can copy or inflate them out of a file with no copy in between.
+    // Every level by default; the rest are left alone, so they can be filled by CopyLevels.
+    void UploadLevels(TextureHandle texture, const LevelWriter& writeLevel, uint32_t firstLevel = 0, uint32_t levelCount = ~0u);
+
+    // Copy levels from one texture into another of the same format, where they are the same size. The source has
+    // to have been uploaded; the destination's levels are replaced.
+    void CopyLevels(TextureHandle source, uint32_t sourceLevel, TextureHandle destination, uint32_t destinationLevel, uint32_t levelCount);
+
+    // Submit the uploads recorded so far. Anything submitted to the queue after this sees the new contents.
+    // Returns the fence value the uploads finish at.
+    uint64_t Flush();
+
+    // Release a texture once the GPU is done with it, including its place in the bindless heap.
+    void Destroy(TextureHandle texture);
+
+    // Write a texture into the bindless heap, and return its index there.
+    BindlessHandle RegisterBindless(TextureHandle texture, BindlessHeap& heap, VkSampler sampler);
+
+    // Reuse staging space, free memory and read the timings of everything the GPU has finished. Call once a frame.
+    void Collect();
+
+    const Texture& Get(TextureHandle texture) const {
+        return m_Textures[texture];
+    }
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+    const DeviceMemoryPool::Stats& GetMemoryStats() const {
+        return m_MemoryPool.GetStats();
+    }
+
+    // bytes per texel of the uncompressed formats textures can be uploaded in, 0 for anything else
+    static uint32_t GetTexelSize(VkFormat format);
+    // bytes per 4x4 block of the BC formats, 0 for anything else
+    static uint32_t GetBlockSize(VkFormat format);
+    // of one level, tightly packed rows of texels, or of blocks for the BC formats
+    static VkDeviceSize GetLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+private:
+    // a range of the staging ring, in use until the GPU reaches fenceValue. 0 means its batch hasn't been submitted
+    struct StagingRange
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint64_t fenceValue;
+    };
+    // memory (and a bindless slot) of a destroyed texture, free once the GPU reaches fenceValue
+    struct PendingFree
+    {
+        uint64_t fenceValue;
+        DeviceMemoryPool::Allocation memory;
+        BindlessHandle bindless;
+    };
+    struct TimedBatch
+    {
+        uint32_t query;         // the first of its two timestamps
+        uint64_t fenceValue;
+        uint64_t bytes;
+    };
+
+    static constexpr uint32_t MaxTimedBatches = 64;
+
+    // where in the ring size bytes can go, waiting for the GPU if it is full
+    VkDeviceSize ReserveStaging(VkDeviceSize size);
+    // the batch's command buffer, begun if it isn't yet
+    VkCommandBuffer GetBatchCommandBuffer();
+    void RecordMips(VkCommandBuffer commandBuffer, const Texture& texture);
+
+    VkPhysicalDevice            m_PhysicalDevice;
+    VkDevice                    m_Device;
+    TimelineQueue&              m_Queue;
+    CommandBufferPool&          m_Commands;
+    DeletionQueue&              m_DeletionQueue;
+    Settings                    m_Settings;
+    DeviceMemoryPool            m_MemoryPool;
+
+    std::vector<Texture>        m_Textures;
+    std::vector<TextureHandle>  m_FreeHandles;      // destroyed textures, for new ones to reuse
+    BindlessHeap*               m_BindlessHeap = nullptr;       // the one heap textures are registered with
+
+    VkBuffer                    m_StagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory              m_StagingMemory = VK_NULL_HANDLE;
+    std::byte*                  m_StagingMapped = nullptr;
+    VkDeviceSize                m_StagingHead = 0;              // where the next upload goes, if it fits
+    std::deque<StagingRange>    m_StagingRanges;                // oldest first, so they sit in ring order
+
+    VkCommandBuffer             m_Batch = VK_NULL_HANDLE;       // recording, not yet submitted
+    uint64_t                    m_BatchBytes = 0;
+    uint32_t                    m_BatchQuery = ~0u;             // its timestamps, ~0u if it isn't timed
+
+    std::deque<PendingFree>     m_PendingFrees;
+    VkQueryPool                 m_QueryPool = VK_NULL_HANDLE;
+    uint32_t                    m_NextQuery = 0;                // the next batch's pair, used round-robin
+    std::deque<TimedBatch>      m_TimedBatches;                 // submitted, not read back yet
+
+    Stats                       m_Stats;
+};
+#endif
@@ -0,0 +1,131 @@
+#if VK_AVAILABLE
+#include "VkTimelineQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+TimelineQueue::TimelineQueue(VkDevice device, VkQueue queue)
+    : m_Device(device),
+    m_Queue(queue)
+{
+    VkSemaphoreTypeCreateInfo timelineInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = m_FenceValue
+    };
+    VkSemaphoreCreateInfo semaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timelineInfo
+    };
+    VK_CHECK(vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Semaphore));
+}
+
+TimelineQueue::~TimelineQueue()
+{
+    // the device must be idle, like for any other object
+    vkDestroySemaphore(m_Device, m_Semaphore, nullptr);
+}
+
+uint64_t TimelineQueue::Submit(std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits, std::span<const VkSemaphore> binarySignals)
+{
+    // the arrays are only needed until vkQueueSubmit returns, keep them on the stack unless there are a lot of semaphores
+    std::array<std::byte, 512> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    std::pmr::vector<VkSemaphore> waitSemaphores(&scratch);
+    std::pmr::vector<uint64_t> waitValues(&scratch);
+    std::pmr::vector<VkPipelineStageFlags> waitStages(&scratch);
+    waitSemaphores.reserve(waits.size());
+    waitValues.reserve(waits.size());
+    waitStages.reserve(waits.size());
+    for (const auto& wait : waits)
+    {
+        waitSemaphores.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stage);
+    }
+
+    // the timeline goes last, the values for binary semaphores are ignored
+    uint64_t fenceValue = ++m_FenceValue;
+    std::pmr::vector<VkSemaphore> signalSemaphores(&scratch);
+    std::pmr::vector<uint64_t> signalValues(&scratch);
+    signalSemaphores.reserve(binarySignals.size() + 1);
+    signalValues.reserve(binarySignals.size() + 1);
+    signalSemaphores.assign(binarySignals.begin(), binarySignals.end());
+    signalValues.assign(binarySignals.size(), 0);
+    signalSemaphores.push_back(m_Semaphore);
+    signalValues.push_back(fenceValue);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+        .pWaitSemaphoreValues = waitValues.data(),
+        .signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size()),
+        .pSignalSemaphoreValues = signalValues.data()
+    };
+    VkSubmitInfo submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+        .pWaitSemaphores = waitSemaphores.data(),
+        .pWaitDstStageMask = waitStages.data(),
+        .commandBufferCount = static_cast<uint32_t>(commandBuffers.size()),
+        .pCommandBuffers = commandBuffers.data(),
+        .signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size()),
+        .pSignalSemaphores = signalSemaphores.data()
+    };
+    VK_CHECK(vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    return fenceValue;
+}
+
+uint64_t TimelineQueue::Signal()
+{
+    // an empty submission still signals once everything before it on the queue is done
+    return Submit({});
+}
+
+void TimelineQueue::UpdateCompletedValue(uint64_t value)
+{
+    // release, so a thread that sees the value through the cache also sees what the thread that learned it did
+    uint64_t current = m_CompletedValue.load(std::memory_order_relaxed);
+    while (current < value && !m_CompletedValue.compare_exchange_weak(current, value, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t TimelineQueue::GetCompletedValue()
+{
+    uint64_t value;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_Device, m_Semaphore, &value));
+    UpdateCompletedValue(value);
+    return std::max(value, m_CompletedValue.load(std::memory_order_acquire));
+}
+
+bool TimelineQueue::IsFenceComplete(uint64_t fenceValue)
+{
+    return m_CompletedValue.load(std::memory_order_acquire) >= fenceValue || GetCompletedValue() >= fenceValue;
+}
+
+void TimelineQueue::WaitForFenceValue(uint64_t fenceValue)
+{
+    if (!IsFenceComplete(fenceValue))
+    {
+        VkSemaphoreWaitInfo waitInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &m_Semaphore,
+            .pValues = &fenceValue
+        };
+        VK_CHECK(vkWaitSemaphores(m_Device, &waitInfo, std::numeric_limits<uint64_t>::max()));
+        UpdateCompletedValue(fenceValue);
+    }
+}
+
+void TimelineQueue::Flush()
+{
+    WaitForFenceValue(Signal());
+}
+#endif
@@ -0,0 +1,64 @@
+/**
+ * Wrapper for a VkQueue that tracks GPU progress with a timeline semaphore, the Vulkan counterpart of the D3D12 CommandQueue.
+ * Every submission signals the next value of a single counter, so the CPU can tell whether any earlier submission
+ * has finished with one comparison, instead of keeping a fence per frame. Other queues can wait on the same values.
+ */
+
+#pragma once
+#if VK_AVAILABLE
+
+#include "VkCommon.hpp"
+
+#include <atomic>   // For std::atomic
+#include <cstdint>  // For uint64_t
+#include <span>     // For std::span
+
+class TimelineQueue
+{
+public:
+    // Something a submission has to wait for. Binary semaphores ignore value
+    struct Wait
+    {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stage;
+    };
+
+    TimelineQueue(VkDevice device, VkQueue queue);
+    virtual ~TimelineQueue();
+
+    // Submit command buffers, also signalling any binary semaphores (for presentation) when they finish.
+    // Returns the fence value to wait for for these command buffers.
+    uint64_t Submit(std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits = {}, std::span<const VkSemaphore> binarySignals = {});
+
+    uint64_t Signal();
+    // These may be called from any thread, the command buffer pool checks fences from whichever thread records
+    bool IsFenceComplete(uint64_t fenceValue);
+    void WaitForFenceValue(uint64_t fenceValue);
+    void Flush();
+
+    // The highest value the GPU has reached, everything submitted up to it is done
+    uint64_t GetCompletedValue();
+
+    // The value of the most recent submission
+    uint64_t GetLastSignaledValue() const {
+        return m_FenceValue;
+    }
+    VkSemaphore GetSemaphore() const {
+        return m_Semaphore;
+    }
+    VkQueue GetVkQueue() const {
+        return m_Queue;
+    }
+
+private:
+    // raise the cached completed value to at least value, never lowering it when threads race
+    void UpdateCompletedValue(uint64_t value);
+
+    VkDevice                m_Device;
+    VkQueue                 m_Queue;
+    VkSemaphore             m_Semaphore;
+    uint64_t                m_FenceValue = 0;
+    std::atomic<uint64_t>   m_CompletedValue = 0;   // cached, so checks for work known to be done don't call into the driver
+};
+#endif
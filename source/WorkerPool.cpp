@@ -0,0 +1,90 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t threadCount)
+{
+    for (uint32_t i = 1; i < std::max(threadCount, 1u); i++)
+    {
+        m_Threads.emplace_back(&WorkerPool::WorkerMain, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkReady.notify_all();
+    for (auto& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::ParallelFor(uint32_t jobCount, const std::function<void(uint32_t job)>& job)
+{
+    if (jobCount == 0)
+    {
+        return;
+    }
+    // not worth waking anyone for
+    if (jobCount == 1 || m_Threads.empty())
+    {
+        for (uint32_t i = 0; i < jobCount; i++)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Job = &job;
+        m_JobCount = jobCount;
+        m_NextJob.store(0, std::memory_order_relaxed);
+        m_BusyWorkers = static_cast<uint32_t>(m_Threads.size());
+        m_Generation++;
+    }
+    m_WorkReady.notify_all();
+    RunJobs();
+
+    // every job has been taken once the caller runs out, but workers may still be finishing theirs
+    std::unique_lock lock(m_Mutex);
+    m_WorkDone.wait(lock, [this] { return m_BusyWorkers == 0; });
+    m_Job = nullptr;
+}
+
+void WorkerPool::WorkerMain()
+{
+    uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_WorkReady.wait(lock, [&] { return m_Stop || m_Generation != seenGeneration; });
+            if (m_Stop)
+            {
+                return;
+            }
+            seenGeneration = m_Generation;
+        }
+        RunJobs();
+        {
+            std::lock_guard lock(m_Mutex);
+            if (--m_BusyWorkers == 0)
+            {
+                m_WorkDone.notify_one();
+            }
+        }
+    }
+}
+
+void WorkerPool::RunJobs()
+{
+    for (uint32_t i = m_NextJob.fetch_add(1, std::memory_order_relaxed); i < m_JobCount; i = m_NextJob.fetch_add(1, std::memory_order_relaxed))
+    {
+        (*m_Job)(i);
+    }
+}
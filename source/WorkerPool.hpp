@@ -0,0 +1,50 @@
+/**
+ * A fixed set of worker threads for splitting CPU work across cores.
+ * ParallelFor hands out job indices from an atomic counter, so threads that finish early
+ * take more jobs and uneven jobs still balance out. The calling thread works too, and the
+ * call returns once every job has run, so work can be split into phases without extra synchronization.
+ * Only one ParallelFor runs at a time, and jobs must not start another one.
+ */
+
+#pragma once
+
+#include <atomic>               // For std::atomic
+#include <condition_variable>   // For std::condition_variable
+#include <cstdint>              // For uint32_t
+#include <functional>           // For std::function
+#include <mutex>                // For std::mutex
+#include <thread>               // For std::thread
+#include <vector>               // For std::vector
+
+class WorkerPool
+{
+public:
+    // threadCount includes the thread calling ParallelFor, so 1 runs everything inline
+    explicit WorkerPool(uint32_t threadCount = std::thread::hardware_concurrency());
+    virtual ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Run job(i) for every i below jobCount, on whichever threads get to it first.
+    void ParallelFor(uint32_t jobCount, const std::function<void(uint32_t job)>& job);
+
+    uint32_t GetThreadCount() const {
+        return static_cast<uint32_t>(m_Threads.size()) + 1;
+    }
+
+private:
+    void WorkerMain();
+    void RunJobs();
+
+    std::vector<std::thread>    m_Threads;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_WorkReady;
+    std::condition_variable     m_WorkDone;
+    const std::function<void(uint32_t)>* m_Job = nullptr;
+    uint32_t                    m_JobCount = 0;
+    std::atomic<uint32_t>       m_NextJob = 0;
+    uint64_t                    m_Generation = 0;   // bumped for every ParallelFor, so workers can tell new work apart
+    uint32_t                    m_BusyWorkers = 0;  // still inside the current ParallelFor
+    bool                        m_Stop = false;
+};
@@ -1,20 +1,164 @@
 #include "App.hpp"
+#include "BlockCompression.hpp"
+#include "FenceRecycler.hpp"
+#include "FrameArena.hpp"
+#include "FrameWriter.hpp"
+#include "Meshlet.hpp"
+#include "MeshSimplifier.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "TextureCooker.hpp"
+#include <algorithm>
 #include <memory>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
 
 using namespace std;
 
-int main(int argc, char** argv) {
+template<typename T>
+static std::unique_ptr<AppBase> makeApp() {
+    return std::make_unique<T>();
+}
 
-    std::unique_ptr<AppBase> app;
+struct Backend {
+    std::string_view name;
+    std::unique_ptr<AppBase>(*create)();
+};
 
-#if !DX12_AVAILABLE
-    app = std::make_unique<DxApp>();
-#elif VK_AVAILABLE
-    app = std::make_unique<VkApp>();
-#elif MTL_AVAILABLE
-    app = std::make_unique<MTLApp>();
+// every backend built into this binary, the platform's native API first.
+// The null backend is always there, for machines without a GPU API at all
+static constexpr Backend backends[] = {
+#if DX12_AVAILABLE
+    {"d3d12", makeApp<DxApp>},
+#endif
+#if VK_AVAILABLE
+    {"vulkan", makeApp<VkApp>},
 #endif
+#if MTL_AVAILABLE
+    {"metal", makeApp<MTLApp>},
+#endif
+    {"null", makeApp<NullApp>},
+};
+
+static void printBackends() {
+    std::cout << "Available backends:";
+    for (const auto& backend : backends) {
+        std::cout << " " << backend.name;
+    }
+    std::cout << std::endl;
+}
+
+// --backend=name, or the GFX_BACKEND environment variable, or the first available
+static const Backend* selectBackend() {
+    std::optional<std::string_view> requested = CommandLine::GetValue("backend");
+    if (!requested) {
+        if (auto env = std::getenv("GFX_BACKEND")) {
+            requested = env;
+        }
+    }
+    if (!requested) {
+        return &backends[0];
+    }
+    for (const auto& backend : backends) {
+        if (backend.name == *requested) {
+            return &backend;
+        }
+    }
+    std::cout << std::format("Backend '{}' is not available", *requested) << std::endl;
+    printBackends();
+    return nullptr;
+}
+
+// scenes and ways of rendering them only the Vulkan backend has. --compare runs every backend on the same scene the
+// same way, so it can't take these: bindless and dynamic resolution change what the GPU does, capture adds a copy
+// and a writer thread to every frame
+static constexpr std::string_view vulkanOnlyOptions[] = {
+    "overdraw", "depth-prepass", "occlusion", "meshlets", "lod", "textures", "particles",
+    "bindless", "dynres", "capture", "capture-compare",
+};
 
+static void printTimings(std::string_view name, const FrameTimings& timings) {
+    auto print = [name](const char* what, const FrameTimings::Summary& summary) {
+        std::cout << std::format("{:<8} {:<7} {:>7} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}",
+            name, what, summary.frames, summary.averageMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs) << std::endl;
+    };
+    print("submit", timings.SummarizeSubmits());
+    print("frame", timings.SummarizeFrames());
+}
+
+static void printTimingsHeader() {
+    std::cout << std::format("{:<8} {:<7} {:>7} {:>10} {:>10} {:>10} {:>10} {:>10}", "backend", "ms", "frames", "average", "p50", "p95", "p99", "max") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    CommandLine::Init(argc, argv);
+
+    // CPU-only modes that don't need a window or a GPU
+    if (CommandLine::HasFlag("bench-recycler")) {
+        return RunFenceRecyclerBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-arena")) {
+        return RunFrameArenaBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-occlusion")) {
+        return RunSoftwareOcclusionBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-meshlets")) {
+        return RunMeshletBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-lod")) {
+        return RunMeshSimplifierBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-bc")) {
+        return RunBlockCompressionBenchmark();
+    }
+    if (CommandLine::HasFlag("bench-capture")) {
+        return RunFrameWriterBenchmark();
+    }
+    if (CommandLine::GetValue("cook")) {
+        return RunTextureCooker();
+    }
+
+    // run the same scene on every backend in turn, and compare their timings side by side
+    if (CommandLine::HasFlag("compare")) {
+        for (auto option : vulkanOnlyOptions) {
+            if (CommandLine::HasFlag(option)) {
+                std::cout << std::format("--{} is Vulkan only, --compare draws the same scene the same way on every backend (use --draws=N to load it)", option) << std::endl;
+                return 1;
+            }
+        }
+        std::vector<std::pair<std::string_view, FrameTimings>> results;
+        int exitCode = 0;
+        for (const auto& backend : backends) {
+            std::cout << std::format("Running {}", backend.name) << std::endl;
+            auto app = backend.create();
+            if (app->frameLimit == 0) {
+                app->frameLimit = 600;      // windows would otherwise stay open until closed
+            }
+            if (app->warmupFrames == 0) {
+                app->warmupFrames = 60;     // skip startup, pipeline creation and the first presents
+            }
+            app->Run();
+            results.emplace_back(backend.name, app->getTimings());
+            exitCode = std::max(exitCode, app->exitCode);
+        }
+        printTimingsHeader();
+        for (const auto& [name, timings] : results) {
+            printTimings(name, timings);
+        }
+        return exitCode;
+    }
+
+    auto backend = selectBackend();
+    if (!backend) {
+        return 1;
+    }
+    auto app = backend->create();
     app->Run();
-    return 0;
+
+    printTimingsHeader();
+    printTimings(backend->name, app->getTimings());
+    return app->exitCode;
 }
@@ -0,0 +1,23 @@
+#version 450
+
+// LOD scene: every level is drawn instanced, each instance placed by its own position.
+// The level rides along in w so meshlet.frag colours each level differently
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inInstance;    // position, and the level in w
+
+// must match LodConstants in VkApp.cpp
+layout(push_constant) uniform Constants {
+    mat4 view;
+    mat4 projection;
+} constants;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outLevel;
+
+void main() {
+    gl_Position = constants.projection * constants.view * vec4(inPosition + inInstance.xyz, 1.0);
+    outNormal = inNormal;
+    outLevel = uint(inInstance.w);
+}
@@ -0,0 +1,12 @@
+#version 450
+
+// Meshlet scene: every meshlet gets its own colour, so the clusters show
+layout(location = 0) in vec3 normal;
+layout(location = 1) flat in uint meshlet;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 base = fract(vec3(0.37, 0.61, 0.83) * float(meshlet + 1));
+    float light = 0.3 + 0.7 * max(dot(normalize(normal), normalize(vec3(0.4, 0.8, 0.3))), 0.0);
+    outColor = vec4(base * light, 1.0);
+}
@@ -0,0 +1,106 @@
+#version 450
+
+// Meshlet scene without mesh shaders: every meshlet of every instance is an instance of 124 triangles, pulled
+// from the same buffers the mesh shader reads. Meshlets that would be culled, and the triangles past the end of
+// a meshlet, collapse to a point and are thrown away before rasterization
+
+// must match Meshlet and MeshletBounds in Meshlet.hpp, and MeshVertex in Mesh.hpp
+struct Meshlet {
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+struct Bounds {
+    vec3 center;
+    float radius;
+    vec3 coneApex;
+    float coneCutoff;
+    vec3 coneAxis;
+    float padding;
+};
+struct Vertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+layout(std430, binding = 0) readonly buffer Meshlets {
+    Meshlet meshlets[];
+};
+layout(std430, binding = 1) readonly buffer MeshletBounds {
+    Bounds bounds[];
+};
+layout(std430, binding = 2) readonly buffer MeshletVertices {
+    uint meshletVertices[];
+};
+layout(std430, binding = 3) readonly buffer MeshletTriangles {
+    uint meshletTriangles[];
+};
+layout(std430, binding = 5) readonly buffer Vertices {
+    Vertex vertices[];
+};
+
+// must match MeshletConstants in VkApp.cpp
+layout(push_constant) uniform Constants {
+    mat4 view;
+    float p00;
+    float p11;              // flipped back so y points up
+    float zNear;
+    uint meshletCount;
+    vec3 cameraPosition;
+    uint instancesPerRow;
+    float instanceSpacing;
+    uint culling;
+} constants;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outMeshlet;
+
+vec3 instanceOffset(uint instance) {
+    vec2 cell = vec2(instance % constants.instancesPerRow, instance / constants.instancesPerRow);
+    vec2 position = (cell - 0.5 * float(constants.instancesPerRow - 1)) * constants.instanceSpacing;
+    return vec3(position.x, 0.0, position.y);
+}
+
+bool inFrustum(vec3 center, float radius) {
+    vec2 slope = 1.0 / vec2(constants.p00, constants.p11);
+    vec2 distances = abs(center.xy) - center.z * slope;
+    return center.z + radius > constants.zNear && all(lessThanEqual(distances, radius * sqrt(1.0 + slope * slope)));
+}
+
+uint triangleIndex(uint byteOffset) {
+    return (meshletTriangles[byteOffset / 4] >> ((byteOffset % 4) * 8)) & 0xff;
+}
+
+void main() {
+    uint meshletIndex = gl_InstanceIndex % constants.meshletCount;
+    uint instance = gl_InstanceIndex / constants.meshletCount;
+    Meshlet meshlet = meshlets[meshletIndex];
+    vec3 offset = instanceOffset(instance);
+    uint triangle = gl_VertexIndex / 3;
+
+    bool visible = triangle < meshlet.triangleCount;
+    if (visible && constants.culling != 0) {
+        // every vertex of the meshlet comes to the same answer
+        Bounds meshletBounds = bounds[meshletIndex];
+        vec3 center = (constants.view * vec4(meshletBounds.center + offset, 1.0)).xyz;
+        center.z = -center.z;
+        visible = inFrustum(center, meshletBounds.radius) &&
+            dot(normalize(meshletBounds.coneApex + offset - constants.cameraPosition), meshletBounds.coneAxis) < meshletBounds.coneCutoff;
+    }
+    if (!visible) {
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        outNormal = vec3(0.0);
+        outMeshlet = 0;
+        return;
+    }
+
+    uint local = triangleIndex((meshlet.triangleOffset + triangle) * 3 + gl_VertexIndex % 3);
+    Vertex vertex = vertices[meshletVertices[meshlet.vertexOffset + local]];
+    vec3 position = vec3(vertex.position[0], vertex.position[1], vertex.position[2]) + offset;
+    vec3 viewPosition = (constants.view * vec4(position, 1.0)).xyz;
+    gl_Position = vec4(viewPosition.x * constants.p00, -viewPosition.y * constants.p11, constants.zNear, -viewPosition.z);
+    outNormal = vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+    outMeshlet = gl_InstanceIndex;
+}
@@ -0,0 +1,38 @@
+#version 450
+
+// Occlusion scene: each object is a camera facing quad filling the middle of its bounding sphere,
+// drawn through the list the culling shader wrote. firstInstance says which phase's half of the list to read
+
+// must match OcclusionObject in VkApp.cpp
+struct Object {
+    vec4 sphere;
+};
+
+layout(std430, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+layout(std430, binding = 1) readonly buffer VisibleIndices {
+    uint visibleIndices[];
+};
+
+layout(push_constant) uniform Constants {
+    mat4 view;
+    mat4 projection;        // reverse-Z, infinite far plane
+} constants;
+
+layout(location = 0) flat out uint layer;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    uint index = visibleIndices[gl_InstanceIndex];
+    vec4 sphere = objects[index].sphere;
+    vec4 center = constants.view * vec4(sphere.xyz, 1.0);
+    // inside the sphere, so the culling bounds always contain what is drawn
+    vec2 offset = corners[gl_VertexIndex] * sphere.w * 0.7;
+    gl_Position = constants.projection * (center + vec4(offset, 0.0, 0.0));
+    layer = index;
+}
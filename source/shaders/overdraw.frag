@@ -0,0 +1,16 @@
+#version 450
+
+// deliberately expensive, so every fragment that is shaded and then covered up shows in the frame time.
+// It doesn't write depth or discard, so the depth test can run before it
+layout(location = 0) flat in uint layer;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 p = gl_FragCoord.xy * 0.01;
+    float value = 0.0;
+    for (int i = 0; i < 64; i++) {
+        value += sin(p.x * float(i) + float(layer)) * cos(p.y * float(i));
+    }
+    vec3 base = fract(vec3(0.37, 0.61, 0.83) * float(layer + 1));
+    outColor = vec4(base * (0.75 + 0.25 * sin(value)), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 450
+
+// Overdraw benchmark: every instance is a quad covering most of the screen, farther away the lower its index,
+// so drawing them in order goes back to front and every layer passes the depth test unless a pre-pass ran first.
+// The pre-pass and the main pass both use this shader. invariant makes sure they compute exactly the same depth,
+// which the main pass's EQUAL test relies on
+
+layout(push_constant) uniform Constants {
+    mat4 projection;        // reverse-Z, infinite far plane
+    uint layerCount;
+} constants;
+
+layout(location = 0) flat out uint layer;
+
+invariant gl_Position;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    uint i = gl_InstanceIndex;
+    float distance = 2.0 + float(constants.layerCount - 1 - i) * 0.25;
+
+    // scaled with distance so each layer covers about the same part of the screen, and nudged so the edges don't line up
+    vec2 offset = vec2(sin(float(i) * 1.7), cos(float(i) * 2.3)) * 0.1;
+    vec2 xy = (corners[gl_VertexIndex] * 0.9 + offset) * distance;
+
+    gl_Position = constants.projection * vec4(xy, -distance, 1.0);
+    layer = i;
+}
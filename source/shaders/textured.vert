@@ -0,0 +1,29 @@
+#version 450
+
+// Texture scene: one quad per texture, laid out in a grid on the ground stretching away from the camera.
+// The far ones cover few pixels, so they sample the small mips
+
+// must match TextureConstants in VkApp.cpp
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    uint instance;
+    uint texture;
+    uint instancesPerRow;
+    float spacing;
+} constants;
+
+layout(location = 0) out vec2 outUV;
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex];
+    vec2 cell = vec2(constants.instance % constants.instancesPerRow, constants.instance / constants.instancesPerRow);
+    // a small gap between quads, centred in x and receding in -z
+    vec2 position = (cell + corner * 0.9 - vec2(0.5 * float(constants.instancesPerRow), 0.0)) * constants.spacing;
+    gl_Position = constants.viewProjection * vec4(position.x, 0.0, -position.y, 1.0);
+    outUV = corner * 2.0;       // repeated, so the clamping samplers show
+}
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Texture scene through the bindless heap, the texture is picked by the handle in the push constants
+layout(set = 0, binding = 1) uniform sampler2D images[];
+
+// must match TextureConstants in VkApp.cpp
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    uint instance;
+    uint texture;
+    uint instancesPerRow;
+    float spacing;
+} constants;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(images[constants.texture], uv);
+}
@@ -0,0 +1,40 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Texture scene with streaming: samples through the bindless heap like textured_bindless.frag, and writes feedback,
+// the finest mip level each texture is sampled at, for the streamer to load
+layout(set = 0, binding = 1) uniform sampler2D images[];
+
+// per texture, cleared to ~0u on the CPU before the frame
+layout(set = 1, binding = 0) buffer Feedback {
+    uint requestedLevels[];
+};
+
+// must match TextureConstants in VkApp.cpp
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    uint instance;
+    uint texture;
+    uint instancesPerRow;
+    float spacing;
+    uint residentLevel;     // the finest level the streamer has resident, which is the image's level 0
+    uint feedbackPhase;     // which pixel of each 4x4 writes feedback this frame
+} constants;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(images[constants.texture], uv);
+
+    // one pixel in 16 writes feedback, a different one each frame, which keeps the atomics down and still gets
+    // round every pixel. The LOD is relative to the resident image, and below 0 where it needs finer levels
+    uvec2 pixel = uvec2(gl_FragCoord.xy) & 3u;
+    if (pixel.y * 4u + pixel.x == constants.feedbackPhase) {
+        float lod = textureQueryLod(images[constants.texture], uv).y + float(constants.residentLevel);
+        uint level = uint(max(floor(lod), 0.0));
+        if (level < requestedLevels[constants.instance]) {
+            atomicMin(requestedLevels[constants.instance], level);
+        }
+    }
+}
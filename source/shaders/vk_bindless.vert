@@ -0,0 +1,29 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// same data as vk.vert, but read out of the bindless heap
+layout(set = 0, binding = 0) readonly buffer UniformBufferObject{
+    float time;
+} buffers[];
+
+// must match BindlessDrawConstants in VkApp.cpp
+layout(push_constant) uniform DrawHandles{
+    uint uniformBuffer;
+} handles;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+
+    float anim = buffers[handles.uniformBuffer].time / 100;
+    mat2 rotmat = {
+		vec2(cos(anim),-sin(anim)),
+		vec2(sin(anim), cos(anim))
+	};
+
+    gl_Position = vec4(rotmat * inPosition, 0.0, 1.0);
+    fragColor = inColor;
+}